@@ -422,6 +422,20 @@ APR_DECLARE(void) apr_pool_mutex_set(apr_pool_t *pool,
 									 apr_thread_mutex_t *mutex);
 #endif
 
+/**
+ * Attach one pointer for the pool's owner, found without the user data hash.
+ * @param pool The pool
+ * @param data The pointer, usually allocated from the pool itself
+ * @remark Reset to NULL when the pool is cleared, like the user data.
+ */
+APR_DECLARE(void) apr_pool_owner_data_set(apr_pool_t *pool, void *data);
+
+/**
+ * Get the pointer set with apr_pool_owner_data_set().
+ * @param pool The pool
+ */
+APR_DECLARE(void *) apr_pool_owner_data_get(apr_pool_t *pool);
+
 
 /*
  * User data management
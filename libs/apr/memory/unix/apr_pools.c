@@ -449,6 +449,7 @@ struct apr_pool_t {
     apr_abortfunc_t       abort_fn;
     apr_hash_t           *user_data;
     const char           *tag;
+	void                 *owner_data;
 #if APR_HAS_THREADS
 	apr_thread_mutex_t   *user_mutex;
 #endif
@@ -708,6 +709,7 @@ APR_DECLARE(void) apr_pool_clear(apr_pool_t *pool)
 
     /* Clear the user data. */
     pool->user_data = NULL;
+	pool->owner_data = NULL;
 
     /* Find the node attached to the pool structure, reset it, make
      * it the active node and free the rest of the nodes.
@@ -737,6 +739,16 @@ APR_DECLARE(void) apr_pool_mutex_set(apr_pool_t *pool,
 }
 #endif
 
+APR_DECLARE(void) apr_pool_owner_data_set(apr_pool_t *pool, void *data)
+{
+    pool->owner_data = data;
+}
+
+APR_DECLARE(void *) apr_pool_owner_data_get(apr_pool_t *pool)
+{
+    return pool->owner_data;
+}
+
 APR_DECLARE(void) apr_pool_destroy(apr_pool_t *pool)
 {
     apr_memnode_t *active;
@@ -845,6 +857,7 @@ APR_DECLARE(apr_status_t) apr_pool_create_ex(apr_pool_t **newpool,
     pool->subprocesses = NULL;
     pool->user_data = NULL;
     pool->tag = NULL;
+	pool->owner_data = NULL;
 #if APR_HAS_THREADS
 	pool->user_mutex = NULL;
 #endif
@@ -1422,6 +1435,7 @@ static void pool_clear_debug(apr_pool_t *pool, const char *file_line)
 
     /* Clear the user data. */
     pool->user_data = NULL;
+	pool->owner_data = NULL;
 
     /* Free the blocks, scribbling over them first to help highlight
      * use-after-free issues. */
@@ -111,10 +111,11 @@ static float dtmf_col[] = {1209.0f, 1336.0f, 1477.0f, 1633.0f};
 
 static char dtmf_positions[] = "123A" "456B" "789C" "*0#D";
 
-static void goertzel_init(teletone_goertzel_state_t *goertzel_state, teletone_detection_descriptor_t *tdesc) {
-	goertzel_state->v2 = goertzel_state->v3 = 0.0;
-	goertzel_state->fac = tdesc->fac;
-}
+/* lanes of the dtmf goertzel bank */
+#define DTMF_ROW(x) (x)
+#define DTMF_COL(x) (GRID_FACTOR + (x))
+#define DTMF_ROW_2ND(x) (GRID_FACTOR * 2 + (x))
+#define DTMF_COL_2ND(x) (GRID_FACTOR * 3 + (x))
 
 TELETONE_API(void) teletone_goertzel_update(teletone_goertzel_state_t *goertzel_state,
 							  int16_t sample_buffer[],
@@ -129,11 +130,39 @@ TELETONE_API(void) teletone_goertzel_update(teletone_goertzel_state_t *goertzel_
 		goertzel_state->v3 = (float)(goertzel_state->fac*goertzel_state->v2 - v1 + sample_buffer[i]);
 	}
 }
+
+TELETONE_API(void) teletone_goertzel_bank_update(teletone_goertzel_bank_t *bank,
+								   int16_t sample_buffer[],
+								   int samples)
+{
+	int i, g, x;
+	float v1, famp;
+
+	/* lanes are stepped in fixed size groups with no dependency between them so the compiler can run each group as simd */
+	for (i = 0;	 i < samples;  i++) {
+		famp = sample_buffer[i];
+
+		for (g = 0; g < bank->lanes; g += TELETONE_GOERTZEL_GROUP) {
+			for (x = g; x < g + TELETONE_GOERTZEL_GROUP; x++) {
+				v1 = bank->v2[x];
+				bank->v2[x] = bank->v3[x];
+				bank->v3[x] = (float)(bank->fac[x]*bank->v2[x] - v1 + famp);
+			}
+		}
+	}
+}
+
+static void goertzel_bank_reset(teletone_goertzel_bank_t *bank)
+{
+	memset(bank->v2, 0, sizeof(bank->v2));
+	memset(bank->v3, 0, sizeof(bank->v3));
+}
 #ifdef _MSC_VER
 #pragma warning(disable:4244)
 #endif
 
 #define teletone_goertzel_result(gs) (double)(((gs)->v3 * (gs)->v3 + (gs)->v2 * (gs)->v2 - (gs)->v2 * (gs)->v3 * (gs)->fac))
+#define teletone_goertzel_bank_result(b, x) (double)(((b)->v3[x] * (b)->v3[x] + (b)->v2[x] * (b)->v2[x] - (b)->v2[x] * (b)->v3[x] * (b)->fac[x]))
 
 TELETONE_API(void) teletone_dtmf_detect_init (teletone_dtmf_detect_state_t *dtmf_detect_state, int sample_rate)
 {
@@ -141,6 +170,7 @@ TELETONE_API(void) teletone_dtmf_detect_init (teletone_dtmf_detect_state_t *dtmf
 	float theta;
 
 	dtmf_detect_state->hit1 = dtmf_detect_state->hit2 = 0;
+	memset(&dtmf_detect_state->bank, 0, sizeof(dtmf_detect_state->bank));
 
 	for (i = 0;	 i < GRID_FACTOR;  i++) {
 		theta = (float)(M_TWO_PI*(dtmf_row[i]/(float)sample_rate));
@@ -155,13 +185,14 @@ TELETONE_API(void) teletone_dtmf_detect_init (teletone_dtmf_detect_state_t *dtmf
 		theta = (float)(M_TWO_PI*(dtmf_col[i]*2.0/(float)sample_rate));
 		dtmf_detect_col_2nd[i].fac = (float)(2.0*cos(theta));
 	
-		goertzel_init (&dtmf_detect_state->row_out[i], &dtmf_detect_row[i]);
-		goertzel_init (&dtmf_detect_state->col_out[i], &dtmf_detect_col[i]);
-		goertzel_init (&dtmf_detect_state->row_out2nd[i], &dtmf_detect_row_2nd[i]);
-		goertzel_init (&dtmf_detect_state->col_out2nd[i], &dtmf_detect_col_2nd[i]);
+		dtmf_detect_state->bank.fac[DTMF_ROW(i)] = dtmf_detect_row[i].fac;
+		dtmf_detect_state->bank.fac[DTMF_COL(i)] = dtmf_detect_col[i].fac;
+		dtmf_detect_state->bank.fac[DTMF_ROW_2ND(i)] = dtmf_detect_row_2nd[i].fac;
+		dtmf_detect_state->bank.fac[DTMF_COL_2ND(i)] = dtmf_detect_col_2nd[i].fac;
 	
 		dtmf_detect_state->energy = 0.0;
 	}
+	dtmf_detect_state->bank.lanes = GRID_FACTOR * 4;
 	dtmf_detect_state->current_sample = 0;
 	dtmf_detect_state->detected_digits = 0;
 	dtmf_detect_state->lost_digits = 0;
@@ -196,6 +227,8 @@ TELETONE_API(void) teletone_multi_tone_init(teletone_multi_tone_t *mt, teletone_
 		mt->hit_factor = 2;
 	}
 
+	memset(&mt->bank, 0, sizeof(mt->bank));
+
 	for(x = 0; x < TELETONE_MAX_TONES; x++) {
 		if ((int) map->freqs[x] == 0) {
 			break;
@@ -203,10 +236,12 @@ TELETONE_API(void) teletone_multi_tone_init(teletone_multi_tone_t *mt, teletone_
 		mt->tone_count++;
 		theta = (float)(M_TWO_PI*(map->freqs[x]/(float)mt->sample_rate));
 		mt->tdd[x].fac = (float)(2.0 * cos(theta));
-		goertzel_init (&mt->gs[x], &mt->tdd[x]);
-		goertzel_init (&mt->gs2[x], &mt->tdd[x]);
+		mt->bank.fac[x] = mt->tdd[x].fac;
 	}
 
+	/* round up to whole groups, the spare lanes have no coefficient and are never read */
+	mt->bank.lanes = (mt->tone_count + TELETONE_GOERTZEL_GROUP - 1) / TELETONE_GOERTZEL_GROUP * TELETONE_GOERTZEL_GROUP;
+
 }
 
 TELETONE_API(int) teletone_multi_tone_detect (teletone_multi_tone_t *mt,
@@ -214,7 +249,7 @@ TELETONE_API(int) teletone_multi_tone_detect (teletone_multi_tone_t *mt,
 								int samples)
 {
 	int sample, limit = 0, j, x = 0;
-	float v1, famp;
+	float famp;
 	float eng_sum = 0, eng_all[TELETONE_MAX_TONES] = {0.0};
 	int gtest = 0, see_hit = 0;
 
@@ -232,20 +267,11 @@ TELETONE_API(int) teletone_multi_tone_detect (teletone_multi_tone_t *mt,
 
 		for (j = sample;  j < limit;  j++) {
 			famp = sample_buffer[j];
-			
 			mt->energy += famp*famp;
-
-			for(x = 0; x < TELETONE_MAX_TONES && x < mt->tone_count; x++) {
-				v1 = mt->gs[x].v2;
-				mt->gs[x].v2 = mt->gs[x].v3;
-				mt->gs[x].v3 = (float)(mt->gs[x].fac * mt->gs[x].v2 - v1 + famp);
-	
-				v1 = mt->gs2[x].v2;
-				mt->gs2[x].v2 = mt->gs2[x].v3;
-				mt->gs2[x].v3 = (float)(mt->gs2[x].fac*mt->gs2[x].v2 - v1 + famp);
-			}
 		}
 
+		teletone_goertzel_bank_update(&mt->bank, sample_buffer + sample, limit - sample);
+
 		mt->current_sample += (limit - sample);
 		if (mt->current_sample < mt->min_samples) {
 			continue;
@@ -253,13 +279,14 @@ TELETONE_API(int) teletone_multi_tone_detect (teletone_multi_tone_t *mt,
 
 		eng_sum = 0;
 		for(x = 0; x < TELETONE_MAX_TONES && x < mt->tone_count; x++) {
-			eng_all[x] = (float)(teletone_goertzel_result (&mt->gs[x]));
+			eng_all[x] = (float)(teletone_goertzel_bank_result (&mt->bank, x));
 			eng_sum += eng_all[x];
 		}
 
+		/* the second filter set always carried the same coefficients as the first, so test against the bank again */
 		gtest = 0;
 		for(x = 0; x < TELETONE_MAX_TONES && x < mt->tone_count; x++) {
-			gtest += teletone_goertzel_result (&mt->gs2[x]) < eng_all[x] ? 1 : 0;
+			gtest += teletone_goertzel_bank_result (&mt->bank, x) < eng_all[x] ? 1 : 0;
 		}
 
 		if ((gtest >= 2 || gtest == mt->tone_count) && eng_sum > 42.0 * mt->energy) {
@@ -286,10 +313,7 @@ TELETONE_API(int) teletone_multi_tone_detect (teletone_multi_tone_t *mt,
 		}
 
 		/* Reinitialise the detector for the next block */
-		for(x = 0; x < TELETONE_MAX_TONES && x < mt->tone_count; x++) {
-			goertzel_init (&mt->gs[x], &mt->tdd[x]);
-			goertzel_init (&mt->gs2[x], &mt->tdd[x]);
-		}
+		goertzel_bank_reset(&mt->bank);
 
 		mt->energy = 0.0;
 		mt->current_sample = 0;
@@ -306,7 +330,6 @@ TELETONE_API(int) teletone_dtmf_detect (teletone_dtmf_detect_state_t *dtmf_detec
 	float row_energy[GRID_FACTOR];
 	float col_energy[GRID_FACTOR];
 	float famp;
-	float v1;
 	int i;
 	int j;
 	int sample;
@@ -325,46 +348,27 @@ TELETONE_API(int) teletone_dtmf_detect (teletone_dtmf_detect_state_t *dtmf_detec
 		}
 
 		for (j = sample;  j < limit;  j++) {
-			int x = 0;
 			famp = sample_buffer[j];
-			
 			dtmf_detect_state->energy += famp*famp;
-
-			for(x = 0; x < GRID_FACTOR; x++) {
-				v1 = dtmf_detect_state->row_out[x].v2;
-				dtmf_detect_state->row_out[x].v2 = dtmf_detect_state->row_out[x].v3;
-				dtmf_detect_state->row_out[x].v3 = (float)(dtmf_detect_state->row_out[x].fac*dtmf_detect_state->row_out[x].v2 - v1 + famp);
-	
-				v1 = dtmf_detect_state->col_out[x].v2;
-				dtmf_detect_state->col_out[x].v2 = dtmf_detect_state->col_out[x].v3;
-				dtmf_detect_state->col_out[x].v3 = (float)(dtmf_detect_state->col_out[x].fac*dtmf_detect_state->col_out[x].v2 - v1 + famp);
-
-				v1 = dtmf_detect_state->col_out2nd[x].v2;
-				dtmf_detect_state->col_out2nd[x].v2 = dtmf_detect_state->col_out2nd[x].v3;
-				dtmf_detect_state->col_out2nd[x].v3 = (float)(dtmf_detect_state->col_out2nd[x].fac*dtmf_detect_state->col_out2nd[x].v2 - v1 + famp);
-		
-				v1 = dtmf_detect_state->row_out2nd[x].v2;
-				dtmf_detect_state->row_out2nd[x].v2 = dtmf_detect_state->row_out2nd[x].v3;
-				dtmf_detect_state->row_out2nd[x].v3 = (float)(dtmf_detect_state->row_out2nd[x].fac*dtmf_detect_state->row_out2nd[x].v2 - v1 + famp);
-			}
-
 		}
 
+		teletone_goertzel_bank_update(&dtmf_detect_state->bank, sample_buffer + sample, limit - sample);
+
 		dtmf_detect_state->current_sample += (limit - sample);
 		if (dtmf_detect_state->current_sample < BLOCK_LEN) {
 			continue;
 		}
 		/* We are at the end of a DTMF detection block */
 		/* Find the peak row and the peak column */
-		row_energy[0] = teletone_goertzel_result (&dtmf_detect_state->row_out[0]);
-		col_energy[0] = teletone_goertzel_result (&dtmf_detect_state->col_out[0]);
+		row_energy[0] = teletone_goertzel_bank_result (&dtmf_detect_state->bank, DTMF_ROW(0));
+		col_energy[0] = teletone_goertzel_bank_result (&dtmf_detect_state->bank, DTMF_COL(0));
 
 		for (best_row = best_col = 0, i = 1;  i < GRID_FACTOR;	i++) {
-			row_energy[i] = teletone_goertzel_result (&dtmf_detect_state->row_out[i]);
+			row_energy[i] = teletone_goertzel_bank_result (&dtmf_detect_state->bank, DTMF_ROW(i));
 			if (row_energy[i] > row_energy[best_row]) {
 				best_row = i;
 			}
-			col_energy[i] = teletone_goertzel_result (&dtmf_detect_state->col_out[i]);
+			col_energy[i] = teletone_goertzel_bank_result (&dtmf_detect_state->bank, DTMF_COL(i));
 			if (col_energy[i] > col_energy[best_col]) {
 				best_col = i;
 			}
@@ -384,8 +388,8 @@ TELETONE_API(int) teletone_dtmf_detect (teletone_dtmf_detect_state_t *dtmf_detec
 			}
 			/* ... and second harmonic test */
 			if (i >= GRID_FACTOR && (row_energy[best_row] + col_energy[best_col]) > 42.0*dtmf_detect_state->energy &&
-				teletone_goertzel_result (&dtmf_detect_state->col_out2nd[best_col])*DTMF_2ND_HARMONIC_COL < col_energy[best_col] &&
-				teletone_goertzel_result (&dtmf_detect_state->row_out2nd[best_row])*DTMF_2ND_HARMONIC_ROW < row_energy[best_row]) {
+				teletone_goertzel_bank_result (&dtmf_detect_state->bank, DTMF_COL_2ND(best_col))*DTMF_2ND_HARMONIC_COL < col_energy[best_col] &&
+				teletone_goertzel_bank_result (&dtmf_detect_state->bank, DTMF_ROW_2ND(best_row))*DTMF_2ND_HARMONIC_ROW < row_energy[best_row]) {
 				hit = dtmf_positions[(best_row << 2) + best_col];
 				/* Look for two successive similar results */
 				/* The logic in the next test is:
@@ -413,12 +417,7 @@ TELETONE_API(int) teletone_dtmf_detect (teletone_dtmf_detect_state_t *dtmf_detec
 		dtmf_detect_state->hit2 = dtmf_detect_state->hit3;
 		dtmf_detect_state->hit3 = hit;
 		/* Reinitialise the detector for the next block */
-		for (i = 0;	 i < GRID_FACTOR;  i++) {
-			goertzel_init (&dtmf_detect_state->row_out[i], &dtmf_detect_row[i]);
-			goertzel_init (&dtmf_detect_state->col_out[i], &dtmf_detect_col[i]);
-			goertzel_init (&dtmf_detect_state->row_out2nd[i], &dtmf_detect_row_2nd[i]);
-			goertzel_init (&dtmf_detect_state->col_out2nd[i], &dtmf_detect_col_2nd[i]);
-		}
+		goertzel_bank_reset(&dtmf_detect_state->bank);
 		dtmf_detect_state->energy = 0.0;
 		dtmf_detect_state->current_sample = 0;
 	}
@@ -140,6 +140,17 @@ extern "C" {
 		float v3;
 		double fac;
 	} teletone_goertzel_state_t;
+
+#define TELETONE_GOERTZEL_LANES 20
+#define TELETONE_GOERTZEL_GROUP 4
+
+	/*! \brief A bank of Goertzel filters stored lane by lane so every filter is stepped in one pass over the samples */
+	typedef struct {
+		float v2[TELETONE_GOERTZEL_LANES];
+		float v3[TELETONE_GOERTZEL_LANES];
+		double fac[TELETONE_GOERTZEL_LANES];
+		int lanes;
+	} teletone_goertzel_bank_t;
 	
 	/*! \brief A container for a DTMF detection state.*/
 	typedef struct {
@@ -149,10 +160,7 @@ extern "C" {
 		int hit4;
 		int mhit;
 
-		teletone_goertzel_state_t row_out[GRID_FACTOR];
-		teletone_goertzel_state_t col_out[GRID_FACTOR];
-		teletone_goertzel_state_t row_out2nd[GRID_FACTOR];
-		teletone_goertzel_state_t col_out2nd[GRID_FACTOR];
+		teletone_goertzel_bank_t bank;
 		float energy;
 	
 		int current_sample;
@@ -176,8 +184,7 @@ extern "C" {
 		int sample_rate;
 
 		teletone_detection_descriptor_t tdd[TELETONE_MAX_TONES];
-		teletone_goertzel_state_t gs[TELETONE_MAX_TONES];
-		teletone_goertzel_state_t gs2[TELETONE_MAX_TONES];
+		teletone_goertzel_bank_t bank;
 		int tone_count;
 
 		float energy;
@@ -253,6 +260,16 @@ TELETONE_API(void) teletone_goertzel_update(teletone_goertzel_state_t *goertzel_
 								  int16_t sample_buffer[],
 								  int samples);
 
+	/*! 
+	  \brief Step every filter in a Goertzel bank through each sample in a buffer
+	  \param bank the goertzel bank to step the samples through
+	  \param sample_buffer an array aof 16 bit signed linear samples
+	  \param samples the number of samples present in sample_buffer
+	*/
+TELETONE_API(void) teletone_goertzel_bank_update(teletone_goertzel_bank_t *bank,
+									   int16_t sample_buffer[],
+									   int samples);
+
 
 
 #ifdef __cplusplus
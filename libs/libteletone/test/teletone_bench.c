@@ -0,0 +1,173 @@
+/*
+ * libteletone
+ * Copyright (C) 2005-2011, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is libteletone
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * teletone_bench.c -- DTMF detection throughput in calls per core
+ *
+ * A digit string is rendered with the teletone generator, mixed with a
+ * little deterministic noise and then fed through the detector in 20ms
+ * frames, once per simulated call leg, the way a media bug would see it.
+ * Every leg must detect exactly the digits that were generated or the
+ * program exits non-zero, so it doubles as a check that a faster detector
+ * did not change what it hears.  The result is reported as frames per
+ * second and as calls per core (one call = 50 frames per second).
+ */
+/* getopt and gettimeofday under -std=c99 */
+#define _XOPEN_SOURCE 600
+#include <libteletone.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#define FRAME_MS 20
+#define DEFAULT_DIGITS "1234567890*#ABCD"
+
+typedef struct {
+	int16_t *data;
+	int len;
+	int size;
+} bench_audio_t;
+
+static int bench_handler(teletone_generation_session_t *ts, teletone_tone_map_t *map)
+{
+	bench_audio_t *audio = (bench_audio_t *) ts->user_data;
+	int wrote = teletone_mux_tones(ts, map);
+
+	if (wrote <= 0) {
+		return 0;
+	}
+
+	if (audio->len + wrote > audio->size) {
+		audio->size = (audio->len + wrote) * 2;
+		audio->data = realloc(audio->data, audio->size * sizeof(*audio->data));
+		if (!audio->data) {
+			return -1;
+		}
+	}
+
+	memcpy(audio->data + audio->len, ts->buffer, wrote * sizeof(*audio->data));
+	audio->len += wrote;
+
+	return 0;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-d digits] [-r rate] [-l legs] [-n noise_amplitude] [-t tone_ms] [-g gap_ms]\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *digits = DEFAULT_DIGITS;
+	int rate = 8000, legs = 200, noise = 200, tone_ms = 100, gap_ms = 100;
+	int leg, i, opt, frame, frames, bad = 0;
+	teletone_generation_session_t ts;
+	bench_audio_t audio = { 0 };
+	uint32_t seed = 1;
+	struct timeval t0, t1;
+	double elapsed, fps;
+
+	while ((opt = getopt(argc, argv, "d:r:l:n:t:g:h")) != -1) {
+		switch (opt) {
+		case 'd': digits = optarg; break;
+		case 'r': rate = atoi(optarg); break;
+		case 'l': legs = atoi(optarg); break;
+		case 'n': noise = atoi(optarg); break;
+		case 't': tone_ms = atoi(optarg); break;
+		case 'g': gap_ms = atoi(optarg); break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (rate < 8000 || legs < 1 || tone_ms < 1 || gap_ms < 1 || !*digits) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	teletone_init_session(&ts, 0, bench_handler, &audio);
+	ts.rate = rate;
+	ts.channels = 1;
+	ts.duration = tone_ms * (rate / 1000);
+	ts.wait = gap_ms * (rate / 1000);
+	/* lead in so the first digit does not start on sample 0 */
+	audio.size = audio.len = gap_ms * (rate / 1000);
+	audio.data = calloc(audio.size, sizeof(*audio.data));
+	teletone_run(&ts, digits);
+	teletone_destroy_session(&ts);
+
+	if (!audio.data || !audio.len) {
+		fprintf(stderr, "generation failed\n");
+		return 1;
+	}
+
+	for (i = 0; i < audio.len; i++) {
+		int v;
+
+		seed = seed * 1103515245 + 12345;
+		v = audio.data[i] + (int) ((seed >> 16) % (2 * noise + 1)) - noise;
+		audio.data[i] = (int16_t) (v > 32767 ? 32767 : v < -32768 ? -32768 : v);
+	}
+
+	frame = FRAME_MS * (rate / 1000);
+	frames = audio.len / frame;
+
+	gettimeofday(&t0, NULL);
+
+	for (leg = 0; leg < legs; leg++) {
+		teletone_dtmf_detect_state_t dtmf;
+		char heard[256] = "";
+		int hlen = 0;
+
+		teletone_dtmf_detect_init(&dtmf, rate);
+
+		for (i = 0; i < frames; i++) {
+			teletone_dtmf_detect(&dtmf, audio.data + i * frame, frame);
+			if (hlen < (int) sizeof(heard) - 1) {
+				hlen += teletone_dtmf_get(&dtmf, heard + hlen, sizeof(heard) - 1 - hlen);
+				heard[hlen] = '\0';
+			}
+		}
+
+		if (strcmp(heard, digits)) {
+			if (!bad++) {
+				fprintf(stderr, "leg %d heard \"%s\" expected \"%s\"\n", leg, heard, digits);
+			}
+		}
+	}
+
+	gettimeofday(&t1, NULL);
+	elapsed = (t1.tv_sec - t0.tv_sec) + (t1.tv_usec - t0.tv_usec) / 1e6;
+	fps = (double) frames * legs / elapsed;
+
+	printf("%d legs x %d frames of %dms at %dhz in %.3fs\n", legs, frames, FRAME_MS, rate, elapsed);
+	printf("%.0f frames/sec, %.0f calls per core\n", fps, fps / (1000 / FRAME_MS));
+	printf("digits %s on %d of %d legs\n", bad ? "MISMATCH" : "ok", legs - bad, legs);
+
+	free(audio.data);
+
+	return bad ? 1 : 0;
+}
@@ -57,6 +57,10 @@ struct stfu_queue {
 	uint32_t wr_len;
     uint32_t last_index;
     int32_t last_jitter;
+    /* timestamp index: bucket -> first slot + 1, slot -> next slot + 1 */
+    uint32_t *ts_head;
+    uint32_t *ts_next;
+    uint32_t ts_bits;
 };
 typedef struct stfu_queue stfu_queue_t;
 
@@ -157,6 +161,47 @@ void stfu_global_set_default_logger(int level)
 
 
 
+#define STFU_TS_BUCKET(_q, _ts) ((uint32_t)((_ts) * 2654435761U) >> (32 - (_q)->ts_bits))
+
+static void stfu_n_index_link(stfu_queue_t *queue, uint32_t slot)
+{
+    uint32_t bucket = STFU_TS_BUCKET(queue, queue->array[slot].ts);
+
+    queue->ts_next[slot] = queue->ts_head[bucket];
+    queue->ts_head[bucket] = slot + 1;
+}
+
+static void stfu_n_index_unlink(stfu_queue_t *queue, uint32_t slot)
+{
+    uint32_t *np = &queue->ts_head[STFU_TS_BUCKET(queue, queue->array[slot].ts)];
+
+    while (*np) {
+        if (*np == slot + 1) {
+            *np = queue->ts_next[slot];
+            break;
+        }
+        np = &queue->ts_next[*np - 1];
+    }
+}
+
+/* (re)build the timestamp index over every slot in the array, sized to keep the chains short */
+static void stfu_n_index_build(stfu_queue_t *queue)
+{
+    uint32_t x;
+
+    for (queue->ts_bits = 1; (1U << queue->ts_bits) < queue->real_array_size * 2 && queue->ts_bits < 16; queue->ts_bits++);
+
+    free(queue->ts_head);
+    free(queue->ts_next);
+    queue->ts_head = calloc(1U << queue->ts_bits, sizeof(uint32_t));
+    queue->ts_next = calloc(queue->real_array_size, sizeof(uint32_t));
+    assert(queue->ts_head != NULL && queue->ts_next != NULL);
+
+    for (x = 0; x < queue->real_array_size; x++) {
+        stfu_n_index_link(queue, x);
+    }
+}
+
 static stfu_status_t stfu_n_resize_aqueue(stfu_queue_t *queue, uint32_t qlen)
 {
     unsigned char *m;
@@ -172,6 +217,7 @@ static stfu_status_t stfu_n_resize_aqueue(stfu_queue_t *queue, uint32_t qlen)
         memset(m + queue->array_size * sizeof(struct stfu_frame), 0, (qlen * sizeof(struct stfu_frame)) - (queue->array_size * sizeof(struct stfu_frame)));
         queue->array = (struct stfu_frame *) m;
         queue->real_array_size = queue->array_size = qlen;
+        stfu_n_index_build(queue);
     }
 
 	return STFU_IT_WORKED;
@@ -186,6 +232,7 @@ static void stfu_n_init_aqueue(stfu_queue_t *queue, uint32_t qlen)
 	queue->real_array_size = queue->array_size = qlen;
 	queue->int_frame.plc = 1;
     memset(queue->int_frame.data, 255, sizeof(queue->int_frame.data));
+    stfu_n_index_build(queue);
 }
 
 
@@ -206,6 +253,12 @@ void stfu_n_destroy(stfu_instance_t **i)
 		free(ii->a_queue.array);
 		free(ii->b_queue.array);
 		free(ii->c_queue.array);
+		free(ii->a_queue.ts_head);
+		free(ii->a_queue.ts_next);
+		free(ii->b_queue.ts_head);
+		free(ii->b_queue.ts_next);
+		free(ii->c_queue.ts_head);
+		free(ii->c_queue.ts_next);
 		free(ii);
 	}
 }
@@ -395,6 +448,7 @@ static void stfu_n_swap(stfu_instance_t *i)
 stfu_status_t stfu_n_add_data(stfu_instance_t *i, uint32_t ts, uint32_t pt, void *data, size_t datalen, uint32_t timer_ts, int last)
 {
 	uint32_t index = 0;
+	stfu_queue_t *queue;
 	stfu_frame_t *frame;
 	size_t cplen = 0;
     int good_ts = 0;
@@ -540,9 +594,10 @@ stfu_status_t stfu_n_add_data(stfu_instance_t *i, uint32_t ts, uint32_t pt, void
 		return STFU_IM_DONE;
 	}
 
-    index = i->in_queue->array_len++;
-    assert(index < i->in_queue->array_size);
-	frame = &i->in_queue->array[index];
+    queue = i->in_queue;
+    index = queue->array_len++;
+    assert(index < queue->array_size);
+	frame = &queue->array[index];
 
 	if (i->in_queue->array_len == i->in_queue->array_size) {
         stfu_n_swap(i);
@@ -558,7 +613,9 @@ stfu_status_t stfu_n_add_data(stfu_instance_t *i, uint32_t ts, uint32_t pt, void
 	memcpy(frame->data, data, cplen);
 
     frame->pt = pt;
+    stfu_n_index_unlink(queue, index);
 	frame->ts = ts;
+    stfu_n_index_link(queue, index);
 	frame->dlen = cplen;
 	frame->was_read = 0;	
 
@@ -592,29 +649,37 @@ static int stfu_n_find_any_frame(stfu_instance_t *in, stfu_queue_t *queue, stfu_
 
 static int stfu_n_find_frame(stfu_instance_t *in, stfu_queue_t *queue, uint32_t ts, stfu_frame_t **r_frame)
 {
-    uint32_t i = 0;
+    uint32_t i = 0, slot;
     stfu_frame_t *frame = NULL;
 
     if (r_frame) {
         *r_frame = NULL;
     }
 
-    for(i = 0; i < queue->array_size; i++) {
-        frame = &queue->array[i];
-        
-        if (frame->ts == ts) {
-            if (r_frame) {
-                *r_frame = frame;
-                queue->last_index = i;
-                frame->was_read = 1;
-                in->period_packet_out_count++;
-                in->session_packet_out_count++;
-            }
-            return 1;
+    /* walk the bucket for this ts and keep the lowest live slot, same as a scan of the array would */
+    i = queue->array_size;
+
+    for (slot = queue->ts_head[STFU_TS_BUCKET(queue, ts)]; slot; slot = queue->ts_next[slot - 1]) {
+        if (slot - 1 < i && queue->array[slot - 1].ts == ts) {
+            i = slot - 1;
         }
     }
 
-    return 0;
+    if (i == queue->array_size) {
+        return 0;
+    }
+
+    frame = &queue->array[i];
+
+    if (r_frame) {
+        *r_frame = frame;
+        queue->last_index = i;
+        frame->was_read = 1;
+        in->period_packet_out_count++;
+        in->session_packet_out_count++;
+    }
+
+    return 1;
 }
 
 stfu_frame_t *stfu_n_read_a_frame(stfu_instance_t *i)
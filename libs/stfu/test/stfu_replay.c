@@ -0,0 +1,374 @@
+/*
+ * STFU (S)ort (T)ransportable (F)ramed (U)tterances
+ * Copyright (c) 2007 Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * stfu_replay.c -- replay RTP arrival timing through the jitter buffer
+ *
+ * Packets come from a pcap capture (one RTP stream, picked by port and/or
+ * ssrc) or from a seeded synthetic stream with jitter, loss and reordering.
+ * They are fed to the jitter buffer the way switch_rtp.c does: every ptime
+ * the packets that arrived so far are eaten with the timer's sample count,
+ * a marker bit resets the buffer, and one frame is read.
+ *
+ * Every frame read goes into a digest printed at the end, so two builds of
+ * this program against different stfu.c files can be compared; see the
+ * "compare" target in the Makefile.  -v prints every read.
+ */
+#include "stfu.h"
+#include <sys/time.h>
+
+#define MAX_PACKETS 2000000
+
+typedef struct {
+	int64_t arrival_us;
+	uint32_t ts;
+	uint16_t seq;
+	uint8_t pt;
+	uint8_t marker;
+	uint16_t len;
+	uint8_t payload[320];
+} replay_packet_t;
+
+static replay_packet_t *packets;
+static uint32_t packet_count;
+
+static uint32_t rd16(const uint8_t *p, int swap)
+{
+	return swap ? (uint32_t) (p[1] << 8 | p[0]) : (uint32_t) (p[0] << 8 | p[1]);
+}
+
+static uint32_t rd32(const uint8_t *p, int swap)
+{
+	return swap ? ((uint32_t) p[3] << 24 | (uint32_t) p[2] << 16 | (uint32_t) p[1] << 8 | p[0]) :
+		((uint32_t) p[0] << 24 | (uint32_t) p[1] << 16 | (uint32_t) p[2] << 8 | p[3]);
+}
+
+/* classic pcap, ethernet / 802.1q / linux cooked / raw ip, ipv4 udp only */
+static int load_pcap(const char *path, uint32_t port, uint32_t ssrc)
+{
+	FILE *fp;
+	uint8_t gh[24], rh[16], *buf = NULL;
+	uint32_t magic, linktype, caplen;
+	int swap, nsec, have_ssrc = ssrc != 0;
+
+	if (!(fp = fopen(path, "rb"))) {
+		perror(path);
+		return -1;
+	}
+
+	if (fread(gh, 1, sizeof(gh), fp) != sizeof(gh)) {
+		fprintf(stderr, "%s: short pcap header\n", path);
+		fclose(fp);
+		return -1;
+	}
+
+	magic = rd32(gh, 0);
+	swap = magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1;
+	nsec = magic == 0xa1b23c4d || magic == 0x4d3cb2a1;
+	if (!swap && magic != 0xa1b2c3d4 && magic != 0xa1b23c4d) {
+		fprintf(stderr, "%s: not a pcap file (pcapng is not supported)\n", path);
+		fclose(fp);
+		return -1;
+	}
+	linktype = rd32(gh + 20, swap);
+
+	buf = malloc(65536);
+	assert(buf);
+
+	while (fread(rh, 1, sizeof(rh), fp) == sizeof(rh) && packet_count < MAX_PACKETS) {
+		const uint8_t *p = buf, *end;
+		uint32_t ethertype = 0x0800, ihl, cc, hlen;
+		replay_packet_t *pkt;
+
+		caplen = rd32(rh + 8, swap);
+		if (caplen > 65536 || fread(buf, 1, caplen, fp) != caplen) {
+			break;
+		}
+		end = buf + caplen;
+
+		switch (linktype) {
+		case 1:
+			if (caplen < 14) continue;
+			ethertype = rd16(p + 12, 0);
+			p += 14;
+			if (ethertype == 0x8100 && p + 4 <= end) {
+				ethertype = rd16(p + 2, 0);
+				p += 4;
+			}
+			break;
+		case 113:
+			if (caplen < 16) continue;
+			ethertype = rd16(p + 14, 0);
+			p += 16;
+			break;
+		case 12:
+		case 101:
+			break;
+		default:
+			fprintf(stderr, "%s: unsupported link type %u\n", path, linktype);
+			free(buf);
+			fclose(fp);
+			return -1;
+		}
+
+		if (ethertype != 0x0800 || p + 20 > end || (p[0] >> 4) != 4 || p[9] != 17) {
+			continue;
+		}
+		ihl = (p[0] & 0x0f) * 4;
+		p += ihl;
+		if (p + 8 > end || (port && rd16(p + 2, 0) != port)) {
+			continue;
+		}
+		p += 8;
+
+		/* rtp v2, skip rtcp */
+		if (p + 12 > end || (p[0] >> 6) != 2 || (p[1] >= 200 && p[1] <= 204)) {
+			continue;
+		}
+		if (!have_ssrc) {
+			ssrc = rd32(p + 8, 0);
+			have_ssrc = 1;
+		} else if (rd32(p + 8, 0) != ssrc) {
+			continue;
+		}
+
+		cc = p[0] & 0x0f;
+		hlen = 12 + cc * 4;
+		if ((p[0] & 0x10) && p + hlen + 4 <= end) {
+			hlen += 4 + rd16(p + hlen + 2, 0) * 4;
+		}
+		if (p + hlen > end) {
+			continue;
+		}
+
+		pkt = &packets[packet_count++];
+		pkt->arrival_us = (int64_t) rd32(rh, swap) * 1000000 + (nsec ? rd32(rh + 4, swap) / 1000 : rd32(rh + 4, swap));
+		pkt->seq = (uint16_t) rd16(p + 2, 0);
+		pkt->ts = rd32(p + 4, 0);
+		pkt->pt = p[1] & 0x7f;
+		pkt->marker = p[1] >> 7;
+		pkt->len = (uint16_t) (end - (p + hlen) > (int) sizeof(pkt->payload) ? sizeof(pkt->payload) : end - (p + hlen));
+		memcpy(pkt->payload, p + hlen, pkt->len);
+	}
+
+	free(buf);
+	fclose(fp);
+
+	return 0;
+}
+
+static uint32_t rng_state = 1;
+
+static uint32_t rng(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+static int cmp_arrival(const void *a, const void *b)
+{
+	const replay_packet_t *x = a, *y = b;
+
+	if (x->arrival_us != y->arrival_us) {
+		return x->arrival_us < y->arrival_us ? -1 : 1;
+	}
+	return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+/* ptime spaced stream, uniform jitter with occasional spikes, random loss */
+static void make_synthetic(uint32_t count, uint32_t ptime, uint32_t spp, uint32_t jitter_ms, uint32_t loss_pct, uint32_t seed)
+{
+	uint32_t i;
+
+	rng_state = seed ? seed : 1;
+
+	for (i = 0; i < count; i++) {
+		replay_packet_t *pkt;
+		int64_t delay = jitter_ms ? (int64_t) (rng() % (jitter_ms * 1000)) : 0;
+
+		if (loss_pct && rng() % 100 < loss_pct) {
+			continue;
+		}
+		if (jitter_ms && rng() % 200 == 0) {
+			delay += (int64_t) jitter_ms * 3000;
+		}
+
+		pkt = &packets[packet_count++];
+		pkt->seq = (uint16_t) i;
+		pkt->ts = 1000 + i * spp;
+		pkt->pt = 0;
+		pkt->marker = i == 0;
+		pkt->arrival_us = (int64_t) i * ptime * 1000 + delay;
+		pkt->len = (uint16_t) (spp > sizeof(pkt->payload) ? sizeof(pkt->payload) : spp);
+		memset(pkt->payload, (int) (i & 0xff), pkt->len);
+	}
+
+	qsort(packets, packet_count, sizeof(*packets), cmp_arrival);
+}
+
+static uint64_t fnv(uint64_t h, const void *data, size_t len)
+{
+	const uint8_t *p = data;
+
+	while (len--) {
+		h ^= *p++;
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+			"usage: %s [-f capture.pcap] [-P port] [-S ssrc] [-j jb_msec] [-m max_jb_msec] [-d max_drift_msec]\n"
+			"          [-p ptime] [-r rate] [-n packets] [-J jitter_msec] [-L loss_pct] [-s seed] [-l loops] [-v]\n"
+			"without -f a synthetic stream is generated (-n, -J, -L, -s)\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *file = NULL;
+	uint32_t port = 0, ssrc = 0, jb_ms = 60, max_jb_ms = 200, max_drift_ms = 0, ptime = 20, rate = 8000;
+	uint32_t count = 50000, jitter_ms = 40, loss_pct = 2, seed = 1, loops = 1, loop, spp, qlen, max_qlen;
+	uint32_t reads = 0, plc = 0, late = 0;
+	int verbose = 0, opt;
+	uint64_t digest = 14695981039346656037ULL;
+	double elapsed = 0;
+	stfu_report_t report = { 0 };
+
+	while ((opt = getopt(argc, argv, "f:P:S:j:m:d:p:r:n:J:L:s:l:vh")) != -1) {
+		switch (opt) {
+		case 'f': file = optarg; break;
+		case 'P': port = (uint32_t) atoi(optarg); break;
+		case 'S': ssrc = (uint32_t) strtoul(optarg, NULL, 0); break;
+		case 'j': jb_ms = (uint32_t) atoi(optarg); break;
+		case 'm': max_jb_ms = (uint32_t) atoi(optarg); break;
+		case 'd': max_drift_ms = (uint32_t) atoi(optarg); break;
+		case 'p': ptime = (uint32_t) atoi(optarg); break;
+		case 'r': rate = (uint32_t) atoi(optarg); break;
+		case 'n': count = (uint32_t) atoi(optarg); break;
+		case 'J': jitter_ms = (uint32_t) atoi(optarg); break;
+		case 'L': loss_pct = (uint32_t) atoi(optarg); break;
+		case 's': seed = (uint32_t) strtoul(optarg, NULL, 0); break;
+		case 'l': loops = (uint32_t) atoi(optarg); break;
+		case 'v': verbose = 1; break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (!ptime || !rate || !jb_ms || count > MAX_PACKETS || !loops) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	spp = rate / 1000 * ptime;
+	qlen = jb_ms / ptime;
+	max_qlen = max_jb_ms / ptime;
+	if (max_qlen < qlen) {
+		max_qlen = qlen;
+	}
+
+	packets = calloc(MAX_PACKETS, sizeof(*packets));
+	assert(packets);
+
+	if (file) {
+		if (load_pcap(file, port, ssrc) < 0) {
+			return 1;
+		}
+	} else {
+		make_synthetic(count, ptime, spp, jitter_ms, loss_pct, seed);
+	}
+
+	if (!packet_count) {
+		fprintf(stderr, "no rtp packets\n");
+		return 1;
+	}
+
+	for (loop = 0; loop < loops; loop++) {
+		stfu_instance_t *jb = stfu_n_init(qlen, max_qlen, spp, rate, max_drift_ms);
+		int64_t start_us = packets[0].arrival_us, now_us;
+		uint32_t next = 0, tick;
+		struct timeval t0, t1;
+
+		assert(jb);
+		gettimeofday(&t0, NULL);
+
+		for (tick = 0; next < packet_count || tick < (packet_count + max_qlen) * 2; tick++) {
+			stfu_frame_t *frame;
+
+			now_us = start_us + (int64_t) tick * ptime * 1000;
+
+			while (next < packet_count && packets[next].arrival_us <= now_us) {
+				replay_packet_t *pkt = &packets[next++];
+
+				if (pkt->marker) {
+					stfu_n_reset(jb);
+				}
+				if (stfu_n_eat(jb, pkt->ts, pkt->pt, pkt->payload, pkt->len, tick * spp) == STFU_ITS_TOO_LATE && !loop) {
+					late++;
+				}
+			}
+
+			if ((frame = stfu_n_read_a_frame(jb)) && !loop) {
+				reads++;
+				plc += frame->plc;
+				digest = fnv(digest, &frame->ts, sizeof(frame->ts));
+				digest = fnv(digest, &frame->plc, sizeof(frame->plc));
+				if (!frame->plc) {
+					digest = fnv(digest, frame->data, frame->dlen);
+				}
+				if (verbose) {
+					printf("tick %u ts %u pt %u len %u%s\n", tick, frame->ts, frame->pt, (unsigned) frame->dlen, frame->plc ? " plc" : "");
+				}
+			}
+
+			if (next >= packet_count && !frame && tick > packet_count) {
+				break;
+			}
+		}
+
+		gettimeofday(&t1, NULL);
+		elapsed += (t1.tv_sec - t0.tv_sec) + (t1.tv_usec - t0.tv_usec) / 1e6;
+
+		if (!loop) {
+			stfu_n_report(jb, &report);
+		}
+		stfu_n_destroy(&jb);
+	}
+
+	printf("packets %u reads %u plc %u late %u\n", packet_count, reads, plc, late);
+	printf("qlen %u packet_in_count %u clean_count %u consecutive_good %u consecutive_bad %u\n",
+		   report.qlen, report.packet_in_count, report.clean_count, report.consecutive_good_count, report.consecutive_bad_count);
+	printf("digest %016llx\n", (unsigned long long) digest);
+	/* on stderr so the stdout of two builds can be diffed */
+	fprintf(stderr, "%.1f ns per packet over %u loops\n", elapsed * 1e9 / ((double) packet_count * loops), loops);
+
+	free(packets);
+
+	return 0;
+}
@@ -241,6 +241,7 @@ struct switch_runtime {
 	uint32_t runlevel;
 	uint32_t tipping_point;
 	int32_t timer_affinity;
+	uint32_t timer_shards;
 	switch_profile_timer_t *profile_timer;
 	double profile_time;
 	double min_idle_time;
@@ -251,6 +252,8 @@ struct switch_runtime {
 	int multiple_registrations;
 	uint32_t max_db_handles;
 	uint32_t db_handle_timeout;
+	uint32_t event_queue_len;
+	switch_event_queue_policy_t event_queue_policy;
 };
 
 extern struct switch_runtime runtime;
@@ -262,6 +265,18 @@ struct switch_session_manager {
 	uint32_t session_count;
 	uint32_t session_limit;
 	switch_size_t session_id;
+	switch_mutex_t *thread_pool_mutex;
+	switch_queue_t *thread_pool_queue;
+	uint32_t thread_pool_min;
+	uint32_t thread_pool_max;
+	uint32_t thread_pool_idle_timeout;
+	uint32_t thread_pool_threads;
+	uint32_t thread_pool_idle;
+	uint32_t thread_pool_peak;
+	uint64_t thread_pool_jobs;
+	uint64_t thread_pool_created;
+	uint64_t thread_pool_overflow;
+	int thread_pool_running;
 };
 
 extern struct switch_session_manager session_manager;
@@ -270,8 +285,12 @@ extern struct switch_session_manager session_manager;
 
 switch_status_t switch_core_sqldb_start(switch_memory_pool_t *pool, switch_bool_t manage);
 void switch_core_sqldb_stop(void);
+void switch_regex_cache_init(switch_memory_pool_t *pool);
+void switch_regex_cache_shutdown(void);
 void switch_core_session_init(switch_memory_pool_t *pool);
 void switch_core_session_uninit(void);
+void switch_core_session_thread_pool_start(void);
+void switch_core_session_thread_pool_stop(void);
 void switch_core_state_machine_init(switch_memory_pool_t *pool);
 switch_memory_pool_t *switch_core_memory_init(void);
 void switch_core_memory_stop(void);
@@ -1053,6 +1053,13 @@ SWITCH_DECLARE(switch_status_t) switch_thread_create(switch_thread_t ** new_thre
 /** Freeswitch's socket address type, used to ensure protocol independence */
 	 typedef struct apr_sockaddr_t switch_sockaddr_t;
 
+/** The native descriptor behind a switch_socket_t */
+#ifdef WIN32
+	 typedef SOCKET switch_os_socket_t;
+#else
+	 typedef int switch_os_socket_t;
+#endif
+
 	 typedef enum {
 		 SWITCH_SHUTDOWN_READ,	   /**< no longer allow read request */
 		 SWITCH_SHUTDOWN_WRITE,	   /**< no longer allow write requests */
@@ -1143,6 +1150,28 @@ SWITCH_DECLARE(int32_t) switch_sockaddr_get_family(switch_sockaddr_t *sa);
 SWITCH_DECLARE(switch_status_t) switch_sockaddr_ip_get(char **addr, switch_sockaddr_t *sa);
 SWITCH_DECLARE(int) switch_sockaddr_equal(const switch_sockaddr_t *sa1, const switch_sockaddr_t *sa2);
 
+/**
+ * Expose the native sockaddr behind an apr_sockaddr_t.
+ * @param sa The apr_sockaddr_t
+ * @param len Returns the length of the native address
+ */
+SWITCH_DECLARE(const void *) switch_sockaddr_get_raw(switch_sockaddr_t *sa, uint32_t *len);
+
+/**
+ * Fill an apr_sockaddr_t from a native sockaddr, as recvfrom would.
+ * @param sa The apr_sockaddr_t to fill in
+ * @param raw The native address
+ * @param len The length of the native address
+ */
+SWITCH_DECLARE(switch_status_t) switch_sockaddr_set_raw(switch_sockaddr_t *sa, const void *raw, uint32_t len);
+
+/**
+ * Get the OS descriptor behind a socket.
+ * @param thesock Returns the native descriptor
+ * @param sock The socket
+ */
+SWITCH_DECLARE(switch_status_t) switch_os_sock_get(switch_os_socket_t *thesock, switch_socket_t *sock);
+
 
 /**
  * Create apr_sockaddr_t from hostname, address family, and port.
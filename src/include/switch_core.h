@@ -113,6 +113,48 @@ struct switch_core_thread_session {
 	switch_memory_pool_t *pool;
 };
 
+/*! \brief A snapshot of the session thread pool counters */
+struct switch_core_session_thread_pool_stats {
+	/*! threads kept alive while idle */
+	uint32_t min;
+	/*! maximum pooled threads, launches past this get a dedicated thread */
+	uint32_t max;
+	/*! seconds an idle thread above min waits before exiting */
+	uint32_t idle_timeout;
+	/*! pooled threads alive now */
+	uint32_t threads;
+	/*! pooled threads waiting for work */
+	uint32_t idle;
+	/*! highest number of busy pooled threads seen */
+	uint32_t peak;
+	/*! jobs run on pooled threads */
+	uint64_t jobs;
+	/*! pooled threads created */
+	uint64_t created;
+	/*! jobs that found the pool saturated and got a dedicated thread */
+	uint64_t overflow;
+};
+typedef struct switch_core_session_thread_pool_stats switch_core_session_thread_pool_stats_t;
+
+/*! \brief A snapshot of a port allocator's usage */
+struct switch_core_port_allocator_stats {
+	/*! first port in the range */
+	switch_port_t start;
+	/*! last port in the range */
+	switch_port_t end;
+	/*! ports the allocator can hand out */
+	uint32_t total;
+	/*! ports handed out now */
+	uint32_t used;
+	/*! highest number of ports handed out at once */
+	uint32_t high_water;
+	/*! freed ports still resting before they are reused */
+	uint32_t quarantined;
+	/*! requests that found no port */
+	uint64_t failed;
+};
+typedef struct switch_core_port_allocator_stats switch_core_port_allocator_stats_t;
+
 struct switch_core_session;
 struct switch_core_runtime;
 struct switch_core_port_allocator;
@@ -299,9 +341,17 @@ SWITCH_DECLARE(switch_status_t) switch_core_port_allocator_request_port(_In_ swi
   \param alloc the allocator object
   \param port the port
   \return SUCCESS
+  \note the port rests for a few seconds before it is handed out again unless the range runs dry
 */
 SWITCH_DECLARE(switch_status_t) switch_core_port_allocator_free_port(_In_ switch_core_port_allocator_t *alloc, _In_ switch_port_t port);
 
+/*!
+  \brief Read the usage counters of a port allocator
+  \param alloc the allocator object
+  \param stats the structure to fill
+*/
+SWITCH_DECLARE(void) switch_core_port_allocator_stats(_In_ switch_core_port_allocator_t *alloc, _Out_ switch_core_port_allocator_stats_t *stats);
+
 /*!
   \brief destroythe port allocator
   \param alloc the allocator object
@@ -974,6 +1024,22 @@ SWITCH_DECLARE(int) switch_core_session_get_stream_count(_In_ switch_core_sessio
 SWITCH_DECLARE(void) switch_core_session_launch_thread(_In_ switch_core_session_t *session,
 													   _In_ void *(*func) (switch_thread_t *, void *), _In_opt_ void *obj);
 
+/*! 
+  \brief Run a function on a session pool thread, falling back to a dedicated thread when the pool is saturated
+  \param func a function to execute in the thread
+  \param obj an arguement
+  \param pool a pool to create the dedicated thread from if one is needed
+  \return SWITCH_STATUS_SUCCESS if the function was handed to a thread
+*/
+SWITCH_DECLARE(switch_status_t) switch_core_session_thread_pool_launch(_In_ void *(*func) (switch_thread_t *, void *), _In_opt_ void *obj,
+																	   _In_ switch_memory_pool_t *pool);
+
+/*! 
+  \brief Read the session thread pool counters
+  \param stats the structure to fill
+*/
+SWITCH_DECLARE(void) switch_core_session_thread_pool_stats(_Out_ switch_core_session_thread_pool_stats_t *stats);
+
 /*! 
   \brief Signal a thread using a thread session to terminate
   \param session the session to indicate to
@@ -1340,6 +1406,14 @@ SWITCH_DECLARE(switch_status_t) switch_core_timer_check(switch_timer_t *timer, s
   \return SWITCH_STATUS_SUCCESS after destruction
 */
 SWITCH_DECLARE(switch_status_t) switch_core_timer_destroy(switch_timer_t *timer);
+
+/*! 
+  \brief Write the timing statistics of a timer module to a stream
+  \param timer_name the name of the timer module
+  \param stream the stream to write to
+  \return SWITCH_STATUS_NOTIMPL if the timer keeps no statistics
+*/
+SWITCH_DECLARE(switch_status_t) switch_core_timer_stats(const char *timer_name, switch_stream_handle_t *stream);
 ///\}
 
 ///\defgroup codecs Codec Functions
@@ -2033,6 +2107,11 @@ SWITCH_DECLARE(void *) switch_loadable_module_create_interface(switch_loadable_m
 */
 SWITCH_DECLARE(switch_time_t) switch_micro_time_now(void);
 SWITCH_DECLARE(void) switch_core_memory_reclaim(void);
+/*! 
+ \brief Write the live memory pools, their peak and the bytes allocated from them, grouped by the file:line that created them
+ \param stream the stream to write to
+*/
+SWITCH_DECLARE(void) switch_core_memory_pool_stats(switch_stream_handle_t *stream);
 SWITCH_DECLARE(void) switch_core_memory_reclaim_events(void);
 SWITCH_DECLARE(void) switch_core_memory_reclaim_logger(void);
 SWITCH_DECLARE(void) switch_core_memory_reclaim_all(void);
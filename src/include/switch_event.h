@@ -96,12 +96,20 @@ struct switch_event {
 	unsigned long key;
 	struct switch_event *next;
 	int flags;
+	/*! optional header index (see switch_event_index_headers) */
+	struct switch_event_index *index;
 };
 
 typedef enum {
 	EF_UNIQ_HEADERS = (1 << 0)
 } switch_event_flag_t;
 
+/*! \brief What to do when a subscriber's private event queue is full */
+typedef enum {
+	SWITCH_EVENT_QUEUE_POLICY_DROP,
+	SWITCH_EVENT_QUEUE_POLICY_BLOCK
+} switch_event_queue_policy_t;
+
 
 struct switch_event_node;
 
@@ -185,6 +193,15 @@ SWITCH_DECLARE(switch_status_t) switch_event_add_header_string(switch_event_t *e
 SWITCH_DECLARE(switch_status_t) switch_event_del_header_val(switch_event_t *event, const char *header_name, const char *val);
 #define switch_event_del_header(_e, _h) switch_event_del_header_val(_e, _h, NULL)
 
+/*!
+  \brief Switch an event to indexed header storage
+  \param event the event to index
+  \return SWITCH_STATUS_SUCCESS if the event is indexed
+  \note header lookups become a hash probe instead of a list walk and new headers are carved out of a
+        per-event arena, event->headers still holds every header in insertion order
+*/
+SWITCH_DECLARE(switch_status_t) switch_event_index_headers(switch_event_t *event);
+
 /*!
   \brief Destroy an event
   \param event pointer to the pointer to event to destroy
@@ -247,6 +264,13 @@ SWITCH_DECLARE(switch_status_t) switch_event_bind_removable(const char *id, swit
 SWITCH_DECLARE(switch_status_t) switch_event_unbind(switch_event_node_t **node);
 SWITCH_DECLARE(switch_status_t) switch_event_unbind_callback(switch_event_callback_t callback);
 
+/*!
+  \brief Write the depth and counters of every subscriber queue to a stream
+  \param stream the stream to write to
+  \note subscribers only get their own queue when event-subscriber-queue-len is set in switch.conf
+*/
+SWITCH_DECLARE(void) switch_event_queue_stats(switch_stream_handle_t *stream);
+
 /*!
   \brief Render the name of an event id enumeration
   \param event the event id to render the name of
@@ -258,6 +258,8 @@ struct switch_timer_interface {
 	switch_status_t (*timer_check) (switch_timer_t *, switch_bool_t);
 	/*! function to deallocate the timer */
 	switch_status_t (*timer_destroy) (switch_timer_t *);
+	/*! optional function to report timing statistics */
+	switch_status_t (*timer_stats) (switch_stream_handle_t *);
 	switch_thread_rwlock_t *rwlock;
 	int refs;
 	switch_mutex_t *reflock;
@@ -50,6 +50,13 @@ SWITCH_DECLARE(int) switch_regex_copy_substring(const char *subject, int *ovecto
 SWITCH_DECLARE(void) switch_regex_free(void *data);
 
 SWITCH_DECLARE(int) switch_regex_perform(const char *field, const char *expression, switch_regex_t **new_re, int *ovector, uint32_t olen);
+
+/*!
+ \brief Same as switch_regex_perform but lets the caller say where the expression came from
+ \param dynamic SWITCH_TRUE if the expression was produced by variable expansion, these are cached apart from static patterns
+*/
+SWITCH_DECLARE(int) switch_regex_perform_ex(const char *field, const char *expression, switch_regex_t **new_re, int *ovector, uint32_t olen,
+											switch_bool_t dynamic);
 SWITCH_DECLARE(void) switch_perform_substitution(switch_regex_t *re, int match_count, const char *data, const char *field_data,
 												 char *substituted, switch_size_t len, int *ovector);
 
@@ -70,6 +77,16 @@ SWITCH_DECLARE(switch_status_t) switch_regex_match(const char *target, const cha
 */
 SWITCH_DECLARE(switch_status_t) switch_regex_match_partial(const char *target, const char *expression, int *partial_match);
 
+/*!
+ \brief Write hit/miss/eviction counters of the compiled pattern cache to a stream
+*/
+SWITCH_DECLARE(void) switch_regex_cache_status(switch_stream_handle_t *stream);
+
+/*!
+ \brief Drop every cached pattern, handles still held by callers stay valid until freed
+*/
+SWITCH_DECLARE(void) switch_regex_cache_flush(void);
+
 
 #define switch_regex_safe_free(re)	if (re) {\
 				switch_regex_free(re);\
@@ -90,6 +90,13 @@ SWITCH_DECLARE(void) switch_rtp_get_random(void *buf, uint32_t len);
 SWITCH_DECLARE(void) switch_rtp_init(switch_memory_pool_t *pool);
 SWITCH_DECLARE(void) switch_rtp_shutdown(void);
 
+/*! 
+  \brief Set the number of threads behind the shared RTP I/O engine
+  \param threads number of threads, 0 leaves every session reading its own socket
+  \note only takes effect before switch_rtp_init, the engine needs epoll and recvmmsg
+*/
+SWITCH_DECLARE(void) switch_rtp_set_io_threads(uint32_t threads);
+
 /*!
   \brief Set/Get RTP start port
   \param port new value (if > 0)
@@ -114,6 +121,12 @@ SWITCH_DECLARE(switch_port_t) switch_rtp_set_end_port(switch_port_t port);
 SWITCH_DECLARE(switch_port_t) switch_rtp_request_port(const char *ip);
 SWITCH_DECLARE(void) switch_rtp_release_port(const char *ip, switch_port_t port);
 
+/*!
+  \brief Write the usage of each per-ip RTP port range to a stream
+  \param stream the stream to write to
+*/
+SWITCH_DECLARE(void) switch_rtp_port_usage(switch_stream_handle_t *stream);
+
 SWITCH_DECLARE(switch_status_t) switch_rtp_set_interval(switch_rtp_t *rtp_session, uint32_t ms_per_packet, uint32_t samples_per_interval);
 
 SWITCH_DECLARE(switch_status_t) switch_rtp_change_interval(switch_rtp_t *rtp_session, uint32_t ms_per_packet, uint32_t samples_per_interval);
@@ -264,7 +264,8 @@ typedef enum {
 	SCF_VERBOSE_EVENTS = (1 << 11),
 	SCF_USE_WIN32_MONOTONIC = (1 << 12),
 	SCF_AUTO_SCHEMAS = (1 << 13),
-	SCF_MINIMAL = (1 << 14)
+	SCF_MINIMAL = (1 << 14),
+	SCF_INDEXED_VARIABLES = (1 << 15)
 } switch_core_flag_enum_t;
 typedef uint32_t switch_core_flag_t;
 
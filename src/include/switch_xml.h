@@ -65,6 +65,9 @@ struct switch_xml_binding;
 ///\{
 SWITCH_BEGIN_EXTERN_C
 #define SWITCH_XML_BUFSIZE 1024	// size of internal memory buffers
+/* custom event subclass that flushes the directory user cache, optional "user" and "domain" headers narrow it down */
+#define SWITCH_XML_USER_CACHE_FLUSH_EVENT "xml::flush_user_cache"
+
 	typedef enum {
 	SWITCH_XML_ROOT = (1 << 0),	// root
 	SWITCH_XML_NAMEM = (1 << 1),	// name is malloced
@@ -371,6 +374,42 @@ SWITCH_DECLARE(switch_status_t) switch_xml_locate_user(_In_z_ const char *key,
 													   _Out_ switch_xml_t *root, _Out_ switch_xml_t *domain, _Out_ switch_xml_t *user,
 													   _Out_opt_ switch_xml_t *ingroup, _In_opt_ switch_event_t *params);
 
+///\brief search the directory for a user, answering from the user cache when it is enabled
+///\ takes the same arguments as switch_xml_locate_user(); on a cache hit *root is a private copy
+///\ holding only the user and the params/variables of its group and domain, free it with switch_xml_free()
+///\ lookups with an ip always go to the directory when the domain has users with an ip attribute
+SWITCH_DECLARE(switch_status_t) switch_xml_locate_user_cached(_In_z_ const char *key,
+															  _In_z_ const char *user_name,
+															  _In_z_ const char *domain_name,
+															  _In_opt_z_ const char *ip,
+															  _Out_ switch_xml_t *root, _Out_ switch_xml_t *domain, _Out_ switch_xml_t *user,
+															  _Out_opt_ switch_xml_t *ingroup, _In_opt_ switch_event_t *params);
+
+///\brief drop entries from the user cache
+///\param user_name only drop this user (NULL for all)
+///\param domain_name only drop users of this domain (NULL for all)
+///\return the number of entries removed
+SWITCH_DECLARE(uint32_t) switch_xml_clear_user_cache(_In_opt_z_ const char *user_name, _In_opt_z_ const char *domain_name);
+
+///\brief set how long (in seconds) a user stays in the user cache, 0 disables the cache
+SWITCH_DECLARE(void) switch_xml_set_user_cache_ttl(uint32_t ttl);
+
+///\brief set the maximum number of users kept in the user cache, 0 for no limit
+SWITCH_DECLARE(void) switch_xml_set_user_cache_max_entries(uint32_t max_entries);
+
+typedef struct {
+	uint32_t ttl;
+	uint32_t max_entries;
+	uint32_t entries;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t expired;
+	uint64_t flushed;
+} switch_xml_user_cache_stats_t;
+
+///\brief fetch the user cache counters
+SWITCH_DECLARE(void) switch_xml_user_cache_stats(switch_xml_user_cache_stats_t *stats);
+
 SWITCH_DECLARE(switch_status_t) switch_xml_locate_user_in_domain(_In_z_ const char *user_name, _In_ switch_xml_t domain, _Out_ switch_xml_t *user,
 																 _Out_opt_ switch_xml_t *ingroup);
 
@@ -408,6 +408,18 @@ static struct {
 	int32_t threads;
 	int32_t running;
 	switch_mutex_t *mutex;
+	switch_mutex_t *agent_mutex;
+	switch_hash_t *agent_hash;
+	switch_hash_t *tier_set_hash;
+	uint32_t agent_lock_depth;
+	switch_queue_t *sql_queue;
+	switch_mutex_t *sql_mutex;
+	struct cc_sql_pending *sql_head;
+	struct cc_sql_pending *sql_tail;
+	switch_thread_t *sql_thread;
+	int32_t sql_running;
+	uint32_t agent_sync_interval;
+	uint32_t agent_sync_gen;
 	switch_memory_pool_t *pool;
 } globals;
 
@@ -650,6 +662,651 @@ end:
 	return ret;
 }
 
+/* 
+   Agents and tiers are kept in memory and that copy is authoritative.  The
+   agents and tiers tables are written behind by cc_sql_thread_run(), which
+   also reads them back every agent-sync-interval seconds once all of our own
+   writes have landed, so boxes sharing one odbc-dsn (or anything writing the
+   tables directly) see each other's agent and tier changes that much later.
+
+   Each queue keeps its tiers in an array sorted the way its strategy used to
+   ORDER BY them, so picking an agent is a walk over that array.  When a sort
+   key changes the tier is moved with a binary search.
+*/
+
+typedef enum {
+	CC_TIER_ORDER_SEQUENTIAL,		/* level, position, last_offered_call */
+	CC_TIER_ORDER_LONGEST_IDLE,		/* level, last_offered_call, position */
+	CC_TIER_ORDER_LEAST_TALK_TIME,	/* level, talk_time, position */
+	CC_TIER_ORDER_FEWEST_CALLS,		/* level, calls_answered, position */
+	CC_TIER_ORDER_RING_ALL			/* level, position */
+} cc_tier_order_t;
+
+struct cc_tier;
+
+struct cc_agent {
+	char *name;
+	char *system;
+	char *uuid;
+	char *type;
+	char *contact;
+	cc_agent_status_t status;
+	cc_agent_state_t state;
+	int max_no_answer;
+	int wrap_up_time;
+	int reject_delay_time;
+	int busy_delay_time;
+	int no_answer_delay_time;
+	long last_bridge_start;
+	long last_bridge_end;
+	long last_offered_call;
+	long last_status_change;
+	long no_answer_count;
+	long calls_answered;
+	long talk_time;
+	long ready_time;
+	struct cc_tier *tiers;
+	/* globals.agent_sync_gen of the last read that found it in the db */
+	uint32_t sync_gen;
+};
+typedef struct cc_agent cc_agent_t;
+
+struct cc_tier_set {
+	char *queue_name;
+	cc_tier_order_t order;
+	struct cc_tier **tiers;
+	uint32_t count;
+	uint32_t alloc;
+};
+typedef struct cc_tier_set cc_tier_set_t;
+
+struct cc_tier {
+	cc_agent_t *agent;
+	cc_tier_set_t *set;
+	cc_tier_state_t state;
+	int level;
+	int position;
+	uint32_t index;
+	uint32_t sync_gen;
+	/* next tier of the same agent */
+	struct cc_tier *next;
+};
+typedef struct cc_tier cc_tier_t;
+
+#define CC_SQL_QUEUE_LEN 10000
+#define CC_SQL_BATCH 500
+/* seconds between re-reads of the agents and tiers tables */
+#define CC_AGENT_SYNC_INTERVAL 5
+
+struct cc_sql_pending {
+	char *sql;
+	struct cc_sql_pending *next;
+};
+typedef struct cc_sql_pending cc_sql_pending_t;
+
+/*
+   Writes to the agents and tiers tables are made with agent_mutex held so
+   they are collected in memory order, but nothing is pushed or run until the
+   outermost cc_agent_unlock().  globals.mutex may be held by the caller and
+   the sql thread needs it, so cc_sql_flush() never blocks on the queue:
+   whatever does not fit stays pending and is handed over on the next flush.
+*/
+static void cc_execute_sql_async(char *sql)
+{
+	cc_sql_pending_t *pending;
+
+	if (!sql) {
+		return;
+	}
+
+	switch_zmalloc(pending, sizeof(*pending));
+	pending->sql = sql;
+
+	switch_mutex_lock(globals.sql_mutex);
+	if (globals.sql_tail) {
+		globals.sql_tail->next = pending;
+	} else {
+		globals.sql_head = pending;
+	}
+	globals.sql_tail = pending;
+	switch_mutex_unlock(globals.sql_mutex);
+}
+
+static void cc_sql_flush(void)
+{
+	cc_sql_pending_t *pending, *list = NULL;
+
+	switch_mutex_lock(globals.sql_mutex);
+	if (globals.sql_running) {
+		while ((pending = globals.sql_head) && switch_queue_trypush(globals.sql_queue, pending->sql) == SWITCH_STATUS_SUCCESS) {
+			if (!(globals.sql_head = pending->next)) {
+				globals.sql_tail = NULL;
+			}
+			free(pending);
+		}
+		switch_mutex_unlock(globals.sql_mutex);
+		return;
+	}
+	switch_mutex_unlock(globals.sql_mutex);
+
+	/* No sql thread, run them here.  globals.mutex is taken first so concurrent flushes keep their order */
+	switch_mutex_lock(globals.mutex);
+	switch_mutex_lock(globals.sql_mutex);
+	list = globals.sql_head;
+	globals.sql_head = globals.sql_tail = NULL;
+	switch_mutex_unlock(globals.sql_mutex);
+
+	while ((pending = list)) {
+		list = pending->next;
+		cc_execute_sql(NULL, pending->sql, NULL);
+		free(pending->sql);
+		free(pending);
+	}
+	switch_mutex_unlock(globals.mutex);
+}
+
+static void cc_agent_lock(void)
+{
+	switch_mutex_lock(globals.agent_mutex);
+	globals.agent_lock_depth++;
+}
+
+static void cc_agent_unlock(void)
+{
+	uint32_t depth = --globals.agent_lock_depth;
+
+	switch_mutex_unlock(globals.agent_mutex);
+
+	if (!depth) {
+		cc_sql_flush();
+	}
+}
+
+static void cc_agents_sync(void);
+
+static void *SWITCH_THREAD_FUNC cc_sql_thread_run(switch_thread_t *thread, void *obj)
+{
+	void *pop = NULL;
+	time_t last_sync = switch_epoch_time_now(NULL);
+
+	while (globals.sql_running || switch_queue_size(globals.sql_queue)) {
+		switch_stream_handle_t stream = { 0 };
+		switch_cache_db_handle_t *dbh = NULL;
+		int n = 0;
+
+		/* pick up what did not fit in the queue last time */
+		cc_sql_flush();
+
+		if (globals.sql_running && globals.agent_sync_interval && switch_epoch_time_now(NULL) - last_sync >= globals.agent_sync_interval) {
+			cc_agents_sync();
+			last_sync = switch_epoch_time_now(NULL);
+		}
+
+		if (switch_queue_pop_timeout(globals.sql_queue, &pop, 100000) != SWITCH_STATUS_SUCCESS || !pop) {
+			continue;
+		}
+
+		SWITCH_STANDARD_STREAM(stream);
+		do {
+			stream.write_function(&stream, "%s;\n", (char *) pop);
+			free(pop);
+			pop = NULL;
+		} while (++n < CC_SQL_BATCH && switch_queue_trypop(globals.sql_queue, &pop) == SWITCH_STATUS_SUCCESS && pop);
+
+		switch_mutex_lock(globals.mutex);
+		if ((dbh = cc_get_db_handle())) {
+			switch_cache_db_persistant_execute_trans(dbh, (char *) stream.data, 1);
+			switch_cache_db_release_db_handle(&dbh);
+		} else {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error Opening DB\n");
+		}
+		switch_mutex_unlock(globals.mutex);
+
+		switch_safe_free(stream.data);
+	}
+
+	return NULL;
+}
+
+static cc_tier_order_t cc_strategy2order(const char *strategy)
+{
+	if (!strategy) {
+		return CC_TIER_ORDER_SEQUENTIAL;
+	} else if (!strcasecmp(strategy, "longest-idle-agent")) {
+		return CC_TIER_ORDER_LONGEST_IDLE;
+	} else if (!strcasecmp(strategy, "agent-with-least-talk-time")) {
+		return CC_TIER_ORDER_LEAST_TALK_TIME;
+	} else if (!strcasecmp(strategy, "agent-with-fewest-calls")) {
+		return CC_TIER_ORDER_FEWEST_CALLS;
+	} else if (!strcasecmp(strategy, "ring-all")) {
+		return CC_TIER_ORDER_RING_ALL;
+	}
+
+	/* sequentially-by-agent-order and anything unknown */
+	return CC_TIER_ORDER_SEQUENTIAL;
+}
+
+#define CC_TIER_CMP(_a, _b) if ((_a) != (_b)) return (_a) < (_b) ? -1 : 1
+
+static int cc_tier_cmp(cc_tier_order_t order, cc_tier_t *a, cc_tier_t *b)
+{
+	CC_TIER_CMP(a->level, b->level);
+
+	switch (order) {
+	case CC_TIER_ORDER_LONGEST_IDLE:
+		CC_TIER_CMP(a->agent->last_offered_call, b->agent->last_offered_call);
+		break;
+	case CC_TIER_ORDER_LEAST_TALK_TIME:
+		CC_TIER_CMP(a->agent->talk_time, b->agent->talk_time);
+		break;
+	case CC_TIER_ORDER_FEWEST_CALLS:
+		CC_TIER_CMP(a->agent->calls_answered, b->agent->calls_answered);
+		break;
+	default:
+		break;
+	}
+
+	CC_TIER_CMP(a->position, b->position);
+
+	if (order == CC_TIER_ORDER_SEQUENTIAL) {
+		CC_TIER_CMP(a->agent->last_offered_call, b->agent->last_offered_call);
+	}
+
+	return 0;
+}
+
+static void cc_tier_set_remove(cc_tier_t *tier)
+{
+	cc_tier_set_t *set = tier->set;
+	uint32_t i;
+
+	set->count--;
+	memmove(&set->tiers[tier->index], &set->tiers[tier->index + 1], (set->count - tier->index) * sizeof(*set->tiers));
+	for (i = tier->index; i < set->count; i++) {
+		set->tiers[i]->index = i;
+	}
+}
+
+static void cc_tier_set_insert(cc_tier_t *tier)
+{
+	cc_tier_set_t *set = tier->set;
+	uint32_t lo = 0, hi = set->count, i;
+
+	/* after any equal keys, like rows inserted later */
+	while (lo < hi) {
+		uint32_t mid = (lo + hi) / 2;
+
+		if (cc_tier_cmp(set->order, tier, set->tiers[mid]) < 0) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+	}
+
+	if (set->count == set->alloc) {
+		set->alloc = set->alloc ? set->alloc * 2 : 16;
+		set->tiers = realloc(set->tiers, set->alloc * sizeof(*set->tiers));
+		switch_assert(set->tiers);
+	}
+
+	memmove(&set->tiers[lo + 1], &set->tiers[lo], (set->count - lo) * sizeof(*set->tiers));
+	set->tiers[lo] = tier;
+	set->count++;
+	for (i = lo; i < set->count; i++) {
+		set->tiers[i]->index = i;
+	}
+}
+
+/* move a tier whose sort key changed back into place */
+static void cc_tier_set_fix(cc_tier_t *tier)
+{
+	cc_tier_set_t *set = tier->set;
+	uint32_t i = tier->index;
+
+	if ((i == 0 || cc_tier_cmp(set->order, set->tiers[i - 1], tier) <= 0) &&
+		(i + 1 == set->count || cc_tier_cmp(set->order, tier, set->tiers[i + 1]) <= 0)) {
+		return;
+	}
+
+	cc_tier_set_remove(tier);
+	cc_tier_set_insert(tier);
+}
+
+static void cc_agent_fix_tiers(cc_agent_t *agent)
+{
+	cc_tier_t *tier;
+
+	for (tier = agent->tiers; tier; tier = tier->next) {
+		cc_tier_set_fix(tier);
+	}
+}
+
+static cc_tier_set_t *cc_tier_set_locate(const char *queue_name, switch_bool_t create)
+{
+	cc_tier_set_t *set;
+
+	if (!(set = switch_core_hash_find(globals.tier_set_hash, queue_name)) && create) {
+		set = calloc(1, sizeof(*set));
+		switch_assert(set);
+		set->queue_name = strdup(queue_name);
+		set->order = CC_TIER_ORDER_SEQUENTIAL;
+		switch_core_hash_insert(globals.tier_set_hash, set->queue_name, set);
+	}
+
+	return set;
+}
+
+/* called when a queue is (re)loaded since its strategy decides the order */
+static void cc_tier_set_order(const char *queue_name, const char *strategy)
+{
+	cc_tier_set_t *set;
+	cc_tier_order_t order = cc_strategy2order(strategy);
+	uint32_t i, count;
+
+	cc_agent_lock();
+	set = cc_tier_set_locate(queue_name, SWITCH_TRUE);
+	if (set->order != order) {
+		set->order = order;
+		count = set->count;
+		set->count = 0;
+		for (i = 0; i < count; i++) {
+			cc_tier_set_insert(set->tiers[i]);
+		}
+	}
+	cc_agent_unlock();
+}
+
+static cc_agent_t *cc_agent_locate(const char *name)
+{
+	return (cc_agent_t *) switch_core_hash_find(globals.agent_hash, name);
+}
+
+static cc_tier_t *cc_tier_locate(cc_agent_t *agent, const char *queue_name)
+{
+	cc_tier_t *tier;
+
+	for (tier = agent->tiers; tier; tier = tier->next) {
+		if (!strcmp(tier->set->queue_name, queue_name)) {
+			break;
+		}
+	}
+
+	return tier;
+}
+
+static cc_agent_t *cc_agent_create(const char *name, const char *system, const char *type)
+{
+	cc_agent_t *agent = calloc(1, sizeof(*agent));
+
+	switch_assert(agent);
+	agent->name = strdup(name);
+	agent->system = strdup(switch_str_nil(system));
+	agent->type = strdup(switch_str_nil(type));
+	agent->uuid = strdup("");
+	agent->contact = strdup("");
+	agent->status = CC_AGENT_STATUS_LOGGED_OUT;
+	agent->state = CC_AGENT_STATE_WAITING;
+	switch_core_hash_insert(globals.agent_hash, agent->name, agent);
+
+	return agent;
+}
+
+static cc_tier_t *cc_tier_create(cc_agent_t *agent, const char *queue_name, cc_tier_state_t state, int level, int position)
+{
+	cc_tier_t *tier = calloc(1, sizeof(*tier));
+
+	switch_assert(tier);
+	tier->agent = agent;
+	tier->set = cc_tier_set_locate(queue_name, SWITCH_TRUE);
+	tier->state = state;
+	tier->level = level;
+	tier->position = position;
+	tier->next = agent->tiers;
+	agent->tiers = tier;
+	cc_tier_set_insert(tier);
+
+	return tier;
+}
+
+static void cc_tier_destroy(cc_tier_t *tier)
+{
+	cc_tier_t **tp;
+
+	for (tp = &tier->agent->tiers; *tp; tp = &(*tp)->next) {
+		if (*tp == tier) {
+			*tp = tier->next;
+			break;
+		}
+	}
+	cc_tier_set_remove(tier);
+	free(tier);
+}
+
+static void cc_agent_destroy(cc_agent_t *agent)
+{
+	while (agent->tiers) {
+		cc_tier_destroy(agent->tiers);
+	}
+	switch_core_hash_delete(globals.agent_hash, agent->name);
+	switch_safe_free(agent->name);
+	switch_safe_free(agent->system);
+	switch_safe_free(agent->uuid);
+	switch_safe_free(agent->type);
+	switch_safe_free(agent->contact);
+	free(agent);
+}
+
+static void cc_agent_set_string(char **field, const char *value)
+{
+	switch_safe_free(*field);
+	*field = strdup(switch_str_nil(value));
+}
+
+/* create or refresh an agent from its row */
+static int cc_agents_load_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	cc_agent_t *agent;
+
+	if (zstr(argv[0])) {
+		return 0;
+	}
+
+	if ((agent = cc_agent_locate(argv[0]))) {
+		cc_agent_set_string(&agent->system, argv[1]);
+		cc_agent_set_string(&agent->type, argv[3]);
+	} else {
+		agent = cc_agent_create(argv[0], argv[1], argv[3]);
+	}
+	agent->sync_gen = globals.agent_sync_gen;
+	cc_agent_set_string(&agent->uuid, argv[2]);
+	cc_agent_set_string(&agent->contact, argv[4]);
+	agent->status = cc_agent_str2status(switch_str_nil(argv[5]));
+	agent->state = cc_agent_str2state(switch_str_nil(argv[6]));
+	agent->max_no_answer = atoi(switch_str_nil(argv[7]));
+	agent->wrap_up_time = atoi(switch_str_nil(argv[8]));
+	agent->reject_delay_time = atoi(switch_str_nil(argv[9]));
+	agent->busy_delay_time = atoi(switch_str_nil(argv[10]));
+	agent->no_answer_delay_time = atoi(switch_str_nil(argv[11]));
+	agent->last_bridge_start = atol(switch_str_nil(argv[12]));
+	agent->last_bridge_end = atol(switch_str_nil(argv[13]));
+	agent->last_offered_call = atol(switch_str_nil(argv[14]));
+	agent->last_status_change = atol(switch_str_nil(argv[15]));
+	agent->no_answer_count = atol(switch_str_nil(argv[16]));
+	agent->calls_answered = atol(switch_str_nil(argv[17]));
+	agent->talk_time = atol(switch_str_nil(argv[18]));
+	agent->ready_time = atol(switch_str_nil(argv[19]));
+	cc_agent_fix_tiers(agent);
+
+	return 0;
+}
+
+static int cc_tiers_load_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	cc_agent_t *agent;
+	cc_tier_t *tier;
+	cc_tier_state_t state;
+	int level, position;
+
+	if (zstr(argv[0]) || zstr(argv[1]) || !(agent = cc_agent_locate(argv[1]))) {
+		return 0;
+	}
+
+	state = cc_tier_str2state(switch_str_nil(argv[2]));
+	level = atoi(switch_str_nil(argv[3]));
+	position = atoi(switch_str_nil(argv[4]));
+
+	if ((tier = cc_tier_locate(agent, argv[0]))) {
+		tier->state = state;
+		if (tier->level != level || tier->position != position) {
+			tier->level = level;
+			tier->position = position;
+			cc_tier_set_fix(tier);
+		}
+	} else {
+		tier = cc_tier_create(agent, argv[0], state, level, position);
+	}
+	tier->sync_gen = globals.agent_sync_gen;
+
+	return 0;
+}
+
+#define CC_AGENTS_SELECT "SELECT name, system, uuid, type, contact, status, state, max_no_answer, wrap_up_time, reject_delay_time, " \
+	"busy_delay_time, no_answer_delay_time, last_bridge_start, last_bridge_end, last_offered_call, last_status_change, " \
+	"no_answer_count, calls_answered, talk_time, ready_time FROM agents"
+#define CC_TIERS_SELECT "SELECT queue, agent, state, level, position FROM tiers"
+
+/* pick up the agents and tiers left in the database by a previous run, globals.mutex is the outer lock */
+static void cc_agents_load(void)
+{
+	switch_mutex_lock(globals.mutex);
+	cc_agent_lock();
+	cc_execute_sql_callback(NULL, NULL, CC_AGENTS_SELECT, cc_agents_load_callback, NULL);
+	cc_execute_sql_callback(NULL, NULL, CC_TIERS_SELECT, cc_tiers_load_callback, NULL);
+	cc_agent_unlock();
+	switch_mutex_unlock(globals.mutex);
+}
+
+/*
+   Bring the memory copy in line with the tables: rows changed by other boxes
+   are applied, rows they added are created and agents or tiers they deleted
+   go away.  Only done when none of our own writes are still queued, those
+   would otherwise be undone.  Called from the sql thread between batches.
+*/
+static void cc_agents_sync(void)
+{
+	switch_cache_db_handle_t *dbh = NULL;
+	switch_hash_index_t *hi;
+	char *errmsg = NULL;
+	void *val;
+	int pending;
+
+	switch_mutex_lock(globals.mutex);
+	cc_agent_lock();
+
+	switch_mutex_lock(globals.sql_mutex);
+	pending = globals.sql_head || switch_queue_size(globals.sql_queue);
+	switch_mutex_unlock(globals.sql_mutex);
+
+	if (pending || !(dbh = cc_get_db_handle())) {
+		goto end;
+	}
+
+	globals.agent_sync_gen++;
+
+	switch_cache_db_execute_sql_callback(dbh, CC_AGENTS_SELECT, cc_agents_load_callback, NULL, &errmsg);
+	if (!errmsg) {
+		switch_cache_db_execute_sql_callback(dbh, CC_TIERS_SELECT, cc_tiers_load_callback, NULL, &errmsg);
+	}
+
+	if (errmsg) {
+		/* a partial read says nothing about what was deleted */
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "SQL ERR: [agent sync] %s\n", errmsg);
+		free(errmsg);
+		goto end;
+	}
+
+	for (hi = switch_hash_first(NULL, globals.agent_hash); hi;) {
+		cc_agent_t *agent;
+		cc_tier_t *tier, *next;
+
+		switch_hash_this(hi, NULL, NULL, &val);
+		agent = (cc_agent_t *) val;
+
+		if (agent->sync_gen != globals.agent_sync_gen) {
+			/* deleting invalidates the iterator, start over */
+			cc_agent_destroy(agent);
+			hi = switch_hash_first(NULL, globals.agent_hash);
+			continue;
+		}
+
+		for (tier = agent->tiers; tier; tier = next) {
+			next = tier->next;
+			if (tier->sync_gen != globals.agent_sync_gen) {
+				cc_tier_destroy(tier);
+			}
+		}
+
+		hi = switch_hash_next(hi);
+	}
+
+  end:
+	switch_cache_db_release_db_handle(&dbh);
+	cc_agent_unlock();
+	switch_mutex_unlock(globals.mutex);
+}
+
+/* same as the reset of an unclean shutdown done in load_queue() */
+static void cc_agents_reset(void)
+{
+	switch_hash_index_t *hi;
+	void *val;
+
+	cc_agent_lock();
+	for (hi = switch_hash_first(NULL, globals.agent_hash); hi; hi = switch_hash_next(hi)) {
+		cc_agent_t *agent;
+		cc_tier_t *tier;
+
+		switch_hash_this(hi, NULL, NULL, &val);
+		agent = (cc_agent_t *) val;
+
+		if (strcmp(agent->system, "single_box")) {
+			continue;
+		}
+		agent->state = CC_AGENT_STATE_WAITING;
+		cc_agent_set_string(&agent->uuid, "");
+		for (tier = agent->tiers; tier; tier = tier->next) {
+			tier->state = CC_TIER_STATE_READY;
+		}
+	}
+
+	cc_execute_sql_async(switch_mprintf("UPDATE agents SET state = 'Waiting', uuid = '' WHERE system = 'single_box';"
+										"UPDATE tiers SET state = 'Ready' WHERE agent IN (SELECT name FROM agents WHERE system = 'single_box');"));
+	cc_agent_unlock();
+}
+
+static void cc_agents_destroy(void)
+{
+	switch_hash_index_t *hi;
+	void *val;
+
+	cc_agent_lock();
+	while ((hi = switch_hash_first(NULL, globals.agent_hash))) {
+		switch_hash_this(hi, NULL, NULL, &val);
+		cc_agent_destroy((cc_agent_t *) val);
+	}
+	while ((hi = switch_hash_first(NULL, globals.tier_set_hash))) {
+		cc_tier_set_t *set;
+
+		switch_hash_this(hi, NULL, NULL, &val);
+		set = (cc_tier_set_t *) val;
+		switch_core_hash_delete(globals.tier_set_hash, set->queue_name);
+		switch_safe_free(set->tiers);
+		switch_safe_free(set->queue_name);
+		free(set);
+	}
+	cc_agent_unlock();
+}
+
 static cc_queue_t *load_queue(const char *queue_name)
 {
 	cc_queue_t *queue = NULL;
@@ -715,10 +1372,11 @@ static cc_queue_t *load_queue(const char *queue_name)
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Added queue %s\n", queue->name);
 		switch_core_hash_insert(globals.queue_hash, queue->name, queue);
 
+		cc_tier_set_order(queue->name, queue->strategy);
+
 		/* Reset a unclean shutdown */
-		sql = switch_mprintf("UPDATE agents SET state = 'Waiting', uuid = '' WHERE system = 'single_box';"
-				"UPDATE tiers SET state = 'Ready' WHERE agent IN (SELECT name FROM agents WHERE system = 'single_box');"
-				"UPDATE members SET state = '%q', uuid = '' WHERE system = 'single_box';",
+		cc_agents_reset();
+		sql = switch_mprintf("UPDATE members SET state = '%q', uuid = '' WHERE system = 'single_box';",
 					cc_member_state2str(CC_MEMBER_STATE_ABANDONED));
 
 		cc_execute_sql(NULL, sql, NULL);
@@ -727,6 +1385,8 @@ static cc_queue_t *load_queue(const char *queue_name)
 
 end:
 
+	switch_cache_db_release_db_handle(&dbh);
+
 	if (xml) {
 		switch_xml_free(xml);
 	}
@@ -816,23 +1476,21 @@ cc_status_t cc_agent_add(const char *agent, const char *type)
 	char *sql;
 
 	if (!strcasecmp(type, CC_AGENT_TYPE_CALLBACK) || !strcasecmp(type, CC_AGENT_TYPE_UUID_STANDBY)) {
-		char res[256] = "";
+		cc_agent_lock();
 		/* Check to see if agent already exist */
-		sql = switch_mprintf("SELECT count(*) FROM agents WHERE name = '%q'", agent);
-		cc_execute_sql2str(NULL, NULL, sql, res, sizeof(res));
-		switch_safe_free(sql);
-
-		if (atoi(res) != 0) {
+		if (cc_agent_locate(agent)) {
+			cc_agent_unlock();
 			result = CC_STATUS_AGENT_ALREADY_EXIST;
 			goto done;
 		}
 		/* Add Agent */
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Adding Agent %s with type %s with default status %s\n", 
 				agent, type, cc_agent_status2str(CC_AGENT_STATUS_LOGGED_OUT));
+		cc_agent_create(agent, "single_box", type);
 		sql = switch_mprintf("INSERT INTO agents (name, system, type, status, state) VALUES('%q', 'single_box', '%q', '%q', '%q');", 
 				agent, type, cc_agent_status2str(CC_AGENT_STATUS_LOGGED_OUT), cc_agent_state2str(CC_AGENT_STATE_WAITING));
-		cc_execute_sql(NULL, sql, NULL);
-		switch_safe_free(sql);
+		cc_execute_sql_async(sql);
+		cc_agent_unlock();
 	} else {
 		result = CC_STATUS_AGENT_INVALID_TYPE;
 		goto done;
@@ -844,40 +1502,40 @@ done:
 cc_status_t cc_agent_del(const char *agent)
 {
 	cc_status_t result = CC_STATUS_SUCCESS;
-
+	cc_agent_t *a;
 	char *sql;
 
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Deleted Agent %s\n", agent);
+	cc_agent_lock();
+	if ((a = cc_agent_locate(agent))) {
+		cc_agent_destroy(a);
+	}
 	sql = switch_mprintf("DELETE FROM agents WHERE name = '%q';"
 			"DELETE FROM tiers WHERE agent = '%q';",
 			agent, agent);
-	cc_execute_sql(NULL, sql, NULL);
-	switch_safe_free(sql);
+	cc_execute_sql_async(sql);
+	cc_agent_unlock();
 	return result;
 }
 
 cc_status_t cc_agent_get(const char *key, const char *agent, char *ret_result, size_t ret_result_size)
 {
 	cc_status_t result = CC_STATUS_SUCCESS;
-	char *sql;
+	cc_agent_t *a;
 	switch_event_t *event;
 	char res[256];
 
+	cc_agent_lock();
 	/* Check to see if agent already exist */
-	sql = switch_mprintf("SELECT count(*) FROM agents WHERE name = '%q'", agent);
-	cc_execute_sql2str(NULL, NULL, sql, res, sizeof(res));
-	switch_safe_free(sql);
-
-	if (atoi(res) == 0) {
+	if (!(a = cc_agent_locate(agent))) {
+		cc_agent_unlock();
 		result = CC_STATUS_AGENT_NOT_FOUND;
 		goto done;
 	}
+	switch_set_string(res, cc_agent_status2str(a->status));
+	cc_agent_unlock();
 
 	if (!strcasecmp(key, "status") ) { 
-		/* Check to see if agent already exist */
-		sql = switch_mprintf("SELECT %q FROM agents WHERE name = '%q'", key, agent);
-		cc_execute_sql2str(NULL, NULL, sql, res, sizeof(res));
-		switch_safe_free(sql);
 		switch_snprintf(ret_result, ret_result_size, "%s", res);
 		result = CC_STATUS_SUCCESS;
 
@@ -905,38 +1563,49 @@ done:
 cc_status_t cc_agent_update(const char *key, const char *value, const char *agent)
 {
 	cc_status_t result = CC_STATUS_SUCCESS;
+	cc_agent_t *a;
 	char *sql;
 	char res[256];
 	switch_event_t *event;
 
-	/* Check to see if agent already exist */
-	sql = switch_mprintf("SELECT count(*) FROM agents WHERE name = '%q'", agent);
-	cc_execute_sql2str(NULL, NULL, sql, res, sizeof(res));
-	switch_safe_free(sql);
+	cc_agent_lock();
 
-	if (atoi(res) == 0) {
+	/* Check to see if agent already exist */
+	if (!(a = cc_agent_locate(agent))) {
+		cc_agent_unlock();
 		result = CC_STATUS_AGENT_NOT_FOUND;
 		goto done;
 	}
 
 	if (!strcasecmp(key, "status")) {
-		if (cc_agent_str2status(value) != CC_AGENT_STATUS_UNKNOWN) {
+		cc_agent_status_t status = cc_agent_str2status(value);
+
+		if (status != CC_AGENT_STATUS_UNKNOWN) {
 			/* Reset values on available only */
-			if (cc_agent_str2status(value) == CC_AGENT_STATUS_AVAILABLE) {
+			if (status == CC_AGENT_STATUS_AVAILABLE) {
+				if (a->status != status) {
+					a->status = status;
+					a->last_status_change = (long) switch_epoch_time_now(NULL);
+					a->talk_time = 0;
+					a->calls_answered = 0;
+					a->no_answer_count = 0;
+					cc_agent_fix_tiers(a);
+				}
 				sql = switch_mprintf("UPDATE agents SET status = '%q', last_status_change = '%ld', talk_time = 0, calls_answered = 0, no_answer_count = 0"
 						" WHERE name = '%q' AND NOT status = '%q'",
 						value, (long) switch_epoch_time_now(NULL),
 						agent, value);
 			} else {
+				a->status = status;
+				a->last_status_change = (long) switch_epoch_time_now(NULL);
 				sql = switch_mprintf("UPDATE agents SET status = '%q', last_status_change = '%ld' WHERE name = '%q'",
 						value, (long) switch_epoch_time_now(NULL), agent);
 			}
-			cc_execute_sql(NULL, sql, NULL);
-			switch_safe_free(sql);
-
+			cc_execute_sql_async(sql);
+			cc_agent_unlock();
 
 			/* Used to stop any active callback */
-			if (cc_agent_str2status(value) != CC_AGENT_STATUS_AVAILABLE) {
+			if (status != CC_AGENT_STATUS_AVAILABLE) {
 				sql = switch_mprintf("SELECT uuid FROM members WHERE serving_agent = '%q' AND serving_system = 'single_box' AND NOT state = 'Answered'", agent);
 				cc_execute_sql2str(NULL, NULL, sql, res, sizeof(res));
 				switch_safe_free(sql);
@@ -954,21 +1623,27 @@ cc_status_t cc_agent_update(const char *key, const char *value, const char *agen
 				switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "CC-Agent-Status", value);
 				switch_event_fire(&event);
 			}
+			goto done;
 
 		} else {
 			result = CC_STATUS_AGENT_INVALID_STATUS;
-			goto done;
+			goto unlock;
 		}
 	} else if (!strcasecmp(key, "state")) {
-		if (cc_agent_str2state(value) != CC_AGENT_STATE_UNKNOWN) {
-			if (cc_agent_str2state(value) != CC_AGENT_STATE_RECEIVING) {
+		cc_agent_state_t state = cc_agent_str2state(value);
+
+		if (state != CC_AGENT_STATE_UNKNOWN) {
+			a->state = state;
+			if (state != CC_AGENT_STATE_RECEIVING) {
 				sql = switch_mprintf("UPDATE agents SET state = '%q' WHERE name = '%q'", value, agent);
 			} else {
+				a->last_offered_call = (long) switch_epoch_time_now(NULL);
+				cc_agent_fix_tiers(a);
 				sql = switch_mprintf("UPDATE agents SET state = '%q', last_offered_call = '%ld' WHERE name = '%q'",
-						value, (long) switch_epoch_time_now(NULL), agent);
+						value, a->last_offered_call, agent);
 			}
-			cc_execute_sql(NULL, sql, NULL);
-			switch_safe_free(sql);
+			cc_execute_sql_async(sql);
+			cc_agent_unlock();
 
 			result = CC_STATUS_SUCCESS;
 
@@ -978,79 +1653,91 @@ cc_status_t cc_agent_update(const char *key, const char *value, const char *agen
 				switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "CC-Agent-State", value);
 				switch_event_fire(&event);
 			}
+			goto done;
 
 		} else {
 			result = CC_STATUS_AGENT_INVALID_STATE;
-			goto done;
+			goto unlock;
 		}
 	} else if (!strcasecmp(key, "uuid")) {
+		cc_agent_set_string(&a->uuid, value);
+		cc_agent_set_string(&a->system, "single_box");
 		sql = switch_mprintf("UPDATE agents SET uuid = '%q', system = 'single_box' WHERE name = '%q'", value, agent);
-		cc_execute_sql(NULL, sql, NULL);
-		switch_safe_free(sql);
+		cc_execute_sql_async(sql);
 
 		result = CC_STATUS_SUCCESS;
 	} else if (!strcasecmp(key, "contact")) {
+		cc_agent_set_string(&a->contact, value);
+		cc_agent_set_string(&a->system, "single_box");
 		sql = switch_mprintf("UPDATE agents SET contact = '%q', system = 'single_box' WHERE name = '%q'", value, agent);
-		cc_execute_sql(NULL, sql, NULL);
-		switch_safe_free(sql);
+		cc_execute_sql_async(sql);
 
 		result = CC_STATUS_SUCCESS;
 	} else if (!strcasecmp(key, "ready_time")) {
+		a->ready_time = atol(value);
+		cc_agent_set_string(&a->system, "single_box");
 		sql = switch_mprintf("UPDATE agents SET ready_time = '%ld', system = 'single_box' WHERE name = '%q'", atol(value), agent);
-		cc_execute_sql(NULL, sql, NULL);
-		switch_safe_free(sql);
+		cc_execute_sql_async(sql);
 
 		result = CC_STATUS_SUCCESS;
 	} else if (!strcasecmp(key, "busy_delay_time")) {
+		a->busy_delay_time = atoi(value);
+		cc_agent_set_string(&a->system, "single_box");
 		sql = switch_mprintf("UPDATE agents SET busy_delay_time = '%ld', system = 'single_box' WHERE name = '%q'", atol(value), agent);
-		cc_execute_sql(NULL, sql, NULL);
-		switch_safe_free(sql);
+		cc_execute_sql_async(sql);
 
 		result = CC_STATUS_SUCCESS;
 	} else if (!strcasecmp(key, "reject_delay_time")) {
+		a->reject_delay_time = atoi(value);
+		cc_agent_set_string(&a->system, "single_box");
 		sql = switch_mprintf("UPDATE agents SET reject_delay_time = '%ld', system = 'single_box' WHERE name = '%q'", atol(value), agent);
-		cc_execute_sql(NULL, sql, NULL);
-		switch_safe_free(sql);
+		cc_execute_sql_async(sql);
 
 		result = CC_STATUS_SUCCESS;
 	} else if (!strcasecmp(key, "no_answer_delay_time")) {
+		a->no_answer_delay_time = atoi(value);
+		cc_agent_set_string(&a->system, "single_box");
 		sql = switch_mprintf("UPDATE agents SET no_answer_delay_time = '%ld', system = 'single_box' WHERE name = '%q'", atol(value), agent);
-		cc_execute_sql(NULL, sql, NULL);
-		switch_safe_free(sql);
+		cc_execute_sql_async(sql);
 
 		result = CC_STATUS_SUCCESS;
 	} else if (!strcasecmp(key, "type")) {
 		if (strcasecmp(value, CC_AGENT_TYPE_CALLBACK) && strcasecmp(value, CC_AGENT_TYPE_UUID_STANDBY)) {
 			result = CC_STATUS_AGENT_INVALID_TYPE;
-			goto done;
+			goto unlock;
 		}
 
+		cc_agent_set_string(&a->type, value);
 		sql = switch_mprintf("UPDATE agents SET type = '%q' WHERE name = '%q'", value, agent);
-		cc_execute_sql(NULL, sql, NULL);
-		switch_safe_free(sql);
+		cc_execute_sql_async(sql);
 
 		result = CC_STATUS_SUCCESS;
 
 	} else if (!strcasecmp(key, "max_no_answer")) {
+		a->max_no_answer = atoi(value);
+		cc_agent_set_string(&a->system, "single_box");
 		sql = switch_mprintf("UPDATE agents SET max_no_answer = '%d', system = 'single_box' WHERE name = '%q'", atoi(value), agent);
-		cc_execute_sql(NULL, sql, NULL);
-		switch_safe_free(sql);
+		cc_execute_sql_async(sql);
 
 		result = CC_STATUS_SUCCESS;
 
 	} else if (!strcasecmp(key, "wrap_up_time")) {
+		a->wrap_up_time = atoi(value);
+		cc_agent_set_string(&a->system, "single_box");
 		sql = switch_mprintf("UPDATE agents SET wrap_up_time = '%d', system = 'single_box' WHERE name = '%q'", atoi(value), agent);
-		cc_execute_sql(NULL, sql, NULL);
-		switch_safe_free(sql);
+		cc_execute_sql_async(sql);
 
 		result = CC_STATUS_SUCCESS;
 
 	} else {
 		result = CC_STATUS_INVALID_KEY;
-		goto done;
+		goto unlock;
 
 	}
 
+unlock:
+	cc_agent_unlock();
+
 done:
 	if (result == CC_STATUS_SUCCESS) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Updated Agent %s set %s = %s\n", agent, key, value);
@@ -1064,6 +1751,7 @@ cc_status_t cc_tier_add(const char *queue_name, const char *agent, const char *s
 	cc_status_t result = CC_STATUS_SUCCESS;
 	char *sql;
 	cc_queue_t *queue = NULL;
+	cc_agent_t *a;
 	if (!(queue = get_queue(queue_name))) {
 		result = CC_STATUS_QUEUE_NOT_FOUND;
 		goto done;
@@ -1072,33 +1760,28 @@ cc_status_t cc_tier_add(const char *queue_name, const char *agent, const char *s
 	}
 
 	if (cc_tier_str2state(state) != CC_TIER_STATE_UNKNOWN) {
-		char res[256] = "";
+		cc_agent_lock();
 		/* Check to see if agent already exist */
-		sql = switch_mprintf("SELECT count(*) FROM agents WHERE name = '%q'", agent);
-		cc_execute_sql2str(NULL, NULL, sql, res, sizeof(res));
-		switch_safe_free(sql);
-
-		if (atoi(res) == 0) {
+		if (!(a = cc_agent_locate(agent))) {
+			cc_agent_unlock();
 			result = CC_STATUS_AGENT_NOT_FOUND;
 			goto done;
 		}
 
 		/* Check to see if tier already exist */
-		sql = switch_mprintf("SELECT count(*) FROM tiers WHERE agent = '%q' AND queue = '%q'", agent, queue_name);
-		cc_execute_sql2str(NULL, NULL, sql, res, sizeof(res));
-		switch_safe_free(sql);
-
-		if (atoi(res) != 0) {
+		if (cc_tier_locate(a, queue_name)) {
+			cc_agent_unlock();
 			result = CC_STATUS_TIER_ALREADY_EXIST;
 			goto done;
 		}
 
 		/* Add Agent in tier */
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Adding Tier on Queue %s for Agent %s, level %d, position %d\n", queue_name, agent, level, position);
+		cc_tier_create(a, queue_name, cc_tier_str2state(state), level, position);
 		sql = switch_mprintf("INSERT INTO tiers (queue, agent, state, level, position) VALUES('%q', '%q', '%q', '%d', '%d');",
 				queue_name, agent, state, level, position);
-		cc_execute_sql(NULL, sql, NULL);
-		switch_safe_free(sql);
+		cc_execute_sql_async(sql);
+		cc_agent_unlock();
 
 		result = CC_STATUS_SUCCESS;
 	} else {
@@ -1115,29 +1798,21 @@ cc_status_t cc_tier_update(const char *key, const char *value, const char *queue
 {
 	cc_status_t result = CC_STATUS_SUCCESS;
 	char *sql;
-	char res[256];
 	cc_queue_t *queue = NULL;
+	cc_agent_t *a;
+	cc_tier_t *tier;
 
 	/* Check to see if tier already exist */
-	sql = switch_mprintf("SELECT count(*) FROM tiers WHERE agent = '%q' AND queue = '%q'", agent, queue_name);
-	cc_execute_sql2str(NULL, NULL, sql, res, sizeof(res));
-	switch_safe_free(sql);
+	cc_agent_lock();
+	a = cc_agent_locate(agent);
+	tier = a ? cc_tier_locate(a, queue_name) : NULL;
+	cc_agent_unlock();
 
-	if (atoi(res) == 0) {
+	if (!tier) {
 		result = CC_STATUS_TIER_NOT_FOUND;
 		goto done;
 	}
 
-	/* Check to see if agent already exist */
-	sql = switch_mprintf("SELECT count(*) FROM agents WHERE name = '%q'", agent);
-	cc_execute_sql2str(NULL, NULL, sql, res, sizeof(res));
-	switch_safe_free(sql);
-
-	if (atoi(res) == 0) {
-		result = CC_STATUS_AGENT_NOT_FOUND;
-		goto done;
-	}
-
 	if (!(queue = get_queue(queue_name))) {
 		result = CC_STATUS_QUEUE_NOT_FOUND;
 		goto done;
@@ -1145,33 +1820,44 @@ cc_status_t cc_tier_update(const char *key, const char *value, const char *queue
 		queue_rwunlock(queue);
 	}
 
+	/* get_queue() takes globals.mutex, so look the tier up again now that we hold agent_mutex */
+	cc_agent_lock();
+	if (!(a = cc_agent_locate(agent)) || !(tier = cc_tier_locate(a, queue_name))) {
+		result = CC_STATUS_TIER_NOT_FOUND;
+		goto unlock;
+	}
+
 	if (!strcasecmp(key, "state")) {
 		if (cc_tier_str2state(value) != CC_TIER_STATE_UNKNOWN) {
+			tier->state = cc_tier_str2state(value);
 			sql = switch_mprintf("UPDATE tiers SET state = '%q' WHERE queue = '%q' AND agent = '%q'", value, queue_name, agent);
-			cc_execute_sql(NULL, sql, NULL);
-			switch_safe_free(sql);
+			cc_execute_sql_async(sql);
 			result = CC_STATUS_SUCCESS;
 		} else {
 			result = CC_STATUS_TIER_INVALID_STATE;
-			goto done;
+			goto unlock;
 		}
 	} else if (!strcasecmp(key, "level")) {
+		tier->level = atoi(value);
+		cc_tier_set_fix(tier);
 		sql = switch_mprintf("UPDATE tiers SET level = '%d' WHERE queue = '%q' AND agent = '%q'", atoi(value), queue_name, agent);
-		cc_execute_sql(NULL, sql, NULL);
-		switch_safe_free(sql);
+		cc_execute_sql_async(sql);
 
 		result = CC_STATUS_SUCCESS;
 
 	} else if (!strcasecmp(key, "position")) {
+		tier->position = atoi(value);
+		cc_tier_set_fix(tier);
 		sql = switch_mprintf("UPDATE tiers SET position = '%d' WHERE queue = '%q' AND agent = '%q'", atoi(value), queue_name, agent);
-		cc_execute_sql(NULL, sql, NULL);
-		switch_safe_free(sql);
+		cc_execute_sql_async(sql);
 
 		result = CC_STATUS_SUCCESS;
 	} else {
 		result = CC_STATUS_INVALID_KEY;
-		goto done;
+		goto unlock;
 	}	
+unlock:
+	cc_agent_unlock();
 done:
 	if (result == CC_STATUS_SUCCESS) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Updated tier: Agent %s in Queue %s set %s = %s\n", agent, queue_name, key, value);
@@ -1182,18 +1868,135 @@ done:
 cc_status_t cc_tier_del(const char *queue_name, const char *agent)
 {
 	cc_status_t result = CC_STATUS_SUCCESS;
+	cc_agent_t *a;
+	cc_tier_t *tier;
 	char *sql;
 
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Deleted tier Agent %s in Queue %s\n", agent, queue_name);
+	cc_agent_lock();
+	if ((a = cc_agent_locate(agent)) && (tier = cc_tier_locate(a, queue_name))) {
+		cc_tier_destroy(tier);
+	}
 	sql = switch_mprintf("DELETE FROM tiers WHERE queue = '%q' AND agent = '%q';", queue_name, agent);
-	cc_execute_sql(NULL, sql, NULL);
-	switch_safe_free(sql);
+	cc_execute_sql_async(sql);
+	cc_agent_unlock();
 
 	result = CC_STATUS_SUCCESS;
 
 	return result;
 }
 
+static cc_agent_t *cc_agent_locate_system(const char *name, const char *system)
+{
+	cc_agent_t *agent = cc_agent_locate(name);
+
+	if (agent && system && strcmp(agent->system, system)) {
+		agent = NULL;
+	}
+
+	return agent;
+}
+
+static void cc_agent_bridge_start(const char *name, const char *system, const char *uuid)
+{
+	cc_agent_t *agent;
+	long now = (long) switch_epoch_time_now(NULL);
+
+	cc_agent_lock();
+	if ((agent = cc_agent_locate_system(name, system))) {
+		cc_agent_set_string(&agent->uuid, uuid);
+		agent->last_bridge_start = now;
+		agent->calls_answered++;
+		agent->no_answer_count = 0;
+		cc_agent_fix_tiers(agent);
+	}
+	cc_execute_sql_async(switch_mprintf("UPDATE agents SET uuid = '%q', last_bridge_start = '%ld', calls_answered = calls_answered + 1, no_answer_count = 0"
+				" WHERE name = '%q' AND system = '%q'",
+				uuid, now, name, system));
+	cc_agent_unlock();
+}
+
+static void cc_agent_bridge_end(const char *name, const char *system, switch_bool_t clear_uuid)
+{
+	cc_agent_t *agent;
+	long now = (long) switch_epoch_time_now(NULL);
+
+	cc_agent_lock();
+	if ((agent = cc_agent_locate_system(name, system))) {
+		if (clear_uuid) {
+			cc_agent_set_string(&agent->uuid, "");
+		}
+		agent->last_bridge_end = now;
+		agent->talk_time += now - agent->last_bridge_start;
+		cc_agent_fix_tiers(agent);
+	}
+	cc_execute_sql_async(switch_mprintf("UPDATE agents SET %s last_bridge_end = %ld, talk_time = talk_time + (%ld-last_bridge_start) WHERE name = '%q' AND system = '%q';"
+				, (clear_uuid ? "uuid = '',":""), now, now, name, system));
+	cc_agent_unlock();
+}
+
+static void cc_agent_no_answer(const char *name, const char *system)
+{
+	cc_agent_t *agent;
+
+	cc_agent_lock();
+	if ((agent = cc_agent_locate_system(name, system))) {
+		agent->no_answer_count++;
+	}
+	cc_execute_sql_async(switch_mprintf("UPDATE agents SET no_answer_count = no_answer_count + 1 WHERE name = '%q' AND system = '%q';",
+				name, system));
+	cc_agent_unlock();
+}
+
+/* The agent is being offered a member of queue_name, hold its tiers in the other queues */
+static void cc_agent_tiers_offering(const char *name, const char *queue_name)
+{
+	cc_agent_t *agent;
+	cc_tier_t *tier;
+
+	cc_agent_lock();
+	if ((agent = cc_agent_locate(name))) {
+		for (tier = agent->tiers; tier; tier = tier->next) {
+			if (!strcmp(tier->set->queue_name, queue_name)) {
+				tier->state = CC_TIER_STATE_OFFERING;
+			} else if (tier->state == CC_TIER_STATE_READY) {
+				tier->state = CC_TIER_STATE_STANDBY;
+			}
+		}
+	}
+	cc_execute_sql_async(switch_mprintf("UPDATE tiers SET state = '%q' WHERE agent = '%q' AND queue = '%q';"
+				"UPDATE tiers SET state = '%q' WHERE agent = '%q' AND NOT queue = '%q' AND state = '%q';",
+				cc_tier_state2str(CC_TIER_STATE_OFFERING), name, queue_name,
+				cc_tier_state2str(CC_TIER_STATE_STANDBY), name, queue_name, cc_tier_state2str(CC_TIER_STATE_READY)));
+	cc_agent_unlock();
+}
+
+/* Undo cc_agent_tiers_offering() once the call is over */
+static void cc_agent_tiers_release(const char *name, const char *queue_name, cc_tier_state_t tiers_state)
+{
+	cc_agent_t *agent;
+	cc_tier_t *tier;
+
+	cc_agent_lock();
+	if ((agent = cc_agent_locate(name))) {
+		for (tier = agent->tiers; tier; tier = tier->next) {
+			if (!strcmp(tier->set->queue_name, queue_name)) {
+				if (tier->state == CC_TIER_STATE_ACTIVE_INBOUND || tier->state == CC_TIER_STATE_STANDBY || tier->state == CC_TIER_STATE_OFFERING) {
+					tier->state = tiers_state;
+				}
+			} else if (tier->state == CC_TIER_STATE_STANDBY) {
+				tier->state = CC_TIER_STATE_READY;
+			}
+		}
+	}
+	cc_execute_sql_async(switch_mprintf(
+			"UPDATE tiers SET state = '%q' WHERE agent = '%q' AND queue = '%q' AND (state = '%q' OR state = '%q' OR state = '%q');"
+			"UPDATE tiers SET state = '%q' WHERE agent = '%q' AND NOT queue = '%q' AND state = '%q'"
+			, cc_tier_state2str(tiers_state), name, queue_name, cc_tier_state2str(CC_TIER_STATE_ACTIVE_INBOUND), cc_tier_state2str(CC_TIER_STATE_STANDBY), cc_tier_state2str(CC_TIER_STATE_OFFERING),
+			cc_tier_state2str(CC_TIER_STATE_READY), name, queue_name, cc_tier_state2str(CC_TIER_STATE_STANDBY)));
+	cc_agent_unlock();
+}
+
 static switch_status_t load_agent(const char *agent_name)
 {
 	switch_xml_t x_agents, x_agent, cfg, xml;
@@ -1277,6 +2080,8 @@ static switch_status_t load_config(void)
 				globals.debug = atoi(val);
 			} else if (!strcasecmp(var, "dbname")) {
 				globals.dbname = strdup(val);
+			} else if (!strcasecmp(var, "agent-sync-interval")) {
+				globals.agent_sync_interval = atoi(val) > 0 ? atoi(val) : 0;
 			} else if (!strcasecmp(var, "odbc-dsn")) {
 				globals.odbc_dsn = strdup(val);
 
@@ -1300,6 +2105,9 @@ static switch_status_t load_config(void)
 		for (x_queue = switch_xml_child(x_queues, "queue"); x_queue; x_queue = x_queue->next) {
 			load_queue(switch_xml_attr_soft(x_queue, "name"));
 		}
+
+		/* Loading the queues created the tables, bring back the agents and tiers left there by a previous run */
+		cc_agents_load();
 	}
 
 	/* Importing from XML config Agents */
@@ -1519,12 +2327,7 @@ static void *SWITCH_THREAD_FUNC outbound_agent_thread_run(switch_thread_t *threa
 		switch_channel_set_variable_printf(member_channel, "cc_queue_answered_epoch", "%ld", (long) switch_epoch_time_now(NULL)); 
 
 		/* Set UUID of the Agent channel */
-		sql = switch_mprintf("UPDATE agents SET uuid = '%q', last_bridge_start = '%ld', calls_answered = calls_answered + 1, no_answer_count = 0"
-				" WHERE name = '%q' AND system = '%q'",
-				agent_uuid, (long) switch_epoch_time_now(NULL),
-				h->agent_name, h->agent_system);
-		cc_execute_sql(NULL, sql, NULL);
-		switch_safe_free(sql);
+		cc_agent_bridge_start(h->agent_name, h->agent_system, agent_uuid);
 
 		/* Change the agents Status in the tiers */
 		cc_tier_update("state", cc_tier_state2str(CC_TIER_STATE_ACTIVE_INBOUND), h->queue_name, h->agent_name);
@@ -1575,10 +2378,7 @@ static void *SWITCH_THREAD_FUNC outbound_agent_thread_run(switch_thread_t *threa
 
 		/* Update Agents Items */
 		/* Do not remove uuid of the agent if we are a standby agent */
-		sql = switch_mprintf("UPDATE agents SET %s last_bridge_end = %ld, talk_time = talk_time + (%ld-last_bridge_start) WHERE name = '%q' AND system = '%q';"
-				, (strcasecmp(h->agent_type, CC_AGENT_TYPE_UUID_STANDBY)?"uuid = '',":""),  (long) switch_epoch_time_now(NULL), (long) switch_epoch_time_now(NULL), h->agent_name, h->agent_system);
-		cc_execute_sql(NULL, sql, NULL);
-		switch_safe_free(sql);
+		cc_agent_bridge_end(h->agent_name, h->agent_system, strcasecmp(h->agent_type, CC_AGENT_TYPE_UUID_STANDBY) ? SWITCH_TRUE : SWITCH_FALSE);
 
 		/* Remove the member entry from the db (Could become optional to support latter processing) */
 		sql = switch_mprintf("DELETE FROM members WHERE system = 'single_box' AND uuid = '%q'", h->member_uuid);
@@ -1638,10 +2438,7 @@ static void *SWITCH_THREAD_FUNC outbound_agent_thread_run(switch_thread_t *threa
 				tiers_state = CC_TIER_STATE_NO_ANSWER;
 
 				/* Update Agent NO Answer count */
-				sql = switch_mprintf("UPDATE agents SET no_answer_count = no_answer_count + 1 WHERE name = '%q' AND system = '%q';",
-						h->agent_name, h->agent_system);
-				cc_execute_sql(NULL, sql, NULL);
-				switch_safe_free(sql);
+				cc_agent_no_answer(h->agent_name, h->agent_system);
 
 				/* Put Agent on break because he didn't answer often */
 				if (h->max_no_answer > 0 && (h->no_answer_count + 1) >= h->max_no_answer) {
@@ -1677,13 +2474,7 @@ static void *SWITCH_THREAD_FUNC outbound_agent_thread_run(switch_thread_t *threa
 
 done:
 	/* Make Agent Available Again */
-	sql = switch_mprintf(
-			"UPDATE tiers SET state = '%q' WHERE agent = '%q' AND queue = '%q' AND (state = '%q' OR state = '%q' OR state = '%q');"
-			"UPDATE tiers SET state = '%q' WHERE agent = '%q' AND NOT queue = '%q' AND state = '%q'"
-			, cc_tier_state2str(tiers_state), h->agent_name, h->queue_name, cc_tier_state2str(CC_TIER_STATE_ACTIVE_INBOUND), cc_tier_state2str(CC_TIER_STATE_STANDBY), cc_tier_state2str(CC_TIER_STATE_OFFERING),
-			cc_tier_state2str(CC_TIER_STATE_READY), h->agent_name, h->queue_name, cc_tier_state2str(CC_TIER_STATE_STANDBY));
-	cc_execute_sql(NULL, sql, NULL);
-	switch_safe_free(sql);
+	cc_agent_tiers_release(h->agent_name, h->queue_name, tiers_state);
 
 	/* If we are in Status Available On Demand, set state to Idle so we do not receive another call until state manually changed to Waiting */
 	if (!strcasecmp(cc_agent_status2str(CC_AGENT_STATUS_AVAILABLE_ON_DEMAND), h->agent_status)) {
@@ -1728,75 +2519,25 @@ struct agent_callback {
 };
 typedef struct agent_callback agent_callback_t;
 
-static int agents_callback(void *pArg, int argc, char **argv, char **columnNames)
+struct agent_candidate {
+	char *name;
+	char *status;
+	char *contact;
+	char *type;
+	char *uuid;
+	int no_answer_count;
+	int max_no_answer;
+	int reject_delay_time;
+	int busy_delay_time;
+	int no_answer_delay_time;
+	struct agent_candidate *next;
+};
+typedef struct agent_candidate agent_candidate_t;
+
+static int agent_offer_member(agent_callback_t *cbt, agent_candidate_t *c)
 {
-	agent_callback_t *cbt = (agent_callback_t *) pArg;
 	char *sql = NULL;
 	char res[256];
-	char *agent_status = argv[2];
-	char *agent_tier_state = argv[9];
-	char *agent_last_bridge_end = argv[10];
-	char *agent_wrap_up_time = argv[11];
-	char *agent_state = argv[12];
-	char *agent_ready_time = argv[13];
-	char *agent_tier_level = argv[14];
-	char *agent_type = argv[15];
-	char *agent_uuid = argv[16];
-
-	switch_bool_t contact_agent = SWITCH_TRUE;
-
-	cbt->agent_found = SWITCH_TRUE;
-
-	/* Check if we switch to a different tier, if so, check if we should continue further for that member */
-
-	if (cbt->tier_rules_apply == SWITCH_TRUE && atoi(agent_tier_level) > cbt->tier) {
-		/* Continue if no agent was logged in in the previous tier and noagent = true */
-		if (cbt->tier_rule_no_agent_no_wait == SWITCH_TRUE && cbt->tier_agent_available == 0) {
-			cbt->tier = atoi(agent_tier_level);
-			/* Multiple the tier level by the tier wait time */
-		} else if (cbt->tier_rule_wait_multiply_level == SWITCH_TRUE && (long) switch_epoch_time_now(NULL) - atol(cbt->joined_epoch) >= atoi(agent_tier_level) * cbt->tier_rule_wait_second) {
-			cbt->tier = atoi(agent_tier_level);
-			cbt->tier_agent_available = 0;
-			/* Just check if joined is bigger than next tier wait time */
-		} else if (cbt->tier_rule_wait_multiply_level == SWITCH_FALSE && (long) switch_epoch_time_now(NULL) - atol(cbt->joined_epoch) >= cbt->tier_rule_wait_second) {
-			cbt->tier = atoi(agent_tier_level);
-			cbt->tier_agent_available = 0;
-		} else {
-			/* We are not allowed to continue to the next tier of agent */
-			return 1;
-		}
-	}
-	cbt->tier_agent_available++;
-
-	/* If Agent is not in a acceptable tier state, continue */
-	if (! (!strcasecmp(agent_tier_state, cc_tier_state2str(CC_TIER_STATE_NO_ANSWER)) || !strcasecmp(agent_tier_state, cc_tier_state2str(CC_TIER_STATE_READY)))) {
-		contact_agent = SWITCH_FALSE;
-	}
-	if (! (!strcasecmp(agent_state, cc_agent_state2str(CC_AGENT_STATE_WAITING)))) {
-		contact_agent = SWITCH_FALSE;
-	}
-	if (! (atol(agent_last_bridge_end) < ((long) switch_epoch_time_now(NULL) - atol(agent_wrap_up_time)))) {
-		contact_agent = SWITCH_FALSE;
-	}
-	if (! (atol(agent_ready_time) <= (long) switch_epoch_time_now(NULL))) {
-		contact_agent = SWITCH_FALSE;
-	}
-	if (! (strcasecmp(agent_status, cc_agent_status2str(CC_AGENT_STATUS_ON_BREAK)))) {
-		contact_agent = SWITCH_FALSE;
-	}
-
-	if (contact_agent == SWITCH_FALSE) {
-		return 0; /* Continue to next Agent */
-	}
-
-	/* If agent isn't on this box */
-	if (strcasecmp(argv[0],"single_box" /* SELF */)) {
-		if (!strcasecmp(cbt->strategy, "ring-all")) {
-			return 1; /* Abort finding agent for member if we found a match but for a different Server */
-		} else {
-			return 0; /* Skip this Agents only, so we can ring the other one */
-		}
-	}
 
 	if (!strcasecmp(cbt->strategy,"ring-all")) {
 		/* Check if member is a ring-all mode */
@@ -1808,14 +2549,14 @@ static int agents_callback(void *pArg, int argc, char **argv, char **columnNames
 		/* Map the Agent to the member */
 		sql = switch_mprintf("UPDATE members SET serving_agent = '%q', serving_system = 'single_box', state = '%q'"
 				" WHERE state = '%q' AND uuid = '%q' AND system = 'single_box'", 
-				argv[1], cc_member_state2str(CC_MEMBER_STATE_TRYING),
+				c->name, cc_member_state2str(CC_MEMBER_STATE_TRYING),
 				cc_member_state2str(CC_MEMBER_STATE_WAITING), cbt->uuid);
 		cc_execute_sql(NULL, sql, NULL);
 		switch_safe_free(sql);
 
 		/* Check if we won the race to get the member to our selected agent (Used for Multi system purposes) */
 		sql = switch_mprintf("SELECT count(*) FROM members WHERE serving_agent = '%q' AND serving_system = 'single_box' AND uuid = '%q' AND system = 'single_box'",
-				argv[1], cbt->uuid);
+				c->name, cbt->uuid);
 		cc_execute_sql2str(NULL, NULL, sql, res, sizeof(res));
 		switch_safe_free(sql);
 	}
@@ -1836,33 +2577,27 @@ static int agents_callback(void *pArg, int argc, char **argv, char **columnNames
 				h->pool = pool;
 				h->member_uuid = switch_core_strdup(h->pool, cbt->uuid);
 				h->queue_strategy = switch_core_strdup(h->pool, cbt->strategy);
-				h->originate_string = switch_core_strdup(h->pool, argv[3]);
-				h->agent_name = switch_core_strdup(h->pool, argv[1]);
+				h->originate_string = switch_core_strdup(h->pool, c->contact);
+				h->agent_name = switch_core_strdup(h->pool, c->name);
 				h->agent_system = switch_core_strdup(h->pool, "single_box");
-				h->agent_status = switch_core_strdup(h->pool, argv[2]);
-				h->agent_type = switch_core_strdup(h->pool, agent_type);
-				h->agent_uuid = switch_core_strdup(h->pool, agent_uuid);
+				h->agent_status = switch_core_strdup(h->pool, c->status);
+				h->agent_type = switch_core_strdup(h->pool, c->type);
+				h->agent_uuid = switch_core_strdup(h->pool, c->uuid);
 				h->member_joined_epoch = switch_core_strdup(h->pool, cbt->joined_epoch); 
 				h->member_caller_name = switch_core_strdup(h->pool, cbt->caller_name);
 				h->member_caller_number = switch_core_strdup(h->pool, cbt->caller_number);
 				h->queue_name = switch_core_strdup(h->pool, cbt->queue_name);
 				h->record_template = switch_core_strdup(h->pool, cbt->record_template);
-				h->no_answer_count = atoi(argv[4]);
-				h->max_no_answer = atoi(argv[5]);
-				h->reject_delay_time = atoi(argv[6]);
-				h->busy_delay_time = atoi(argv[7]);
-				h->no_answer_delay_time = atoi(argv[8]);
+				h->no_answer_count = c->no_answer_count;
+				h->max_no_answer = c->max_no_answer;
+				h->reject_delay_time = c->reject_delay_time;
+				h->busy_delay_time = c->busy_delay_time;
+				h->no_answer_delay_time = c->no_answer_delay_time;
 			
 
 				cc_agent_update("state", cc_agent_state2str(CC_AGENT_STATE_RECEIVING), h->agent_name);
 
-				sql = switch_mprintf(
-						"UPDATE tiers SET state = '%q' WHERE agent = '%q' AND queue = '%q';"
-						"UPDATE tiers SET state = '%q' WHERE agent = '%q' AND NOT queue = '%q' AND state = '%q';",
-						cc_tier_state2str(CC_TIER_STATE_OFFERING), h->agent_name, h->queue_name,
-						cc_tier_state2str(CC_TIER_STATE_STANDBY), h->agent_name, h->queue_name, cc_tier_state2str(CC_TIER_STATE_READY));
-				cc_execute_sql(NULL, sql, NULL);
-				switch_safe_free(sql);
+				cc_agent_tiers_offering(h->agent_name, h->queue_name);
 
 				switch_threadattr_create(&thd_attr, h->pool);
 				switch_threadattr_detach_set(thd_attr, 1);
@@ -1880,11 +2615,111 @@ static int agents_callback(void *pArg, int argc, char **argv, char **columnNames
 	return 0;
 }
 
+/* 
+   Walk the tiers of the queue in strategy order and collect the agents that can take the member,
+   the first one only unless we ring-all.  The members table is only touched once agent_mutex
+   is released, by agent_offer_member().
+*/
+static void agents_pick(agent_callback_t *cbt)
+{
+	cc_tier_set_t *set;
+	agent_candidate_t *candidates = NULL, **next = &candidates, *c;
+	switch_bool_t ring_all = !strcasecmp(cbt->strategy, "ring-all") ? SWITCH_TRUE : SWITCH_FALSE;
+	switch_bool_t stop = SWITCH_FALSE;
+	long now = (long) switch_epoch_time_now(NULL);
+	uint32_t i;
+
+	cc_agent_lock();
+	if ((set = cc_tier_set_locate(cbt->queue_name, SWITCH_FALSE))) {
+		for (i = 0; i < set->count; i++) {
+			cc_tier_t *tier = set->tiers[i];
+			cc_agent_t *agent = tier->agent;
+
+			if (!(agent->status == CC_AGENT_STATUS_AVAILABLE || agent->status == CC_AGENT_STATUS_ON_BREAK || agent->status == CC_AGENT_STATUS_AVAILABLE_ON_DEMAND)) {
+				continue;
+			}
+
+			cbt->agent_found = SWITCH_TRUE;
+
+			/* Check if we switch to a different tier, if so, check if we should continue further for that member */
+
+			if (cbt->tier_rules_apply == SWITCH_TRUE && tier->level > cbt->tier) {
+				/* Continue if no agent was logged in in the previous tier and noagent = true */
+				if (cbt->tier_rule_no_agent_no_wait == SWITCH_TRUE && cbt->tier_agent_available == 0) {
+					cbt->tier = tier->level;
+					/* Multiple the tier level by the tier wait time */
+				} else if (cbt->tier_rule_wait_multiply_level == SWITCH_TRUE && now - atol(cbt->joined_epoch) >= tier->level * cbt->tier_rule_wait_second) {
+					cbt->tier = tier->level;
+					cbt->tier_agent_available = 0;
+					/* Just check if joined is bigger than next tier wait time */
+				} else if (cbt->tier_rule_wait_multiply_level == SWITCH_FALSE && now - atol(cbt->joined_epoch) >= cbt->tier_rule_wait_second) {
+					cbt->tier = tier->level;
+					cbt->tier_agent_available = 0;
+				} else {
+					/* We are not allowed to continue to the next tier of agent */
+					break;
+				}
+			}
+			cbt->tier_agent_available++;
+
+			/* If Agent is not in a acceptable tier state, continue */
+			if (!(tier->state == CC_TIER_STATE_NO_ANSWER || tier->state == CC_TIER_STATE_READY) ||
+				agent->state != CC_AGENT_STATE_WAITING ||
+				!(agent->last_bridge_end < now - agent->wrap_up_time) ||
+				!(agent->ready_time <= now) ||
+				agent->status == CC_AGENT_STATUS_ON_BREAK) {
+				continue;
+			}
+
+			/* If agent isn't on this box */
+			if (strcasecmp(agent->system, "single_box" /* SELF */)) {
+				if (ring_all) {
+					break; /* Abort finding agent for member if we found a match but for a different Server */
+				} else {
+					continue; /* Skip this Agents only, so we can ring the other one */
+				}
+			}
+
+			c = calloc(1, sizeof(*c));
+			switch_assert(c);
+			c->name = strdup(agent->name);
+			c->status = strdup(cc_agent_status2str(agent->status));
+			c->contact = strdup(agent->contact);
+			c->type = strdup(agent->type);
+			c->uuid = strdup(agent->uuid);
+			c->no_answer_count = (int) agent->no_answer_count;
+			c->max_no_answer = agent->max_no_answer;
+			c->reject_delay_time = agent->reject_delay_time;
+			c->busy_delay_time = agent->busy_delay_time;
+			c->no_answer_delay_time = agent->no_answer_delay_time;
+			*next = c;
+			next = &c->next;
+
+			if (!ring_all) {
+				break;
+			}
+		}
+	}
+	cc_agent_unlock();
+
+	while ((c = candidates)) {
+		candidates = c->next;
+		if (!stop && agent_offer_member(cbt, c)) {
+			stop = SWITCH_TRUE;
+		}
+		switch_safe_free(c->name);
+		switch_safe_free(c->status);
+		switch_safe_free(c->contact);
+		switch_safe_free(c->type);
+		switch_safe_free(c->uuid);
+		free(c);
+	}
+}
+
 static int members_callback(void *pArg, int argc, char **argv, char **columnNames)
 {
 	cc_queue_t *queue = NULL;
 	char *sql = NULL;
-	char *sql_order_by = NULL;
 	char *queue_name = NULL;
 	char *queue_strategy = NULL;
 	char *queue_record_template = NULL;
@@ -1947,37 +2782,14 @@ static int members_callback(void *pArg, int argc, char **argv, char **columnName
 	cbt.record_template = queue_record_template;
 	cbt.agent_found = SWITCH_FALSE;
 	
-	if (!strcasecmp(queue->strategy, "longest-idle-agent")) {
-		sql_order_by = switch_mprintf("level, agents.last_offered_call, position");
-	} else if (!strcasecmp(queue_strategy, "agent-with-least-talk-time")) {
-		sql_order_by = switch_mprintf("level, agents.talk_time, position");
-	} else if (!strcasecmp(queue_strategy, "agent-with-fewest-calls")) {
-		sql_order_by = switch_mprintf("level, agents.calls_answered, position");
-	} else if (!strcasecmp(queue_strategy, "ring-all")) {
+	if (!strcasecmp(queue_strategy, "ring-all")) {
 		sql = switch_mprintf("UPDATE members SET state = '%q' WHERE state = '%q' AND uuid = '%q' AND system = 'single_box'",
 				cc_member_state2str(CC_MEMBER_STATE_TRYING), cc_member_state2str(CC_MEMBER_STATE_WAITING), cbt.uuid);
 		cc_execute_sql(NULL, sql, NULL);
 		switch_safe_free(sql);
-		sql_order_by = switch_mprintf("level, position");
-	} else if(!strcasecmp(queue_strategy, "sequentially-by-agent-order")) {
-		sql_order_by = switch_mprintf("level, position, agents.last_offered_call"); /* Default to last_offered_call, let add new strategy if needing it differently */
-	} else {
-		/* If the strategy doesn't exist, just fallback to the following */
-		sql_order_by = switch_mprintf("level, position, agents.last_offered_call");
 	}
 
-	sql = switch_mprintf("SELECT system, name, status, contact, no_answer_count, max_no_answer, reject_delay_time, busy_delay_time, no_answer_delay_time, tiers.state, agents.last_bridge_end, agents.wrap_up_time, agents.state, agents.ready_time, tiers.level, agents.type, agents.uuid FROM agents LEFT JOIN tiers ON (agents.name = tiers.agent)"
-			" WHERE tiers.queue = '%q'"
-			" AND (agents.status = '%q' OR agents.status = '%q' OR agents.status = '%q')"
-			" ORDER BY %q",
-			queue_name,
-			cc_agent_status2str(CC_AGENT_STATUS_AVAILABLE), cc_agent_status2str(CC_AGENT_STATUS_ON_BREAK), cc_agent_status2str(CC_AGENT_STATUS_AVAILABLE_ON_DEMAND),
-			sql_order_by);
-
-	cc_execute_sql_callback(NULL /* queue */, NULL /* mutex */, sql, agents_callback, &cbt /* Call back variables */);
-
-	switch_safe_free(sql);
-	switch_safe_free(sql_order_by);
+	agents_pick(&cbt);
 
 	/* We update a field in the queue struct so we can kick caller out if waiting for too long with no agent */
 	if (!argv[0] || !(queue = get_queue(argv[0]))) {
@@ -2889,14 +3701,30 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_callcenter_load)
 
 	memset(&globals, 0, sizeof(globals));
 	globals.pool = pool;
+	globals.agent_sync_interval = CC_AGENT_SYNC_INTERVAL;
 
 	switch_core_hash_init(&globals.queue_hash, globals.pool);
+	switch_core_hash_init(&globals.agent_hash, globals.pool);
+	switch_core_hash_init(&globals.tier_set_hash, globals.pool);
 	switch_mutex_init(&globals.mutex, SWITCH_MUTEX_NESTED, globals.pool);
+	switch_mutex_init(&globals.agent_mutex, SWITCH_MUTEX_NESTED, globals.pool);
+	switch_mutex_init(&globals.sql_mutex, SWITCH_MUTEX_NESTED, globals.pool);
+	switch_queue_create(&globals.sql_queue, CC_SQL_QUEUE_LEN, globals.pool);
 
 	if ((status = load_config()) != SWITCH_STATUS_SUCCESS) {
 		return status;
 	}
 
+	/* Until here the agents and tiers tables were written synchronously */
+	{
+		switch_threadattr_t *thd_attr = NULL;
+
+		globals.sql_running = 1;
+		switch_threadattr_create(&thd_attr, globals.pool);
+		switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+		switch_thread_create(&globals.sql_thread, thd_attr, cc_sql_thread_run, NULL, globals.pool);
+	}
+
 	switch_mutex_lock(globals.mutex);
 	globals.running = 1;
 	switch_mutex_unlock(globals.mutex);
@@ -2972,6 +3800,19 @@ SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_callcenter_shutdown)
 		}
 	}
 
+	/* Flush what is left of the agents and tiers writes, the thread drains the queue and we run the rest */
+	if (globals.sql_thread) {
+		switch_status_t st;
+
+		switch_mutex_lock(globals.sql_mutex);
+		globals.sql_running = 0;
+		switch_mutex_unlock(globals.sql_mutex);
+		switch_thread_join(&st, globals.sql_thread);
+		globals.sql_thread = NULL;
+	}
+	cc_sql_flush();
+	cc_agents_destroy();
+
 	switch_mutex_lock(globals.mutex);
 	while ((hi = switch_hash_first(NULL, globals.queue_hash))) {
 		switch_hash_this(hi, &key, &keylen, &val);
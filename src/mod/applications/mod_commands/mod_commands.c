@@ -251,6 +251,22 @@ SWITCH_STANDARD_API(db_cache_function)
 	return SWITCH_STATUS_SUCCESS;
 }
 
+SWITCH_STANDARD_API(regex_cache_function)
+{
+	if (zstr(cmd)) {
+		stream->write_function(stream, "%s", "parameter missing\n");
+	} else if (!strcasecmp(cmd, "status")) {
+		switch_regex_cache_status(stream);
+	} else if (!strcasecmp(cmd, "flush")) {
+		switch_regex_cache_flush();
+		stream->write_function(stream, "+OK\n");
+	} else {
+		stream->write_function(stream, "-USAGE: status|flush\n");
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 SWITCH_STANDARD_API(host_lookup_function)
 {
 	char host[256] = "";
@@ -1331,6 +1347,45 @@ SWITCH_STANDARD_API(xml_locate_function)
 	return SWITCH_STATUS_SUCCESS;
 }
 
+#define XML_USER_CACHE_SYNTAX "status|flush [<user>|*] [<domain>]"
+SWITCH_STANDARD_API(xml_user_cache_function)
+{
+	char *mydata = NULL, *argv[3] = { 0 };
+	int argc = 0;
+
+	if (!zstr(cmd) && (mydata = strdup(cmd))) {
+		argc = switch_separate_string(mydata, ' ', argv, (sizeof(argv) / sizeof(argv[0])));
+	}
+
+	if (argc < 1 || !strcasecmp(argv[0], "status")) {
+		switch_xml_user_cache_stats_t stats;
+		uint64_t lookups;
+
+		switch_xml_user_cache_stats(&stats);
+		lookups = stats.hits + stats.misses;
+
+		stream->write_function(stream, "ttl: %u\n", stats.ttl);
+		stream->write_function(stream, "max-entries: %u\n", stats.max_entries);
+		stream->write_function(stream, "entries: %u\n", stats.entries);
+		stream->write_function(stream, "hits: %" SWITCH_UINT64_T_FMT "\n", stats.hits);
+		stream->write_function(stream, "misses: %" SWITCH_UINT64_T_FMT "\n", stats.misses);
+		stream->write_function(stream, "hit-rate: %.1f%%\n", lookups ? (double) stats.hits * 100 / lookups : 0.0);
+		stream->write_function(stream, "expired: %" SWITCH_UINT64_T_FMT "\n", stats.expired);
+		stream->write_function(stream, "flushed: %" SWITCH_UINT64_T_FMT "\n", stats.flushed);
+	} else if (!strcasecmp(argv[0], "flush")) {
+		const char *user = (argc > 1 && strcmp(argv[1], "*")) ? argv[1] : NULL;
+		uint32_t count = switch_xml_clear_user_cache(user, argv[2]);
+
+		stream->write_function(stream, "+OK flushed %u\n", count);
+	} else {
+		stream->write_function(stream, "-USAGE: %s\n", XML_USER_CACHE_SYNTAX);
+	}
+
+	switch_safe_free(mydata);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 SWITCH_STANDARD_API(reload_acl_function)
 {
 	const char *err;
@@ -1650,6 +1705,7 @@ SWITCH_STANDARD_API(status_function)
 	char *http = NULL;
 	int sps = 0, last_sps = 0;
 	const char *var;
+	switch_core_session_thread_pool_stats_t tp_stats = { 0 };
 
 	switch_core_measure_time(switch_core_uptime(), &duration);
 
@@ -1684,6 +1740,10 @@ SWITCH_STANDARD_API(status_function)
 	stream->write_function(stream, "%d session(s) %d/%d\n", switch_core_session_count(), last_sps, sps);
 	stream->write_function(stream, "%d session(s) max\n", switch_core_session_limit(0));
 	stream->write_function(stream, "min idle cpu %0.2f/%0.2f\n", switch_core_min_idle_cpu(-1.0), switch_core_idle_cpu());
+	switch_core_session_thread_pool_stats(&tp_stats);
+	stream->write_function(stream, "%u session thread(s) %u busy/%u max, %" SWITCH_UINT64_T_FMT " saturated\n",
+						   tp_stats.threads, tp_stats.threads - tp_stats.idle, tp_stats.max, tp_stats.overflow);
+	switch_rtp_port_usage(stream);
 
 	if (html) {
 		stream->write_function(stream, "</b>\n");
@@ -3782,7 +3842,7 @@ SWITCH_STANDARD_API(alias_function)
 	return SWITCH_STATUS_SUCCESS;
 }
 
-#define SHOW_SYNTAX "codec|endpoint|application|api|dialplan|file|timer|calls [count]|channels [count|like <match string>]|distinct_channels|aliases|complete|chat|management|modules|nat_map|say|interfaces|interface_types|tasks|limits"
+#define SHOW_SYNTAX "codec|endpoint|application|api|dialplan|file|timer|calls [count]|channels [count|like <match string>]|distinct_channels|aliases|complete|chat|management|modules|nat_map|say|interfaces|interface_types|tasks|limits|events_queues|timer_stats [<timer_name>]|threads|pools"
 SWITCH_STANDARD_API(show_function)
 {
 	char sql[1024];
@@ -3841,6 +3901,27 @@ SWITCH_STANDARD_API(show_function)
 	if (!command) {
 		stream->write_function(stream, "-USAGE: %s\n", SHOW_SYNTAX);
 		goto end;
+	} else if (!strcasecmp(command, "timer_stats")) {
+		const char *timer_name = argc > 1 ? argv[1] : "sharded";
+
+		if (switch_core_timer_stats(timer_name, stream) != SWITCH_STATUS_SUCCESS) {
+			stream->write_function(stream, "-ERR No statistics for timer %s\n", timer_name);
+		}
+		goto end;
+	} else if (!strcasecmp(command, "threads")) {
+		switch_core_session_thread_pool_stats_t tp_stats = { 0 };
+
+		switch_core_session_thread_pool_stats(&tp_stats);
+		stream->write_function(stream, "Session thread pool:\n");
+		stream->write_function(stream, "  min %u, max %u, idle timeout %us\n", tp_stats.min, tp_stats.max, tp_stats.idle_timeout);
+		stream->write_function(stream, "  threads %u, busy %u, idle %u, peak busy %u\n",
+							   tp_stats.threads, tp_stats.threads - tp_stats.idle, tp_stats.idle, tp_stats.peak);
+		stream->write_function(stream, "  jobs %" SWITCH_UINT64_T_FMT ", threads created %" SWITCH_UINT64_T_FMT ", saturated %" SWITCH_UINT64_T_FMT "\n",
+							   tp_stats.jobs, tp_stats.created, tp_stats.overflow);
+		goto end;
+	} else if (!strcasecmp(command, "pools")) {
+		switch_core_memory_pool_stats(stream);
+		goto end;
 	} else if (!strncasecmp(command, "codec", 5) ||
 			   !strncasecmp(command, "dialplan", 8) ||
 			   !strncasecmp(command, "file", 4) ||
@@ -3945,6 +4026,9 @@ SWITCH_STANDARD_API(show_function)
 		} else {
 			switch_snprintf(sql, sizeof(sql) - 1, "select name, syntax, description, ikey from interfaces where hostname='%s' and type = 'api' order by name", hostname);
 		}
+	} else if (!strcasecmp(command, "events_queues")) {
+		switch_event_queue_stats(stream);
+		goto end;
 	} else if (!strcasecmp(command, "nat_map")) {
 		switch_snprintf(sql, sizeof(sql) - 1,
 						"SELECT port, "
@@ -4987,6 +5071,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_commands_load)
 	SWITCH_ADD_API(commands_api_interface, "console_complete_xml", "", console_complete_xml_function, "<line>");
 	SWITCH_ADD_API(commands_api_interface, "create_uuid", "Create a uuid", uuid_function, UUID_SYNTAX);
 	SWITCH_ADD_API(commands_api_interface, "db_cache", "db cache management", db_cache_function, "status");
+	SWITCH_ADD_API(commands_api_interface, "regex_cache", "compiled regex cache management", regex_cache_function, "status|flush");
 	SWITCH_ADD_API(commands_api_interface, "domain_exists", "check if a domain exists", domain_exists_function, "<domain>");
 	SWITCH_ADD_API(commands_api_interface, "echo", "echo", echo_function, "<data>");
 	SWITCH_ADD_API(commands_api_interface, "escape", "escape a string", escape_function, "<data>");
@@ -5082,12 +5167,15 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_commands_load)
 	SWITCH_ADD_API(commands_api_interface, "uuid_jitterbuffer", "Try to cut out of a call path / attended xfer", 
 				   uuid_jitterbuffer_function, JITTERBUFFER_SYNTAX);
 	SWITCH_ADD_API(commands_api_interface, "xml_locate", "find some xml", xml_locate_function, "[root | <section> <tag> <tag_attr_name> <tag_attr_val>]");
+	SWITCH_ADD_API(commands_api_interface, "xml_user_cache", "Directory user cache", xml_user_cache_function, XML_USER_CACHE_SYNTAX);
 	SWITCH_ADD_API(commands_api_interface, "xml_wrap", "Wrap another api command in xml", xml_wrap_api_function, "<command> <args>");
 	switch_console_set_complete("add alias add");
 	switch_console_set_complete("add alias del");
 	switch_console_set_complete("add complete add");
 	switch_console_set_complete("add complete del");
 	switch_console_set_complete("add db_cache status");
+	switch_console_set_complete("add regex_cache status");
+	switch_console_set_complete("add regex_cache flush");
 	switch_console_set_complete("add fsctl debug_level");
 	switch_console_set_complete("add fsctl last_sps");
 	switch_console_set_complete("add fsctl default_dtmf_duration");
@@ -5145,6 +5233,10 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_commands_load)
 	switch_console_set_complete("add show dialplan");
 	switch_console_set_complete("add show distinct_channels");
 	switch_console_set_complete("add show endpoint");
+	switch_console_set_complete("add show events_queues");
+	switch_console_set_complete("add show timer_stats");
+	switch_console_set_complete("add show threads");
+	switch_console_set_complete("add show pools");
 	switch_console_set_complete("add show file");
 	switch_console_set_complete("add show interfaces");
 	switch_console_set_complete("add show interface_types");
@@ -0,0 +1,401 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2011, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * conference_mix.h -- mixing kernels for the conference mux loop
+ *
+ */
+#ifndef CONFERENCE_MIX_H
+#define CONFERENCE_MIX_H
+
+#include <switch.h>
+
+/* Mixing kernels for the mux loop.  Each variant produces output identical to the scalar
+   reference below; mod_conference picks the best one the CPU supports once at load. */
+#if (defined(__x86_64__) || defined(__i386__)) && \
+	((defined(__clang__) && __clang_major__ >= 4) || \
+	 (!defined(__clang__) && defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define CONF_MIX_X86
+#include <immintrin.h>
+#endif
+
+typedef void (*conference_mix_accumulate_t) (int32_t *mix, const int16_t *in, uint32_t samples);
+typedef void (*conference_mix_reduce_t) (int32_t *mix, const int16_t *in, uint32_t samples);
+typedef void (*conference_mix_subtract_t) (int16_t *out, const int32_t *mix, const int16_t *self, uint32_t self_samples, uint32_t samples);
+typedef uint32_t (*conference_mix_energy32_t) (const int32_t *mix, uint32_t samples);
+typedef uint32_t (*conference_mix_energy16_t) (const int16_t *in, uint32_t samples);
+
+typedef struct {
+	const char *name;
+	/* mix[x] += in[x] */
+	conference_mix_accumulate_t accumulate;
+	/* mix[x] -= in[x] */
+	conference_mix_reduce_t reduce;
+	/* out[x] = saturate(mix[x] - self[x]), self only applies to the first self_samples */
+	conference_mix_subtract_t subtract;
+	/* sum of min(abs(mix[x]), SWITCH_SMAX) */
+	conference_mix_energy32_t energy32;
+	/* sum of abs(in[x]) */
+	conference_mix_energy16_t energy16;
+} conference_mix_kernels_t;
+
+static void mix_accumulate_c(int32_t *mix, const int16_t *in, uint32_t samples)
+{
+	uint32_t x;
+
+	for (x = 0; x < samples; x++) {
+		mix[x] += (int32_t) in[x];
+	}
+}
+
+static void mix_reduce_c(int32_t *mix, const int16_t *in, uint32_t samples)
+{
+	uint32_t x;
+
+	for (x = 0; x < samples; x++) {
+		mix[x] -= (int32_t) in[x];
+	}
+}
+
+static void mix_subtract_c(int16_t *out, const int32_t *mix, const int16_t *self, uint32_t self_samples, uint32_t samples)
+{
+	uint32_t x;
+	int32_t z;
+
+	for (x = 0; x < samples; x++) {
+		z = mix[x];
+		if (x < self_samples) {
+			z -= (int32_t) self[x];
+		}
+		switch_normalize_to_16bit(z);
+		out[x] = (int16_t) z;
+	}
+}
+
+static uint32_t mix_energy32_c(const int32_t *mix, uint32_t samples)
+{
+	uint32_t x, energy = 0;
+	int32_t z;
+
+	for (x = 0; x < samples; x++) {
+		z = abs(mix[x]);
+		switch_normalize_to_16bit(z);
+		energy += (int16_t) z;
+	}
+
+	return energy;
+}
+
+static uint32_t mix_energy16_c(const int16_t *in, uint32_t samples)
+{
+	uint32_t x, energy = 0;
+
+	for (x = 0; x < samples; x++) {
+		energy += abs(in[x]);
+	}
+
+	return energy;
+}
+
+#ifdef CONF_MIX_X86
+/* SSE2 has no 32 bit abs or a 16 to 32 bit sign extension so both are done by hand. */
+#define MIX_SSE2_ABS32(_v) _mm_sub_epi32(_mm_xor_si128(_v, _mm_srai_epi32(_v, 31)), _mm_srai_epi32(_v, 31))
+#define MIX_SSE2_LO32(_v) _mm_srai_epi32(_mm_unpacklo_epi16(_v, _v), 16)
+#define MIX_SSE2_HI32(_v) _mm_srai_epi32(_mm_unpackhi_epi16(_v, _v), 16)
+
+__attribute__ ((target("sse2")))
+static uint32_t mix_sse2_sum32(__m128i acc)
+{
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+	return (uint32_t) _mm_cvtsi128_si32(acc);
+}
+
+__attribute__ ((target("sse2")))
+static void mix_accumulate_sse2(int32_t *mix, const int16_t *in, uint32_t samples)
+{
+	uint32_t x;
+
+	for (x = 0; x + 8 <= samples; x += 8) {
+		__m128i s = _mm_loadu_si128((const __m128i *) (in + x));
+		__m128i *m = (__m128i *) (mix + x);
+
+		_mm_storeu_si128(m, _mm_add_epi32(_mm_loadu_si128(m), MIX_SSE2_LO32(s)));
+		_mm_storeu_si128(m + 1, _mm_add_epi32(_mm_loadu_si128(m + 1), MIX_SSE2_HI32(s)));
+	}
+
+	mix_accumulate_c(mix + x, in + x, samples - x);
+}
+
+__attribute__ ((target("sse2")))
+static void mix_reduce_sse2(int32_t *mix, const int16_t *in, uint32_t samples)
+{
+	uint32_t x;
+
+	for (x = 0; x + 8 <= samples; x += 8) {
+		__m128i s = _mm_loadu_si128((const __m128i *) (in + x));
+		__m128i *m = (__m128i *) (mix + x);
+
+		_mm_storeu_si128(m, _mm_sub_epi32(_mm_loadu_si128(m), MIX_SSE2_LO32(s)));
+		_mm_storeu_si128(m + 1, _mm_sub_epi32(_mm_loadu_si128(m + 1), MIX_SSE2_HI32(s)));
+	}
+
+	mix_reduce_c(mix + x, in + x, samples - x);
+}
+
+__attribute__ ((target("sse2")))
+static void mix_subtract_sse2(int16_t *out, const int32_t *mix, const int16_t *self, uint32_t self_samples, uint32_t samples)
+{
+	uint32_t x;
+
+	if (self_samples > samples) {
+		self_samples = samples;
+	}
+
+	for (x = 0; x + 8 <= self_samples; x += 8) {
+		__m128i s = _mm_loadu_si128((const __m128i *) (self + x));
+		__m128i a = _mm_sub_epi32(_mm_loadu_si128((const __m128i *) (mix + x)), MIX_SSE2_LO32(s));
+		__m128i b = _mm_sub_epi32(_mm_loadu_si128((const __m128i *) (mix + x + 4)), MIX_SSE2_HI32(s));
+
+		_mm_storeu_si128((__m128i *) (out + x), _mm_packs_epi32(a, b));
+	}
+
+	if (x < self_samples) {
+		mix_subtract_c(out + x, mix + x, self + x, self_samples - x, self_samples - x);
+		x = self_samples;
+	}
+
+	for (; x + 8 <= samples; x += 8) {
+		__m128i a = _mm_loadu_si128((const __m128i *) (mix + x));
+		__m128i b = _mm_loadu_si128((const __m128i *) (mix + x + 4));
+
+		_mm_storeu_si128((__m128i *) (out + x), _mm_packs_epi32(a, b));
+	}
+
+	mix_subtract_c(out + x, mix + x, NULL, 0, samples - x);
+}
+
+__attribute__ ((target("sse2")))
+static uint32_t mix_energy32_sse2(const int32_t *mix, uint32_t samples)
+{
+	__m128i acc = _mm_setzero_si128(), ones = _mm_set1_epi16(1);
+	uint32_t x;
+
+	for (x = 0; x + 8 <= samples; x += 8) {
+		__m128i a = _mm_loadu_si128((const __m128i *) (mix + x));
+		__m128i b = _mm_loadu_si128((const __m128i *) (mix + x + 4));
+
+		/* the saturating pack clamps to SWITCH_SMAX, madd against 1 folds pairs into 32 bit lanes */
+		acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_packs_epi32(MIX_SSE2_ABS32(a), MIX_SSE2_ABS32(b)), ones));
+	}
+
+	return mix_sse2_sum32(acc) + mix_energy32_c(mix + x, samples - x);
+}
+
+__attribute__ ((target("sse2")))
+static uint32_t mix_energy16_sse2(const int16_t *in, uint32_t samples)
+{
+	__m128i acc = _mm_setzero_si128();
+	uint32_t x;
+
+	for (x = 0; x + 8 <= samples; x += 8) {
+		__m128i s = _mm_loadu_si128((const __m128i *) (in + x));
+		__m128i lo = MIX_SSE2_LO32(s), hi = MIX_SSE2_HI32(s);
+
+		acc = _mm_add_epi32(acc, _mm_add_epi32(MIX_SSE2_ABS32(lo), MIX_SSE2_ABS32(hi)));
+	}
+
+	return mix_sse2_sum32(acc) + mix_energy16_c(in + x, samples - x);
+}
+
+/* The compiler does not add a vzeroupper to target("avx2") functions.  Every one of them clears the
+   upper halves itself before it hands the tail to the legacy encoded sse2 code or returns, otherwise
+   each SSE instruction after it pays for the AVX to SSE transition. */
+__attribute__ ((target("avx2")))
+static uint32_t mix_avx2_sum32(__m256i acc)
+{
+	__m128i v = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+
+	v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+	v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+	return (uint32_t) _mm_cvtsi128_si32(v);
+}
+
+__attribute__ ((target("avx2")))
+static void mix_accumulate_avx2(int32_t *mix, const int16_t *in, uint32_t samples)
+{
+	uint32_t x;
+
+	for (x = 0; x + 16 <= samples; x += 16) {
+		__m256i *m = (__m256i *) (mix + x);
+		__m256i a = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (in + x)));
+		__m256i b = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (in + x + 8)));
+
+		_mm256_storeu_si256(m, _mm256_add_epi32(_mm256_loadu_si256(m), a));
+		_mm256_storeu_si256(m + 1, _mm256_add_epi32(_mm256_loadu_si256(m + 1), b));
+	}
+
+	_mm256_zeroupper();
+	mix_accumulate_sse2(mix + x, in + x, samples - x);
+}
+
+__attribute__ ((target("avx2")))
+static void mix_reduce_avx2(int32_t *mix, const int16_t *in, uint32_t samples)
+{
+	uint32_t x;
+
+	for (x = 0; x + 16 <= samples; x += 16) {
+		__m256i *m = (__m256i *) (mix + x);
+		__m256i a = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (in + x)));
+		__m256i b = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (in + x + 8)));
+
+		_mm256_storeu_si256(m, _mm256_sub_epi32(_mm256_loadu_si256(m), a));
+		_mm256_storeu_si256(m + 1, _mm256_sub_epi32(_mm256_loadu_si256(m + 1), b));
+	}
+
+	_mm256_zeroupper();
+	mix_reduce_sse2(mix + x, in + x, samples - x);
+}
+
+__attribute__ ((target("avx2")))
+static void mix_subtract_avx2(int16_t *out, const int32_t *mix, const int16_t *self, uint32_t self_samples, uint32_t samples)
+{
+	uint32_t x;
+
+	if (self_samples > samples) {
+		self_samples = samples;
+	}
+
+	/* packs works within 128 bit lanes, the permute puts the 64 bit quarters back in order */
+	for (x = 0; x + 16 <= self_samples; x += 16) {
+		__m256i a = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *) (mix + x)),
+									 _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (self + x))));
+		__m256i b = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *) (mix + x + 8)),
+									 _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (self + x + 8))));
+
+		_mm256_storeu_si256((__m256i *) (out + x), _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+
+	if (x < self_samples) {
+		_mm256_zeroupper();
+		mix_subtract_sse2(out + x, mix + x, self + x, self_samples - x, self_samples - x);
+		x = self_samples;
+	}
+
+	for (; x + 16 <= samples; x += 16) {
+		__m256i a = _mm256_loadu_si256((const __m256i *) (mix + x));
+		__m256i b = _mm256_loadu_si256((const __m256i *) (mix + x + 8));
+
+		_mm256_storeu_si256((__m256i *) (out + x), _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+
+	_mm256_zeroupper();
+	mix_subtract_sse2(out + x, mix + x, NULL, 0, samples - x);
+}
+
+__attribute__ ((target("avx2")))
+static uint32_t mix_energy32_avx2(const int32_t *mix, uint32_t samples)
+{
+	__m256i acc = _mm256_setzero_si256(), ones = _mm256_set1_epi16(1);
+	uint32_t x, energy;
+
+	for (x = 0; x + 16 <= samples; x += 16) {
+		__m256i a = _mm256_abs_epi32(_mm256_loadu_si256((const __m256i *) (mix + x)));
+		__m256i b = _mm256_abs_epi32(_mm256_loadu_si256((const __m256i *) (mix + x + 8)));
+
+		/* lane order does not matter for a sum so the pack is left unpermuted */
+		acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_packs_epi32(a, b), ones));
+	}
+
+	energy = mix_avx2_sum32(acc);
+	_mm256_zeroupper();
+
+	return energy + mix_energy32_sse2(mix + x, samples - x);
+}
+
+__attribute__ ((target("avx2")))
+static uint32_t mix_energy16_avx2(const int16_t *in, uint32_t samples)
+{
+	__m256i acc = _mm256_setzero_si256();
+	uint32_t x, energy;
+
+	for (x = 0; x + 16 <= samples; x += 16) {
+		__m256i a = _mm256_abs_epi32(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (in + x))));
+		__m256i b = _mm256_abs_epi32(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (in + x + 8))));
+
+		acc = _mm256_add_epi32(acc, _mm256_add_epi32(a, b));
+	}
+
+	energy = mix_avx2_sum32(acc);
+	_mm256_zeroupper();
+
+	return energy + mix_energy16_sse2(in + x, samples - x);
+}
+#endif
+
+static const conference_mix_kernels_t conference_mix_scalar = {
+	"scalar", mix_accumulate_c, mix_reduce_c, mix_subtract_c, mix_energy32_c, mix_energy16_c
+};
+
+/* out = saturate(mix - every excluded frame - self) for a listener whose relationships keep it from hearing
+   some of the members in the mix.  scratch gets a copy of the mix so the excluded frames can be taken out a
+   whole frame at a time. */
+static void conference_mix_exclude(const conference_mix_kernels_t *k, int16_t *out, const int32_t *mix, int32_t *scratch,
+								   int16_t **excluded, uint32_t count, const int16_t *self, uint32_t self_samples, uint32_t samples)
+{
+	uint32_t i;
+
+	memcpy(scratch, mix, samples * sizeof(*scratch));
+
+	for (i = 0; i < count; i++) {
+		k->reduce(scratch, excluded[i], samples);
+	}
+
+	k->subtract(out, scratch, self, self_samples, samples);
+}
+
+#ifdef CONF_MIX_X86
+static const conference_mix_kernels_t conference_mix_sse2 = {
+	"sse2", mix_accumulate_sse2, mix_reduce_sse2, mix_subtract_sse2, mix_energy32_sse2, mix_energy16_sse2
+};
+
+static const conference_mix_kernels_t conference_mix_avx2 = {
+	"avx2", mix_accumulate_avx2, mix_reduce_avx2, mix_subtract_avx2, mix_energy32_avx2, mix_energy16_avx2
+};
+#endif
+
+#endif
+
+/* For Emacs:
+ * Local Variables:
+ * mode:c
+ * indent-tabs-mode:t
+ * tab-width:4
+ * c-basic-offset:4
+ * End:
+ * For VIM:
+ * vim:set softtabstop=4 shiftwidth=4 tabstop=4:
+ */
@@ -36,6 +36,7 @@
  *
  */
 #include <switch.h>
+#include "conference_mix.h"
 #define DEFAULT_AGC_LEVEL 1100
 #define CONFERENCE_UUID_VARIABLE "conference_uuid"
 
@@ -62,6 +63,7 @@ static int EC = 0;
 #define CONF_DBLOCK_SIZE CONF_BUFFER_SIZE
 #define CONF_DBUFFER_SIZE CONF_BUFFER_SIZE
 #define CONF_DBUFFER_MAX 0
+#define CONF_GROUP_BLOCK_SIZE 4096
 #define CONF_CHAT_PROTO "conf"
 
 #ifndef MIN
@@ -100,6 +102,25 @@ static struct {
 	switch_event_node_t *node;
 } globals;
 
+static conference_mix_kernels_t mix_kernels;
+
+static void conference_mix_init(void)
+{
+	mix_kernels = conference_mix_scalar;
+
+#ifdef CONF_MIX_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2")) {
+		mix_kernels = conference_mix_avx2;
+	} else if (__builtin_cpu_supports("sse2")) {
+		mix_kernels = conference_mix_sse2;
+	}
+#endif
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Using %s conference mixing kernels.\n", mix_kernels.name);
+}
+
 /* forward declaration for conference_obj and caller_control */
 struct conference_member;
 typedef struct conference_member conference_member_t;
@@ -155,7 +176,8 @@ typedef enum {
 	CFLAG_WAIT_MOD = (1 << 7),
 	CFLAG_VID_FLOOR = (1 << 8),
 	CFLAG_WASTE_BANDWIDTH = (1 << 9),
-	CFLAG_OUTCALL = (1 << 10)
+	CFLAG_OUTCALL = (1 << 10),
+	CFLAG_LISTENER_GROUPS = (1 << 11)
 } conf_flag_t;
 
 typedef enum {
@@ -219,6 +241,17 @@ typedef struct conf_xml_cfg {
 } conf_xml_cfg_t;
 
 /* Conference Object */
+/* Listen-only members that share a write codec get the mix encoded once per tick */
+typedef struct conference_listener_group {
+	const switch_codec_implementation_t *implementation;
+	char *fmtp;
+	switch_codec_t codec;
+	uint32_t tick;
+	uint32_t encoded_len;
+	uint8_t encoded[SWITCH_RECOMMENDED_BUFFER_SIZE];
+	struct conference_listener_group *next;
+} conference_listener_group_t;
+
 typedef struct conference_obj {
 	char *name;
 	char *timer_name;
@@ -294,6 +327,11 @@ typedef struct conference_obj {
 	char *uuid_str;
 	uint32_t originating;
 	switch_call_cause_t cancel_cause;
+	conference_listener_group_t *listener_groups;
+	uint32_t group_tick;
+	conference_member_t **mix_speakers;
+	int16_t **mix_excluded;
+	uint32_t mix_alloc;
 } conference_obj_t;
 
 /* Relationship with another member */
@@ -355,6 +393,11 @@ struct conference_member {
 	uint32_t avg_tally;
 	struct conference_member *next;
 	switch_ivr_dmachine_t *dmachine;
+	const switch_codec_implementation_t *group_impl;
+	char *group_fmtp;
+	conference_listener_group_t *group;
+	switch_buffer_t *group_buffer;
+	uint32_t group_frames;
 };
 
 /* Record Node */
@@ -832,6 +875,13 @@ static switch_status_t conference_del_member(conference_obj_t *conference, confe
 	lock_member(member);
 	switch_clear_flag(member, MFLAG_INTREE);
 
+	/* listener groups belong to the conference we are leaving */
+	member->group = NULL;
+	member->group_frames = 0;
+	if (member->group_buffer) {
+		switch_buffer_zero(member->group_buffer);
+	}
+
 	for (imember = conference->members; imember; imember = imember->next) {
 		if (imember == member) {
 			if (last) {
@@ -1040,10 +1090,155 @@ static void *SWITCH_THREAD_FUNC conference_video_thread_run(switch_thread_t *thr
 }
 
 /* Main monitor thread (1 per distinct conference room) */
+/* Find or create the listener group for a write codec, must be called with conference->mutex held */
+static conference_listener_group_t *conference_get_listener_group(conference_obj_t *conference, const switch_codec_implementation_t *impl,
+																  const char *fmtp)
+{
+	conference_listener_group_t *group;
+
+	for (group = conference->listener_groups; group; group = group->next) {
+		if (group->implementation == impl && !strcmp(switch_str_nil(group->fmtp), switch_str_nil(fmtp))) {
+			return group;
+		}
+	}
+
+	group = switch_core_alloc(conference->pool, sizeof(*group));
+	group->implementation = impl;
+	group->fmtp = fmtp ? switch_core_strdup(conference->pool, fmtp) : NULL;
+
+	/* a group whose codec can't be set up is kept anyway so we don't retry on every frame */
+	if (switch_core_codec_init(&group->codec, impl->iananame, group->fmtp, impl->samples_per_second, impl->microseconds_per_packet / 1000,
+							   impl->number_of_channels, SWITCH_CODEC_FLAG_ENCODE | SWITCH_CODEC_FLAG_DECODE, NULL,
+							   conference->pool) == SWITCH_STATUS_SUCCESS) {
+		if (group->codec.implementation != impl) {
+			switch_core_codec_destroy(&group->codec);
+		}
+	}
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Conference %s new listener group %s@%uh %dms%s\n", conference->name,
+					  impl->iananame, impl->samples_per_second, impl->microseconds_per_packet / 1000,
+					  switch_core_codec_ready(&group->codec) ? "" : " (codec unavailable)");
+
+	group->next = conference->listener_groups;
+	conference->listener_groups = group;
+
+	return group;
+}
+
+/* Hand a listen-only member this tick's shared encoding of the mix instead of its own pcm frame.
+   Must be called with conference->mutex held, returns SWITCH_FALSE if the member needs its own mix. */
+static switch_bool_t conference_member_group_write(conference_obj_t *conference, conference_member_t *member, int32_t *main_frame, uint32_t samples)
+{
+	conference_listener_group_t *group;
+	switch_bool_t r = SWITCH_FALSE;
+	uint32_t len;
+
+	if (!member->group_buffer || conference->relationship_total || member->fnode || member->volume_out_level ||
+		!switch_test_flag(member, MFLAG_CAN_HEAR) || switch_test_flag(member, MFLAG_CAN_SPEAK) || switch_test_flag(member, MFLAG_HAS_AUDIO)) {
+		return SWITCH_FALSE;
+	}
+
+	switch_mutex_lock(member->audio_out_mutex);
+
+	if (!member->group_impl || member->group_impl->actual_samples_per_second != conference->rate ||
+		member->group_impl->samples_per_packet != samples || member->group_impl->number_of_channels != 1) {
+		goto end;
+	}
+
+	if (!(group = member->group) || group->implementation != member->group_impl ||
+		strcmp(switch_str_nil(group->fmtp), switch_str_nil(member->group_fmtp))) {
+		group = conference_get_listener_group(conference, member->group_impl, member->group_fmtp);
+	}
+
+	if (!switch_core_codec_ready(&group->codec)) {
+		goto end;
+	}
+
+	if (group->tick != conference->group_tick) {
+		int16_t pcm[SWITCH_RECOMMENDED_BUFFER_SIZE / 2];
+		uint32_t rate = conference->rate;
+		unsigned int flag = 0;
+
+		group->tick = conference->group_tick;
+		group->encoded_len = sizeof(group->encoded);
+		mix_kernels.subtract(pcm, main_frame, NULL, 0, samples);
+
+		if (switch_core_codec_encode(&group->codec, NULL, pcm, samples * 2, conference->rate,
+									 group->encoded, &group->encoded_len, &rate, &flag) != SWITCH_STATUS_SUCCESS) {
+			group->encoded_len = 0;
+		}
+	}
+
+	if (!group->encoded_len) {
+		goto end;
+	}
+
+	if (member->group != group || member->group_frames > 10) {
+		/* new group or the output thread is falling behind, start clean */
+		switch_buffer_zero(member->group_buffer);
+		member->group_frames = 0;
+		member->group = group;
+	}
+
+	if (switch_buffer_inuse(member->mux_buffer)) {
+		switch_buffer_zero(member->mux_buffer);
+	}
+
+	len = group->encoded_len;
+	switch_buffer_write(member->group_buffer, &len, sizeof(len));
+	switch_buffer_write(member->group_buffer, group->encoded, len);
+	member->group_frames++;
+	r = SWITCH_TRUE;
+
+  end:
+
+	switch_mutex_unlock(member->audio_out_mutex);
+
+	return r;
+}
+
+/* Relationships are resolved once per tick into the list of frames a listener must not hear, the mux loop
+   then takes those out a whole frame at a time instead of walking every member for every sample. */
+static uint32_t conference_relationship_exclusions(conference_obj_t *conference, conference_member_t *omember, uint32_t speakers)
+{
+	conference_member_t *imember;
+	conference_relationship_t *rel;
+	uint32_t i, excluded = 0;
+
+	for (i = 0; i < speakers; i++) {
+		imember = conference->mix_speakers[i];
+
+		if (imember == omember) {
+			continue;
+		}
+
+		for (rel = imember->relationships; rel; rel = rel->next) {
+			if ((rel->id == omember->id || rel->id == 0) && !switch_test_flag(rel, RFLAG_CAN_SPEAK)) {
+				break;
+			}
+		}
+
+		if (!rel) {
+			for (rel = omember->relationships; rel; rel = rel->next) {
+				if ((rel->id == imember->id || rel->id == 0) && !switch_test_flag(rel, RFLAG_CAN_HEAR)) {
+					break;
+				}
+			}
+		}
+
+		if (rel) {
+			conference->mix_excluded[excluded++] = (int16_t *) imember->frame;
+		}
+	}
+
+	return excluded;
+}
+
 static void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, void *obj)
 {
 	conference_obj_t *conference = (conference_obj_t *) obj;
 	conference_member_t *imember, *omember;
+	conference_listener_group_t *group;
 	uint32_t samples = switch_samples_per_packet(conference->rate, conference->interval);
 	uint32_t bytes = samples * 2;
 	uint8_t ready = 0, total = 0;
@@ -1053,7 +1248,6 @@ static void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, v
 	uint8_t *async_file_frame;
 	int16_t *bptr;
 	uint32_t x = 0;
-	int32_t z = 0;
 	int member_score_sum = 0;
 	int divisor = 0;
 	
@@ -1251,7 +1445,9 @@ static void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, v
 		if (ready || has_file_data) {
 			/* Use more bits in the main_frame to preserve the exact sum of the audio samples. */
 			int main_frame[SWITCH_RECOMMENDED_BUFFER_SIZE / 2] = { 0 };
+			int32_t rel_frame[SWITCH_RECOMMENDED_BUFFER_SIZE / 2];
 			int16_t write_frame[SWITCH_RECOMMENDED_BUFFER_SIZE / 2] = { 0 };
+			uint32_t speakers = 0, excluded;
 
 
 			/* Init the main frame with file data if there is any. */
@@ -1286,20 +1482,11 @@ static void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, v
 					}
 				}
 				
-				bptr = (int16_t *) omember->frame;
-				for (x = 0; x < omember->read / 2; x++) {
-					main_frame[x] += (int32_t) bptr[x];
-				}
+				mix_kernels.accumulate(main_frame, (int16_t *) omember->frame, omember->read / 2);
 			}
 
 			if (conference->agc_level && conference->member_loop_count) {
-				conf_energy = 0;
-			
-				for (x = 0; x < bytes / 2; x++) {
-					z = abs(main_frame[x]);
-					switch_normalize_to_16bit(z);
-					conf_energy += (int16_t) z;
-				}
+				conf_energy = mix_kernels.energy32(main_frame, bytes / 2);
 				
 				conference->score = conf_energy / ((bytes / 2) / divisor) / conference->member_loop_count;
 
@@ -1308,6 +1495,26 @@ static void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, v
 				if (!conference->avg_itt) conference->avg_tally = conference->score;
 			}
 			
+			conference->group_tick++;
+
+			/* everyone with audio this tick is someone a relationship might keep a listener from hearing */
+			if (conference->relationship_total) {
+				for (imember = conference->members; imember; imember = imember->next) {
+					if (!switch_test_flag(imember, MFLAG_HAS_AUDIO)) {
+						continue;
+					}
+
+					if (speakers == conference->mix_alloc) {
+						conference->mix_alloc = conference->mix_alloc ? conference->mix_alloc * 2 : 16;
+						conference->mix_speakers = realloc(conference->mix_speakers, conference->mix_alloc * sizeof(*conference->mix_speakers));
+						conference->mix_excluded = realloc(conference->mix_excluded, conference->mix_alloc * sizeof(*conference->mix_excluded));
+						switch_assert(conference->mix_speakers && conference->mix_excluded);
+					}
+
+					conference->mix_speakers[speakers++] = imember;
+				}
+			}
+
 			/* Create write frame once per member who is not deaf for each sample in the main frame
 			   check if our audio is involved and if so, subtract it from the sample so we don't hear ourselves.
 			   Since main frame was 32 bit int, we did not lose any detail, now that we have to convert to 16 bit we can
@@ -1325,49 +1532,25 @@ static void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, v
 					continue;
 				}
 
-				bptr = (int16_t *) omember->frame;
-				for (x = 0; x < bytes / 2; x++) {
-					z = main_frame[x];
-					/* bptr[x] represents my own contribution to this audio sample */
-					if (switch_test_flag(omember, MFLAG_HAS_AUDIO) && x <= omember->read / 2) {
-						z -= (int32_t) bptr[x];
-					}
-
-					/* when there are relationships, we have to do more work by scouring all the members to see if there are any 
-					   reasons why we should not be hearing a paticular member, and if not, delete their samples as well.
-					 */
-					if (conference->relationship_total) {
-						for (imember = conference->members; imember; imember = imember->next) {
-							if (imember != omember && switch_test_flag(imember, MFLAG_HAS_AUDIO)) {
-								conference_relationship_t *rel;
-								switch_size_t found = 0;
-								int16_t *rptr = (int16_t *) imember->frame;
-								for (rel = imember->relationships; rel; rel = rel->next) {
-									if ((rel->id == omember->id || rel->id == 0) && !switch_test_flag(rel, RFLAG_CAN_SPEAK)) {
-										z -= (int32_t) rptr[x];
-										found = 1;
-										break;
-									}
-								}
-								if (!found) {
-									for (rel = omember->relationships; rel; rel = rel->next) {
-										if ((rel->id == imember->id || rel->id == 0) && !switch_test_flag(rel, RFLAG_CAN_HEAR)) {
-											z -= (int32_t) rptr[x];
-											break;
-										}
-									}
-								}
-
-							}
-						}
-					}
+				if (switch_test_flag(conference, CFLAG_LISTENER_GROUPS) && conference_member_group_write(conference, omember, main_frame, bytes / 2)) {
+					continue;
+				}
 
-					/* Now we can convert to 16 bit. */
-					switch_normalize_to_16bit(z);
-					write_frame[x] = (int16_t) z;
+				if (!conference->relationship_total || !(excluded = conference_relationship_exclusions(conference, omember, speakers))) {
+					/* the common case is just my own contribution to remove, the kernel does it a vector at a time */
+					mix_kernels.subtract(write_frame, main_frame, (int16_t *) omember->frame,
+										 switch_test_flag(omember, MFLAG_HAS_AUDIO) ? omember->read / 2 + 1 : 0, bytes / 2);
+				} else {
+					/* take out everyone a relationship says I should not hear, then myself */
+					conference_mix_exclude(&mix_kernels, write_frame, main_frame, rel_frame, conference->mix_excluded, excluded,
+										   (int16_t *) omember->frame, switch_test_flag(omember, MFLAG_HAS_AUDIO) ? omember->read / 2 + 1 : 0, bytes / 2);
 				}
-				
+
 				switch_mutex_lock(omember->audio_out_mutex);
+				if (omember->group_frames) {
+					switch_buffer_zero(omember->group_buffer);
+					omember->group_frames = 0;
+				}
 				ok = switch_buffer_write(omember->mux_buffer, write_frame, bytes);
 				switch_mutex_unlock(omember->audio_out_mutex);
 
@@ -1504,6 +1687,17 @@ static void *SWITCH_THREAD_FUNC conference_thread_run(switch_thread_t *thread, v
 		switch_thread_rwlock_unlock(conference->rwlock);
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Write Lock OFF\n");
 
+		for (group = conference->listener_groups; group; group = group->next) {
+			if (switch_core_codec_ready(&group->codec)) {
+				switch_core_codec_destroy(&group->codec);
+			}
+		}
+		conference->listener_groups = NULL;
+
+		switch_safe_free(conference->mix_speakers);
+		switch_safe_free(conference->mix_excluded);
+		conference->mix_alloc = 0;
+
 		if (conference->sh) {
 			switch_speech_flag_t flags = SWITCH_SPEECH_FLAG_NONE;
 			switch_core_speech_close(&conference->lsh, &flags);
@@ -2208,9 +2402,13 @@ static void *SWITCH_THREAD_FUNC conference_loop_input(switch_thread_t *thread, v
 			}
 			
 			if ((samples = read_frame->datalen / sizeof(*data))) {
-				for (i = 0; i < samples; i++) {
-					energy += abs(data[j]);
-					j += member->read_impl.number_of_channels;
+				if (member->read_impl.number_of_channels == 1) {
+					energy = mix_kernels.energy16(data, samples);
+				} else {
+					for (i = 0; i < samples; i++) {
+						energy += abs(data[j]);
+						j += member->read_impl.number_of_channels;
+					}
 				}
 				
 				member->score = energy / samples;
@@ -2482,17 +2680,13 @@ static void member_add_file_data(conference_member_t *member, int16_t *data, swi
 /* launch an input thread for the call leg */
 static void launch_conference_loop_input(conference_member_t *member, switch_memory_pool_t *pool)
 {
-	switch_thread_t *thread;
-	switch_threadattr_t *thd_attr = NULL;
-
 	if (member == NULL)
 		return;
 
-	switch_threadattr_create(&thd_attr, pool);
-	switch_threadattr_detach_set(thd_attr, 1);
-	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
 	switch_set_flag_locked(member, MFLAG_ITHREAD);
-	switch_thread_create(&thread, thd_attr, conference_loop_input, member, pool);
+	if (switch_core_session_thread_pool_launch(conference_loop_input, member, pool) != SWITCH_STATUS_SUCCESS) {
+		switch_clear_flag_locked(member, MFLAG_ITHREAD);
+	}
 }
 
 /* marshall frames from the conference (or file or tts output) to the call leg */
@@ -2519,6 +2713,18 @@ static void conference_loop_output(conference_member_t *member)
 
 	restarting++;
 
+	if (member->group_buffer) {
+		switch_codec_t *session_write_codec = switch_core_session_get_write_codec(member->session);
+
+		switch_mutex_lock(member->audio_out_mutex);
+		member->group_impl = NULL;
+		if (session_write_codec && switch_core_codec_ready(session_write_codec)) {
+			member->group_fmtp = session_write_codec->fmtp_in ? switch_core_session_strdup(member->session, session_write_codec->fmtp_in) : NULL;
+			member->group_impl = session_write_codec->implementation;
+		}
+		switch_mutex_unlock(member->audio_out_mutex);
+	}
+
 	if (switch_test_flag(member, MFLAG_RESTART)) {
 		switch_clear_flag(member, MFLAG_RESTART);
 		switch_set_flag_locked(member, MFLAG_FLUSH_BUFFER);
@@ -2697,7 +2903,34 @@ static void conference_loop_output(conference_member_t *member)
 			}
 		}
 
-		if (mux_used >= bytes) {
+		if (mux_used < bytes && member->group_frames) {
+			/* already encoded by the conference thread for our listener group, pass it straight through */
+			uint32_t len = 0;
+
+			switch_mutex_lock(member->audio_out_mutex);
+			if (member->group && switch_buffer_read(member->group_buffer, &len, sizeof(len)) == sizeof(len) &&
+				len && len <= SWITCH_RECOMMENDED_BUFFER_SIZE && switch_buffer_read(member->group_buffer, data, len) == len) {
+				member->group_frames--;
+				write_frame.data = data;
+				write_frame.datalen = len;
+				write_frame.samples = member->group->implementation->samples_per_packet;
+				write_frame.timestamp = timer.samplecount;
+				write_frame.codec = &member->group->codec;
+				low_count = 0;
+
+				if (switch_core_session_write_frame(member->session, &write_frame, SWITCH_IO_FLAG_NONE, 0) != SWITCH_STATUS_SUCCESS) {
+					write_frame.codec = &member->write_codec;
+					switch_channel_hangup(channel, SWITCH_CAUSE_DESTINATION_OUT_OF_ORDER);
+					switch_mutex_unlock(member->audio_out_mutex);
+					break;
+				}
+				write_frame.codec = &member->write_codec;
+			} else {
+				switch_buffer_zero(member->group_buffer);
+				member->group_frames = 0;
+			}
+			switch_mutex_unlock(member->audio_out_mutex);
+		} else if (mux_used >= bytes) {
 			/* Flush the output buffer and write all the data (presumably muxed) back to the channel */
 			switch_mutex_lock(member->audio_out_mutex);
 			write_frame.data = data;
@@ -2759,9 +2992,13 @@ static void conference_loop_output(conference_member_t *member)
 		}
 
 		if (switch_test_flag(member, MFLAG_FLUSH_BUFFER)) {
-			if (switch_buffer_inuse(member->mux_buffer)) {
+			if (switch_buffer_inuse(member->mux_buffer) || member->group_frames) {
 				switch_mutex_lock(member->audio_out_mutex);
 				switch_buffer_zero(member->mux_buffer);
+				if (member->group_buffer) {
+					switch_buffer_zero(member->group_buffer);
+					member->group_frames = 0;
+				}
 				switch_mutex_unlock(member->audio_out_mutex);
 			}
 			switch_clear_flag_locked(member, MFLAG_FLUSH_BUFFER);
@@ -5388,6 +5625,8 @@ static void set_cflags(const char *flags, uint32_t *f)
 				*f |= CFLAG_VID_FLOOR;
 			} else if (!strcasecmp(argv[i], "waste-bandwidth")) {
 				*f |= CFLAG_WASTE_BANDWIDTH;
+			} else if (!strcasecmp(argv[i], "listener-groups")) {
+				*f |= CFLAG_LISTENER_GROUPS;
 			}
 		}
 
@@ -5585,6 +5824,13 @@ static int setup_media(conference_member_t *member, conference_obj_t *conference
 		goto codec_done1;
 	}
 
+	/* and one for frames already encoded for our listener group */
+	if (switch_test_flag(conference, CFLAG_LISTENER_GROUPS) && !member->group_buffer &&
+		switch_buffer_create_dynamic(&member->group_buffer, CONF_GROUP_BLOCK_SIZE, CONF_GROUP_BLOCK_SIZE, 0) != SWITCH_STATUS_SUCCESS) {
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(member->session), SWITCH_LOG_CRIT, "Memory Error Creating Audio Buffer!\n");
+		goto codec_done1;
+	}
+
 	return 0;
 
   codec_done1:
@@ -6057,6 +6303,7 @@ SWITCH_STANDARD_APP(conference_function)
 	switch_buffer_destroy(&member.resample_buffer);
 	switch_buffer_destroy(&member.audio_buffer);
 	switch_buffer_destroy(&member.mux_buffer);
+	switch_buffer_destroy(&member.group_buffer);
 
 	if (conference) {
 		switch_mutex_lock(conference->mutex);
@@ -6931,6 +7178,8 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_conference_load)
 
 	memset(&globals, 0, sizeof(globals));
 
+	conference_mix_init();
+
 	/* Connect my internal structure to the blank pointer passed to me */
 	*module_interface = switch_loadable_module_create_module_interface(pool, modname);
 
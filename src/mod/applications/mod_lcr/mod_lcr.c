@@ -33,7 +33,7 @@
 #include <switch.h>
 
 #define LCR_SYNTAX "lcr <digits> [<lcr profile>] [caller_id] [intrastate] [as xml]"
-#define LCR_ADMIN_SYNTAX "lcr_admin show profiles"
+#define LCR_ADMIN_SYNTAX "lcr_admin show profiles|show routes|reload routes"
 
 #define LCR_HEADERS_COUNT 7
 
@@ -99,6 +99,16 @@ typedef lcr_obj_t *lcr_route;
 typedef struct max_obj max_obj_t;
 typedef max_obj_t *max_len;
 
+/* the order_by terms a profile can use with the in-memory route table */
+typedef enum {
+	LCR_ORDER_RATE,
+	LCR_ORDER_QUALITY,
+	LCR_ORDER_RELIABILITY
+} lcr_order_t;
+
+#define LCR_MAX_ORDER 4
+#define LCR_MAX_DIGITS 32
+
 struct profile_obj {
 	char *name;
 	uint16_t id;
@@ -118,9 +128,73 @@ struct profile_obj {
 	switch_bool_t quote_in_list;
 	switch_bool_t info_in_headers;
 	switch_bool_t enable_sip_redir;
+
+	switch_bool_t in_memory;
+	lcr_order_t order[LCR_MAX_ORDER];
+	int order_cnt;
 };
 typedef struct profile_obj profile_t;
 
+/* 
+   In-memory route table.  The joined lcr/carriers/carrier_gateway rows are
+   kept in digit order and indexed by a trie whose children are stored
+   contiguously, so a node only needs a bitmap of the digits present and the
+   index of its first child.  Every string is interned once and referenced
+   by id, so the whole table is a handful of flat arrays.
+*/
+typedef struct {
+	uint32_t first_child;
+	uint32_t first_route;
+	uint32_t route_count;
+	uint16_t child_mask;
+} lcr_trie_node_t;
+
+typedef struct {
+	uint32_t carrier_name;
+	uint32_t rate[3];
+	uint32_t gw_prefix;
+	uint32_t gw_suffix;
+	uint32_t lead_strip;
+	uint32_t trail_strip;
+	uint32_t prefix;
+	uint32_t suffix;
+	uint32_t codec;
+	uint32_t cid;
+	uint32_t date_start;
+	uint32_t date_end;
+	int32_t profile_id;
+	float quality;
+	float reliability;
+} lcr_mem_route_t;
+
+typedef struct {
+	uint32_t npanxx;
+	uint32_t state;
+	uint32_t lata;
+} lcr_npanxx_t;
+
+/* index into lcr_mem_route_t.rate */
+#define LCR_RATE_INTERSTATE 0
+#define LCR_RATE_INTRASTATE 1
+#define LCR_RATE_INTRALATA 2
+
+typedef struct {
+	switch_memory_pool_t *pool;
+	lcr_trie_node_t *nodes;
+	uint32_t node_count;
+	lcr_mem_route_t *routes;
+	uint32_t route_count;
+	/* string id 0 is SQL NULL */
+	char **strings;
+	switch_time_t *string_time;
+	uint32_t string_count;
+	lcr_npanxx_t *npanxx;
+	uint32_t npanxx_count;
+	switch_bool_t has_codec;
+	switch_bool_t has_cid;
+	switch_time_t load_time;
+} lcr_route_table_t;
+
 struct callback_obj {
 	lcr_route head;
 	switch_hash_t *dedup_hash;
@@ -146,6 +220,10 @@ static struct {
 	switch_hash_t *profile_hash;
 	profile_t *default_profile;
 	void *filler1;
+	switch_bool_t in_memory_routes;
+	switch_thread_rwlock_t *route_table_rwlock;
+	lcr_route_table_t *route_table;
+	int route_table_loading;
 } globals;
 
 
@@ -723,6 +801,566 @@ static int route_add_callback(void *pArg, int argc, char **argv, char **columnNa
 
 }
 
+/* in-memory route table */
+
+typedef struct {
+	lcr_route_table_t *table;
+	switch_hash_t *string_hash;
+	uint32_t string_alloc;
+	uint32_t route_alloc;
+	uint32_t npanxx_alloc;
+	char **digits;
+} lcr_table_builder_t;
+
+static uint32_t lcr_table_intern(lcr_table_builder_t *builder, const char *str)
+{
+	lcr_route_table_t *table = builder->table;
+	void *val;
+	uint32_t id;
+
+	if (!str) {
+		return 0;
+	}
+
+	if ((val = switch_core_hash_find(builder->string_hash, str))) {
+		return (uint32_t) (intptr_t) val;
+	}
+
+	if (table->string_count == builder->string_alloc) {
+		builder->string_alloc *= 2;
+		table->strings = realloc(table->strings, builder->string_alloc * sizeof(*table->strings));
+		switch_assert(table->strings);
+	}
+
+	id = table->string_count++;
+	table->strings[id] = switch_core_strdup(table->pool, str);
+	switch_core_hash_insert(builder->string_hash, table->strings[id], (void *) (intptr_t) id);
+
+	return id;
+}
+
+static int lcr_table_route_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	lcr_table_builder_t *builder = (lcr_table_builder_t *) pArg;
+	lcr_route_table_t *table = builder->table;
+	lcr_mem_route_t *route;
+	const char *p;
+
+	/* the IN () list of a lookup only ever holds digits so nothing else can match */
+	if (zstr(argv[0])) {
+		return 0;
+	}
+	for (p = argv[0]; *p; p++) {
+		if (!switch_isdigit(*p)) {
+			return 0;
+		}
+	}
+	if (p - argv[0] > LCR_MAX_DIGITS) {
+		return 0;
+	}
+
+	if (table->route_count == builder->route_alloc) {
+		builder->route_alloc *= 2;
+		table->routes = realloc(table->routes, builder->route_alloc * sizeof(*table->routes));
+		builder->digits = realloc(builder->digits, builder->route_alloc * sizeof(*builder->digits));
+		switch_assert(table->routes && builder->digits);
+	}
+
+	builder->digits[table->route_count] = strdup(argv[0]);
+	route = &table->routes[table->route_count++];
+	route->carrier_name = lcr_table_intern(builder, argv[1]);
+	route->rate[LCR_RATE_INTERSTATE] = lcr_table_intern(builder, argv[2]);
+	route->rate[LCR_RATE_INTRASTATE] = lcr_table_intern(builder, argv[3]);
+	route->rate[LCR_RATE_INTRALATA] = lcr_table_intern(builder, argv[4]);
+	route->gw_prefix = lcr_table_intern(builder, argv[5]);
+	route->gw_suffix = lcr_table_intern(builder, argv[6]);
+	route->lead_strip = lcr_table_intern(builder, argv[7]);
+	route->trail_strip = lcr_table_intern(builder, argv[8]);
+	route->prefix = lcr_table_intern(builder, argv[9]);
+	route->suffix = lcr_table_intern(builder, argv[10]);
+	route->codec = lcr_table_intern(builder, argv[11]);
+	route->cid = lcr_table_intern(builder, argv[12]);
+	route->profile_id = argv[13] ? atoi(argv[13]) : -1;
+	route->date_start = lcr_table_intern(builder, argv[14]);
+	route->date_end = lcr_table_intern(builder, argv[15]);
+	route->quality = (float)atof(switch_str_nil(argv[16]));
+	route->reliability = (float)atof(switch_str_nil(argv[17]));
+
+	return 0;
+}
+
+static int lcr_table_npanxx_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	lcr_table_builder_t *builder = (lcr_table_builder_t *) pArg;
+	lcr_route_table_t *table = builder->table;
+	lcr_npanxx_t *npanxx;
+
+	if (zstr(argv[0]) || zstr(argv[1])) {
+		return 0;
+	}
+
+	if (table->npanxx_count == builder->npanxx_alloc) {
+		builder->npanxx_alloc *= 2;
+		table->npanxx = realloc(table->npanxx, builder->npanxx_alloc * sizeof(*table->npanxx));
+		switch_assert(table->npanxx);
+	}
+
+	npanxx = &table->npanxx[table->npanxx_count++];
+	npanxx->npanxx = atoi(argv[0]) * 1000 + atoi(argv[1]);
+	npanxx->state = lcr_table_intern(builder, argv[2]);
+	npanxx->lata = lcr_table_intern(builder, argv[3]);
+
+	return 0;
+}
+
+static char **lcr_sort_digits;
+
+static int lcr_table_digits_cmp(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+	int r;
+
+	if ((r = strcmp(lcr_sort_digits[x], lcr_sort_digits[y]))) {
+		return r;
+	}
+	/* keep database order between rows for the same digits */
+	return x < y ? -1 : x > y;
+}
+
+static int lcr_table_npanxx_cmp(const void *a, const void *b)
+{
+	const lcr_npanxx_t *x = a, *y = b;
+
+	return x->npanxx < y->npanxx ? -1 : x->npanxx > y->npanxx;
+}
+
+static void lcr_route_table_destroy(lcr_route_table_t **tablep)
+{
+	lcr_route_table_t *table = *tablep;
+	switch_memory_pool_t *pool;
+
+	if (!table) {
+		return;
+	}
+
+	*tablep = NULL;
+	switch_safe_free(table->nodes);
+	switch_safe_free(table->routes);
+	switch_safe_free(table->strings);
+	switch_safe_free(table->string_time);
+	switch_safe_free(table->npanxx);
+	pool = table->pool;
+	switch_core_destroy_memory_pool(&pool);
+}
+
+/* sort the routes by digits and lay the trie out breadth first so the children of a node are contiguous */
+static switch_status_t lcr_route_table_index(lcr_route_table_t *table, char **digits)
+{
+	uint32_t *order = NULL, *lo = NULL, *hi = NULL, *depth = NULL;
+	uint32_t node_alloc = 1024, i;
+	lcr_mem_route_t *routes = NULL;
+	switch_status_t status = SWITCH_STATUS_MEMERR;
+
+	if (!(order = malloc((table->route_count + 1) * sizeof(*order)))) {
+		goto end;
+	}
+	for (i = 0; i < table->route_count; i++) {
+		order[i] = i;
+	}
+	lcr_sort_digits = digits;
+	qsort(order, table->route_count, sizeof(*order), lcr_table_digits_cmp);
+	lcr_sort_digits = NULL;
+
+	if (!(table->nodes = malloc(node_alloc * sizeof(*table->nodes))) || !(lo = malloc(node_alloc * sizeof(*lo))) ||
+		!(hi = malloc(node_alloc * sizeof(*hi))) || !(depth = malloc(node_alloc * sizeof(*depth)))) {
+		goto end;
+	}
+
+	table->node_count = 1;
+	lo[0] = 0;
+	hi[0] = table->route_count;
+	depth[0] = 0;
+
+	for (i = 0; i < table->node_count; i++) {
+		uint32_t s = lo[i], h = hi[i], d = depth[i];
+		lcr_trie_node_t *node = &table->nodes[i];
+
+		/* rows ending at this depth sort ahead of the longer ones */
+		while (s < h && digits[order[s]][d] == '\0') {
+			s++;
+		}
+		node->first_route = lo[i];
+		node->route_count = s - lo[i];
+		node->first_child = table->node_count;
+		node->child_mask = 0;
+
+		while (s < h) {
+			char c = digits[order[s]][d];
+			uint32_t e = s, n;
+
+			while (e < h && digits[order[e]][d] == c) {
+				e++;
+			}
+
+			if (table->node_count == node_alloc) {
+				node_alloc *= 2;
+				if (!(table->nodes = realloc(table->nodes, node_alloc * sizeof(*table->nodes))) ||
+					!(lo = realloc(lo, node_alloc * sizeof(*lo))) ||
+					!(hi = realloc(hi, node_alloc * sizeof(*hi))) || !(depth = realloc(depth, node_alloc * sizeof(*depth)))) {
+					goto end;
+				}
+				node = &table->nodes[i];
+			}
+
+			n = table->node_count++;
+			lo[n] = s;
+			hi[n] = e;
+			depth[n] = d + 1;
+			node->child_mask |= (uint16_t) (1 << (c - '0'));
+			s = e;
+		}
+	}
+
+	if (!(routes = malloc((table->route_count + 1) * sizeof(*routes)))) {
+		goto end;
+	}
+	for (i = 0; i < table->route_count; i++) {
+		routes[i] = table->routes[order[i]];
+	}
+	free(table->routes);
+	table->routes = routes;
+
+	status = SWITCH_STATUS_SUCCESS;
+
+  end:
+	switch_safe_free(order);
+	switch_safe_free(lo);
+	switch_safe_free(hi);
+	switch_safe_free(depth);
+	return status;
+}
+
+static lcr_route_table_t *lcr_route_table_build(void)
+{
+	switch_memory_pool_t *pool = NULL;
+	lcr_route_table_t *table;
+	lcr_table_builder_t builder = { 0 };
+	char *sql;
+	uint32_t i;
+	switch_bool_t ok = SWITCH_FALSE;
+
+	switch_core_new_memory_pool(&pool);
+	table = switch_core_alloc(pool, sizeof(*table));
+	table->pool = pool;
+
+	builder.table = table;
+	builder.string_alloc = builder.route_alloc = builder.npanxx_alloc = 1024;
+	table->strings = malloc(builder.string_alloc * sizeof(*table->strings));
+	table->routes = malloc(builder.route_alloc * sizeof(*table->routes));
+	table->npanxx = malloc(builder.npanxx_alloc * sizeof(*table->npanxx));
+	builder.digits = malloc(builder.route_alloc * sizeof(*builder.digits));
+	switch_assert(table->strings && table->routes && table->npanxx && builder.digits);
+	switch_core_hash_init(&builder.string_hash, pool);
+
+	/* id 0 stands in for NULL */
+	table->strings[table->string_count++] = NULL;
+
+	table->has_codec = db_check("SELECT codec from carrier_gateway limit 1");
+	table->has_cid = db_check("SELECT cid from lcr limit 1");
+
+	sql = switch_core_sprintf(pool,
+							  "SELECT l.digits, c.carrier_name, l.rate, %s, %s, cg.prefix, cg.suffix, l.lead_strip, l.trail_strip, l.prefix, l.suffix, %s, %s, "
+							  "l.lcr_profile, l.date_start, l.date_end, l.quality, l.reliability "
+							  "FROM lcr l JOIN carriers c ON l.carrier_id=c.id JOIN carrier_gateway cg ON c.id=cg.carrier_id "
+							  "WHERE c.enabled = '1' AND cg.enabled = '1' AND l.enabled = '1'",
+							  db_check("SELECT intrastate_rate FROM lcr LIMIT 1") ? "l.intrastate_rate" : "NULL",
+							  db_check("SELECT intralata_rate FROM lcr LIMIT 1") ? "l.intralata_rate" : "NULL",
+							  table->has_codec ? "cg.codec" : "NULL",
+							  table->has_cid ? "l.cid" : "NULL");
+
+	if (!lcr_execute_sql_callback(sql, lcr_table_route_callback, &builder)) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Unable to load routes into memory\n");
+		goto end;
+	}
+
+	if (lcr_route_table_index(table, builder.digits) != SWITCH_STATUS_SUCCESS) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Memory Error!\n");
+		goto end;
+	}
+
+	if (db_check("SELECT npa, nxx, state FROM npa_nxx_company_ocn LIMIT 1")) {
+		if (lcr_execute_sql_callback("SELECT npa, nxx, state, lata FROM npa_nxx_company_ocn", lcr_table_npanxx_callback, &builder)) {
+			qsort(table->npanxx, table->npanxx_count, sizeof(*table->npanxx), lcr_table_npanxx_cmp);
+		} else {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Unable to load npa_nxx_company_ocn into memory, using the database for intrastate detection\n");
+			table->npanxx_count = 0;
+		}
+	}
+
+	/* dates are few and repeat on every row so parse each of them once */
+	table->string_time = calloc(table->string_count, sizeof(*table->string_time));
+	switch_assert(table->string_time);
+	for (i = 0; i < table->route_count; i++) {
+		lcr_mem_route_t *route = &table->routes[i];
+
+		if (route->date_start && !table->string_time[route->date_start]) {
+			table->string_time[route->date_start] = switch_str_time(table->strings[route->date_start]);
+		}
+		if (route->date_end && !table->string_time[route->date_end]) {
+			table->string_time[route->date_end] = switch_str_time(table->strings[route->date_end]);
+		}
+	}
+
+	table->load_time = switch_micro_time_now();
+	ok = SWITCH_TRUE;
+
+  end:
+	if (builder.digits) {
+		for (i = 0; i < table->route_count; i++) {
+			free(builder.digits[i]);
+		}
+		free(builder.digits);
+	}
+	switch_core_hash_destroy(&builder.string_hash);
+
+	if (!ok) {
+		lcr_route_table_destroy(&table);
+	}
+
+	return table;
+}
+
+static void *SWITCH_THREAD_FUNC lcr_route_table_thread(switch_thread_t *thread, void *obj)
+{
+	lcr_route_table_t *table, *old = NULL;
+	switch_time_t start = switch_micro_time_now();
+
+	if ((table = lcr_route_table_build())) {
+		switch_thread_rwlock_wrlock(globals.route_table_rwlock);
+		old = globals.route_table;
+		globals.route_table = table;
+		switch_thread_rwlock_unlock(globals.route_table_rwlock);
+
+		lcr_route_table_destroy(&old);
+
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "Loaded %u routes, %u trie nodes and %u npa/nxx entries in %" SWITCH_TIME_T_FMT "ms\n",
+						  table->route_count, table->node_count, table->npanxx_count, (switch_micro_time_now() - start) / 1000);
+	}
+
+	switch_mutex_lock(globals.mutex);
+	globals.route_table_loading = 0;
+	switch_mutex_unlock(globals.mutex);
+
+	return NULL;
+}
+
+static switch_status_t lcr_route_table_load(void)
+{
+	switch_thread_t *thread;
+	switch_threadattr_t *thd_attr = NULL;
+
+	switch_mutex_lock(globals.mutex);
+	if (globals.route_table_loading) {
+		switch_mutex_unlock(globals.mutex);
+		return SWITCH_STATUS_INUSE;
+	}
+	globals.route_table_loading = 1;
+	switch_mutex_unlock(globals.mutex);
+
+	switch_threadattr_create(&thd_attr, globals.pool);
+	switch_threadattr_detach_set(thd_attr, 1);
+	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+	switch_thread_create(&thread, thd_attr, lcr_route_table_thread, NULL, globals.pool);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+/* same answer as the count(DISTINCT ...) query in is_intrastatelata() */
+static void lcr_route_table_intrastatelata(lcr_route_table_t *table, callback_t *cb_struct)
+{
+	uint32_t keys[2], states[2] = { 0 }, latas[2] = { 0 };
+	int nstates = 0, nlatas = 0, k, j;
+
+	keys[0] = atoi(switch_core_sprintf(cb_struct->pool, "%6.6s", cb_struct->lookup_number + 1));
+	keys[1] = atoi(switch_core_sprintf(cb_struct->pool, "%6.6s", cb_struct->cid + 1));
+
+	for (k = 0; k < 2; k++) {
+		lcr_npanxx_t key = { 0 }, *found;
+		uint32_t i;
+
+		key.npanxx = keys[k];
+		if (!(found = bsearch(&key, table->npanxx, table->npanxx_count, sizeof(*table->npanxx), lcr_table_npanxx_cmp))) {
+			continue;
+		}
+		i = (uint32_t) (found - table->npanxx);
+		while (i > 0 && table->npanxx[i - 1].npanxx == key.npanxx) {
+			i--;
+		}
+
+		/* two distinct values are enough to know the answer is not 1 */
+		for (; i < table->npanxx_count && table->npanxx[i].npanxx == key.npanxx; i++) {
+			uint32_t state = table->npanxx[i].state, lata = table->npanxx[i].lata;
+
+			for (j = 0; state && j < nstates && states[j] != state; j++);
+			if (state && j == nstates && nstates < 2) {
+				states[nstates++] = state;
+			}
+			for (j = 0; lata && j < nlatas && latas[j] != lata; j++);
+			if (lata && j == nlatas && nlatas < 2) {
+				latas[nlatas++] = lata;
+			}
+		}
+	}
+
+	if (nstates == 1) {
+		cb_struct->intrastate = SWITCH_TRUE;
+	}
+	if (nlatas == 1) {
+		cb_struct->intralata = SWITCH_TRUE;
+	}
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Type: state, Count: %d\n", nstates);
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Type: lata, Count: %d\n", nlatas);
+}
+
+/* order routes sharing the same digits the way the profile's ORDER BY would */
+static int lcr_route_table_cmp(lcr_route_table_t *table, profile_t *profile, int rate, const lcr_mem_route_t *a, const lcr_mem_route_t *b)
+{
+	int i;
+
+	for (i = 0; i < profile->order_cnt; i++) {
+		double x = 0, y = 0;
+
+		switch (profile->order[i]) {
+		case LCR_ORDER_RATE:
+			x = atof(switch_str_nil(table->strings[a->rate[rate]]));
+			y = atof(switch_str_nil(table->strings[b->rate[rate]]));
+			break;
+		case LCR_ORDER_QUALITY:
+			x = b->quality;
+			y = a->quality;
+			break;
+		case LCR_ORDER_RELIABILITY:
+			x = b->reliability;
+			y = a->reliability;
+			break;
+		}
+
+		if (x != y) {
+			return x < y ? -1 : 1;
+		}
+	}
+
+	return 0;
+}
+
+static switch_bool_t lcr_route_table_lookup(lcr_route_table_t *table, callback_t *cb_struct, const char *digits, int rate)
+{
+	uint32_t path[LCR_MAX_DIGITS];
+	char digit_str[LCR_MAX_DIGITS + 1];
+	int depth = 0, d;
+	uint32_t cur = 0;
+	uint32_t *cand = NULL, cand_alloc = 0;
+	switch_time_t now = switch_micro_time_now();
+	profile_t *profile = cb_struct->profile;
+	char *argv[11], *columnNames[11];
+
+	for (; digits[depth] && depth < LCR_MAX_DIGITS; depth++) {
+		lcr_trie_node_t *node = &table->nodes[cur];
+		int c = digits[depth] - '0';
+		uint16_t below;
+
+		if (c < 0 || c > 9 || !(node->child_mask & (1 << c))) {
+			break;
+		}
+
+		/* children are stored in digit order so the slot is the number of smaller digits present */
+		for (below = node->child_mask & ((1 << c) - 1), cur = node->first_child; below; below &= below - 1) {
+			cur++;
+		}
+		path[depth] = cur;
+	}
+
+	/* ORDER BY digits DESC */
+	for (d = depth - 1; d >= 0; d--) {
+		lcr_trie_node_t *node = &table->nodes[path[d]];
+		uint32_t i, n = 0;
+
+		if (!node->route_count) {
+			continue;
+		}
+
+		if (node->route_count > cand_alloc) {
+			cand_alloc = node->route_count;
+			cand = switch_core_alloc(cb_struct->pool, cand_alloc * sizeof(*cand));
+		}
+
+		for (i = node->first_route; i < node->first_route + node->route_count; i++) {
+			lcr_mem_route_t *route = &table->routes[i];
+
+			if (profile->id > 0 && route->profile_id != profile->id) {
+				continue;
+			}
+			if (!route->date_start || !route->date_end ||
+				now < table->string_time[route->date_start] || now > table->string_time[route->date_end]) {
+				continue;
+			}
+			cand[n++] = i;
+		}
+
+		if (db_random) {
+			for (i = n; i > 1; i--) {
+				uint32_t j = rand() % i, tmp = cand[i - 1];
+				cand[i - 1] = cand[j];
+				cand[j] = tmp;
+			}
+		}
+
+		/* insertion sort is stable and the lists are short */
+		for (i = 1; i < n; i++) {
+			uint32_t v = cand[i], j = i;
+
+			while (j > 0 && lcr_route_table_cmp(table, profile, rate, &table->routes[v], &table->routes[cand[j - 1]]) < 0) {
+				cand[j] = cand[j - 1];
+				j--;
+			}
+			cand[j] = v;
+		}
+
+		memcpy(digit_str, digits, d + 1);
+		digit_str[d + 1] = '\0';
+
+		for (i = 0; i < n; i++) {
+			lcr_mem_route_t *route = &table->routes[cand[i]];
+			int argc = 0;
+
+#define LCR_COLUMN(_name, _val) columnNames[argc] = _name; argv[argc++] = _val
+			LCR_COLUMN("lcr_digits", digit_str);
+			LCR_COLUMN("lcr_carrier_name", table->strings[route->carrier_name]);
+			LCR_COLUMN("lcr_rate_field", table->strings[route->rate[rate]]);
+			LCR_COLUMN("lcr_gw_prefix", table->strings[route->gw_prefix]);
+			LCR_COLUMN("lcr_gw_suffix", table->strings[route->gw_suffix]);
+			LCR_COLUMN("lcr_lead_strip", table->strings[route->lead_strip]);
+			LCR_COLUMN("lcr_trail_strip", table->strings[route->trail_strip]);
+			LCR_COLUMN("lcr_prefix", table->strings[route->prefix]);
+			LCR_COLUMN("lcr_suffix", table->strings[route->suffix]);
+			if (table->has_codec) {
+				LCR_COLUMN("lcr_codec", table->strings[route->codec]);
+			}
+			if (table->has_cid) {
+				LCR_COLUMN("lcr_cid", table->strings[route->cid]);
+			}
+#undef LCR_COLUMN
+
+			if (route_add_callback(cb_struct, argc, argv, columnNames)) {
+				return SWITCH_FALSE;
+			}
+		}
+	}
+
+	return SWITCH_TRUE;
+}
+
 static int intrastatelata_callback(void *pArg, int argc, char **argv, char **columnNames)
 {
 	int count = 0;
@@ -742,7 +1380,7 @@ static int intrastatelata_callback(void *pArg, int argc, char **argv, char **col
 	return SWITCH_STATUS_SUCCESS;
 }
 
-static switch_status_t is_intrastatelata(callback_t *cb_struct)
+static switch_status_t is_intrastatelata(callback_t *cb_struct, lcr_route_table_t *table)
 {
 	char *sql = NULL;
 	
@@ -768,6 +1406,11 @@ static switch_status_t is_intrastatelata(callback_t *cb_struct)
 		return SWITCH_STATUS_SUCCESS;
 	}
 	*/
+
+	if (table && table->npanxx_count) {
+		lcr_route_table_intrastatelata(table, cb_struct);
+		return SWITCH_STATUS_SUCCESS;
+	}
 	
 	sql = switch_core_sprintf(cb_struct->pool,
 								"SELECT 'state', count(DISTINCT state) FROM npa_nxx_company_ocn WHERE (npa=%3.3s AND nxx=%3.3s) OR (npa=%3.3s AND nxx=%3.3s)"
@@ -797,6 +1440,8 @@ static switch_status_t lcr_do_lookup(callback_t *cb_struct)
 	char *safe_sql = NULL;
 	char *rate_field = NULL;
 	char *user_rate_field = NULL;
+	int rate = LCR_RATE_INTERSTATE;
+	lcr_route_table_t *table = NULL;
 	
 	switch_assert(cb_struct->lookup_number != NULL);
 
@@ -812,18 +1457,24 @@ static switch_status_t lcr_do_lookup(callback_t *cb_struct)
 	}
 	
 	digits_expanded = expand_digits(cb_struct->pool, digits_copy, cb_struct->profile->quote_in_list);
+
+	/* the table is only swapped out under the write lock so it stays valid until we are done with it */
+	switch_thread_rwlock_rdlock(globals.route_table_rwlock);
+	table = globals.route_table;
 	
 	if (profile->profile_has_npanxx == SWITCH_TRUE) {
-		is_intrastatelata(cb_struct);
+		is_intrastatelata(cb_struct, table);
 	}
 	
 	/* set our rate field based on env and profile */
 	if (cb_struct->intralata == SWITCH_TRUE && profile->profile_has_intralata == SWITCH_TRUE) {
 		rate_field = switch_core_strdup(cb_struct->pool, "intralata_rate");
 		user_rate_field = switch_core_strdup(cb_struct->pool, "user_intralata_rate");
+		rate = LCR_RATE_INTRALATA;
 	} else if (cb_struct->intrastate == SWITCH_TRUE && profile->profile_has_intrastate == SWITCH_TRUE) {
 		rate_field = switch_core_strdup(cb_struct->pool, "intrastate_rate");
 		user_rate_field = switch_core_strdup(cb_struct->pool, "user_intrastate_rate");
+		rate = LCR_RATE_INTRASTATE;
 	} else {
 		rate_field = switch_core_strdup(cb_struct->pool, "rate");
 		user_rate_field = switch_core_strdup(cb_struct->pool, "user_rate");
@@ -853,6 +1504,14 @@ static switch_status_t lcr_do_lookup(callback_t *cb_struct)
 		switch_event_add_header_string(cb_struct->event, SWITCH_STACK_BOTTOM, "lcr_query_expanded_digits", digits_expanded);
 	}
 
+	if (table && profile->in_memory) {
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(cb_struct->session), SWITCH_LOG_DEBUG, "Using in-memory routes for %s\n", digits_copy);
+		lookup_status = lcr_route_table_lookup(table, cb_struct, digits_copy, rate);
+		switch_thread_rwlock_unlock(globals.route_table_rwlock);
+		goto end;
+	}
+	switch_thread_rwlock_unlock(globals.route_table_rwlock);
+
 	/* set up the query to be executed */
 	/* format the custom_sql */
 	safe_sql = format_custom_sql(profile->custom_sql, cb_struct, digits_copy);
@@ -873,6 +1532,8 @@ static switch_status_t lcr_do_lookup(callback_t *cb_struct)
 	lookup_status = lcr_execute_sql_callback((char *)sql_stream.data, route_add_callback, cb_struct);
 
 	switch_safe_free(sql_stream.data);
+
+  end:
 	switch_core_hash_destroy(&cb_struct->dedup_hash);
 
 	if (lookup_status) {
@@ -904,6 +1565,9 @@ static switch_bool_t test_profile(char *lcr_profile)
 	        SWITCH_TRUE : SWITCH_FALSE;
 }
 
+/* record an order_by term for the in-memory table, which only keeps the first LCR_MAX_ORDER of them */
+#define ADD_ORDER(_o) if (order_cnt < LCR_MAX_ORDER) { order[order_cnt++] = _o; } else { order_in_memory = SWITCH_FALSE; }
+
 static switch_status_t lcr_load_config()
 {
 	char *cf = "lcr.conf";
@@ -934,6 +1598,8 @@ static switch_status_t lcr_load_config()
 						*globals.odbc_pass++ = '\0';
 					}
 				}
+			} else if (!strcasecmp(var, "in-memory-routes") && !zstr(val)) {
+				globals.in_memory_routes = switch_true(val);
 			}
 		}
 	}
@@ -973,6 +1639,9 @@ static switch_status_t lcr_load_config()
 			char *limit_type = NULL;
 			int argc, x = 0;
 			char *argv[4] = { 0 };
+			lcr_order_t order[LCR_MAX_ORDER];
+			int order_cnt = 0;
+			switch_bool_t order_in_memory = SWITCH_TRUE;
 			
 			SWITCH_STANDARD_STREAM(order_by);
 
@@ -991,12 +1660,16 @@ static switch_status_t lcr_load_config()
 							if (!zstr(argv[x])) {
 								if (!strcasecmp(argv[x], "quality")) {
 									thisorder->write_function(thisorder, "%s quality DESC", comma);
+									ADD_ORDER(LCR_ORDER_QUALITY);
 								} else if (!strcasecmp(argv[x], "reliability")) {
 									thisorder->write_function(thisorder, "%s reliability DESC", comma);
+									ADD_ORDER(LCR_ORDER_RELIABILITY);
 								} else if (!strcasecmp(argv[x], "rate")) {
 									thisorder->write_function(thisorder, "%s ${lcr_rate_field}", comma);
+									ADD_ORDER(LCR_ORDER_RATE);
 								} else {
 									thisorder->write_function(thisorder, "%s %s", comma, argv[x]);
+									order_in_memory = SWITCH_FALSE;
 								}
 							} else {
 								switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "arg #%d is empty\n", x);
@@ -1005,10 +1678,13 @@ static switch_status_t lcr_load_config()
 					} else {
 						if (!strcasecmp(val, "quality")) {
 							thisorder->write_function(thisorder, "%s quality DESC", comma);
+							ADD_ORDER(LCR_ORDER_QUALITY);
 						} else if (!strcasecmp(val, "reliability")) {
 							thisorder->write_function(thisorder, "%s reliability DESC", comma);
+							ADD_ORDER(LCR_ORDER_RELIABILITY);
 						} else {
 							thisorder->write_function(thisorder, "%s %s", comma, val);
+							order_in_memory = SWITCH_FALSE;
 						}
 					}
 				} else if (!strcasecmp(var, "id") && !zstr(val)) {
@@ -1039,11 +1715,18 @@ static switch_status_t lcr_load_config()
 				
 				if (!zstr((char *)order_by.data)) {
 					profile->order_by = switch_core_strdup(globals.pool, (char *)order_by.data);
+					memcpy(profile->order, order, sizeof(order));
+					profile->order_cnt = order_cnt;
 				} else {
 					/* default to rate */
 					profile->order_by = ", ${lcr_rate_field}";
+					profile->order[0] = LCR_ORDER_RATE;
+					profile->order_cnt = 1;
 				}
 
+				/* custom sql and unknown order_by columns can only be answered by the database */
+				profile->in_memory = globals.in_memory_routes && zstr(custom_sql) && order_in_memory;
+
 				if (!zstr(id_s)) {
 					profile->id = (uint16_t)atoi(id_s);
 				}
@@ -1878,8 +2561,38 @@ SWITCH_STANDARD_API(dialplan_lcr_admin_function)
 				stream->write_function(stream, " Import fields:\t%s\n", 
 					profile->export_fields_str ? profile->export_fields_str : "(null)");
 				stream->write_function(stream, " Limit type:\t%s\n", profile->limit_type);
+				stream->write_function(stream, " In-memory routes:\t%s\n", profile->in_memory ? "enabled" : "disabled");
 				stream->write_function(stream, "\n");
 			}
+		} else if (!strcasecmp(argv[0], "show") && !strcasecmp(argv[1], "routes")) {
+			switch_thread_rwlock_rdlock(globals.route_table_rwlock);
+			if (globals.route_table) {
+				switch_time_exp_t tm;
+				switch_size_t retsize;
+				char date[80] = "";
+
+				switch_time_exp_lt(&tm, globals.route_table->load_time);
+				switch_strftime_nocheck(date, &retsize, sizeof(date), "%Y-%m-%d %T", &tm);
+				stream->write_function(stream, "Loaded:\t\t%s\n", date);
+				stream->write_function(stream, "Routes:\t\t%u\n", globals.route_table->route_count);
+				stream->write_function(stream, "Trie nodes:\t%u\n", globals.route_table->node_count);
+				stream->write_function(stream, "Strings:\t%u\n", globals.route_table->string_count);
+				stream->write_function(stream, "NPA/NXX:\t%u\n", globals.route_table->npanxx_count);
+			} else {
+				stream->write_function(stream, "No routes loaded in memory\n");
+			}
+			switch_thread_rwlock_unlock(globals.route_table_rwlock);
+			if (globals.route_table_loading) {
+				stream->write_function(stream, "Reload in progress\n");
+			}
+		} else if (!strcasecmp(argv[0], "reload") && !strcasecmp(argv[1], "routes")) {
+			if (!globals.in_memory_routes) {
+				stream->write_function(stream, "-ERR in-memory-routes is not enabled\n");
+			} else if (lcr_route_table_load() != SWITCH_STATUS_SUCCESS) {
+				stream->write_function(stream, "-ERR Reload already in progress\n");
+			} else {
+				stream->write_function(stream, "+OK Reloading routes in the background\n");
+			}
 		} else {
 			goto usage;
 		}
@@ -1913,11 +2626,17 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_lcr_load)
 	if (switch_mutex_init(&globals.mutex, SWITCH_MUTEX_NESTED, globals.pool) != SWITCH_STATUS_SUCCESS) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "failed to initialize mutex\n");
 	}
+	switch_thread_rwlock_create(&globals.route_table_rwlock, globals.pool);
 	if (lcr_load_config() != SWITCH_STATUS_SUCCESS) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Unable to load lcr config file\n");
 		return SWITCH_STATUS_FALSE;
 	}
 
+	/* lookups go to the database until the table is ready */
+	if (globals.in_memory_routes) {
+		lcr_route_table_load();
+	}
+
 	SWITCH_ADD_API(dialplan_lcr_api_interface, "lcr", "Least Cost Routing Module", dialplan_lcr_function, LCR_SYNTAX);
 	SWITCH_ADD_API(dialplan_lcr_api_admin_interface, "lcr_admin", "Least Cost Routing Module Admin", dialplan_lcr_admin_function, LCR_ADMIN_SYNTAX);
 	SWITCH_ADD_APP(app_interface, "lcr", "Perform an LCR lookup", "Perform an LCR lookup",
@@ -1934,6 +2653,13 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_lcr_load)
 
 SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_lcr_shutdown)
 {
+	while (globals.route_table_loading) {
+		switch_yield(100000);
+	}
+
+	switch_thread_rwlock_wrlock(globals.route_table_rwlock);
+	lcr_route_table_destroy(&globals.route_table);
+	switch_thread_rwlock_unlock(globals.route_table_rwlock);
 
 	switch_core_hash_destroy(&globals.profile_hash);
 
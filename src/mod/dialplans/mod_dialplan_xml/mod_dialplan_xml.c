@@ -35,7 +35,8 @@
 #include <fcntl.h>
 
 SWITCH_MODULE_LOAD_FUNCTION(mod_dialplan_xml_load);
-SWITCH_MODULE_DEFINITION(mod_dialplan_xml, mod_dialplan_xml_load, NULL, NULL);
+SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_dialplan_xml_shutdown);
+SWITCH_MODULE_DEFINITION(mod_dialplan_xml, mod_dialplan_xml_load, mod_dialplan_xml_shutdown, NULL);
 
 typedef enum {
 	BREAK_ON_TRUE,
@@ -166,7 +167,8 @@ static int parse_exten(switch_core_session_t *session, switch_caller_profile_t *
 				field_data = "";
 			}
 
-			if ((proceed = switch_regex_perform(field_data, expression, &re, ovector, sizeof(ovector) / sizeof(ovector[0])))) {
+			if ((proceed = switch_regex_perform_ex(field_data, expression, &re, ovector, sizeof(ovector) / sizeof(ovector[0]),
+												   expression_expanded ? SWITCH_TRUE : SWITCH_FALSE))) {
 				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG_CLEAN(session), SWITCH_LOG_DEBUG,
 								  "Dialplan: %s Regex (PASS) [%s] %s(%s) =~ /%s/ break=%s\n",
 								  switch_channel_get_name(channel), exten_name, field, field_data, expression, do_break_a ? do_break_a : "on-false");
@@ -292,6 +294,759 @@ static int parse_exten(switch_core_session_t *session, switch_caller_profile_t *
 	return proceed;
 }
 
+/* Compiled dialplan.  Each context of the main XML root is flattened once into
+   arrays of extensions, conditions and actions with everything that does not
+   depend on the call already resolved.  The program is rebuilt on reloadxml and
+   only used when the dialplan came from the main root (not from a binding or an
+   alternate file), otherwise parse_exten() walks the xml as before. */
+
+typedef enum {
+	DP_FIELD_NONE,
+	DP_FIELD_EXPAND,
+	DP_FIELD_PROFILE,
+	DP_FIELD_DESTINATION_NUMBER,
+	DP_FIELD_CALLER_ID_NAME,
+	DP_FIELD_CALLER_ID_NUMBER,
+	DP_FIELD_ANI,
+	DP_FIELD_NETWORK_ADDR,
+	DP_FIELD_RDNIS,
+	DP_FIELD_USERNAME,
+	DP_FIELD_CONTEXT,
+	DP_FIELD_SOURCE
+} dp_field_t;
+
+typedef struct {
+	const char *application;
+	const char *data;
+	const char *loop;
+	int xinline;
+} dp_action_t;
+
+typedef struct {
+	dp_field_t field_id;
+	const char *field;
+	const char *expression;
+	switch_bool_t dynamic;
+	switch_bool_t substitute;
+	switch_bool_t nested;
+	break_t do_break_i;
+	const char *do_break_a;
+	switch_xml_t xtime;
+	dp_action_t *actions;
+	int action_count;
+	dp_action_t *anti_actions;
+	int anti_action_count;
+} dp_condition_t;
+
+typedef struct {
+	const char *name;
+	const char *cont;
+	dp_condition_t *conditions;
+	int condition_count;
+	const char *prefix;
+	switch_size_t prefix_len;
+} dp_extension_t;
+
+typedef struct {
+	int *list;
+	int count;
+} dp_index_t;
+
+typedef struct {
+	dp_extension_t *extensions;
+	int extension_count;
+	/* extensions worth trying for a destination_number starting with a given byte,
+	   bytes nobody is anchored on share the list of extensions without a prefix */
+	dp_index_t *by_first[256];
+	dp_index_t unanchored;
+} dp_context_t;
+
+typedef struct {
+	switch_memory_pool_t *pool;
+	switch_hash_t *contexts;
+	switch_xml_t *timed;
+	int timed_count;
+	void *root_id;
+	uint32_t generation;
+	int refs;
+} dp_program_t;
+
+static struct {
+	switch_mutex_t *mutex;
+	dp_program_t *program;
+	switch_event_node_t *node;
+	/* bumped on every RELOADXML, a freed root can come back at the same address */
+	uint32_t generation;
+} globals;
+
+static const struct {
+	const char *name;
+	dp_field_t id;
+} dp_fields[] = {
+	{ "destination_number", DP_FIELD_DESTINATION_NUMBER },
+	{ "caller_id_name", DP_FIELD_CALLER_ID_NAME },
+	{ "caller_id_number", DP_FIELD_CALLER_ID_NUMBER },
+	{ "ani", DP_FIELD_ANI },
+	{ "network_addr", DP_FIELD_NETWORK_ADDR },
+	{ "rdnis", DP_FIELD_RDNIS },
+	{ "username", DP_FIELD_USERNAME },
+	{ "context", DP_FIELD_CONTEXT },
+	{ "source", DP_FIELD_SOURCE },
+	{ NULL, DP_FIELD_NONE }
+};
+
+static const char *dp_time_attrs[] = {
+	"date-time", "year", "yday", "mon", "mday", "week", "mweek", "wday", "hour", "minute", "minute-of-day", "time-of-day", NULL
+};
+
+static const char *dp_field_data(dp_field_t id, const char *field, switch_caller_profile_t *caller_profile)
+{
+	switch (id) {
+	case DP_FIELD_DESTINATION_NUMBER:
+		return caller_profile->destination_number;
+	case DP_FIELD_CALLER_ID_NAME:
+		return caller_profile->caller_id_name;
+	case DP_FIELD_CALLER_ID_NUMBER:
+		return caller_profile->caller_id_number;
+	case DP_FIELD_ANI:
+		return caller_profile->ani;
+	case DP_FIELD_NETWORK_ADDR:
+		return caller_profile->network_addr;
+	case DP_FIELD_RDNIS:
+		return caller_profile->rdnis;
+	case DP_FIELD_USERNAME:
+		return caller_profile->username;
+	case DP_FIELD_CONTEXT:
+		return caller_profile->context;
+	case DP_FIELD_SOURCE:
+		return caller_profile->source;
+	default:
+		return switch_caller_get_field_by_name(caller_profile, field);
+	}
+}
+
+/* Literal text a destination_number has to start with for this expression to have
+   any chance of matching, or NULL if that can't be told safely from the pattern. */
+static char *dp_anchored_prefix(switch_memory_pool_t *pool, const char *expression)
+{
+	char prefix[128] = "";
+	const char *p;
+	switch_size_t len = 0;
+
+	if (*expression != '^' || strchr(expression, '|') || strstr(expression, ")?") || strstr(expression, ")*") || strstr(expression, "){")) {
+		return NULL;
+	}
+
+	for (p = expression + 1; *p == '(' && *(p + 1) != '?'; p++);
+
+	for (; *p && len < sizeof(prefix) - 1; p++) {
+		if (isalnum((unsigned char) *p)) {
+			prefix[len++] = *p;
+		} else if (*p == '\\' && *(p + 1) && strchr("+*#.", *(p + 1))) {
+			prefix[len++] = *++p;
+		} else {
+			break;
+		}
+	}
+
+	/* a quantifier makes the last literal optional or repeatable */
+	if (len && *p && strchr("?*{", *p)) {
+		len--;
+	}
+
+	if (!len) {
+		return NULL;
+	}
+
+	prefix[len] = '\0';
+
+	return switch_core_strdup(pool, prefix);
+}
+
+static int dp_compile_actions(dp_program_t *program, switch_xml_t xcond, const char *name, dp_action_t **actions)
+{
+	switch_xml_t xaction;
+	int count = 0, i = 0;
+
+	for (xaction = switch_xml_child(xcond, name); xaction; xaction = xaction->next) {
+		count++;
+	}
+
+	if (!count) {
+		*actions = NULL;
+		return 0;
+	}
+
+	*actions = switch_core_alloc(program->pool, sizeof(dp_action_t) * count);
+
+	for (xaction = switch_xml_child(xcond, name); xaction; xaction = xaction->next) {
+		dp_action_t *action = &(*actions)[i++];
+		const char *loop = switch_xml_attr(xaction, "loop");
+
+		action->application = switch_core_strdup(program->pool, switch_xml_attr_soft(xaction, "application"));
+		if (!zstr(xaction->txt)) {
+			action->data = switch_core_strdup(program->pool, xaction->txt);
+		} else {
+			action->data = switch_core_strdup(program->pool, switch_xml_attr_soft(xaction, "data"));
+		}
+		action->loop = loop ? switch_core_strdup(program->pool, loop) : NULL;
+		action->xinline = switch_true(switch_xml_attr_soft(xaction, "inline"));
+	}
+
+	return count;
+}
+
+static void dp_compile_condition(dp_program_t *program, switch_xml_t xcond, dp_condition_t *cond)
+{
+	switch_xml_t xexpression;
+	const char *field = switch_xml_attr(xcond, "field");
+	const char *expression, *do_break_a;
+	int i;
+
+	cond->nested = switch_xml_child(xcond, "condition") ? SWITCH_TRUE : SWITCH_FALSE;
+
+	if ((xexpression = switch_xml_child(xcond, "expression"))) {
+		expression = switch_str_nil(xexpression->txt);
+	} else {
+		expression = switch_xml_attr_soft(xcond, "expression");
+	}
+
+	cond->expression = switch_core_strdup(program->pool, expression);
+	cond->dynamic = (switch_string_var_check_const(expression) || switch_string_has_escaped_data(expression)) ? SWITCH_TRUE : SWITCH_FALSE;
+	cond->substitute = strchr(expression, '(') ? SWITCH_TRUE : SWITCH_FALSE;
+
+	cond->do_break_i = BREAK_ON_FALSE;
+	if ((do_break_a = switch_xml_attr(xcond, "break"))) {
+		if (!strcasecmp(do_break_a, "on-true")) {
+			cond->do_break_i = BREAK_ON_TRUE;
+		} else if (!strcasecmp(do_break_a, "on-false")) {
+			cond->do_break_i = BREAK_ON_FALSE;
+		} else if (!strcasecmp(do_break_a, "always")) {
+			cond->do_break_i = BREAK_ALWAYS;
+		} else if (!strcasecmp(do_break_a, "never")) {
+			cond->do_break_i = BREAK_NEVER;
+		} else {
+			do_break_a = NULL;
+		}
+	}
+	cond->do_break_a = do_break_a ? switch_core_strdup(program->pool, do_break_a) : NULL;
+
+	if (!field) {
+		cond->field_id = DP_FIELD_NONE;
+	} else {
+		cond->field = switch_core_strdup(program->pool, field);
+		if (strchr(field, '$')) {
+			cond->field_id = DP_FIELD_EXPAND;
+		} else {
+			cond->field_id = DP_FIELD_PROFILE;
+			for (i = 0; dp_fields[i].name; i++) {
+				if (!strcasecmp(field, dp_fields[i].name)) {
+					cond->field_id = dp_fields[i].id;
+					break;
+				}
+			}
+		}
+	}
+
+	/* the date/time check wants an xml node, keep a private copy of the ones that need it */
+	for (i = 0; dp_time_attrs[i]; i++) {
+		if (switch_xml_attr(xcond, dp_time_attrs[i])) {
+			cond->xtime = switch_xml_dup(xcond);
+			program->timed[program->timed_count++] = cond->xtime;
+			break;
+		}
+	}
+
+	cond->action_count = dp_compile_actions(program, xcond, "action", &cond->actions);
+	cond->anti_action_count = dp_compile_actions(program, xcond, "anti-action", &cond->anti_actions);
+}
+
+static void dp_compile_extension(dp_program_t *program, switch_xml_t xexten, dp_extension_t *exten)
+{
+	switch_xml_t xcond;
+	const char *name = switch_xml_attr(xexten, "name");
+	const char *cont = switch_xml_attr(xexten, "continue");
+	dp_condition_t *first;
+	int i = 0;
+
+	exten->name = name ? switch_core_strdup(program->pool, name) : NULL;
+	exten->cont = cont ? switch_core_strdup(program->pool, cont) : NULL;
+
+	for (xcond = switch_xml_child(xexten, "condition"); xcond; xcond = xcond->next) {
+		exten->condition_count++;
+	}
+
+	if (!exten->condition_count) {
+		return;
+	}
+
+	exten->conditions = switch_core_alloc(program->pool, sizeof(dp_condition_t) * exten->condition_count);
+
+	for (xcond = switch_xml_child(xexten, "condition"); xcond; xcond = xcond->next) {
+		dp_compile_condition(program, xcond, &exten->conditions[i++]);
+	}
+
+	/* An extension can be skipped on a prefix mismatch only when its first condition failing
+	   is guaranteed to end it with nothing done: a plain destination_number test with no
+	   anti-actions, no date/time part and a break that stops on failure. */
+	first = &exten->conditions[0];
+	if (first->field_id == DP_FIELD_DESTINATION_NUMBER && !first->dynamic && !first->nested && !first->xtime &&
+		!first->anti_action_count && (first->do_break_i == BREAK_ON_FALSE || first->do_break_i == BREAK_ALWAYS)) {
+		if ((exten->prefix = dp_anchored_prefix(program->pool, first->expression))) {
+			exten->prefix_len = strlen(exten->prefix);
+		}
+	}
+}
+
+static dp_context_t *dp_compile_context(dp_program_t *program, switch_xml_t xcontext)
+{
+	dp_context_t *context = switch_core_alloc(program->pool, sizeof(*context));
+	switch_xml_t xexten;
+	int i = 0, c, j;
+
+	for (xexten = switch_xml_child(xcontext, "extension"); xexten; xexten = xexten->next) {
+		context->extension_count++;
+	}
+
+	if (!context->extension_count) {
+		return context;
+	}
+
+	context->extensions = switch_core_alloc(program->pool, sizeof(dp_extension_t) * context->extension_count);
+	context->unanchored.list = switch_core_alloc(program->pool, sizeof(int) * context->extension_count);
+
+	for (xexten = switch_xml_child(xcontext, "extension"); xexten; xexten = xexten->next) {
+		dp_compile_extension(program, xexten, &context->extensions[i]);
+		if (!context->extensions[i].prefix) {
+			context->unanchored.list[context->unanchored.count++] = i;
+		}
+		i++;
+	}
+
+	for (i = 0; i < context->extension_count; i++) {
+		dp_index_t *index;
+
+		if (!context->extensions[i].prefix || context->by_first[(c = (unsigned char) context->extensions[i].prefix[0])]) {
+			continue;
+		}
+
+		index = switch_core_alloc(program->pool, sizeof(*index));
+		index->list = switch_core_alloc(program->pool, sizeof(int) * context->extension_count);
+
+		for (j = 0; j < context->extension_count; j++) {
+			if (!context->extensions[j].prefix || (unsigned char) context->extensions[j].prefix[0] == c) {
+				index->list[index->count++] = j;
+			}
+		}
+
+		context->by_first[c] = index;
+	}
+
+	return context;
+}
+
+static int dp_count_timed(switch_xml_t cfg)
+{
+	switch_xml_t xcontext, xexten, xcond;
+	int count = 0, i;
+
+	for (xcontext = switch_xml_child(cfg, "context"); xcontext; xcontext = xcontext->next) {
+		for (xexten = switch_xml_child(xcontext, "extension"); xexten; xexten = xexten->next) {
+			for (xcond = switch_xml_child(xexten, "condition"); xcond; xcond = xcond->next) {
+				for (i = 0; dp_time_attrs[i]; i++) {
+					if (switch_xml_attr(xcond, dp_time_attrs[i])) {
+						count++;
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	return count;
+}
+
+static void dp_program_destroy(dp_program_t **programp)
+{
+	dp_program_t *program = *programp;
+	switch_memory_pool_t *pool;
+	int i;
+
+	*programp = NULL;
+
+	for (i = 0; i < program->timed_count; i++) {
+		switch_xml_free(program->timed[i]);
+	}
+
+	switch_core_hash_destroy(&program->contexts);
+	pool = program->pool;
+	switch_core_destroy_memory_pool(&pool);
+}
+
+static dp_program_t *dp_program_compile(switch_xml_t root, switch_xml_t cfg, uint32_t generation)
+{
+	switch_memory_pool_t *pool = NULL;
+	dp_program_t *program;
+	switch_xml_t xcontext;
+	int contexts = 0, extensions = 0;
+
+	switch_core_new_memory_pool(&pool);
+	program = switch_core_alloc(pool, sizeof(*program));
+	program->pool = pool;
+	program->root_id = root;
+	program->generation = generation;
+	program->refs = 1;
+	switch_core_hash_init(&program->contexts, pool);
+
+	if ((program->timed_count = dp_count_timed(cfg))) {
+		program->timed = switch_core_alloc(pool, sizeof(switch_xml_t) * program->timed_count);
+		program->timed_count = 0;
+	}
+
+	for (xcontext = switch_xml_child(cfg, "context"); xcontext; xcontext = xcontext->next) {
+		const char *name = switch_xml_attr(xcontext, "name");
+		dp_context_t *context;
+
+		/* first one wins, same as switch_xml_find_child() */
+		if (!name || switch_core_hash_find(program->contexts, name)) {
+			continue;
+		}
+
+		context = dp_compile_context(program, xcontext);
+		switch_core_hash_insert(program->contexts, name, context);
+		contexts++;
+		extensions += context->extension_count;
+	}
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Compiled dialplan: %d context%s, %d extension%s\n",
+					  contexts, contexts == 1 ? "" : "s", extensions, extensions == 1 ? "" : "s");
+
+	return program;
+}
+
+/* Caller must hold globals.mutex, the program handed back must be destroyed once the lock is dropped */
+static dp_program_t *dp_program_swap(dp_program_t *program)
+{
+	dp_program_t *old = globals.program;
+
+	globals.program = program;
+
+	if (old && --old->refs == 0) {
+		return old;
+	}
+
+	return NULL;
+}
+
+static switch_bool_t dp_program_current(dp_program_t *program, switch_xml_t root)
+{
+	return program && program->generation == globals.generation && program->root_id == root;
+}
+
+/* Programs are compiled without globals.mutex so a big dialplan doesn't hold up routing while it builds */
+static dp_program_t *dp_program_acquire(switch_xml_t root, switch_xml_t cfg)
+{
+	dp_program_t *program, *old = NULL;
+	uint32_t generation;
+
+	switch_mutex_lock(globals.mutex);
+	if (dp_program_current(globals.program, root)) {
+		program = globals.program;
+		program->refs++;
+		switch_mutex_unlock(globals.mutex);
+		return program;
+	}
+	generation = globals.generation;
+	switch_mutex_unlock(globals.mutex);
+
+	program = dp_program_compile(root, cfg, generation);
+
+	switch_mutex_lock(globals.mutex);
+	if (dp_program_current(globals.program, root)) {
+		/* somebody else got there first */
+		old = program;
+		program = globals.program;
+		program->refs++;
+	} else if (generation == globals.generation) {
+		old = dp_program_swap(program);
+		program->refs++;
+	}
+	/* otherwise a reload came in while compiling, this call keeps its private copy */
+	switch_mutex_unlock(globals.mutex);
+
+	if (old) {
+		dp_program_destroy(&old);
+	}
+
+	return program;
+}
+
+static void dp_program_release(dp_program_t **programp)
+{
+	dp_program_t *program = *programp;
+	int refs;
+
+	*programp = NULL;
+
+	switch_mutex_lock(globals.mutex);
+	refs = --program->refs;
+	switch_mutex_unlock(globals.mutex);
+
+	if (!refs) {
+		dp_program_destroy(&program);
+	}
+}
+
+static void dp_reload_event_handler(switch_event_t *event)
+{
+	switch_xml_t root, conf;
+	dp_program_t *program, *old = NULL;
+	uint32_t generation;
+
+	switch_mutex_lock(globals.mutex);
+	generation = ++globals.generation;
+	switch_mutex_unlock(globals.mutex);
+
+	if (!(root = switch_xml_root())) {
+		return;
+	}
+
+	if ((conf = switch_xml_find_child(root, "section", "name", "dialplan"))) {
+		program = dp_program_compile(root, conf, generation);
+
+		switch_mutex_lock(globals.mutex);
+		if (generation == globals.generation) {
+			old = dp_program_swap(program);
+		} else {
+			old = program;
+		}
+		switch_mutex_unlock(globals.mutex);
+
+		if (old) {
+			dp_program_destroy(&old);
+		}
+	}
+
+	switch_xml_free(root);
+}
+
+static int dp_exec_actions(switch_core_session_t *session, switch_caller_profile_t *caller_profile, const char *exten_name,
+						   dp_action_t *actions, int count, switch_bool_t anti, const char *field_data, switch_regex_t *re,
+						   int match_count, int *ovector, switch_bool_t substitute, switch_caller_extension_t **extension)
+{
+	switch_channel_t *channel = switch_core_session_get_channel(session);
+	int i;
+
+	for (i = 0; i < count; i++) {
+		dp_action_t *action = &actions[i];
+		char *substituted = NULL;
+		const char *app_data = action->data;
+		uint32_t len = 0;
+		int loop_count = 1;
+
+		if (substitute) {
+			len = (uint32_t) (strlen(action->data) + strlen(field_data) + 10) * match_count;
+			if (!(substituted = malloc(len))) {
+				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_CRIT, "Memory Error!\n");
+				return -1;
+			}
+			memset(substituted, 0, len);
+			switch_perform_substitution(re, match_count, action->data, field_data, substituted, len, ovector);
+			app_data = substituted;
+		}
+
+		if (!*extension) {
+			if ((*extension = switch_caller_extension_new(session, exten_name, caller_profile->destination_number)) == 0) {
+				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_CRIT, "Memory Error!\n");
+				switch_safe_free(substituted);
+				return -1;
+			}
+		}
+
+		if (action->loop) {
+			loop_count = atoi(action->loop);
+		}
+
+		for (; loop_count > 0; loop_count--) {
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG_CLEAN(session), SWITCH_LOG_DEBUG,
+							  "Dialplan: %s %s %s(%s) %s\n", switch_channel_get_name(channel), anti ? "ANTI-Action" : "Action",
+							  action->application, app_data, action->xinline ? "INLINE" : "");
+
+			if (action->xinline) {
+				exec_app(session, action->application, app_data);
+			} else {
+				switch_caller_extension_add_application(session, *extension, action->application, app_data);
+			}
+		}
+
+		switch_safe_free(substituted);
+	}
+
+	return 0;
+}
+
+/* parse_exten() for a compiled extension, keep the two in step */
+static int run_exten(switch_core_session_t *session, switch_caller_profile_t *caller_profile, dp_extension_t *exten,
+					 switch_caller_extension_t **extension)
+{
+	switch_channel_t *channel = switch_core_session_get_channel(session);
+	const char *exten_name = exten->name ? exten->name : "_anon_";
+	char *expression_expanded = NULL, *field_expanded = NULL;
+	switch_regex_t *re = NULL;
+	int proceed = 0;
+	int i;
+
+	for (i = 0; i < exten->condition_count; i++) {
+		dp_condition_t *cond = &exten->conditions[i];
+		const char *expression = cond->expression;
+		const char *field_data = NULL;
+		const char *do_break_a = cond->do_break_a;
+		switch_bool_t anti_action = SWITCH_TRUE;
+		switch_bool_t substitute = cond->substitute;
+		int ovector[30];
+		int time_match = cond->xtime ? switch_xml_std_datetime_check(cond->xtime) : -1;
+
+		switch_safe_free(field_expanded);
+		switch_safe_free(expression_expanded);
+
+		if (cond->nested) {
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_ERROR, "Nested conditions are not allowed!\n");
+			proceed = 1;
+			goto done;
+		}
+
+		if (cond->dynamic) {
+			if ((expression_expanded = switch_channel_expand_variables(channel, cond->expression)) == cond->expression) {
+				expression_expanded = NULL;
+			} else {
+				expression = expression_expanded;
+				substitute = strchr(expression, '(') ? SWITCH_TRUE : SWITCH_FALSE;
+			}
+		}
+
+		if (time_match == 1) {
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG_CLEAN(session), SWITCH_LOG_DEBUG,
+							  "Dialplan: %s Date/Time Match (PASS) [%s] break=%s\n",
+							  switch_channel_get_name(channel), exten_name, do_break_a ? do_break_a : "on-false");
+			anti_action = SWITCH_FALSE;
+		} else if (time_match == 0) {
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG_CLEAN(session), SWITCH_LOG_DEBUG,
+							  "Dialplan: %s Date/Time Match (FAIL) [%s] break=%s\n",
+							  switch_channel_get_name(channel), exten_name, do_break_a ? do_break_a : "on-false");
+		}
+
+		if (cond->field_id != DP_FIELD_NONE) {
+			if (cond->field_id == DP_FIELD_EXPAND) {
+				if ((field_expanded = switch_channel_expand_variables(channel, cond->field)) == cond->field) {
+					field_expanded = NULL;
+					field_data = cond->field;
+				} else {
+					field_data = field_expanded;
+				}
+			} else {
+				field_data = dp_field_data(cond->field_id, cond->field, caller_profile);
+			}
+			if (!field_data) {
+				field_data = "";
+			}
+
+			if ((proceed = switch_regex_perform_ex(field_data, expression, &re, ovector, sizeof(ovector) / sizeof(ovector[0]),
+												   expression_expanded ? SWITCH_TRUE : SWITCH_FALSE))) {
+				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG_CLEAN(session), SWITCH_LOG_DEBUG,
+								  "Dialplan: %s Regex (PASS) [%s] %s(%s) =~ /%s/ break=%s\n",
+								  switch_channel_get_name(channel), exten_name, cond->field, field_data, expression, do_break_a ? do_break_a : "on-false");
+				anti_action = SWITCH_FALSE;
+			} else {
+				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG_CLEAN(session), SWITCH_LOG_DEBUG,
+								  "Dialplan: %s Regex (FAIL) [%s] %s(%s) =~ /%s/ break=%s\n",
+								  switch_channel_get_name(channel), exten_name, cond->field, field_data, expression, do_break_a ? do_break_a : "on-false");
+			}
+		} else if (time_match == -1) {
+			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG_CLEAN(session), SWITCH_LOG_DEBUG,
+							  "Dialplan: %s Absolute Condition [%s]\n", switch_channel_get_name(channel), exten_name);
+			anti_action = SWITCH_FALSE;
+		}
+
+		if (anti_action) {
+			if (dp_exec_actions(session, caller_profile, exten_name, cond->anti_actions, cond->anti_action_count, SWITCH_TRUE,
+								NULL, NULL, 0, NULL, SWITCH_FALSE, extension) < 0) {
+				proceed = 0;
+				goto done;
+			}
+			if (cond->anti_action_count) {
+				proceed = 1;
+			}
+		} else {
+			if (dp_exec_actions(session, caller_profile, exten_name, cond->actions, cond->action_count, SWITCH_FALSE,
+								field_data, re, proceed, ovector, cond->field_id != DP_FIELD_NONE && substitute, extension) < 0) {
+				proceed = 0;
+				goto done;
+			}
+		}
+		switch_regex_safe_free(re);
+
+		if (((anti_action == SWITCH_FALSE && cond->do_break_i == BREAK_ON_TRUE) ||
+			 (anti_action == SWITCH_TRUE && cond->do_break_i == BREAK_ON_FALSE)) || cond->do_break_i == BREAK_ALWAYS) {
+			break;
+		}
+	}
+
+  done:
+	switch_regex_safe_free(re);
+	switch_safe_free(field_expanded);
+	switch_safe_free(expression_expanded);
+	return proceed;
+}
+
+static switch_caller_extension_t *run_context(switch_core_session_t *session, switch_caller_profile_t *caller_profile, dp_context_t *context,
+											  const char *context_name)
+{
+	switch_channel_t *channel = switch_core_session_get_channel(session);
+	switch_caller_extension_t *extension = NULL;
+	const char *dest = switch_str_nil(caller_profile->destination_number);
+	const char *hunt;
+	dp_index_t *index;
+	int start = 0, i;
+
+	if ((hunt = switch_channel_get_variable(channel, "auto_hunt")) && switch_true(hunt)) {
+		for (i = 0; i < context->extension_count; i++) {
+			if (context->extensions[i].name && !strcasecmp(context->extensions[i].name, dest)) {
+				start = i;
+				break;
+			}
+		}
+	}
+
+	if (!(index = context->by_first[(unsigned char) *dest])) {
+		index = &context->unanchored;
+	}
+
+	for (i = 0; i < index->count; i++) {
+		dp_extension_t *exten = &context->extensions[index->list[i]];
+		int proceed = 0;
+
+		if (index->list[i] < start) {
+			continue;
+		}
+
+		if (exten->prefix && strncmp(dest, exten->prefix, exten->prefix_len)) {
+			continue;
+		}
+
+		switch_log_printf(SWITCH_CHANNEL_SESSION_LOG_CLEAN(session), SWITCH_LOG_DEBUG,
+						  "Dialplan: %s parsing [%s->%s] continue=%s\n",
+						  switch_channel_get_name(channel), context_name, exten->name ? exten->name : "UNKNOWN", exten->cont ? exten->cont : "false");
+
+		proceed = run_exten(session, caller_profile, exten, &extension);
+
+		if (proceed && !switch_true(exten->cont)) {
+			break;
+		}
+	}
+
+	return extension;
+}
+
 static switch_status_t dialplan_xml_locate(switch_core_session_t *session, switch_caller_profile_t *caller_profile, switch_xml_t *root,
 										   switch_xml_t *node)
 {
@@ -316,6 +1071,8 @@ SWITCH_STANDARD_DIALPLAN(dialplan_hunt)
 	switch_xml_t alt_root = NULL, cfg, xml = NULL, xcontext, xexten = NULL;
 	char *alt_path = (char *) arg;
 	const char *hunt = NULL;
+	dp_program_t *program = NULL;
+	dp_context_t *context;
 
 	if (!caller_profile) {
 		if (!(caller_profile = switch_channel_get_caller_profile(channel))) {
@@ -349,10 +1106,31 @@ SWITCH_STANDARD_DIALPLAN(dialplan_hunt)
 			goto done;
 		}
 	} else {
+		switch_xml_t main_root;
+
 		if (dialplan_xml_locate(session, caller_profile, &xml, &cfg) != SWITCH_STATUS_SUCCESS) {
 			switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_ERROR, "Open of dialplan failed\n");
 			goto done;
 		}
+
+		if ((main_root = switch_xml_root())) {
+			if (main_root == xml) {
+				program = dp_program_acquire(xml, cfg);
+			}
+			switch_xml_free(main_root);
+		}
+	}
+
+	if (program) {
+		if (!(context = switch_core_hash_find(program->contexts, caller_profile->context))) {
+			if (!(context = switch_core_hash_find(program->contexts, "global"))) {
+				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_WARNING, "Context %s not found\n", caller_profile->context);
+				goto done;
+			}
+		}
+
+		extension = run_context(session, caller_profile, context, caller_profile->context);
+		goto done;
 	}
 
 	/* get a handle to the context tag */
@@ -397,6 +1175,9 @@ SWITCH_STANDARD_DIALPLAN(dialplan_hunt)
 	xml = NULL;
 
   done:
+	if (program) {
+		dp_program_release(&program);
+	}
 	switch_xml_free(xml);
 	return extension;
 }
@@ -409,10 +1190,31 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_dialplan_xml_load)
 	*module_interface = switch_loadable_module_create_module_interface(pool, modname);
 	SWITCH_ADD_DIALPLAN(dp_interface, "XML", dialplan_hunt);
 
+	memset(&globals, 0, sizeof(globals));
+	switch_mutex_init(&globals.mutex, SWITCH_MUTEX_NESTED, pool);
+
+	if (switch_event_bind_removable(modname, SWITCH_EVENT_RELOADXML, NULL, dp_reload_event_handler, NULL, &globals.node) != SWITCH_STATUS_SUCCESS) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Couldn't bind reloadxml event, dialplan will be recompiled on demand\n");
+	}
+
 	/* indicate that the module should continue to be loaded */
 	return SWITCH_STATUS_SUCCESS;
 }
 
+SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_dialplan_xml_shutdown)
+{
+	switch_event_unbind(&globals.node);
+
+	switch_mutex_lock(globals.mutex);
+	if (globals.program && --globals.program->refs == 0) {
+		dp_program_destroy(&globals.program);
+	}
+	globals.program = NULL;
+	switch_mutex_unlock(globals.mutex);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 /* For Emacs:
  * Local Variables:
  * mode:c
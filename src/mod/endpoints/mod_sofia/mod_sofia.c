@@ -2103,7 +2103,7 @@ static switch_status_t sofia_receive_message(switch_core_session_t *session, swi
 					to_host = switch_channel_get_variable(channel, "sip_to_host");
 				}
 				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG, "Challenging call %s\n", to_uri);
-				sofia_reg_auth_challenge(NULL, tech_pvt->profile, tech_pvt->nh, REG_INVITE, to_host, 0);
+				sofia_reg_auth_challenge(NULL, tech_pvt->profile, tech_pvt->nh, NULL, REG_INVITE, to_host, 0);
 				switch_channel_hangup(channel, SWITCH_CAUSE_USER_CHALLENGE);
 			} else if (code == 484 && msg->numeric_arg) {
 				const char *to = switch_channel_get_variable(channel, "sip_to_uri");
@@ -2711,6 +2711,26 @@ static switch_status_t cmd_status(char **argv, int argc, switch_stream_handle_t
 					stream->write_function(stream, "FAILED-CALLS-IN  \t%u\n", profile->ib_failed_calls);
 					stream->write_function(stream, "CALLS-OUT        \t%u\n", profile->ob_calls);
 					stream->write_function(stream, "FAILED-CALLS-OUT \t%u\n", profile->ob_failed_calls);
+					if (profile->reg_index) {
+						stream->write_function(stream, "REG-INDEX        \t%u\n", sofia_reg_index_count(profile));
+					}
+					stream->write_function(stream, "NONCE-STORE      \t%s\n", profile->nonce_shards ? "memory" : "sql");
+					if (profile->nonce_shards) {
+						stream->write_function(stream, "NONCES           \t%u\n", sofia_reg_nonce_count(profile));
+					}
+					if (profile->dispatch_running) {
+						uint32_t x;
+
+						stream->write_function(stream, "DISPATCH-THREADS \t%u\n", profile->dispatch_threads);
+						stream->write_function(stream, "DISPATCH-OVERFLOW\t%u\n", profile->dispatch_overflow);
+						for (x = 0; x < profile->dispatch_threads; x++) {
+							sofia_dispatch_worker_t *worker = &profile->dispatch_workers[x];
+							stream->write_function(stream, "DISPATCH-%-8u\tdepth %u/%u max-depth %u processed %" SWITCH_UINT64_T_FMT
+												   " avg-latency %" SWITCH_INT64_T_FMT "us max-latency %" SWITCH_INT64_T_FMT "us\n",
+												   x, switch_queue_size(worker->queue), profile->dispatch_queue_size, worker->max_depth, worker->processed,
+												   worker->processed ? worker->total_latency / (switch_time_t) worker->processed : 0, worker->max_latency);
+						}
+					}
 				}
 				stream->write_function(stream, "\nRegistrations:\n%s\n", line);
 
@@ -2982,6 +3002,26 @@ static switch_status_t cmd_xml_status(char **argv, int argc, switch_stream_handl
 					stream->write_function(stream, "    <calls-out>%u</calls-out>\n", profile->ob_calls);
 					stream->write_function(stream, "    <failed-calls-in>%u</failed-calls-in>\n", profile->ib_failed_calls);
 					stream->write_function(stream, "    <failed-calls-out>%u</failed-calls-out>\n", profile->ob_failed_calls);
+					if (profile->reg_index) {
+						stream->write_function(stream, "    <reg-index>%u</reg-index>\n", sofia_reg_index_count(profile));
+					}
+					stream->write_function(stream, "    <nonce-store>%s</nonce-store>\n", profile->nonce_shards ? "memory" : "sql");
+					if (profile->nonce_shards) {
+						stream->write_function(stream, "    <nonces>%u</nonces>\n", sofia_reg_nonce_count(profile));
+					}
+					if (profile->dispatch_running) {
+						uint32_t x;
+
+						stream->write_function(stream, "    <dispatch-threads>%u</dispatch-threads>\n", profile->dispatch_threads);
+						stream->write_function(stream, "    <dispatch-overflow>%u</dispatch-overflow>\n", profile->dispatch_overflow);
+						for (x = 0; x < profile->dispatch_threads; x++) {
+							sofia_dispatch_worker_t *worker = &profile->dispatch_workers[x];
+							stream->write_function(stream, "    <dispatch-worker id=\"%u\" depth=\"%u\" max-depth=\"%u\" processed=\"%" SWITCH_UINT64_T_FMT
+												   "\" avg-latency-usec=\"%" SWITCH_INT64_T_FMT "\" max-latency-usec=\"%" SWITCH_INT64_T_FMT "\"/>\n",
+												   x, switch_queue_size(worker->queue), worker->max_depth, worker->processed,
+												   worker->processed ? worker->total_latency / (switch_time_t) worker->processed : 0, worker->max_latency);
+						}
+					}
 					stream->write_function(stream, "  </profile-info>\n");
 				}
 				stream->write_function(stream, "  <registrations>\n");
@@ -3370,6 +3410,37 @@ static int contact_callback(void *pArg, int argc, char **argv, char **columnName
 	return 0;
 }
 
+struct contact_index_helper {
+	struct cb_helper *cb;
+	const char *concat;
+	const char *exclude_contact;
+};
+
+static int contact_index_callback(void *pArg, const sofia_reg_index_entry_t *reg)
+{
+	struct contact_index_helper *h = (struct contact_index_helper *) pArg;
+	char *argv[3];
+
+	if (h->exclude_contact && switch_stristr(h->exclude_contact, reg->contact)) {
+		return 0;
+	}
+
+	argv[0] = reg->contact;
+	argv[1] = h->cb->profile->name;
+	argv[2] = (char *) h->concat;
+
+	return contact_callback(h->cb, 3, argv, NULL);
+}
+
+static int username_index_callback(void *pArg, const sofia_reg_index_entry_t *reg)
+{
+	struct cb_helper_sql2str *cbt = (struct cb_helper_sql2str *) pArg;
+
+	switch_copy_string(cbt->buf, reg->sip_username, cbt->len);
+	cbt->matches++;
+	return 0;
+}
+
 static int sql2str_callback(void *pArg, int argc, char **argv, char **columnNames)
 {
 	struct cb_helper_sql2str *cbt = (struct cb_helper_sql2str *) pArg;
@@ -3539,14 +3610,18 @@ SWITCH_STANDARD_API(sofia_username_of_function)
 
 			switch_assert(!zstr(user));
 
-			sql = switch_mprintf("select sip_username "
-									"from sip_registrations where sip_user='%q' and (sip_host='%q' or presence_hosts like '%%%q%%')",
-									user, domain, domain);
+			if (profile->reg_index) {
+				sofia_reg_index_find(profile, user, domain, username_index_callback, &cb);
+			} else {
+				sql = switch_mprintf("select sip_username "
+									 "from sip_registrations where sip_user='%q' and (sip_host='%q' or presence_hosts like '%%%q%%')",
+									 user, domain, domain);
 
-			switch_assert(sql);
+				switch_assert(sql);
 
-			sofia_glue_execute_sql_callback(profile, profile->ireg_mutex, sql, sql2str_callback, &cb);
-			switch_safe_free(sql);
+				sofia_glue_execute_sql_callback(profile, profile->ireg_mutex, sql, sql2str_callback, &cb);
+				switch_safe_free(sql);
+			}
 			if (!zstr(username)) {
 				stream->write_function(stream, "%s", username);
 			} else {
@@ -3585,6 +3660,16 @@ static void select_from_profile(sofia_profile_t *profile,
 	cb.profile = profile;
 	cb.stream = stream;
 
+	if (profile->reg_index) {
+		struct contact_index_helper h = { 0 };
+
+		h.cb = &cb;
+		h.concat = (concat != NULL) ? concat : "";
+		h.exclude_contact = exclude_contact;
+		sofia_reg_index_find(profile, user, domain, contact_index_callback, &h);
+		return;
+	}
+
 	if (exclude_contact) {
 		sql = switch_mprintf("select contact, profile_name, '%q' "
 							 "from sip_registrations where sip_user='%q' and (sip_host='%q' or presence_hosts like '%%%q%%') "
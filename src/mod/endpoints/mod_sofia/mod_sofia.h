@@ -42,6 +42,10 @@
 #define IREG_SECONDS 30
 #define GATEWAY_SECONDS 1
 #define SOFIA_QUEUE_SIZE 50000
+#define SOFIA_DISPATCH_QUEUE_SIZE 10000
+#define SOFIA_MAX_DISPATCH_THREADS 64
+#define SOFIA_NONCE_SHARDS 16
+#define SOFIA_REG_INDEX_SHARDS 64
 #define HAVE_APR
 #include <switch.h>
 #include <switch_version.h>
@@ -145,6 +149,69 @@ struct sofia_private {
 	int is_static;
 };
 
+/* a nua event handed from the profile thread to one of its dispatch threads */
+struct sofia_dispatch_event {
+	nua_saved_event_t event[1];
+	nua_t *nua;
+	nua_handle_t *nh;
+	switch_time_t queued;
+};
+typedef struct sofia_dispatch_event sofia_dispatch_event_t;
+
+struct sofia_dispatch_worker {
+	sofia_profile_t *profile;
+	switch_queue_t *queue;
+	switch_thread_t *thread;
+	uint32_t id;
+	uint32_t max_depth;
+	uint64_t processed;
+	switch_time_t total_latency;
+	switch_time_t max_latency;
+};
+typedef struct sofia_dispatch_worker sofia_dispatch_worker_t;
+
+/* one slice of a profile's in-memory digest nonce table, see nonce-store */
+struct sofia_nonce_shard {
+	switch_hash_t *hash;
+	switch_mutex_t *mutex;
+	uint32_t count;
+};
+typedef struct sofia_nonce_shard sofia_nonce_shard_t;
+
+/* one row of sip_registrations as kept by the in-memory registration index, see registration-index */
+struct sofia_reg_index_entry {
+	char *call_id;
+	char *sip_user;
+	char *sip_host;
+	char *presence_hosts;
+	char *contact;
+	char *status;
+	char *rpid;
+	char *user_agent;
+	char *server_user;
+	char *server_host;
+	char *network_ip;
+	char *sip_username;
+	long expires;
+	struct sofia_reg_index_entry *next;
+	struct sofia_reg_index_entry *taken;
+};
+typedef struct sofia_reg_index_entry sofia_reg_index_entry_t;
+
+/* registrations whose sip_user hashes here, chained per user, plus a call-id lookup for them */
+struct sofia_reg_index_shard {
+	switch_hash_t *users;
+	switch_hash_t *call_ids;
+	switch_mutex_t *mutex;
+	uint32_t count;
+};
+typedef struct sofia_reg_index_shard sofia_reg_index_shard_t;
+
+typedef int (*sofia_reg_index_callback_t) (void *pArg, const sofia_reg_index_entry_t *reg);
+
+/* the request being handled: the saved one on a dispatch thread, otherwise the one nua is delivering right now */
+#define sofia_dispatch_request(_de, _nua) ((_de) ? nua_saved_event_request((_de)->event) : nua_current_request(_nua))
+
 #define set_param(ptr,val) if (ptr) {free(ptr) ; ptr = NULL;} if (val) {ptr = strdup(val);}
 #define set_anchor(t,m) if (t->Anchor) {delete t->Anchor;} t->Anchor = new SipMessage(m);
 #define sofia_private_free(_pvt) if (_pvt && ! _pvt->is_static) {free(_pvt); _pvt = NULL;}
@@ -233,6 +300,8 @@ typedef enum {
 	PFLAG_RENEG_ON_HOLD,
 	PFLAG_RENEG_ON_REINVITE,
 	PFLAG_RTP_NOTIMER_DURING_BRIDGE,
+	PFLAG_NONCE_MEMORY,
+	PFLAG_REG_INDEX,
 	/* No new flags below this line */
 	PFLAG_MAX
 } PFLAGS;
@@ -589,6 +658,13 @@ struct sofia_profile {
 	uint32_t step_timeout;
 	uint32_t event_timeout;
 	int watchdog_enabled;
+	uint32_t dispatch_threads;
+	uint32_t dispatch_queue_size;
+	sofia_dispatch_worker_t *dispatch_workers;
+	int dispatch_running;
+	uint32_t dispatch_overflow;
+	sofia_nonce_shard_t *nonce_shards;
+	sofia_reg_index_shard_t *reg_index;
 };
 
 struct private_object {
@@ -817,7 +893,7 @@ void sofia_handle_sip_i_info(nua_t *nua, sofia_profile_t *profile, nua_handle_t
 void sofia_handle_sip_i_invite(nua_t *nua, sofia_profile_t *profile, nua_handle_t *nh, sofia_private_t *sofia_private, sip_t const *sip, tagi_t tags[]);
 
 void sofia_reg_handle_sip_i_register(nua_t *nua, sofia_profile_t *profile, nua_handle_t *nh, sofia_private_t *sofia_private, sip_t const *sip,
-									 tagi_t tags[]);
+									 sofia_dispatch_event_t *de, tagi_t tags[]);
 
 void sofia_event_callback(nua_event_t event,
 						  int status,
@@ -847,7 +923,8 @@ void sofia_presence_mwi_event_handler(switch_event_t *event);
 void sofia_glue_track_event_handler(switch_event_t *event);
 void sofia_presence_cancel(void);
 switch_status_t config_sofia(int reload, char *profile_name);
-void sofia_reg_auth_challenge(nua_t *nua, sofia_profile_t *profile, nua_handle_t *nh, sofia_regtype_t regtype, const char *realm, int stale);
+void sofia_reg_auth_challenge(nua_t *nua, sofia_profile_t *profile, nua_handle_t *nh, sofia_dispatch_event_t *de,
+							  sofia_regtype_t regtype, const char *realm, int stale);
 auth_res_t sofia_reg_parse_auth(sofia_profile_t *profile, sip_authorization_t const *authorization,
 								sip_t const *sip, const char *regstr, char *np, size_t nplen, char *ip, switch_event_t **v_event,
 								long exptime, sofia_regtype_t regtype, const char *to_user, switch_event_t **auth_params, long *reg_count);
@@ -863,7 +940,7 @@ void sofia_reg_handle_sip_r_register(int status,
 									 nua_t *nua, sofia_profile_t *profile, nua_handle_t *nh, sofia_private_t *sofia_private, sip_t const *sip,
 									 tagi_t tags[]);
 void sofia_handle_sip_i_options(int status, char const *phrase, nua_t *nua, sofia_profile_t *profile, nua_handle_t *nh, sofia_private_t *sofia_private,
-								sip_t const *sip, tagi_t tags[]);
+								sip_t const *sip, sofia_dispatch_event_t *de, tagi_t tags[]);
 void sofia_presence_handle_sip_i_publish(nua_t *nua, sofia_profile_t *profile, nua_handle_t *nh, sofia_private_t *sofia_private, sip_t const *sip,
 										 tagi_t tags[]);
 void sofia_presence_handle_sip_i_message(int status, char const *phrase, nua_t *nua, sofia_profile_t *profile, nua_handle_t *nh,
@@ -878,6 +955,16 @@ void sofia_glue_actually_execute_sql(sofia_profile_t *profile, char *sql, switch
 void sofia_glue_actually_execute_sql_trans(sofia_profile_t *profile, char *sql, switch_mutex_t *mutex);
 void sofia_glue_execute_sql_now(sofia_profile_t *profile, char **sqlp, switch_bool_t sql_already_dynamic);
 void sofia_reg_check_expire(sofia_profile_t *profile, time_t now, int reboot);
+void sofia_reg_nonce_store_init(sofia_profile_t *profile);
+void sofia_reg_nonce_store_destroy(sofia_profile_t *profile);
+uint32_t sofia_reg_nonce_count(sofia_profile_t *profile);
+void sofia_reg_index_init(sofia_profile_t *profile);
+void sofia_reg_index_destroy(sofia_profile_t *profile);
+void sofia_reg_index_add(sofia_profile_t *profile, const sofia_reg_index_entry_t *reg);
+void sofia_reg_index_del(sofia_profile_t *profile, const char *call_id, const char *user, const char *host, const char *contact);
+void sofia_reg_index_set_expires(sofia_profile_t *profile, const char *user, const char *host, long expires);
+uint32_t sofia_reg_index_find(sofia_profile_t *profile, const char *user, const char *host, sofia_reg_index_callback_t callback, void *pArg);
+uint32_t sofia_reg_index_count(sofia_profile_t *profile);
 void sofia_reg_check_gateway(sofia_profile_t *profile, time_t now);
 void sofia_sub_check_gateway(sofia_profile_t *profile, time_t now);
 void sofia_reg_unregister(sofia_profile_t *profile);
@@ -887,7 +974,7 @@ switch_status_t sofia_glue_ext_address_lookup(sofia_profile_t *profile, private_
 void sofia_glue_pass_sdp(private_object_t *tech_pvt, char *sdp);
 switch_call_cause_t sofia_glue_sip_cause_to_freeswitch(int status);
 void sofia_glue_do_xfer_invite(switch_core_session_t *session);
-uint8_t sofia_reg_handle_register(nua_t *nua, sofia_profile_t *profile, nua_handle_t *nh, sip_t const *sip,
+uint8_t sofia_reg_handle_register(nua_t *nua, sofia_profile_t *profile, nua_handle_t *nh, sip_t const *sip, sofia_dispatch_event_t *de,
 								  sofia_regtype_t regtype, char *key, uint32_t keylen, switch_event_t **v_event, const char *is_nat);
 extern switch_endpoint_interface_t *sofia_endpoint_interface;
 void sofia_presence_set_chat_hash(private_object_t *tech_pvt, sip_t const *sip);
@@ -1002,7 +1089,8 @@ void sofia_glue_set_image_sdp(private_object_t *tech_pvt, switch_t38_options_t *
  * SLA (shared line appearance) entrypoints
  */
 
-void sofia_sla_handle_register(nua_t *nua, sofia_profile_t *profile, sip_t const *sip, long exptime, const char *full_contact);
+void sofia_sla_handle_register(nua_t *nua, sofia_profile_t *profile, sip_t const *sip, sofia_dispatch_event_t *de,
+							   long exptime, const char *full_contact);
 void sofia_sla_handle_sip_i_publish(nua_t *nua, sofia_profile_t *profile, nua_handle_t *nh, sip_t const *sip, tagi_t tags[]);
 void sofia_sla_handle_sip_i_subscribe(nua_t *nua, const char *contact_str, sofia_profile_t *profile, nua_handle_t *nh, sip_t const *sip, tagi_t tags[]);
 void sofia_sla_handle_sip_r_subscribe(int status,
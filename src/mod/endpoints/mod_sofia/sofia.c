@@ -752,6 +752,152 @@ void sofia_update_callee_id(switch_core_session_t *session, sofia_profile_t *pro
 }
 
 
+static void sofia_process_dispatch_event(sofia_dispatch_worker_t *worker, sofia_dispatch_event_t *de)
+{
+	sofia_profile_t *profile = worker->profile;
+	nua_event_data_t const *data = nua_event_data(de->event);
+	nua_handle_t *nh = de->nh;
+	sip_t const *sip = sip_object(data->e_msg);
+	switch_time_t latency = switch_time_now() - de->queued;
+
+	worker->processed++;
+	worker->total_latency += latency;
+	if (latency > worker->max_latency) {
+		worker->max_latency = latency;
+	}
+
+	switch (data->e_event) {
+	case nua_i_register:
+		sofia_reg_handle_sip_i_register(de->nua, profile, nh, NULL, sip, de, (tagi_t *) data->e_tags);
+		break;
+	case nua_i_options:
+		sofia_handle_sip_i_options(data->e_status, data->e_phrase, de->nua, profile, nh, NULL, sip, de, (tagi_t *) data->e_tags);
+		break;
+	default:
+		break;
+	}
+
+	/* same clean up sofia_event_callback does for a handle nobody bound */
+	if (!nua_handle_magic(nh)) {
+		nua_handle_destroy(nh);
+	}
+
+	nua_handle_unref(nh);
+	nua_destroy_event(de->event);
+	free(de);
+}
+
+static void *SWITCH_THREAD_FUNC sofia_dispatch_thread_run(switch_thread_t *thread, void *obj)
+{
+	sofia_dispatch_worker_t *worker = (sofia_dispatch_worker_t *) obj;
+	void *pop;
+
+	while (switch_queue_pop(worker->queue, &pop) == SWITCH_STATUS_SUCCESS && pop) {
+		sofia_process_dispatch_event(worker, (sofia_dispatch_event_t *) pop);
+	}
+
+	return NULL;
+}
+
+static void sofia_dispatch_start(sofia_profile_t *profile)
+{
+	switch_threadattr_t *thd_attr = NULL;
+	uint32_t x;
+
+	if (!profile->dispatch_threads) {
+		return;
+	}
+
+	if (!profile->dispatch_queue_size) {
+		profile->dispatch_queue_size = SOFIA_DISPATCH_QUEUE_SIZE;
+	}
+
+	profile->dispatch_workers = switch_core_alloc(profile->pool, sizeof(sofia_dispatch_worker_t) * profile->dispatch_threads);
+	switch_threadattr_create(&thd_attr, profile->pool);
+	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+
+	for (x = 0; x < profile->dispatch_threads; x++) {
+		sofia_dispatch_worker_t *worker = &profile->dispatch_workers[x];
+
+		worker->profile = profile;
+		worker->id = x;
+		switch_queue_create(&worker->queue, profile->dispatch_queue_size, profile->pool);
+		switch_thread_create(&worker->thread, thd_attr, sofia_dispatch_thread_run, worker, profile->pool);
+	}
+
+	profile->dispatch_running = 1;
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Started %u dispatch thread(s) for %s\n", profile->dispatch_threads, profile->name);
+}
+
+static void sofia_dispatch_stop(sofia_profile_t *profile)
+{
+	switch_status_t st;
+	uint32_t x;
+
+	if (!profile->dispatch_running) {
+		return;
+	}
+
+	/* only the profile thread queues events so anything arriving from here on is handled inline */
+	profile->dispatch_running = 0;
+
+	for (x = 0; x < profile->dispatch_threads; x++) {
+		switch_queue_push(profile->dispatch_workers[x].queue, NULL);
+	}
+
+	for (x = 0; x < profile->dispatch_threads; x++) {
+		switch_thread_join(&st, profile->dispatch_workers[x].thread);
+	}
+}
+
+/* Hand an out of dialog REGISTER or OPTIONS to a dispatch thread.  Requests are hashed on Call-ID so
+   a client's requests stay in order; everything else stays on the profile thread. */
+static switch_status_t sofia_dispatch_event_queue(nua_event_t event, nua_t *nua, sofia_profile_t *profile, nua_handle_t *nh,
+												  sofia_private_t *sofia_private, sip_t const *sip)
+{
+	sofia_dispatch_worker_t *worker;
+	sofia_dispatch_event_t *de;
+	uint32_t depth;
+	switch_ssize_t hlen = -1;
+
+	if (!profile->dispatch_running || !nh || sofia_private || !sip || !sip->sip_call_id || !sip->sip_call_id->i_id) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (event != nua_i_register && event != nua_i_options) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	worker = &profile->dispatch_workers[switch_ci_hashfunc_default(sip->sip_call_id->i_id, &hlen) % profile->dispatch_threads];
+
+	/* Once saved the event belongs to us, so decide before saving it.  Only this thread pushes so a queue
+	   that has room now still has room below.  A full queue is handled inline which also applies back pressure. */
+	if (switch_queue_size(worker->queue) >= profile->dispatch_queue_size) {
+		profile->dispatch_overflow++;
+		return SWITCH_STATUS_FALSE;
+	}
+
+	switch_zmalloc(de, sizeof(*de));
+
+	if (!nua_save_event(nua, de->event)) {
+		free(de);
+		return SWITCH_STATUS_FALSE;
+	}
+
+	/* nua clears e_nh in the saved event before calling us, so hold our own reference */
+	de->nua = nua;
+	de->nh = nua_handle_ref(nh);
+	de->queued = switch_time_now();
+	switch_queue_push(worker->queue, de);
+
+	if ((depth = switch_queue_size(worker->queue)) > worker->max_depth) {
+		worker->max_depth = depth;
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 void sofia_event_callback(nua_event_t event,
 						  int status,
 						  char const *phrase,
@@ -767,6 +913,10 @@ void sofia_event_callback(nua_event_t event,
 
 	profile->last_sip_event = switch_time_now();
 
+	if (sofia_dispatch_event_queue(event, nua, profile, nh, sofia_private, sip) == SWITCH_STATUS_SUCCESS) {
+		return;
+	}
+
 	/* sofia_private will be == &mod_sofia_globals.keep_private whenever a request is done with a new handle that has to be 
 	  freed whenever the request is done */
 	if (nh && sofia_private == &mod_sofia_globals.keep_private) {
@@ -947,7 +1097,7 @@ void sofia_event_callback(nua_event_t event,
 		sofia_reg_handle_sip_r_register(status, phrase, nua, profile, nh, sofia_private, sip, tags);
 		break;
 	case nua_i_options:
-		sofia_handle_sip_i_options(status, phrase, nua, profile, nh, sofia_private, sip, tags);
+		sofia_handle_sip_i_options(status, phrase, nua, profile, nh, sofia_private, sip, NULL, tags);
 		break;
 	case nua_i_invite:
 		if (session) {
@@ -962,7 +1112,7 @@ void sofia_event_callback(nua_event_t event,
 	case nua_i_register:
 		//nua_respond(nh, SIP_200_OK, SIPTAG_CONTACT(sip->sip_contact), NUTAG_WITH_THIS(nua), TAG_END());
 		//nua_handle_destroy(nh);
-		sofia_reg_handle_sip_i_register(nua, profile, nh, sofia_private, sip, tags);
+		sofia_reg_handle_sip_i_register(nua, profile, nh, sofia_private, sip, NULL, tags);
 		break;
 	case nua_i_state:
 		sofia_handle_sip_i_state(session, status, phrase, nua, profile, nh, sofia_private, sip, tags);
@@ -1175,8 +1325,10 @@ void event_handler(switch_event_t *event)
 		}
 		if (sofia_test_pflag(profile, PFLAG_MULTIREG)) {
 			sql = switch_mprintf("delete from sip_registrations where call_id='%q'", call_id);
+			sofia_reg_index_del(profile, call_id, NULL, NULL, NULL);
 		} else {
 			sql = switch_mprintf("delete from sip_registrations where sip_user='%q' and sip_host='%q'", from_user, from_host);
+			sofia_reg_index_del(profile, NULL, from_user, from_host, NULL);
 		}
 
 		if (mod_sofia_globals.rewrite_multicasted_fs_path && contact_str) {
@@ -1231,6 +1383,25 @@ void event_handler(switch_event_t *event)
 			sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Propagating registration for %s@%s->%s\n", from_user, from_host, contact_str);
 		}
+
+		if (profile->reg_index) {
+			sofia_reg_index_entry_t reg = { 0 };
+
+			reg.call_id = call_id;
+			reg.sip_user = from_user;
+			reg.sip_host = from_host;
+			reg.presence_hosts = presence_hosts;
+			reg.contact = contact_str;
+			reg.status = "Registered";
+			reg.rpid = rpid;
+			reg.expires = expires;
+			reg.user_agent = user_agent;
+			reg.server_user = to_user;
+			reg.server_host = guess_ip4;
+			reg.network_ip = network_ip;
+			reg.sip_username = username;
+			sofia_reg_index_add(profile, &reg);
+		}
 		switch_mutex_unlock(profile->ireg_mutex);
 
 		if (profile) {
@@ -1627,7 +1798,16 @@ void *SWITCH_THREAD_FUNC sofia_profile_thread_run(switch_thread_t *thread, void
 
 	profile->started = switch_epoch_time_now(NULL);
 
+	if (sofia_test_pflag(profile, PFLAG_NONCE_MEMORY)) {
+		sofia_reg_nonce_store_init(profile);
+	}
+
+	if (sofia_test_pflag(profile, PFLAG_REG_INDEX)) {
+		sofia_reg_index_init(profile);
+	}
+
 	sofia_set_pflag_locked(profile, PFLAG_RUNNING);
+	sofia_dispatch_start(profile);
 	worker_thread = launch_sofia_worker_thread(profile);
 
 	switch_yield(1000000);
@@ -1652,6 +1832,8 @@ void *SWITCH_THREAD_FUNC sofia_profile_thread_run(switch_thread_t *thread, void
 		}
 	}
 
+	sofia_dispatch_stop(profile);
+
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Write lock %s\n", profile->name);
 	switch_thread_rwlock_wrlock(profile->rwlock);
 	sofia_reg_unregister(profile);
@@ -1714,6 +1896,8 @@ void *SWITCH_THREAD_FUNC sofia_profile_thread_run(switch_thread_t *thread, void
 
 	sofia_glue_del_profile(profile);
 	switch_core_hash_destroy(&profile->chat_hash);
+	sofia_reg_nonce_store_destroy(profile);
+	sofia_reg_index_destroy(profile);
 	
 	switch_thread_rwlock_unlock(profile->rwlock);
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Write unlock %s\n", profile->name);
@@ -3452,6 +3636,19 @@ switch_status_t config_sofia(int reload, char *profile_name)
 						if (v_max_proceeding >= 0) {
 							profile->max_proceeding = v_max_proceeding;
 						}
+					} else if (!strcasecmp(var, "event-dispatch-threads")) {
+						int v = atoi(val);
+						if (v >= 0 && v <= SOFIA_MAX_DISPATCH_THREADS) {
+							profile->dispatch_threads = v;
+						} else {
+							switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "event-dispatch-threads must be between 0 and %d\n",
+											  SOFIA_MAX_DISPATCH_THREADS);
+						}
+					} else if (!strcasecmp(var, "event-dispatch-queue-size")) {
+						int v = atoi(val);
+						if (v > 0) {
+							profile->dispatch_queue_size = v;
+						}
 					} else if (!strcasecmp(var, "rtp-timeout-sec")) {
 						int v = atoi(val);
 						if (v >= 0) {
@@ -3596,6 +3793,18 @@ switch_status_t config_sofia(int reload, char *profile_name)
 						}
 					} else if (!strcasecmp(var, "nonce-ttl")) {
 						profile->nonce_ttl = atoi(val);
+					} else if (!strcasecmp(var, "registration-index")) {
+						if (switch_true(val)) {
+							sofia_set_pflag(profile, PFLAG_REG_INDEX);
+						} else {
+							sofia_clear_pflag(profile, PFLAG_REG_INDEX);
+						}
+					} else if (!strcasecmp(var, "nonce-store")) {
+						if (!strcasecmp(val, "memory")) {
+							sofia_set_pflag(profile, PFLAG_NONCE_MEMORY);
+						} else {
+							sofia_clear_pflag(profile, PFLAG_NONCE_MEMORY);
+						}
 					} else if (!strcasecmp(var, "accept-blind-reg")) {
 						if (switch_true(val)) {
 							sofia_set_pflag(profile, PFLAG_BLIND_REG);
@@ -4098,6 +4307,7 @@ static void sofia_handle_sip_r_options(switch_core_session_t *session, int statu
 		sql = switch_mprintf("update sip_registrations set expires=%ld where sip_user='%s' and sip_host='%s'",
 							 (long) now, sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host);
 		sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+		sofia_reg_index_set_expires(profile, sip->sip_to->a_url->url_user, sip->sip_to->a_url->url_host, (long) now);
 	}
 }
 
@@ -6540,7 +6750,7 @@ void sofia_handle_sip_i_invite(nua_t *nua, sofia_profile_t *profile, nua_handle_
 		if (!strcmp(network_ip, profile->sipip) && network_port == profile->sip_port) {
 			calling_myself++;
 		} else {
-			if (sofia_reg_handle_register(nua, profile, nh, sip, REG_INVITE, key, sizeof(key), &v_event, NULL)) {
+			if (sofia_reg_handle_register(nua, profile, nh, sip, NULL, REG_INVITE, key, sizeof(key), &v_event, NULL)) {
 				if (v_event) {
 					switch_event_destroy(&v_event);
 				}
@@ -7424,9 +7634,9 @@ void sofia_handle_sip_i_invite(nua_t *nua, sofia_profile_t *profile, nua_handle_
 void sofia_handle_sip_i_options(int status,
 								char const *phrase,
 								nua_t *nua, sofia_profile_t *profile, nua_handle_t *nh, sofia_private_t *sofia_private, sip_t const *sip,
-								tagi_t tags[])
+								sofia_dispatch_event_t *de, tagi_t tags[])
 {
-	nua_respond(nh, SIP_200_OK, NUTAG_WITH_THIS(nua), TAG_END());
+	nua_respond(nh, SIP_200_OK, NUTAG_WITH(sofia_dispatch_request(de, nua)), TAG_END());
 }
 
 void sofia_info_send_sipfrag(switch_core_session_t *aleg, switch_core_session_t *bleg)
@@ -466,6 +466,15 @@ int sofia_reg_find_callback(void *pArg, int argc, char **argv, char **columnName
 	return cbt->matches == 1 ? 0 : 1;
 }
 
+static int sofia_reg_index_find_callback(void *pArg, const sofia_reg_index_entry_t *reg)
+{
+	char *argv[1];
+
+	argv[0] = reg->contact;
+
+	return sofia_reg_find_callback(pArg, 1, argv, NULL);
+}
+
 int sofia_reg_nat_callback(void *pArg, int argc, char **argv, char **columnNames)
 {
 	sofia_profile_t *profile = (sofia_profile_t *) pArg;
@@ -577,6 +586,397 @@ int sofia_reg_del_callback(void *pArg, int argc, char **argv, char **columnNames
 	return 0;
 }
 
+/* In-memory registration index (registration-index=true).  sip_registrations stays the persistent copy and is
+   still written on every change, but contact lookups, registration counts and the expiry pass read the index,
+   which is sharded by sip_user so a lookup only ever locks one shard. */
+
+typedef struct {
+	const char *call_id;
+	const char *user;
+	const char *host;
+	const char *contact;
+	int expired;
+	int all;
+	long now;
+} sofia_reg_index_match_t;
+
+static void sofia_reg_index_entry_free(sofia_reg_index_entry_t *reg)
+{
+	switch_safe_free(reg->call_id);
+	switch_safe_free(reg->sip_user);
+	switch_safe_free(reg->sip_host);
+	switch_safe_free(reg->presence_hosts);
+	switch_safe_free(reg->contact);
+	switch_safe_free(reg->status);
+	switch_safe_free(reg->rpid);
+	switch_safe_free(reg->user_agent);
+	switch_safe_free(reg->server_user);
+	switch_safe_free(reg->server_host);
+	switch_safe_free(reg->network_ip);
+	switch_safe_free(reg->sip_username);
+	free(reg);
+}
+
+static sofia_reg_index_shard_t *sofia_reg_index_shard(sofia_profile_t *profile, const char *user)
+{
+	switch_ssize_t hlen = -1;
+
+	return &profile->reg_index[switch_hashfunc_default(user, &hlen) % SOFIA_REG_INDEX_SHARDS];
+}
+
+static void sofia_reg_index_unlink(sofia_reg_index_shard_t *shard, sofia_reg_index_entry_t *reg)
+{
+	sofia_reg_index_entry_t *cur, *prev = NULL;
+
+	if (switch_core_hash_find(shard->call_ids, reg->call_id) == reg) {
+		switch_core_hash_delete(shard->call_ids, reg->call_id);
+	}
+
+	for (cur = switch_core_hash_find(shard->users, reg->sip_user); cur && cur != reg; cur = cur->next) {
+		prev = cur;
+	}
+
+	if (cur) {
+		if (prev) {
+			prev->next = reg->next;
+		} else if (reg->next) {
+			switch_core_hash_insert(shard->users, reg->sip_user, reg->next);
+		} else {
+			switch_core_hash_delete(shard->users, reg->sip_user);
+		}
+		shard->count--;
+	}
+
+	reg->next = NULL;
+}
+
+/* the same conditions the sql deletes use: by call_id, by user and host (and contact), by host alone or by expiry */
+static int sofia_reg_index_matches(const sofia_reg_index_entry_t *reg, const sofia_reg_index_match_t *match)
+{
+	if (match->call_id) {
+		return !strcmp(reg->call_id, match->call_id);
+	}
+
+	if (match->user) {
+		return !strcmp(reg->sip_user, match->user) && (!match->host || !strcmp(reg->sip_host, match->host)) &&
+			(!match->contact || !strcmp(reg->contact, match->contact));
+	}
+
+	if (match->host) {
+		return !strcmp(reg->sip_host, match->host);
+	}
+
+	if (match->expired) {
+		return reg->expires > 0 && (!match->now || reg->expires <= match->now);
+	}
+
+	return match->all;
+}
+
+/* unlink every matching registration and hand them back chained on ->taken; the caller frees them */
+static sofia_reg_index_entry_t *sofia_reg_index_take(sofia_profile_t *profile, const sofia_reg_index_match_t *match)
+{
+	sofia_reg_index_entry_t *list = NULL, *taken, *reg, *next;
+	sofia_reg_index_shard_t *shard, *user_shard = NULL;
+	switch_hash_index_t *hi;
+	void *val;
+	uint32_t x;
+
+	if (!match->call_id && match->user) {
+		user_shard = sofia_reg_index_shard(profile, match->user);
+	}
+
+	for (x = 0; x < SOFIA_REG_INDEX_SHARDS; x++) {
+		shard = &profile->reg_index[x];
+
+		if (user_shard && shard != user_shard) {
+			continue;
+		}
+
+		taken = NULL;
+		switch_mutex_lock(shard->mutex);
+
+		if (match->call_id) {
+			if ((reg = switch_core_hash_find(shard->call_ids, match->call_id))) {
+				reg->taken = taken;
+				taken = reg;
+			}
+		} else if (match->user) {
+			for (reg = switch_core_hash_find(shard->users, match->user); reg; reg = reg->next) {
+				if (sofia_reg_index_matches(reg, match)) {
+					reg->taken = taken;
+					taken = reg;
+				}
+			}
+		} else {
+			for (hi = switch_hash_first(NULL, shard->users); hi; hi = switch_hash_next(hi)) {
+				switch_hash_this(hi, NULL, NULL, &val);
+				for (reg = (sofia_reg_index_entry_t *) val; reg; reg = reg->next) {
+					if (sofia_reg_index_matches(reg, match)) {
+						reg->taken = taken;
+						taken = reg;
+					}
+				}
+			}
+		}
+
+		for (reg = taken; reg; reg = next) {
+			next = reg->taken;
+			sofia_reg_index_unlink(shard, reg);
+			reg->taken = list;
+			list = reg;
+		}
+
+		switch_mutex_unlock(shard->mutex);
+	}
+
+	return list;
+}
+
+static void sofia_reg_index_free_list(sofia_reg_index_entry_t *list)
+{
+	sofia_reg_index_entry_t *next;
+
+	for (; list; list = next) {
+		next = list->taken;
+		sofia_reg_index_entry_free(list);
+	}
+}
+
+/* fire the expire events for registrations taken out of the index, exactly as the sql expiry pass would */
+static void sofia_reg_index_expire_list(sofia_profile_t *profile, sofia_reg_index_entry_t *list, int reboot)
+{
+	sofia_reg_index_entry_t *reg;
+	char expires[32], reboot_str[4];
+	char *argv[13];
+
+	switch_snprintf(reboot_str, sizeof(reboot_str), "%d", reboot);
+
+	for (reg = list; reg; reg = reg->taken) {
+		switch_snprintf(expires, sizeof(expires), "%ld", reg->expires);
+		argv[0] = reg->call_id;
+		argv[1] = reg->sip_user;
+		argv[2] = reg->sip_host;
+		argv[3] = reg->contact;
+		argv[4] = reg->status;
+		argv[5] = reg->rpid;
+		argv[6] = expires;
+		argv[7] = reg->user_agent;
+		argv[8] = reg->server_user;
+		argv[9] = reg->server_host;
+		argv[10] = profile->name;
+		argv[11] = reg->network_ip;
+		argv[12] = reboot_str;
+		sofia_reg_del_callback(profile, 13, argv, NULL);
+	}
+
+	sofia_reg_index_free_list(list);
+}
+
+void sofia_reg_index_add(sofia_profile_t *profile, const sofia_reg_index_entry_t *reg)
+{
+	sofia_reg_index_shard_t *shard;
+	sofia_reg_index_entry_t *new_reg, *old;
+	sofia_reg_index_match_t match = { 0 };
+
+	if (!profile->reg_index || zstr(reg->call_id) || zstr(reg->sip_user)) {
+		return;
+	}
+
+	/* a call-id is one registration, re-registering replaces it */
+	match.call_id = reg->call_id;
+	sofia_reg_index_free_list(sofia_reg_index_take(profile, &match));
+
+	switch_zmalloc(new_reg, sizeof(*new_reg));
+	new_reg->call_id = strdup(reg->call_id);
+	new_reg->sip_user = strdup(reg->sip_user);
+	new_reg->sip_host = strdup(switch_str_nil(reg->sip_host));
+	new_reg->presence_hosts = strdup(switch_str_nil(reg->presence_hosts));
+	new_reg->contact = strdup(switch_str_nil(reg->contact));
+	new_reg->status = strdup(switch_str_nil(reg->status));
+	new_reg->rpid = strdup(switch_str_nil(reg->rpid));
+	new_reg->user_agent = strdup(switch_str_nil(reg->user_agent));
+	new_reg->server_user = strdup(switch_str_nil(reg->server_user));
+	new_reg->server_host = strdup(switch_str_nil(reg->server_host));
+	new_reg->network_ip = strdup(switch_str_nil(reg->network_ip));
+	new_reg->sip_username = strdup(switch_str_nil(reg->sip_username));
+	new_reg->expires = reg->expires;
+
+	shard = sofia_reg_index_shard(profile, new_reg->sip_user);
+
+	switch_mutex_lock(shard->mutex);
+	if ((old = switch_core_hash_find(shard->users, new_reg->sip_user))) {
+		new_reg->next = old;
+	}
+	switch_core_hash_insert(shard->users, new_reg->sip_user, new_reg);
+	switch_core_hash_insert(shard->call_ids, new_reg->call_id, new_reg);
+	shard->count++;
+	switch_mutex_unlock(shard->mutex);
+}
+
+void sofia_reg_index_del(sofia_profile_t *profile, const char *call_id, const char *user, const char *host, const char *contact)
+{
+	sofia_reg_index_match_t match = { 0 };
+
+	if (!profile->reg_index) {
+		return;
+	}
+
+	match.call_id = call_id;
+	match.user = user;
+	match.host = host;
+	match.contact = contact;
+
+	sofia_reg_index_free_list(sofia_reg_index_take(profile, &match));
+}
+
+void sofia_reg_index_set_expires(sofia_profile_t *profile, const char *user, const char *host, long expires)
+{
+	sofia_reg_index_shard_t *shard;
+	sofia_reg_index_entry_t *reg;
+
+	if (!profile->reg_index || zstr(user)) {
+		return;
+	}
+
+	shard = sofia_reg_index_shard(profile, user);
+
+	switch_mutex_lock(shard->mutex);
+	for (reg = switch_core_hash_find(shard->users, user); reg; reg = reg->next) {
+		if (!host || !strcmp(reg->sip_host, host)) {
+			reg->expires = expires;
+		}
+	}
+	switch_mutex_unlock(shard->mutex);
+}
+
+/* walk the registrations of user that are on host or list it in their presence hosts, like the
+   "sip_user=... and (sip_host=... or presence_hosts like ...)" queries; a non-zero callback return stops the walk */
+uint32_t sofia_reg_index_find(sofia_profile_t *profile, const char *user, const char *host, sofia_reg_index_callback_t callback, void *pArg)
+{
+	sofia_reg_index_shard_t *shard;
+	sofia_reg_index_entry_t *reg;
+	uint32_t matches = 0;
+
+	if (!profile->reg_index || zstr(user)) {
+		return 0;
+	}
+
+	shard = sofia_reg_index_shard(profile, user);
+
+	switch_mutex_lock(shard->mutex);
+	for (reg = switch_core_hash_find(shard->users, user); reg; reg = reg->next) {
+		if (host && strcmp(reg->sip_host, host) && !switch_stristr(host, reg->presence_hosts)) {
+			continue;
+		}
+
+		matches++;
+
+		if (callback && callback(pArg, reg)) {
+			break;
+		}
+	}
+	switch_mutex_unlock(shard->mutex);
+
+	return matches;
+}
+
+uint32_t sofia_reg_index_count(sofia_profile_t *profile)
+{
+	uint32_t x, total = 0;
+
+	if (!profile->reg_index) {
+		return 0;
+	}
+
+	for (x = 0; x < SOFIA_REG_INDEX_SHARDS; x++) {
+		total += profile->reg_index[x].count;
+	}
+
+	return total;
+}
+
+static int sofia_reg_index_load_callback(void *pArg, int argc, char **argv, char **columnNames)
+{
+	sofia_profile_t *profile = (sofia_profile_t *) pArg;
+	sofia_reg_index_entry_t reg = { 0 };
+
+	reg.call_id = argv[0];
+	reg.sip_user = argv[1];
+	reg.sip_host = argv[2];
+	reg.presence_hosts = argv[3];
+	reg.contact = argv[4];
+	reg.status = argv[5];
+	reg.rpid = argv[6];
+	reg.expires = zstr(argv[7]) ? 0 : atol(argv[7]);
+	reg.user_agent = argv[8];
+	reg.server_user = argv[9];
+	reg.server_host = argv[10];
+	reg.network_ip = argv[11];
+	reg.sip_username = argv[12];
+
+	sofia_reg_index_add(profile, &reg);
+
+	return 0;
+}
+
+void sofia_reg_index_init(sofia_profile_t *profile)
+{
+	char *sql;
+	uint32_t x;
+
+	profile->reg_index = switch_core_alloc(profile->pool, sizeof(sofia_reg_index_shard_t) * SOFIA_REG_INDEX_SHARDS);
+
+	for (x = 0; x < SOFIA_REG_INDEX_SHARDS; x++) {
+		switch_core_hash_init(&profile->reg_index[x].users, profile->pool);
+		switch_core_hash_init(&profile->reg_index[x].call_ids, profile->pool);
+		switch_mutex_init(&profile->reg_index[x].mutex, SWITCH_MUTEX_NESTED, profile->pool);
+	}
+
+	/* pick up whatever this box had registered before a restart */
+	sql = switch_mprintf("select call_id,sip_user,sip_host,presence_hosts,contact,status,rpid,expires,"
+						 "user_agent,server_user,server_host,network_ip,sip_username "
+						 "from sip_registrations where profile_name='%q' and hostname='%q'", profile->name, mod_sofia_globals.hostname);
+	switch_assert(sql);
+	sofia_glue_execute_sql_callback(profile, profile->ireg_mutex, sql, sofia_reg_index_load_callback, profile);
+	switch_safe_free(sql);
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Loaded %u registrations into the index for %s\n",
+					  sofia_reg_index_count(profile), profile->name);
+}
+
+void sofia_reg_index_destroy(sofia_profile_t *profile)
+{
+	sofia_reg_index_match_t match = { 0 };
+	uint32_t x;
+
+	if (!profile->reg_index) {
+		return;
+	}
+
+	match.all = 1;
+	sofia_reg_index_free_list(sofia_reg_index_take(profile, &match));
+
+	for (x = 0; x < SOFIA_REG_INDEX_SHARDS; x++) {
+		switch_core_hash_destroy(&profile->reg_index[x].users);
+		switch_core_hash_destroy(&profile->reg_index[x].call_ids);
+	}
+
+	profile->reg_index = NULL;
+}
+
+/* Every write to sip_registrations goes through here.  With the index in front of the table the db only has to
+   catch up, so the writes are queued; they must all take the same path or a direct delete can overtake a queued
+   insert for the same contact and leave a row behind. */
+static void sofia_reg_execute_sql(sofia_profile_t *profile, char **sqlp, switch_bool_t sql_already_dynamic)
+{
+	if (profile->reg_index) {
+		sofia_glue_execute_sql(profile, sqlp, sql_already_dynamic);
+	} else {
+		sofia_glue_execute_sql_now(profile, sqlp, sql_already_dynamic);
+	}
+}
+
 void sofia_reg_expire_call_id(sofia_profile_t *profile, const char *call_id, int reboot)
 {
 	char *sql = NULL;
@@ -608,12 +1008,23 @@ void sofia_reg_expire_call_id(sofia_profile_t *profile, const char *call_id, int
 						 ",%d from sip_registrations where call_id='%q' %s", reboot, call_id, sqlextra);
 
 	switch_mutex_lock(profile->ireg_mutex);
-	sofia_glue_execute_sql_callback(profile, NULL, sql, sofia_reg_del_callback, profile);
+	if (profile->reg_index) {
+		sofia_reg_index_match_t match = { 0 };
+
+		match.call_id = call_id;
+		sofia_reg_index_expire_list(profile, sofia_reg_index_take(profile, &match), reboot);
+		match.call_id = NULL;
+		match.user = zstr(user) ? NULL : user;
+		match.host = host;
+		sofia_reg_index_expire_list(profile, sofia_reg_index_take(profile, &match), reboot);
+	} else {
+		sofia_glue_execute_sql_callback(profile, NULL, sql, sofia_reg_del_callback, profile);
+	}
 	switch_mutex_unlock(profile->ireg_mutex);
 	switch_safe_free(sql);
 
 	sql = switch_mprintf("delete from sip_registrations where call_id='%q' %s", call_id, sqlextra);
-	sofia_glue_execute_sql_now(profile, &sql, SWITCH_FALSE);
+	sofia_reg_execute_sql(profile, &sql, SWITCH_TRUE);
 
 	switch_safe_free(sqlextra);
 	switch_safe_free(sql);
@@ -621,22 +1032,204 @@ void sofia_reg_expire_call_id(sofia_profile_t *profile, const char *call_id, int
 
 }
 
+/* In-memory nonce store (nonce-store=memory).  Nonces are spread over SOFIA_NONCE_SHARDS hashes, each with
+   its own mutex, so concurrent challenges and auth checks do not serialize on ireg_mutex and the db. */
+
+typedef struct {
+	time_t expires;
+	unsigned long last_nc;
+} sofia_nonce_t;
+
+typedef struct {
+	time_t now;
+	uint32_t count;
+} sofia_nonce_match_t;
+
+void sofia_reg_nonce_store_init(sofia_profile_t *profile)
+{
+	uint32_t x;
+
+	profile->nonce_shards = switch_core_alloc(profile->pool, sizeof(sofia_nonce_shard_t) * SOFIA_NONCE_SHARDS);
+
+	for (x = 0; x < SOFIA_NONCE_SHARDS; x++) {
+		switch_core_hash_init(&profile->nonce_shards[x].hash, profile->pool);
+		switch_mutex_init(&profile->nonce_shards[x].mutex, SWITCH_MUTEX_NESTED, profile->pool);
+	}
+}
+
+static switch_bool_t sofia_reg_nonce_match_callback(const void *key, const void *val, void *pData)
+{
+	sofia_nonce_t *n = (sofia_nonce_t *) val;
+	sofia_nonce_match_t *match = (sofia_nonce_match_t *) pData;
+
+	if (match->now && (!n->expires || n->expires > match->now)) {
+		return SWITCH_FALSE;
+	}
+
+	free(n);
+	match->count++;
+
+	return SWITCH_TRUE;
+}
+
+static uint32_t sofia_reg_nonce_expire(sofia_profile_t *profile, time_t now)
+{
+	sofia_nonce_match_t match = { 0 };
+	uint32_t x, total = 0;
+
+	if (!profile->nonce_shards) {
+		return 0;
+	}
+
+	match.now = now;
+
+	for (x = 0; x < SOFIA_NONCE_SHARDS; x++) {
+		sofia_nonce_shard_t *shard = &profile->nonce_shards[x];
+
+		switch_mutex_lock(shard->mutex);
+		match.count = 0;
+		switch_core_hash_delete_multi(shard->hash, sofia_reg_nonce_match_callback, &match);
+		shard->count -= match.count;
+		total += match.count;
+		switch_mutex_unlock(shard->mutex);
+	}
+
+	return total;
+}
+
+void sofia_reg_nonce_store_destroy(sofia_profile_t *profile)
+{
+	uint32_t x;
+
+	if (!profile->nonce_shards) {
+		return;
+	}
+
+	sofia_reg_nonce_expire(profile, 0);
+
+	for (x = 0; x < SOFIA_NONCE_SHARDS; x++) {
+		switch_core_hash_destroy(&profile->nonce_shards[x].hash);
+	}
+
+	profile->nonce_shards = NULL;
+}
+
+uint32_t sofia_reg_nonce_count(sofia_profile_t *profile)
+{
+	uint32_t x, total = 0;
+
+	if (!profile->nonce_shards) {
+		return 0;
+	}
+
+	for (x = 0; x < SOFIA_NONCE_SHARDS; x++) {
+		total += profile->nonce_shards[x].count;
+	}
+
+	return total;
+}
+
+static sofia_nonce_shard_t *sofia_reg_nonce_shard(sofia_profile_t *profile, const char *nonce)
+{
+	switch_ssize_t hlen = -1;
+
+	return &profile->nonce_shards[switch_ci_hashfunc_default(nonce, &hlen) % SOFIA_NONCE_SHARDS];
+}
+
+static void sofia_reg_nonce_add(sofia_profile_t *profile, const char *nonce, time_t expires)
+{
+	sofia_nonce_shard_t *shard = sofia_reg_nonce_shard(profile, nonce);
+	sofia_nonce_t *n;
+
+	switch_zmalloc(n, sizeof(*n));
+	n->expires = expires;
+
+	switch_mutex_lock(shard->mutex);
+	switch_core_hash_insert(shard->hash, nonce, n);
+	shard->count++;
+	switch_mutex_unlock(shard->mutex);
+}
+
+/* same rules as the sql lookup: the nonce must exist and, when the client sent nc, be below it.
+   A passing nc is taken right away under the same lock so two requests replaying one nc can't both pass. */
+static switch_bool_t sofia_reg_nonce_check(sofia_profile_t *profile, const char *nonce, const char *nc, unsigned long nc_long, time_t expires,
+										   int *last_nc)
+{
+	sofia_nonce_shard_t *shard = sofia_reg_nonce_shard(profile, nonce);
+	sofia_nonce_t *n;
+	switch_bool_t found = SWITCH_FALSE;
+	time_t now = switch_epoch_time_now(NULL);
+
+	switch_mutex_lock(shard->mutex);
+	if ((n = switch_core_hash_find(shard->hash, nonce)) && (!n->expires || n->expires > now) && (!nc || n->last_nc < nc_long)) {
+		*last_nc = nc ? (int) n->last_nc : 0;
+		if (nc) {
+			n->last_nc = nc_long;
+			n->expires = expires;
+		}
+		found = SWITCH_TRUE;
+	}
+	switch_mutex_unlock(shard->mutex);
+
+	return found;
+}
+
+static void sofia_reg_nonce_del(sofia_profile_t *profile, const char *nonce)
+{
+	sofia_nonce_shard_t *shard = sofia_reg_nonce_shard(profile, nonce);
+	sofia_nonce_t *n;
+
+	switch_mutex_lock(shard->mutex);
+	if ((n = switch_core_hash_find(shard->hash, nonce))) {
+		switch_core_hash_delete(shard->hash, nonce);
+		shard->count--;
+		free(n);
+	}
+	switch_mutex_unlock(shard->mutex);
+}
+
+static void sofia_reg_nonce_update(sofia_profile_t *profile, const char *nonce, time_t expires, unsigned long nc)
+{
+	sofia_nonce_shard_t *shard = sofia_reg_nonce_shard(profile, nonce);
+	sofia_nonce_t *n;
+
+	switch_mutex_lock(shard->mutex);
+	if ((n = switch_core_hash_find(shard->hash, nonce))) {
+		n->expires = expires;
+		/* sofia_reg_nonce_check() may already have moved it on for a later request */
+		if (nc > n->last_nc) {
+			n->last_nc = nc;
+		}
+	}
+	switch_mutex_unlock(shard->mutex);
+}
+
 void sofia_reg_check_expire(sofia_profile_t *profile, time_t now, int reboot)
 {
 	char sql[1024];
+	char *psql = sql;
 
 	switch_mutex_lock(profile->ireg_mutex);
 
-	if (now) {
-		switch_snprintf(sql, sizeof(sql), "select call_id,sip_user,sip_host,contact,status,rpid,expires"
-						",user_agent,server_user,server_host,profile_name,network_ip"
-						",%d from sip_registrations where expires > 0 and expires <= %ld", reboot, (long) now);
+	if (profile->reg_index) {
+		sofia_reg_index_match_t match = { 0 };
+
+		match.expired = 1;
+		match.now = (long) now;
+		sofia_reg_index_expire_list(profile, sofia_reg_index_take(profile, &match), reboot);
 	} else {
-		switch_snprintf(sql, sizeof(sql), "select call_id,sip_user,sip_host,contact,status,rpid,expires"
-						",user_agent,server_user,server_host,profile_name,network_ip" ",%d from sip_registrations where expires > 0", reboot);
+		if (now) {
+			switch_snprintf(sql, sizeof(sql), "select call_id,sip_user,sip_host,contact,status,rpid,expires"
+							",user_agent,server_user,server_host,profile_name,network_ip"
+							",%d from sip_registrations where expires > 0 and expires <= %ld", reboot, (long) now);
+		} else {
+			switch_snprintf(sql, sizeof(sql), "select call_id,sip_user,sip_host,contact,status,rpid,expires"
+							",user_agent,server_user,server_host,profile_name,network_ip" ",%d from sip_registrations where expires > 0", reboot);
+		}
+
+		sofia_glue_execute_sql_callback(profile, NULL, sql, sofia_reg_del_callback, profile);
 	}
 
-	sofia_glue_execute_sql_callback(profile, NULL, sql, sofia_reg_del_callback, profile);
 	if (now) {
 		switch_snprintf(sql, sizeof(sql), "delete from sip_registrations where expires > 0 and expires <= %ld and hostname='%s'",
 						(long) now, mod_sofia_globals.hostname);
@@ -644,7 +1237,7 @@ void sofia_reg_check_expire(sofia_profile_t *profile, time_t now, int reboot)
 		switch_snprintf(sql, sizeof(sql), "delete from sip_registrations where expires > 0 and hostname='%s'", mod_sofia_globals.hostname);
 	}
 
-	sofia_glue_actually_execute_sql(profile, sql, NULL);
+	sofia_reg_execute_sql(profile, &psql, SWITCH_FALSE);
 
 
 
@@ -678,6 +1271,8 @@ void sofia_reg_check_expire(sofia_profile_t *profile, time_t now, int reboot)
 	}
 
 	sofia_glue_actually_execute_sql(profile, sql, NULL);
+
+	sofia_reg_nonce_expire(profile, now);
 	
 	if (now) {
 		switch_snprintf(sql, sizeof(sql),
@@ -746,6 +1341,11 @@ char *sofia_reg_find_reg_url(sofia_profile_t *profile, const char *user, const c
 	cbt.val = val;
 	cbt.len = len;
 
+	if (profile->reg_index) {
+		sofia_reg_index_find(profile, user, host, sofia_reg_index_find_callback, &cbt);
+		return cbt.matches ? val : NULL;
+	}
+
 	if (host) {
 		switch_snprintf(sql, sizeof(sql), "select contact from sip_registrations where sip_user='%s' and (sip_host='%s' or presence_hosts like '%%%s%%')",
 						user, host, host);
@@ -775,6 +1375,11 @@ switch_console_callback_match_t *sofia_reg_find_reg_url_multi(sofia_profile_t *p
 		return NULL;
 	}
 
+	if (profile->reg_index) {
+		sofia_reg_index_find(profile, user, host, sofia_reg_index_find_callback, &cbt);
+		return cbt.list;
+	}
+
 	if (host) {
 		switch_snprintf(sql, sizeof(sql), "select contact from sip_registrations where sip_user='%s' and (sip_host='%s' or presence_hosts like '%%%s%%')",
 						user, host, host);
@@ -789,7 +1394,8 @@ switch_console_callback_match_t *sofia_reg_find_reg_url_multi(sofia_profile_t *p
 }
 
 
-void sofia_reg_auth_challenge(nua_t *nua, sofia_profile_t *profile, nua_handle_t *nh, sofia_regtype_t regtype, const char *realm, int stale)
+void sofia_reg_auth_challenge(nua_t *nua, sofia_profile_t *profile, nua_handle_t *nh, sofia_dispatch_event_t *de,
+							  sofia_regtype_t regtype, const char *realm, int stale)
 {
 	switch_uuid_t uuid;
 	char uuid_str[SWITCH_UUID_FORMATTED_LENGTH + 1];
@@ -798,20 +1404,24 @@ void sofia_reg_auth_challenge(nua_t *nua, sofia_profile_t *profile, nua_handle_t
 	switch_uuid_get(&uuid);
 	switch_uuid_format(uuid_str, &uuid);
 
-	sql = switch_mprintf("insert into sip_authentication (nonce,expires,profile_name,hostname, last_nc) "
-						 "values('%q', %ld, '%q', '%q', 0)", uuid_str,
-						 switch_epoch_time_now(NULL) + (profile->nonce_ttl ? profile->nonce_ttl : DEFAULT_NONCE_TTL),
-						 profile->name, mod_sofia_globals.hostname);
-	switch_assert(sql != NULL);
-	sofia_glue_actually_execute_sql(profile, sql, profile->ireg_mutex);
-	switch_safe_free(sql);
+	if (profile->nonce_shards) {
+		sofia_reg_nonce_add(profile, uuid_str, switch_epoch_time_now(NULL) + (profile->nonce_ttl ? profile->nonce_ttl : DEFAULT_NONCE_TTL));
+	} else {
+		sql = switch_mprintf("insert into sip_authentication (nonce,expires,profile_name,hostname, last_nc) "
+							 "values('%q', %ld, '%q', '%q', 0)", uuid_str,
+							 switch_epoch_time_now(NULL) + (profile->nonce_ttl ? profile->nonce_ttl : DEFAULT_NONCE_TTL),
+							 profile->name, mod_sofia_globals.hostname);
+		switch_assert(sql != NULL);
+		sofia_glue_actually_execute_sql(profile, sql, profile->ireg_mutex);
+		switch_safe_free(sql);
+	}
 
 	auth_str = switch_mprintf("Digest realm=\"%q\", nonce=\"%q\",%s algorithm=MD5, qop=\"auth\"", realm, uuid_str, stale ? " stale=true," : "");
 
 	if (regtype == REG_REGISTER) {
-		nua_respond(nh, SIP_401_UNAUTHORIZED, TAG_IF(nua, NUTAG_WITH_THIS(nua)), SIPTAG_WWW_AUTHENTICATE_STR(auth_str), TAG_END());
+		nua_respond(nh, SIP_401_UNAUTHORIZED, TAG_IF(nua, NUTAG_WITH(sofia_dispatch_request(de, nua))), SIPTAG_WWW_AUTHENTICATE_STR(auth_str), TAG_END());
 	} else if (regtype == REG_INVITE) {
-		nua_respond(nh, SIP_407_PROXY_AUTH_REQUIRED, TAG_IF(nua, NUTAG_WITH_THIS(nua)), SIPTAG_PROXY_AUTHENTICATE_STR(auth_str), TAG_END());
+		nua_respond(nh, SIP_407_PROXY_AUTH_REQUIRED, TAG_IF(nua, NUTAG_WITH(sofia_dispatch_request(de, nua))), SIPTAG_PROXY_AUTHENTICATE_STR(auth_str), TAG_END());
 	}
 
 	switch_safe_free(auth_str);
@@ -821,6 +1431,10 @@ uint32_t sofia_reg_reg_count(sofia_profile_t *profile, const char *user, const c
 {
 	char buf[32] = "";
 	char *sql;
+
+	if (profile->reg_index) {
+		return sofia_reg_index_find(profile, user, host, NULL, NULL);
+	}
 	
 	sql = switch_mprintf("select count(*) from sip_registrations where profile_name='%q' and "
 						 "sip_user='%q' and (sip_host='%q' or presence_hosts like '%%%q%%')", profile->name, user, host, host);
@@ -830,7 +1444,8 @@ uint32_t sofia_reg_reg_count(sofia_profile_t *profile, const char *user, const c
 	return atoi(buf);													
 }
 
-uint8_t sofia_reg_handle_register(nua_t *nua, sofia_profile_t *profile, nua_handle_t *nh, sip_t const *sip, sofia_regtype_t regtype, char *key,
+uint8_t sofia_reg_handle_register(nua_t *nua, sofia_profile_t *profile, nua_handle_t *nh, sip_t const *sip, sofia_dispatch_event_t *de,
+								  sofia_regtype_t regtype, char *key,
 								  uint32_t keylen, switch_event_t **v_event, const char *is_nat)
 {
 	sip_to_t const *to = NULL;
@@ -892,11 +1507,11 @@ uint8_t sofia_reg_handle_register(nua_t *nua, sofia_profile_t *profile, nua_hand
 	/* all callers must confirm that sip, sip->sip_request and sip->sip_contact are not NULL */
 	switch_assert(sip != NULL && sip->sip_contact != NULL && sip->sip_request != NULL);
 
-	sofia_glue_get_addr(nua_current_request(nua), network_ip, sizeof(network_ip), &network_port);
+	sofia_glue_get_addr(sofia_dispatch_request(de, nua), network_ip, sizeof(network_ip), &network_port);
 
 	snprintf(network_port_c, sizeof(network_port_c), "%d", network_port);
 
-	snprintf(url_ip, sizeof(url_ip), (msg_addrinfo(nua_current_request(nua)))->ai_addr->sa_family == AF_INET6 ? "[%s]" : "%s", network_ip);
+	snprintf(url_ip, sizeof(url_ip), (msg_addrinfo(sofia_dispatch_request(de, nua)))->ai_addr->sa_family == AF_INET6 ? "[%s]" : "%s", network_ip);
 
 	expires = sip->sip_expires;
 	authorization = sip->sip_authorization;
@@ -927,7 +1542,7 @@ uint8_t sofia_reg_handle_register(nua_t *nua, sofia_profile_t *profile, nua_hand
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Can not do authorization without a complete header in REGISTER request from %s:%d\n", 
 						  network_ip, network_port);
 
-		nua_respond(nh, SIP_401_UNAUTHORIZED, NUTAG_WITH_THIS(nua), TAG_END());
+		nua_respond(nh, SIP_401_UNAUTHORIZED, NUTAG_WITH(sofia_dispatch_request(de, nua)), TAG_END());
 		switch_goto_int(r, 1, end);
 	}
 
@@ -1189,10 +1804,10 @@ uint8_t sofia_reg_handle_register(nua_t *nua, sofia_profile_t *profile, nua_hand
 
 		if (auth_res != AUTH_OK && !stale) {
 			if (auth_res == AUTH_FORBIDDEN) {
-				nua_respond(nh, SIP_403_FORBIDDEN, NUTAG_WITH_THIS(nua), TAG_END());
+				nua_respond(nh, SIP_403_FORBIDDEN, NUTAG_WITH(sofia_dispatch_request(de, nua)), TAG_END());
 				forbidden = 1;
 			} else {
-				nua_respond(nh, SIP_401_UNAUTHORIZED, NUTAG_WITH_THIS(nua), TAG_END());
+				nua_respond(nh, SIP_401_UNAUTHORIZED, NUTAG_WITH(sofia_dispatch_request(de, nua)), TAG_END());
 			}
 
 			if (profile->debug) {
@@ -1236,7 +1851,7 @@ uint8_t sofia_reg_handle_register(nua_t *nua, sofia_profile_t *profile, nua_hand
 			realm = from_host;
 		}
 
-		sofia_reg_auth_challenge(nua, profile, nh, regtype, realm, stale);
+		sofia_reg_auth_challenge(nua, profile, nh, de, regtype, realm, stale);
 
 		if (profile->debug) {
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Send challenge for [%s@%s]\n", to_user, to_host);
@@ -1313,8 +1928,10 @@ uint8_t sofia_reg_handle_register(nua_t *nua, sofia_profile_t *profile, nua_hand
 			if (multi_reg_contact) {
 				sql =
 					switch_mprintf("delete from sip_registrations where sip_user='%q' and sip_host='%q' and contact='%q'", to_user, reg_host, contact_str);
+				sofia_reg_index_del(profile, NULL, to_user, reg_host, contact_str);
 			} else {
 				sql = switch_mprintf("delete from sip_registrations where call_id='%q'", call_id);
+				sofia_reg_index_del(profile, call_id, NULL, NULL, NULL);
 			}
 		} else {
 			if (delete_subs) {
@@ -1322,9 +1939,10 @@ uint8_t sofia_reg_handle_register(nua_t *nua, sofia_profile_t *profile, nua_hand
 				sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
 			}
 			sql = switch_mprintf("delete from sip_registrations where sip_user='%q' and sip_host='%q'", to_user, reg_host);
+			sofia_reg_index_del(profile, NULL, to_user, reg_host, NULL);
 		}
 		switch_mutex_lock(profile->ireg_mutex);
-		sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+		sofia_reg_execute_sql(profile, &sql, SWITCH_TRUE);
 
 		switch_find_local_ip(guess_ip4, sizeof(guess_ip4), NULL, AF_INET);
 
@@ -1348,7 +1966,26 @@ uint8_t sofia_reg_handle_register(nua_t *nua, sofia_profile_t *profile, nua_hand
 							 mwi_user, mwi_host, guess_ip4, mod_sofia_globals.hostname);
 							 
 		if (sql) {
-			sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+			sofia_reg_execute_sql(profile, &sql, SWITCH_TRUE);
+		}
+
+		if (profile->reg_index) {
+			sofia_reg_index_entry_t reg = { 0 };
+
+			reg.call_id = (char *) call_id;
+			reg.sip_user = (char *) to_user;
+			reg.sip_host = (char *) reg_host;
+			reg.presence_hosts = profile->presence_hosts ? profile->presence_hosts : (char *) reg_host;
+			reg.contact = (char *) contact_str;
+			reg.status = (char *) reg_desc;
+			reg.rpid = (char *) rpid;
+			reg.expires = (long) switch_epoch_time_now(NULL) + (long) exptime + 60;
+			reg.user_agent = (char *) agent;
+			reg.server_user = (char *) from_user;
+			reg.server_host = guess_ip4;
+			reg.network_ip = network_ip;
+			reg.sip_username = (char *) username;
+			sofia_reg_index_add(profile, &reg);
 		}
 
 		if (sofia_reg_reg_count(profile, to_user, reg_host) == 1) {
@@ -1477,11 +2114,13 @@ uint8_t sofia_reg_handle_register(nua_t *nua, sofia_profile_t *profile, nua_hand
 			if (multi_reg_contact) {
 				sql =
 					switch_mprintf("delete from sip_registrations where sip_user='%q' and sip_host='%q' and contact='%q'", to_user, reg_host, contact_str);
+				sofia_reg_index_del(profile, NULL, to_user, reg_host, contact_str);
 			} else {
 				sql = switch_mprintf("delete from sip_registrations where call_id='%q'", call_id);
+				sofia_reg_index_del(profile, call_id, NULL, NULL, NULL);
 			}
 
-			sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+			sofia_reg_execute_sql(profile, &sql, SWITCH_TRUE);
 
 			switch_safe_free(icontact);
 		} else {
@@ -1491,8 +2130,9 @@ uint8_t sofia_reg_handle_register(nua_t *nua, sofia_profile_t *profile, nua_hand
 				}
 			}
 			if ((sql = switch_mprintf("delete from sip_registrations where sip_user='%q' and sip_host='%q'", to_user, reg_host))) {
-				sofia_glue_execute_sql_now(profile, &sql, SWITCH_TRUE);
+				sofia_reg_execute_sql(profile, &sql, SWITCH_TRUE);
 			}
+			sofia_reg_index_del(profile, NULL, to_user, reg_host, NULL);
 		}
 	}
 
@@ -1558,7 +2198,7 @@ uint8_t sofia_reg_handle_register(nua_t *nua, sofia_profile_t *profile, nua_hand
 
 		switch_rfc822_date(date, switch_micro_time_now());
 		nua_respond(nh, SIP_200_OK, SIPTAG_CONTACT(sip->sip_contact),
-					TAG_IF(path_val, SIPTAG_PATH_STR(path_val)), NUTAG_WITH_THIS(nua), SIPTAG_DATE_STR(date), TAG_END());
+					TAG_IF(path_val, SIPTAG_PATH_STR(path_val)), NUTAG_WITH(sofia_dispatch_request(de, nua)), SIPTAG_DATE_STR(date), TAG_END());
 
 		if (s_event) {
 			switch_event_fire(&s_event);
@@ -1569,7 +2209,7 @@ uint8_t sofia_reg_handle_register(nua_t *nua, sofia_profile_t *profile, nua_hand
 		}
 
 		if (*contact_str && sofia_test_pflag(profile, PFLAG_MANAGE_SHARED_APPEARANCE_SYLANTRO)) {
-			sofia_sla_handle_register(nua, profile, sip, exptime, contact_str);
+			sofia_sla_handle_register(nua, profile, sip, de, exptime, contact_str);
 		}
 
 		switch_goto_int(r, 1, end);
@@ -1589,7 +2229,7 @@ uint8_t sofia_reg_handle_register(nua_t *nua, sofia_profile_t *profile, nua_hand
 
 
 void sofia_reg_handle_sip_i_register(nua_t *nua, sofia_profile_t *profile, nua_handle_t *nh, sofia_private_t *sofia_private, sip_t const *sip,
-									 tagi_t tags[])
+									 sofia_dispatch_event_t *de, tagi_t tags[])
 {
 	char key[128] = "";
 	switch_event_t *v_event = NULL;
@@ -1611,7 +2251,7 @@ void sofia_reg_handle_sip_i_register(nua_t *nua, sofia_profile_t *profile, nua_h
 	}
 #endif
 
-	sofia_glue_get_addr(nua_current_request(nua), network_ip, sizeof(network_ip), &network_port);
+	sofia_glue_get_addr(sofia_dispatch_request(de, nua), network_ip, sizeof(network_ip), &network_port);
 
 	if (!(sip->sip_contact && sip->sip_contact->m_url)) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "NO CONTACT! ip: %s, port: %i\n", network_ip, network_port);
@@ -1620,7 +2260,7 @@ void sofia_reg_handle_sip_i_register(nua_t *nua, sofia_profile_t *profile, nua_h
 	}
 
 	if (!(profile->mflags & MFLAG_REGISTER)) {
-		nua_respond(nh, SIP_403_FORBIDDEN, NUTAG_WITH_THIS(nua), TAG_END());
+		nua_respond(nh, SIP_403_FORBIDDEN, NUTAG_WITH(sofia_dispatch_request(de, nua)), TAG_END());
 		goto end;
 	}
 
@@ -1684,7 +2324,7 @@ void sofia_reg_handle_sip_i_register(nua_t *nua, sofia_profile_t *profile, nua_h
 			type = REG_AUTO_REGISTER;
 		} else if (!ok) {
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "IP %s Rejected by register acl \"%s\"\n", network_ip, profile->reg_acl[x]);
-			nua_respond(nh, SIP_403_FORBIDDEN, NUTAG_WITH_THIS(nua), TAG_END());
+			nua_respond(nh, SIP_403_FORBIDDEN, NUTAG_WITH(sofia_dispatch_request(de, nua)), TAG_END());
 			goto end;
 		}
 	}
@@ -1702,7 +2342,7 @@ void sofia_reg_handle_sip_i_register(nua_t *nua, sofia_profile_t *profile, nua_h
 		is_nat = NULL;
 	}
 
-	sofia_reg_handle_register(nua, profile, nh, sip, type, key, sizeof(key), &v_event, is_nat);
+	sofia_reg_handle_register(nua, profile, nh, sip, de, type, key, sizeof(key), &v_event, is_nat);
 
 	if (v_event) {
 		switch_event_destroy(&v_event);
@@ -2085,24 +2725,38 @@ auth_res_t sofia_reg_parse_auth(sofia_profile_t *profile,
 
 		if (nc) {
 			nc_long = strtoul(nc, 0, 16);
-			sql = switch_mprintf("select nonce,last_nc from sip_authentication where nonce='%q' and last_nc < %lu", nonce, nc_long);
-		} else {
-			sql = switch_mprintf("select nonce from sip_authentication where nonce='%q'", nonce);
 		}
 
-		cb.nonce = np;
-		cb.nplen = nplen;
+		if (profile->nonce_shards) {
+			if (sofia_reg_nonce_check(profile, nonce, nc, nc_long,
+									  switch_epoch_time_now(NULL) + (profile->nonce_ttl ? profile->nonce_ttl : exptime + 10), &cb.last_nc)) {
+				switch_copy_string(np, nonce, nplen);
+			} else {
+				sofia_reg_nonce_del(profile, nonce);
+				ret = AUTH_STALE;
+				goto end;
+			}
+		} else {
+			if (nc) {
+				sql = switch_mprintf("select nonce,last_nc from sip_authentication where nonce='%q' and last_nc < %lu", nonce, nc_long);
+			} else {
+				sql = switch_mprintf("select nonce from sip_authentication where nonce='%q'", nonce);
+			}
 
-		switch_assert(sql != NULL);
-		sofia_glue_execute_sql_callback(profile, profile->ireg_mutex, sql, sofia_reg_nonce_callback, &cb);
-		free(sql);
+			cb.nonce = np;
+			cb.nplen = nplen;
 
-		//if (!sofia_glue_execute_sql2str(profile, profile->ireg_mutex, sql, np, nplen)) {
-		if (zstr(np)) {
-			sql = switch_mprintf("delete from sip_authentication where nonce='%q'", nonce);
-			sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
-			ret = AUTH_STALE;
-			goto end;
+			switch_assert(sql != NULL);
+			sofia_glue_execute_sql_callback(profile, profile->ireg_mutex, sql, sofia_reg_nonce_callback, &cb);
+			free(sql);
+
+			//if (!sofia_glue_execute_sql2str(profile, profile->ireg_mutex, sql, np, nplen)) {
+			if (zstr(np)) {
+				sql = switch_mprintf("delete from sip_authentication where nonce='%q'", nonce);
+				sofia_glue_execute_sql(profile, &sql, SWITCH_TRUE);
+				ret = AUTH_STALE;
+				goto end;
+			}
 		}
 
 		if (reg_count) {
@@ -2184,7 +2838,7 @@ auth_res_t sofia_reg_parse_auth(sofia_profile_t *profile,
 		domain_name = realm;
 	}
 
-	if (switch_xml_locate_user("id", zstr(username) ? "nobody" : username, domain_name, ip, &xml, &domain, &user, &group, params) != SWITCH_STATUS_SUCCESS) {
+	if (switch_xml_locate_user_cached("id", zstr(username) ? "nobody" : username, domain_name, ip, &xml, &domain, &user, &group, params) != SWITCH_STATUS_SUCCESS) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Can't find user [%s@%s]\n"
 						  "You must define a domain called '%s' in your directory and add a user with the id=\"%s\" attribute\n"
 						  "and you must configure your device to use the proper domain in it's authentication credentials.\n", username, domain_name,
@@ -2627,12 +3281,16 @@ auth_res_t sofia_reg_parse_auth(sofia_profile_t *profile,
 #else
 #define	LL_FMT "l"
 #endif
-		sql = switch_mprintf("update sip_authentication set expires='%" LL_FMT "u',last_nc=%lu where nonce='%s'",
-							 switch_epoch_time_now(NULL) + (profile->nonce_ttl ? profile->nonce_ttl : exptime + 10), ncl, nonce);
+		if (profile->nonce_shards) {
+			sofia_reg_nonce_update(profile, nonce, switch_epoch_time_now(NULL) + (profile->nonce_ttl ? profile->nonce_ttl : exptime + 10), ncl);
+		} else {
+			sql = switch_mprintf("update sip_authentication set expires='%" LL_FMT "u',last_nc=%lu where nonce='%s'",
+								 switch_epoch_time_now(NULL) + (profile->nonce_ttl ? profile->nonce_ttl : exptime + 10), ncl, nonce);
 
-		switch_assert(sql != NULL);
-		sofia_glue_actually_execute_sql(profile, sql, profile->ireg_mutex);
-		switch_safe_free(sql);
+			switch_assert(sql != NULL);
+			sofia_glue_actually_execute_sql(profile, sql, profile->ireg_mutex);
+			switch_safe_free(sql);
+		}
 	}
 
 	switch_event_destroy(&params);
@@ -68,7 +68,7 @@ int sofia_sla_supported(sip_t const *sip)
 }
 
 
-void sofia_sla_handle_register(nua_t *nua, sofia_profile_t *profile, sip_t const *sip, long exptime, const char *full_contact)
+void sofia_sla_handle_register(nua_t *nua, sofia_profile_t *profile, sip_t const *sip, sofia_dispatch_event_t *de, long exptime, const char *full_contact)
 {
 	nua_handle_t *nh = NULL;
 	char exp_str[256] = "";
@@ -83,7 +83,7 @@ void sofia_sla_handle_register(nua_t *nua, sofia_profile_t *profile, sip_t const
 	char *route_uri = NULL;
 	char port_str[25] = "";
 
-	sofia_glue_get_addr(nua_current_request(nua), network_ip, sizeof(network_ip), &network_port);
+	sofia_glue_get_addr(sofia_dispatch_request(de, nua), network_ip, sizeof(network_ip), &network_port);
 
 	sql = switch_mprintf("select call_id from sip_shared_appearance_dialogs where hostname='%q' and profile_name='%q' and contact_str='%q'",
 						 mod_sofia_globals.hostname, profile->name, contact_str);
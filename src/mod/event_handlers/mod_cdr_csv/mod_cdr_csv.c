@@ -34,14 +34,31 @@ typedef enum {
 	CDR_LEG_B = (1 << 1)
 } cdr_leg_t;
 
+typedef enum {
+	CDR_FSYNC_NONE,
+	CDR_FSYNC_FLUSH
+} cdr_fsync_t;
+
 struct cdr_fd {
 	int fd;
 	char *path;
 	int64_t bytes;
 	switch_mutex_t *mutex;
+	/* lines waiting for the writer thread to flush them */
+	char *buf;
+	switch_size_t buf_len;
 };
 typedef struct cdr_fd cdr_fd_t;
 
+/* One queued cdr, path and line are stored after the struct */
+struct cdr_line {
+	int rotate;
+	unsigned int len;
+	char *path;
+	char *data;
+};
+typedef struct cdr_line cdr_line_t;
+
 const char *default_template =
 	"\"${caller_id_name}\",\"${caller_id_number}\",\"${destination_number}\",\"${context}\",\"${start_stamp}\","
 	"\"${answer_stamp}\",\"${end_stamp}\",\"${duration}\",\"${billsec}\",\"${hangup_cause}\",\"${uuid}\",\"${bleg_uuid}\", \"${accountcode}\"\n";
@@ -57,6 +74,20 @@ static struct {
 	int rotate;
 	int debug;
 	cdr_leg_t legs;
+	int async;
+	uint32_t queue_size;
+	uint32_t flush_bytes;
+	uint32_t flush_interval;
+	cdr_fsync_t fsync;
+	switch_queue_t *queue;
+	switch_thread_t *writer_thread;
+	int writer_running;
+	switch_mutex_t *stats_mutex;
+	uint64_t stalls;
+	uint64_t lines;
+	uint64_t bytes;
+	uint64_t flushes;
+	uint32_t max_backlog;
 } globals;
 
 SWITCH_MODULE_LOAD_FUNCTION(mod_cdr_csv_load);
@@ -125,11 +156,9 @@ static void do_rotate(cdr_fd_t *fd)
 
 }
 
-static void write_cdr(const char *path, const char *log_line)
+static cdr_fd_t *get_cdr_fd(const char *path)
 {
 	cdr_fd_t *fd = NULL;
-	unsigned int bytes_in, bytes_out;
-	int loops = 0;
 
 	if (!(fd = switch_core_hash_find(globals.fd_hash, path))) {
 		fd = switch_core_alloc(globals.pool, sizeof(*fd));
@@ -141,14 +170,19 @@ static void write_cdr(const char *path, const char *log_line)
 		switch_core_hash_insert(globals.fd_hash, path, fd);
 	}
 
-	switch_mutex_lock(fd->mutex);
-	bytes_out = (unsigned) strlen(log_line);
+	return fd;
+}
+
+static void write_fd(cdr_fd_t *fd, const char *data, unsigned int bytes_out)
+{
+	unsigned int bytes_in;
+	int loops = 0;
 
 	if (fd->fd < 0) {
 		do_reopen(fd);
 		if (fd->fd < 0) {
-			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error opening %s\n", path);
-			goto end;
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error opening %s\n", fd->path);
+			return;
 		}
 	}
 
@@ -156,8 +190,8 @@ static void write_cdr(const char *path, const char *log_line)
 		do_rotate(fd);
 	}
 
-	while ((bytes_in = write(fd->fd, log_line, bytes_out)) != bytes_out && ++loops < 10) {
-		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "Write error to file %s %d/%d\n", path, (int) bytes_in, (int) bytes_out);
+	while ((bytes_in = write(fd->fd, data, bytes_out)) != bytes_out && ++loops < 10) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "Write error to file %s %d/%d\n", fd->path, (int) bytes_in, (int) bytes_out);
 		do_rotate(fd);
 		switch_yield(250000);
 	}
@@ -165,12 +199,173 @@ static void write_cdr(const char *path, const char *log_line)
 	if (bytes_in > 0) {
 		fd->bytes += bytes_in;
 	}
+}
 
-  end:
+static void write_cdr(const char *path, const char *log_line)
+{
+	cdr_fd_t *fd = get_cdr_fd(path);
 
+	switch_mutex_lock(fd->mutex);
+	write_fd(fd, log_line, (unsigned) strlen(log_line));
 	switch_mutex_unlock(fd->mutex);
 }
 
+static void sync_fd(cdr_fd_t *fd)
+{
+	if (fd->fd < 0) {
+		return;
+	}
+#if defined(WIN32)
+	_commit(fd->fd);
+#elif defined(__linux__)
+	fdatasync(fd->fd);
+#else
+	fsync(fd->fd);
+#endif
+}
+
+/* The rest of the async writer only runs in the writer thread, it owns fd_hash and the buffers */
+
+static void flush_fd(cdr_fd_t *fd)
+{
+	if (!fd->buf_len) {
+		return;
+	}
+
+	write_fd(fd, fd->buf, (unsigned) fd->buf_len);
+	if (globals.fsync == CDR_FSYNC_FLUSH) {
+		sync_fd(fd);
+	}
+	fd->buf_len = 0;
+	globals.flushes++;
+}
+
+static void flush_all(switch_bool_t close_fds)
+{
+	switch_hash_index_t *hi;
+	void *val;
+	cdr_fd_t *fd;
+
+	for (hi = switch_hash_first(NULL, globals.fd_hash); hi; hi = switch_hash_next(hi)) {
+		switch_hash_this(hi, NULL, NULL, &val);
+		fd = (cdr_fd_t *) val;
+		flush_fd(fd);
+		if (close_fds) {
+			switch_safe_free(fd->buf);
+			if (fd->fd > -1) {
+				close(fd->fd);
+				fd->fd = -1;
+			}
+		}
+	}
+}
+
+static void buffer_cdr(const char *path, const char *data, unsigned int len)
+{
+	cdr_fd_t *fd;
+
+	if (!(fd = switch_core_hash_find(globals.fd_hash, path))) {
+		char *dir = strdup(path), *p;
+
+		/* cdr_csv_base may point to a directory we did not create yet */
+		switch_assert(dir);
+		if ((p = strrchr(dir, *SWITCH_PATH_SEPARATOR))) {
+			*p = '\0';
+			if (switch_dir_make_recursive(dir, SWITCH_DEFAULT_DIR_PERMS, globals.pool) != SWITCH_STATUS_SUCCESS) {
+				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error creating %s\n", dir);
+			}
+		}
+		free(dir);
+		fd = get_cdr_fd(path);
+	}
+
+	if (!fd->buf) {
+		fd->buf = malloc(globals.flush_bytes);
+		switch_assert(fd->buf);
+	}
+
+	if (fd->buf_len + len > globals.flush_bytes) {
+		flush_fd(fd);
+	}
+
+	if (len >= globals.flush_bytes) {
+		write_fd(fd, data, len);
+		globals.flushes++;
+	} else {
+		memcpy(fd->buf + fd->buf_len, data, len);
+		fd->buf_len += len;
+	}
+
+	globals.lines++;
+	globals.bytes += len;
+}
+
+static void *SWITCH_THREAD_FUNC cdr_writer_thread_run(switch_thread_t *thread, void *obj)
+{
+	switch_time_t interval = (switch_time_t) globals.flush_interval * 1000;
+	switch_time_t next_flush = switch_micro_time_now() + interval;
+	void *pop;
+
+	while (globals.writer_running || switch_queue_size(globals.queue)) {
+		switch_time_t now = switch_micro_time_now();
+		uint32_t backlog;
+
+		if (switch_queue_pop_timeout(globals.queue, &pop, next_flush > now ? next_flush - now : 1) == SWITCH_STATUS_SUCCESS && pop) {
+			cdr_line_t *line = (cdr_line_t *) pop;
+
+			if (line->rotate) {
+				switch_hash_index_t *hi;
+				void *val;
+
+				flush_all(SWITCH_FALSE);
+				for (hi = switch_hash_first(NULL, globals.fd_hash); hi; hi = switch_hash_next(hi)) {
+					switch_hash_this(hi, NULL, NULL, &val);
+					do_rotate((cdr_fd_t *) val);
+				}
+			} else {
+				buffer_cdr(line->path, line->data, line->len);
+			}
+			free(line);
+
+			if ((backlog = switch_queue_size(globals.queue)) > globals.max_backlog) {
+				globals.max_backlog = backlog;
+			}
+		}
+
+		if ((now = switch_micro_time_now()) >= next_flush) {
+			flush_all(SWITCH_FALSE);
+			next_flush = now + interval;
+		}
+	}
+
+	flush_all(SWITCH_TRUE);
+
+	return NULL;
+}
+
+/* Called from the reporting state of the session, must not block on the disk */
+static void queue_cdr(const char *path, const char *log_line)
+{
+	size_t path_len = strlen(path) + 1, len = strlen(log_line);
+	cdr_line_t *line = malloc(sizeof(*line) + path_len + len + 1);
+
+	switch_assert(line);
+	line->rotate = 0;
+	line->len = (unsigned) len;
+	line->path = (char *) (line + 1);
+	line->data = line->path + path_len;
+	memcpy(line->path, path, path_len);
+	memcpy(line->data, log_line, len + 1);
+
+	if (switch_queue_trypush(globals.queue, line) != SWITCH_STATUS_SUCCESS) {
+		/* The writer is behind by queue-size lines, rather wait than lose a cdr */
+		switch_mutex_lock(globals.stats_mutex);
+		globals.stalls++;
+		switch_mutex_unlock(globals.stats_mutex);
+		switch_queue_push(globals.queue, line);
+	}
+}
+
 static switch_status_t my_on_reporting(switch_core_session_t *session)
 {
 	switch_channel_t *channel = switch_core_session_get_channel(session);
@@ -198,7 +393,7 @@ static switch_status_t my_on_reporting(switch_core_session_t *session)
 		log_dir = globals.log_dir;
 	}
 
-	if (switch_dir_make_recursive(log_dir, SWITCH_DEFAULT_DIR_PERMS, switch_core_session_get_pool(session)) != SWITCH_STATUS_SUCCESS) {
+	if (!globals.async && switch_dir_make_recursive(log_dir, SWITCH_DEFAULT_DIR_PERMS, switch_core_session_get_pool(session)) != SWITCH_STATUS_SUCCESS) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error creating %s\n", log_dir);
 		return SWITCH_STATUS_FALSE;
 	}
@@ -236,7 +431,11 @@ static switch_status_t my_on_reporting(switch_core_session_t *session)
 	if ((accountcode) && (!globals.masterfileonly)) {
 		path = switch_mprintf("%s%s%s.csv", log_dir, SWITCH_PATH_SEPARATOR, accountcode);
 		assert(path);
-		write_cdr(path, log_line);
+		if (globals.async) {
+			queue_cdr(path, log_line);
+		} else {
+			write_cdr(path, log_line);
+		}
 		free(path);
 	}
 
@@ -254,7 +453,11 @@ static switch_status_t my_on_reporting(switch_core_session_t *session)
 
 	path = switch_mprintf("%s%sMaster.csv", log_dir, SWITCH_PATH_SEPARATOR);
 	assert(path);
-	write_cdr(path, log_line);
+	if (globals.async) {
+		queue_cdr(path, log_line);
+	} else {
+		write_cdr(path, log_line);
+	}
 	free(path);
 
 
@@ -278,6 +481,15 @@ static void event_handler(switch_event_t *event)
 	}
 
 	if (sig && !strcmp(sig, "HUP")) {
+		if (globals.async) {
+			cdr_line_t *line = calloc(1, sizeof(*line));
+
+			switch_assert(line);
+			line->rotate = 1;
+			switch_queue_push(globals.queue, line);
+			return;
+		}
+
 		for (hi = switch_hash_first(NULL, globals.fd_hash); hi; hi = switch_hash_next(hi)) {
 			switch_hash_this(hi, NULL, NULL, &val);
 			fd = (cdr_fd_t *) val;
@@ -320,6 +532,11 @@ static switch_status_t load_config(switch_memory_pool_t *pool)
 	switch_core_hash_insert(globals.template_hash, "default", default_template);
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Adding default template.\n");
 	globals.legs = CDR_LEG_A;
+	globals.async = 0;
+	globals.queue_size = 10000;
+	globals.flush_bytes = 65536;
+	globals.flush_interval = 1000;
+	globals.fsync = CDR_FSYNC_NONE;
 
 	if ((xml = switch_xml_open_cfg(cf, &cfg, NULL))) {
 
@@ -347,6 +564,29 @@ static switch_status_t load_config(switch_memory_pool_t *pool)
 					globals.default_template = switch_core_strdup(pool, val);
 				} else if (!strcasecmp(var, "master-file-only")) {
 					globals.masterfileonly = switch_true(val);
+				} else if (!strcasecmp(var, "async-write")) {
+					globals.async = switch_true(val);
+				} else if (!strcasecmp(var, "queue-size")) {
+					int tmp = atoi(val);
+					if (tmp > 0) {
+						globals.queue_size = tmp;
+					}
+				} else if (!strcasecmp(var, "flush-bytes")) {
+					int tmp = atoi(val);
+					if (tmp >= 1024) {
+						globals.flush_bytes = tmp;
+					}
+				} else if (!strcasecmp(var, "flush-interval")) {
+					int tmp = atoi(val);
+					if (tmp > 0) {
+						globals.flush_interval = tmp;
+					}
+				} else if (!strcasecmp(var, "fsync")) {
+					if (!strcasecmp(val, "flush")) {
+						globals.fsync = CDR_FSYNC_FLUSH;
+					} else {
+						globals.fsync = CDR_FSYNC_NONE;
+					}
 				}
 			}
 		}
@@ -385,9 +625,34 @@ static switch_status_t load_config(switch_memory_pool_t *pool)
 }
 
 
+#define CDR_CSV_SYNTAX "status"
+SWITCH_STANDARD_API(cdr_csv_function)
+{
+	if (zstr(cmd) || strcasecmp(cmd, "status")) {
+		stream->write_function(stream, "-USAGE: %s\n", CDR_CSV_SYNTAX);
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	if (!globals.async) {
+		stream->write_function(stream, "mode: sync\n");
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	stream->write_function(stream, "mode: async\n");
+	stream->write_function(stream, "backlog: %u/%u\n", switch_queue_size(globals.queue), globals.queue_size);
+	stream->write_function(stream, "max-backlog: %u\n", globals.max_backlog);
+	stream->write_function(stream, "stalls: %" SWITCH_UINT64_T_FMT "\n", globals.stalls);
+	stream->write_function(stream, "lines: %" SWITCH_UINT64_T_FMT "\n", globals.lines);
+	stream->write_function(stream, "bytes: %" SWITCH_UINT64_T_FMT "\n", globals.bytes);
+	stream->write_function(stream, "flushes: %" SWITCH_UINT64_T_FMT "\n", globals.flushes);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 SWITCH_MODULE_LOAD_FUNCTION(mod_cdr_csv_load)
 {
 	switch_status_t status = SWITCH_STATUS_SUCCESS;
+	switch_api_interface_t *api_interface;
 
 	load_config(pool);
 
@@ -401,9 +666,22 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_cdr_csv_load)
 		return status;
 	}
 
+	if (globals.async) {
+		switch_threadattr_t *thd_attr = NULL;
+
+		switch_mutex_init(&globals.stats_mutex, SWITCH_MUTEX_NESTED, pool);
+		switch_queue_create(&globals.queue, globals.queue_size, pool);
+		globals.writer_running = 1;
+		switch_threadattr_create(&thd_attr, pool);
+		switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+		switch_thread_create(&globals.writer_thread, thd_attr, cdr_writer_thread_run, NULL, pool);
+	}
+
 	switch_core_add_state_handler(&state_handlers);
 	*module_interface = switch_loadable_module_create_module_interface(pool, modname);
 
+	SWITCH_ADD_API(api_interface, "cdr_csv", "cdr_csv writer status", cdr_csv_function, CDR_CSV_SYNTAX);
+	switch_console_set_complete("add cdr_csv status");
 
 	return status;
 }
@@ -416,6 +694,15 @@ SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_cdr_csv_shutdown)
 	switch_event_unbind_callback(event_handler);
 	switch_core_remove_state_handler(&state_handlers);
 
+	if (globals.writer_thread) {
+		switch_status_t st;
+
+		/* the writer drains the queue and flushes before it exits */
+		globals.writer_running = 0;
+		switch_thread_join(&st, globals.writer_thread);
+		globals.writer_thread = NULL;
+	}
+
 
 	return SWITCH_STATUS_SUCCESS;
 }
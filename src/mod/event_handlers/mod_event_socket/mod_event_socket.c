@@ -66,6 +66,25 @@ typedef enum {
 	EVENT_FORMAT_JSON
 } event_format_t;
 
+#define EVENT_FORMAT_COUNT (EVENT_FORMAT_JSON + 1)
+
+/* An event on its way to the listeners.  It is duplicated once no matter how many listeners take it,
+   and each wire format is rendered at most once by whichever listener needs it first. */
+typedef struct {
+	switch_event_t *event;
+	int refs;
+	char *data[EVENT_FORMAT_COUNT];
+	switch_size_t len[EVENT_FORMAT_COUNT];
+} shared_event_t;
+
+/* One "filter" line parsed ahead of time so matching an event does no string parsing */
+typedef struct {
+	const char *name;
+	const char *value;
+	int pos;
+	int regex;
+} event_filter_t;
+
 struct listener {
 	switch_socket_t *sock;
 	switch_queue_t *event_queue;
@@ -76,7 +95,6 @@ struct listener {
 	switch_mutex_t *filter_mutex;
 	uint32_t flags;
 	switch_log_level_t level;
-	char *ebuf;
 	uint8_t event_list[SWITCH_EVENT_ALL + 1];
 	uint8_t allowed_event_list[SWITCH_EVENT_ALL + 1];
 	switch_hash_t *event_hash;
@@ -94,13 +112,18 @@ struct listener {
 	char remote_ip[50];
 	switch_port_t remote_port;
 	switch_event_t *filters;
+	event_filter_t *filter_table;
+	int filter_count;
 	struct listener *next;
 };
 
 typedef struct listener listener_t;
 
+#define SHARED_EVENT_MUTEXES 16
+
 static struct {
 	switch_mutex_t *listener_mutex;
+	switch_mutex_t *shared_mutex[SHARED_EVENT_MUTEXES];
 	switch_event_node_t *node;
 	int debug;
 } globals;
@@ -143,6 +166,161 @@ static const char *format2str(event_format_t format)
 }
 
 static void remove_listener(listener_t *listener);
+
+static switch_mutex_t *shared_event_mutex(shared_event_t *se)
+{
+	uintptr_t h = (uintptr_t) se;
+
+	/* malloc hands back 16 byte aligned blocks, the low bits carry nothing, fold the rest in */
+	h >>= 4;
+	h ^= h >> 7;
+	h ^= h >> 13;
+
+	return globals.shared_mutex[h % SHARED_EVENT_MUTEXES];
+}
+
+/* takes over the event, the caller holds the only reference */
+static shared_event_t *shared_event_create(switch_event_t **event)
+{
+	shared_event_t *se;
+
+	switch_zmalloc(se, sizeof(*se));
+	se->event = *event;
+	se->refs = 1;
+	*event = NULL;
+
+	return se;
+}
+
+static void shared_event_ref(shared_event_t *se)
+{
+	switch_mutex_t *mutex = shared_event_mutex(se);
+
+	switch_mutex_lock(mutex);
+	se->refs++;
+	switch_mutex_unlock(mutex);
+}
+
+static void shared_event_release(shared_event_t **sep)
+{
+	shared_event_t *se = *sep;
+	switch_mutex_t *mutex = shared_event_mutex(se);
+	int refs, i;
+
+	*sep = NULL;
+
+	switch_mutex_lock(mutex);
+	refs = --se->refs;
+	switch_mutex_unlock(mutex);
+
+	if (refs) {
+		return;
+	}
+
+	for (i = 0; i < EVENT_FORMAT_COUNT; i++) {
+		switch_safe_free(se->data[i]);
+	}
+	switch_event_destroy(&se->event);
+	free(se);
+}
+
+/* returns the event in the given format, rendering it on first use.  The string stays valid until
+   the caller releases its reference. */
+static const char *shared_event_render(shared_event_t *se, event_format_t format, switch_size_t *len)
+{
+	switch_mutex_t *mutex = shared_event_mutex(se);
+	const char *data;
+
+	switch_mutex_lock(mutex);
+	if (!se->data[format]) {
+		switch_xml_t xml;
+
+		switch (format) {
+		case EVENT_FORMAT_PLAIN:
+			switch_event_serialize(se->event, &se->data[format], SWITCH_TRUE);
+			break;
+		case EVENT_FORMAT_JSON:
+			switch_event_serialize_json(se->event, &se->data[format]);
+			break;
+		case EVENT_FORMAT_XML:
+			if ((xml = switch_event_xmlize(se->event, SWITCH_VA_NONE))) {
+				se->data[format] = switch_xml_toxml(xml, SWITCH_FALSE);
+				switch_xml_free(xml);
+			}
+			break;
+		}
+
+		if (se->data[format]) {
+			se->len[format] = strlen(se->data[format]);
+		}
+	}
+	data = se->data[format];
+	*len = se->len[format];
+	switch_mutex_unlock(mutex);
+
+	return data;
+}
+
+/* rebuild the filter table from the filter headers, the caller holds filter_mutex */
+static void compile_filters(listener_t *listener)
+{
+	switch_event_header_t *hp;
+	int count = 0;
+
+	switch_safe_free(listener->filter_table);
+	listener->filter_count = 0;
+
+	if (!listener->filters) {
+		return;
+	}
+
+	for (hp = listener->filters->headers; hp; hp = hp->next) {
+		count++;
+	}
+
+	if (!count) {
+		return;
+	}
+
+	switch_zmalloc(listener->filter_table, count * sizeof(event_filter_t));
+
+	for (hp = listener->filters->headers; hp; hp = hp->next) {
+		event_filter_t *filter;
+		const char *comp_to = hp->value;
+
+		if (!comp_to) {
+			continue;
+		}
+
+		filter = &listener->filter_table[listener->filter_count++];
+		filter->pos = 1;
+
+		while (*comp_to) {
+			if (*comp_to == '+') {
+				filter->pos = 1;
+			} else if (*comp_to == '-') {
+				filter->pos = 0;
+			} else if (*comp_to != ' ') {
+				break;
+			}
+			comp_to++;
+		}
+
+		filter->name = hp->name;
+		filter->value = comp_to;
+		filter->regex = *hp->value == '/';
+	}
+}
+
+static void destroy_filters(listener_t *listener)
+{
+	switch_safe_free(listener->filter_table);
+	listener->filter_count = 0;
+
+	if (listener->filters) {
+		switch_event_destroy(&listener->filters);
+	}
+}
 static void kill_listener(listener_t *l, const char *message);
 static void kill_all_listeners(void);
 
@@ -209,10 +387,10 @@ static void flush_listener(listener_t *listener, switch_bool_t flush_log, switch
 
 	if (listener->event_queue) {
 		while (switch_queue_trypop(listener->event_queue, &pop) == SWITCH_STATUS_SUCCESS) {
-			switch_event_t *pevent = (switch_event_t *) pop;
+			shared_event_t *se = (shared_event_t *) pop;
 			if (!pop)
 				continue;
-			switch_event_destroy(&pevent);
+			shared_event_release(&se);
 		}
 	}
 }
@@ -248,10 +426,7 @@ static switch_status_t expire_listener(listener_t ** listener)
 
 
 	switch_mutex_lock(l->filter_mutex);
-	if (l->filters) {
-		switch_event_destroy(&l->filters);
-	}
-
+	destroy_filters(l);
 	switch_mutex_unlock(l->filter_mutex);
 	switch_thread_rwlock_unlock(l->rwlock);
 	switch_core_destroy_memory_pool(&l->pool);
@@ -263,6 +438,7 @@ static switch_status_t expire_listener(listener_t ** listener)
 static void event_handler(switch_event_t *event)
 {
 	switch_event_t *clone = NULL;
+	shared_event_t *se = NULL;
 	listener_t *l, *lp, *last = NULL;
 	time_t now = switch_epoch_time_now(NULL);
 
@@ -308,52 +484,39 @@ static void event_handler(switch_event_t *event)
 		if (send) {
 			switch_mutex_lock(l->filter_mutex);
 
-			if (l->filters && l->filters->headers) {
-				switch_event_header_t *hp;
+			if (l->filter_count) {
+				event_filter_t *filter;
 				const char *hval;
+				int i, cmp;
 
 				send = 0;
-				
-				for (hp = l->filters->headers; hp; hp = hp->next) {
-					if ((hval = switch_event_get_header(event, hp->name))) {
-						const char *comp_to = hp->value;
-						int pos = 1, cmp = 0;
-
-						while (comp_to && *comp_to) {
-							if (*comp_to == '+') {
-								pos = 1;
-							} else if (*comp_to == '-') {
-								pos = 0;
-							} else if (*comp_to != ' ') {
-								break;
-							}
-							comp_to++;
-						}
 
-						if (send && pos) {
-							continue;
-						}
+				for (i = 0; i < l->filter_count; i++) {
+					filter = &l->filter_table[i];
 
-						if (!comp_to) {
-							continue;
-						}
+					if (!(hval = switch_event_get_header(event, filter->name))) {
+						continue;
+					}
 
-						if (*hp->value == '/') {
-							switch_regex_t *re = NULL;
-							int ovector[30];
-							cmp = !!switch_regex_perform(hval, comp_to, &re, ovector, sizeof(ovector) / sizeof(ovector[0]));
-							switch_regex_safe_free(re);
-						} else {
-							cmp = !strcasecmp(hval, comp_to);
-						}
+					if (send && filter->pos) {
+						continue;
+					}
 
-						if (cmp) {
-							if (pos) {
-								send = 1;
-							} else {
-								send = 0;
-								break;
-							}
+					if (filter->regex) {
+						switch_regex_t *re = NULL;
+						int ovector[30];
+						cmp = !!switch_regex_perform(hval, filter->value, &re, ovector, sizeof(ovector) / sizeof(ovector[0]));
+						switch_regex_safe_free(re);
+					} else {
+						cmp = !strcasecmp(hval, filter->value);
+					}
+
+					if (cmp) {
+						if (filter->pos) {
+							send = 1;
+						} else {
+							send = 0;
+							break;
 						}
 					}
 				}
@@ -369,32 +532,44 @@ static void event_handler(switch_event_t *event)
 			}
 		}
 
-		if (send) {
+		if (send && !se) {
 			if (switch_event_dup(&clone, event) == SWITCH_STATUS_SUCCESS) {
-				if (switch_queue_trypush(l->event_queue, clone) == SWITCH_STATUS_SUCCESS) {
-					if (l->lost_events) {
-						int le = l->lost_events;
-						l->lost_events = 0;
-						switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(l->session), SWITCH_LOG_CRIT, "Lost %d events!\n", le);
-						clone = NULL;
-						if (switch_event_create(&clone, SWITCH_EVENT_TRAP) == SWITCH_STATUS_SUCCESS) {
-							switch_event_add_header(clone, SWITCH_STACK_BOTTOM, "info", "lost %d events", le);
-							switch_event_fire(&clone);
-						}
-					}
-				} else {
-					if (++l->lost_events > MAX_MISSED) {
-						kill_listener(l, "Disconnected due to event queue failure.\n");
+				se = shared_event_create(&clone);
+			} else {
+				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(l->session), SWITCH_LOG_ERROR, "Memory Error!\n");
+				send = 0;
+			}
+		}
+
+		if (send) {
+			shared_event_ref(se);
+			if (switch_queue_trypush(l->event_queue, se) == SWITCH_STATUS_SUCCESS) {
+				if (l->lost_events) {
+					int le = l->lost_events;
+					l->lost_events = 0;
+					switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(l->session), SWITCH_LOG_CRIT, "Lost %d events!\n", le);
+					clone = NULL;
+					if (switch_event_create(&clone, SWITCH_EVENT_TRAP) == SWITCH_STATUS_SUCCESS) {
+						switch_event_add_header(clone, SWITCH_STACK_BOTTOM, "info", "lost %d events", le);
+						switch_event_fire(&clone);
 					}
-					switch_event_destroy(&clone);
 				}
 			} else {
-				switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(l->session), SWITCH_LOG_ERROR, "Memory Error!\n");
+				shared_event_t *dropped = se;
+
+				shared_event_release(&dropped);
+				if (++l->lost_events > MAX_MISSED) {
+					kill_listener(l, "Disconnected due to event queue failure.\n");
+				}
 			}
 		}
 		last = l;
 	}
 	switch_mutex_unlock(globals.listener_mutex);
+
+	if (se) {
+		shared_event_release(&se);
+	}
 }
 
 SWITCH_STANDARD_APP(socket_function)
@@ -758,6 +933,7 @@ SWITCH_STANDARD_API(event_sink_function)
 
 	  filter_end:
 
+		compile_filters(listener);
 		switch_mutex_unlock(listener->filter_mutex);
 
 	} else if (!strcasecmp(wcmd, "stop-logging")) {
@@ -948,7 +1124,6 @@ SWITCH_STANDARD_API(event_sink_function)
 		char *id = switch_event_get_header(stream->param_event, "listen-id");
 		uint32_t idl = 0;
 		void *pop;
-		switch_event_t *pevent = NULL;
 
 		if (id) {
 			idl = (uint32_t) atol(id);
@@ -990,41 +1165,29 @@ SWITCH_STANDARD_API(event_sink_function)
 		stream->write_function(stream, "<events>\n");
 
 		while (switch_queue_trypop(listener->event_queue, &pop) == SWITCH_STATUS_SUCCESS) {
-			char *etype;
-			pevent = (switch_event_t *) pop;
+			shared_event_t *se = (shared_event_t *) pop;
+			const char *ebuf;
+			switch_size_t elen = 0;
 
-			if (listener->format == EVENT_FORMAT_PLAIN) {
-				etype = "plain";
-				switch_event_serialize(pevent, &listener->ebuf, SWITCH_TRUE);
-				stream->write_function(stream, "<event type=\"plain\">\n%s</event>", listener->ebuf);
-			} else if (listener->format == EVENT_FORMAT_JSON) {
-				etype = "json";
-				switch_event_serialize_json(pevent, &listener->ebuf);
-			} else {
-				switch_xml_t xml;
-				etype = "xml";
+			ebuf = shared_event_render(se, listener->format, &elen);
 
-				if ((xml = switch_event_xmlize(pevent, SWITCH_VA_NONE))) {
-					listener->ebuf = switch_xml_toxml(xml, SWITCH_FALSE);
-					switch_xml_free(xml);
-				} else {
+			if (listener->format == EVENT_FORMAT_PLAIN) {
+				stream->write_function(stream, "<event type=\"plain\">\n%s</event>", ebuf);
+			} else if (listener->format == EVENT_FORMAT_XML) {
+				if (!ebuf) {
 					stream->write_function(stream, "<data><reply type=\"error\">XML Render Error</reply></data>\n");
+					shared_event_release(&se);
 					break;
 				}
 
-				stream->write_function(stream, "%s\n", listener->ebuf);
+				stream->write_function(stream, "%s\n", ebuf);
 			}
 
-			switch_safe_free(listener->ebuf);
-			switch_event_destroy(&pevent);
+			shared_event_release(&se);
 		}
 
 		stream->write_function(stream, " </events>\n</data>\n");
 
-		if (pevent) {
-			switch_event_destroy(&pevent);
-		}
-
 		switch_thread_rwlock_unlock(listener->rwlock);
 	} else if (!strcasecmp(wcmd, "exec-fsapi")) {
 		char *api_command = switch_event_get_header(stream->param_event, "fsapi-command");
@@ -1068,11 +1231,16 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_event_socket_load)
 {
 	switch_application_interface_t *app_interface;
 	switch_api_interface_t *api_interface;
+	int x;
 
 	memset(&globals, 0, sizeof(globals));
 
 	switch_mutex_init(&globals.listener_mutex, SWITCH_MUTEX_NESTED, pool);
 
+	for (x = 0; x < SHARED_EVENT_MUTEXES; x++) {
+		switch_mutex_init(&globals.shared_mutex[x], SWITCH_MUTEX_NESTED, pool);
+	}
+
 	memset(&listen_list, 0, sizeof(listen_list));
 	switch_mutex_init(&listen_list.sock_mutex, SWITCH_MUTEX_NESTED, pool);
 
@@ -1271,7 +1439,12 @@ static switch_status_t read_packet(listener_t *listener, switch_event_t **event,
 				if (switch_channel_get_state(chan) < CS_HANGUP && switch_channel_test_flag(chan, CF_DIVERT_EVENTS)) {
 					switch_event_t *e = NULL;
 					while (switch_core_session_dequeue_event(listener->session, &e, SWITCH_TRUE) == SWITCH_STATUS_SUCCESS) {
-						if (switch_queue_trypush(listener->event_queue, e) != SWITCH_STATUS_SUCCESS) {
+						shared_event_t *se = shared_event_create(&e);
+
+						if (switch_queue_trypush(listener->event_queue, se) != SWITCH_STATUS_SUCCESS) {
+							e = se->event;
+							se->event = NULL;
+							free(se);
 							switch_core_session_queue_event(listener->session, &e);
 							break;
 						}
@@ -1282,46 +1455,28 @@ static switch_status_t read_packet(listener_t *listener, switch_event_t **event,
 			if (switch_test_flag(listener, LFLAG_EVENTS)) {
 				while (switch_queue_trypop(listener->event_queue, &pop) == SWITCH_STATUS_SUCCESS) {
 					char hbuf[512];
-					switch_event_t *pevent = (switch_event_t *) pop;
-					char *etype;
+					shared_event_t *se = (shared_event_t *) pop;
+					const char *ebuf;
+					switch_size_t elen = 0;
 
 					do_sleep = 0;
-					if (listener->format == EVENT_FORMAT_PLAIN) {
-						etype = "plain";
-						switch_event_serialize(pevent, &listener->ebuf, SWITCH_TRUE);
-					} else if (listener->format == EVENT_FORMAT_JSON) {
-						etype = "json";
-						switch_event_serialize_json(pevent, &listener->ebuf);
-					} else {
-						switch_xml_t xml;
-						etype = "xml";
 
-						if ((xml = switch_event_xmlize(pevent, SWITCH_VA_NONE))) {
-							listener->ebuf = switch_xml_toxml(xml, SWITCH_FALSE);
-							switch_xml_free(xml);
-						} else {
-							switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(listener->session), SWITCH_LOG_ERROR, "XML ERROR!\n");
-							goto endloop;
-						}
+					if (!(ebuf = shared_event_render(se, listener->format, &elen))) {
+						switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(listener->session), SWITCH_LOG_ERROR, "XML ERROR!\n");
+						shared_event_release(&se);
+						continue;
 					}
 
-					switch_assert(listener->ebuf);
-
-					len = strlen(listener->ebuf);
-
-					switch_snprintf(hbuf, sizeof(hbuf), "Content-Length: %" SWITCH_SSIZE_T_FMT "\n" "Content-Type: text/event-%s\n" "\n", len, etype);
+					switch_snprintf(hbuf, sizeof(hbuf), "Content-Length: %" SWITCH_SSIZE_T_FMT "\n" "Content-Type: text/event-%s\n" "\n",
+									elen, format2str(listener->format));
 
 					len = strlen(hbuf);
 					switch_socket_send(listener->sock, hbuf, &len);
 
-					len = strlen(listener->ebuf);
-					switch_socket_send(listener->sock, listener->ebuf, &len);
-
-					switch_safe_free(listener->ebuf);
-
-				  endloop:
+					len = elen;
+					switch_socket_send(listener->sock, ebuf, &len);
 
-					switch_event_destroy(&pevent);
+					shared_event_release(&se);
 				}
 			}
 		}
@@ -1815,6 +1970,7 @@ static switch_status_t parse_command(listener_t *listener, switch_event_t **even
 		} else {
 			switch_snprintf(reply, reply_len, "-ERR invalid syntax");
 		}
+		compile_filters(listener);
 		switch_mutex_unlock(listener->filter_mutex);
 
 		goto done;
@@ -2565,9 +2721,7 @@ static void *SWITCH_THREAD_FUNC listener_run(switch_thread_t *thread, void *obj)
 	switch_thread_rwlock_wrlock(listener->rwlock);
 	flush_listener(listener, SWITCH_TRUE, SWITCH_TRUE);
 	switch_mutex_lock(listener->filter_mutex);
-	if (listener->filters) {
-		switch_event_destroy(&listener->filters);
-	}
+	destroy_filters(listener);
 	switch_mutex_unlock(listener->filter_mutex);
 
 	if (listener->session) {
@@ -37,6 +37,8 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_xml_curl_load);
 SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_xml_curl_shutdown);
 SWITCH_MODULE_DEFINITION(mod_xml_curl, mod_xml_curl_load, mod_xml_curl_shutdown, NULL);
 
+#define XML_CURL_MAX_HANDLES 16
+
 
 struct xml_binding {
 	char *method;
@@ -57,6 +59,21 @@ struct xml_binding {
 	int use_dynamic_url;
 	int auth_scheme;
 	int timeout;
+	/* response cache, see xml_curl_cache_get() */
+	int cache_ttl;
+	int cache_negative_ttl;
+	uint32_t cache_max_entries;
+	char *cache_key_vars_str;
+	char *cache_key_vars[32];
+	int cache_key_var_count;
+	switch_hash_t *cache;
+	uint32_t cache_count;
+	/* idle curl handles kept with their connections open */
+	int keep_alive;
+	CURL *handles[XML_CURL_MAX_HANDLES];
+	int handle_count;
+	switch_mutex_t *mutex;
+	struct xml_binding *next;
 };
 
 static int keep_files_around = 0;
@@ -66,13 +83,21 @@ typedef struct xml_binding xml_binding_t;
 #define XML_CURL_MAX_BYTES 1024 * 1024
 
 struct config_data {
-	char *name;
-	int fd;
+	char *buf;
 	switch_size_t bytes;
+	switch_size_t size;
 	switch_size_t max_bytes;
 	int err;
 };
 
+struct cache_entry {
+	char *key;
+	/* NULL when the fetch failed */
+	char *body;
+	time_t expires;
+};
+typedef struct cache_entry cache_entry_t;
+
 typedef struct hash_node {
 	switch_hash_t *hash;
 	struct hash_node *next;
@@ -82,9 +107,49 @@ static struct {
 	switch_memory_pool_t *pool;
 	hash_node_t *hash_root;
 	hash_node_t *hash_tail;
+	xml_binding_t *bindings;
 } globals;
 
-#define XML_CURL_SYNTAX "[debug_on|debug_off]"
+static void cache_clear(xml_binding_t *binding)
+{
+	switch_hash_index_t *hi;
+	void *val;
+
+	if (!binding->cache) {
+		return;
+	}
+
+	for (hi = switch_hash_first(NULL, binding->cache); hi; hi = switch_hash_next(hi)) {
+		cache_entry_t *entry;
+
+		switch_hash_this(hi, NULL, NULL, &val);
+		entry = (cache_entry_t *) val;
+		switch_safe_free(entry->key);
+		switch_safe_free(entry->body);
+		free(entry);
+	}
+
+	switch_core_hash_destroy(&binding->cache);
+	switch_core_hash_init(&binding->cache, globals.pool);
+	binding->cache_count = 0;
+}
+
+static int cache_flush(void)
+{
+	xml_binding_t *binding;
+	int x = 0;
+
+	for (binding = globals.bindings; binding; binding = binding->next) {
+		switch_mutex_lock(binding->mutex);
+		x += binding->cache_count;
+		cache_clear(binding);
+		switch_mutex_unlock(binding->mutex);
+	}
+
+	return x;
+}
+
+#define XML_CURL_SYNTAX "[debug_on|debug_off|flush]"
 SWITCH_STANDARD_API(xml_curl_function)
 {
 	if (session) {
@@ -99,6 +164,9 @@ SWITCH_STANDARD_API(xml_curl_function)
 		keep_files_around = 1;
 	} else if (!strcasecmp(cmd, "debug_off")) {
 		keep_files_around = 0;
+	} else if (!strcasecmp(cmd, "flush")) {
+		stream->write_function(stream, "+OK flushed %d cached responses\n", cache_flush());
+		return SWITCH_STATUS_SUCCESS;
 	} else {
 		goto usage;
 	}
@@ -111,25 +179,151 @@ SWITCH_STANDARD_API(xml_curl_function)
 	return SWITCH_STATUS_SUCCESS;
 }
 
-static size_t file_callback(void *ptr, size_t size, size_t nmemb, void *data)
+static size_t buffer_callback(void *ptr, size_t size, size_t nmemb, void *data)
 {
 	register unsigned int realsize = (unsigned int) (size * nmemb);
 	struct config_data *config_data = data;
-	int x;
 
-	config_data->bytes += realsize;
-
-	if (config_data->bytes > config_data->max_bytes) {
-		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Oversized file detected [%d bytes]\n", (int) config_data->bytes);
+	if (config_data->bytes + realsize > config_data->max_bytes) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Oversized file detected [%d bytes]\n", (int) (config_data->bytes + realsize));
 		config_data->err = 1;
 		return 0;
 	}
 
-	x = write(config_data->fd, ptr, realsize);
-	if (x != (int) realsize) {
-		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Short write! %d out of %d\n", x, realsize);
+	if (config_data->bytes + realsize + 1 > config_data->size) {
+		switch_size_t new_size = config_data->size ? config_data->size : 4096;
+		char *new_buf;
+
+		while (new_size < config_data->bytes + realsize + 1) {
+			new_size *= 2;
+		}
+
+		if (!(new_buf = realloc(config_data->buf, new_size))) {
+			config_data->err = 1;
+			return 0;
+		}
+		config_data->buf = new_buf;
+		config_data->size = new_size;
 	}
-	return x;
+
+	memcpy(config_data->buf + config_data->bytes, ptr, realsize);
+	config_data->bytes += realsize;
+	config_data->buf[config_data->bytes] = '\0';
+
+	return realsize;
+}
+
+static CURL *get_handle(xml_binding_t *binding)
+{
+	CURL *curl_handle = NULL;
+
+	if (binding->keep_alive) {
+		switch_mutex_lock(binding->mutex);
+		if (binding->handle_count) {
+			curl_handle = binding->handles[--binding->handle_count];
+		}
+		switch_mutex_unlock(binding->mutex);
+	}
+
+	if (curl_handle) {
+		/* Options go away, the open connection and the dns cache stay */
+		curl_easy_reset(curl_handle);
+	} else {
+		curl_handle = curl_easy_init();
+	}
+
+	return curl_handle;
+}
+
+static void put_handle(xml_binding_t *binding, CURL *curl_handle)
+{
+	if (binding->keep_alive) {
+		switch_mutex_lock(binding->mutex);
+		if (binding->handle_count < XML_CURL_MAX_HANDLES) {
+			binding->handles[binding->handle_count++] = curl_handle;
+			curl_handle = NULL;
+		}
+		switch_mutex_unlock(binding->mutex);
+	}
+
+	if (curl_handle) {
+		curl_easy_cleanup(curl_handle);
+	}
+}
+
+static char *cache_key(xml_binding_t *binding, const char *section, const char *tag_name, const char *key_name, const char *key_value,
+					   switch_event_t *params, const char *data)
+{
+	switch_stream_handle_t stream = { 0 };
+	int i;
+
+	SWITCH_STANDARD_STREAM(stream);
+	stream.write_function(&stream, "%s|%s|%s|%s", section, switch_str_nil(tag_name), switch_str_nil(key_name), switch_str_nil(key_value));
+
+	if (binding->cache_key_var_count) {
+		for (i = 0; i < binding->cache_key_var_count; i++) {
+			stream.write_function(&stream, "|%s", params ? switch_str_nil(switch_event_get_header(params, binding->cache_key_vars[i])) : "");
+		}
+	} else {
+		/* only the enable-post-var variables are in there, bindings without either never cache */
+		stream.write_function(&stream, "|%s", data);
+	}
+
+	return (char *) stream.data;
+}
+
+/* Returns SWITCH_TRUE on a hit, *xml is NULL for a cached failure */
+static switch_bool_t cache_get(xml_binding_t *binding, const char *key, switch_xml_t *xml)
+{
+	cache_entry_t *entry;
+	switch_bool_t hit = SWITCH_FALSE;
+
+	switch_mutex_lock(binding->mutex);
+	if ((entry = switch_core_hash_find(binding->cache, key))) {
+		if (entry->expires > switch_epoch_time_now(NULL)) {
+			*xml = entry->body ? switch_xml_parse_str_dup(entry->body) : NULL;
+			hit = SWITCH_TRUE;
+		} else {
+			switch_core_hash_delete(binding->cache, key);
+			binding->cache_count--;
+			switch_safe_free(entry->key);
+			switch_safe_free(entry->body);
+			free(entry);
+		}
+	}
+	switch_mutex_unlock(binding->mutex);
+
+	return hit;
+}
+
+static void cache_put(xml_binding_t *binding, const char *key, const char *body)
+{
+	cache_entry_t *entry, *old;
+	int ttl = body ? binding->cache_ttl : binding->cache_negative_ttl;
+
+	if (ttl <= 0) {
+		return;
+	}
+
+	switch_zmalloc(entry, sizeof(*entry));
+	entry->key = strdup(key);
+	entry->body = body ? strdup(body) : NULL;
+	entry->expires = switch_epoch_time_now(NULL) + ttl;
+
+	switch_mutex_lock(binding->mutex);
+	if ((old = switch_core_hash_find(binding->cache, key))) {
+		switch_core_hash_delete(binding->cache, key);
+		binding->cache_count--;
+		switch_safe_free(old->key);
+		switch_safe_free(old->body);
+		free(old);
+	} else if (binding->cache_count >= binding->cache_max_entries) {
+		/* Full, start over rather than keep track of the oldest entries */
+		cache_clear(binding);
+	}
+	switch_core_hash_insert(binding->cache, entry->key, entry);
+	binding->cache_count++;
+	switch_mutex_unlock(binding->mutex);
 }
 
 
@@ -154,6 +348,7 @@ static switch_xml_t xml_url_fetch(const char *section, const char *tag_name, con
 	char basic_data[512];
 	char *uri = NULL;
 	char *dynamic_url = NULL;
+	char *key = NULL;
 
 	gethostname(hostname, sizeof(hostname));
 
@@ -177,6 +372,16 @@ static switch_xml_t xml_url_fetch(const char *section, const char *tag_name, con
 	data = switch_event_build_param_string(params, basic_data, binding->vars_map);
 	switch_assert(data);
 
+	if (binding->cache_ttl > 0 || binding->cache_negative_ttl > 0) {
+		key = cache_key(binding, section, tag_name, key_name, key_value, params, data);
+		if (cache_get(binding, key, &xml)) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Cached %s response for [%s]\n", xml ? "positive" : "negative", key);
+			switch_safe_free(key);
+			switch_safe_free(data);
+			return xml;
+		}
+	}
+
 	if (binding->use_dynamic_url) {
 		if (!params) {
 			switch_event_create(&params, SWITCH_EVENT_REQUEST_PARAMS);
@@ -200,11 +405,7 @@ static switch_xml_t xml_url_fetch(const char *section, const char *tag_name, con
 		sprintf(uri, "%s%c%s", dynamic_url, strchr(dynamic_url, '?') != NULL ? '&' : '?', data);
 	}
 
-	switch_uuid_get(&uuid);
-	switch_uuid_format(uuid_str, &uuid);
-
-	switch_snprintf(filename, sizeof(filename), "%s%s.tmp.xml", SWITCH_GLOBAL_dirs.temp_dir, uuid_str);
-	curl_handle = curl_easy_init();
+	curl_handle = get_handle(binding);
 	headers = curl_slist_append(headers, "Content-Type: application/x-www-form-urlencoded");
 
 	if (!strncasecmp(binding->url, "https", 5)) {
@@ -214,108 +415,145 @@ static switch_xml_t xml_url_fetch(const char *section, const char *tag_name, con
 
 	memset(&config_data, 0, sizeof(config_data));
 
-	config_data.name = filename;
 	config_data.max_bytes = XML_CURL_MAX_BYTES;
 
-	if ((config_data.fd = open(filename, O_CREAT | O_RDWR | O_TRUNC, S_IRUSR | S_IWUSR)) > -1) {
-		if (!zstr(binding->cred)) {
-			curl_easy_setopt(curl_handle, CURLOPT_HTTPAUTH, binding->auth_scheme);
-			curl_easy_setopt(curl_handle, CURLOPT_USERPWD, binding->cred);
-		}
-		curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, headers);
-		if (binding->method != NULL)
-			curl_easy_setopt(curl_handle, CURLOPT_CUSTOMREQUEST, binding->method);
-		curl_easy_setopt(curl_handle, CURLOPT_POST, !binding->use_get_style);
-		curl_easy_setopt(curl_handle, CURLOPT_FOLLOWLOCATION, 1);
-		curl_easy_setopt(curl_handle, CURLOPT_MAXREDIRS, 10);
-		if (!binding->use_get_style)
-			curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDS, data);
-		curl_easy_setopt(curl_handle, CURLOPT_URL, binding->use_get_style ? uri : dynamic_url);
-		curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, file_callback);
-		curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, (void *) &config_data);
-		curl_easy_setopt(curl_handle, CURLOPT_USERAGENT, "freeswitch-xml/1.0");
-
-		if (binding->timeout) {
-			curl_easy_setopt(curl_handle, CURLOPT_TIMEOUT, binding->timeout);
-			curl_easy_setopt(curl_handle, CURLOPT_NOSIGNAL, 1);
-		}
+	if (!zstr(binding->cred)) {
+		curl_easy_setopt(curl_handle, CURLOPT_HTTPAUTH, binding->auth_scheme);
+		curl_easy_setopt(curl_handle, CURLOPT_USERPWD, binding->cred);
+	}
+	curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, headers);
+	if (binding->method != NULL)
+		curl_easy_setopt(curl_handle, CURLOPT_CUSTOMREQUEST, binding->method);
+	curl_easy_setopt(curl_handle, CURLOPT_POST, !binding->use_get_style);
+	curl_easy_setopt(curl_handle, CURLOPT_FOLLOWLOCATION, 1);
+	curl_easy_setopt(curl_handle, CURLOPT_MAXREDIRS, 10);
+	if (!binding->use_get_style)
+		curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDS, data);
+	curl_easy_setopt(curl_handle, CURLOPT_URL, binding->use_get_style ? uri : dynamic_url);
+	curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, buffer_callback);
+	curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, (void *) &config_data);
+	curl_easy_setopt(curl_handle, CURLOPT_USERAGENT, "freeswitch-xml/1.0");
+
+	if (binding->keep_alive) {
+		/* A reused handle must never raise SIGALRM in whatever thread it ends up in */
+		curl_easy_setopt(curl_handle, CURLOPT_NOSIGNAL, 1);
+	}
 
-		if (binding->disable100continue) {
-			slist = curl_slist_append(slist, "Expect:");
-			curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, slist);
-		}
+	if (binding->timeout) {
+		curl_easy_setopt(curl_handle, CURLOPT_TIMEOUT, binding->timeout);
+		curl_easy_setopt(curl_handle, CURLOPT_NOSIGNAL, 1);
+	}
 
-		if (binding->enable_cacert_check) {
-			curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, TRUE);
-		}
+	if (binding->disable100continue) {
+		slist = curl_slist_append(slist, "Expect:");
+		curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, slist);
+	}
 
-		if (binding->ssl_cert_file) {
-			curl_easy_setopt(curl_handle, CURLOPT_SSLCERT, binding->ssl_cert_file);
-		}
+	if (binding->enable_cacert_check) {
+		curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, TRUE);
+	}
 
-		if (binding->ssl_key_file) {
-			curl_easy_setopt(curl_handle, CURLOPT_SSLKEY, binding->ssl_key_file);
-		}
+	if (binding->ssl_cert_file) {
+		curl_easy_setopt(curl_handle, CURLOPT_SSLCERT, binding->ssl_cert_file);
+	}
 
-		if (binding->ssl_key_password) {
-			curl_easy_setopt(curl_handle, CURLOPT_SSLKEYPASSWD, binding->ssl_key_password);
-		}
+	if (binding->ssl_key_file) {
+		curl_easy_setopt(curl_handle, CURLOPT_SSLKEY, binding->ssl_key_file);
+	}
 
-		if (binding->ssl_version) {
-			if (!strcasecmp(binding->ssl_version, "SSLv3")) {
-				curl_easy_setopt(curl_handle, CURLOPT_SSLVERSION, CURL_SSLVERSION_SSLv3);
-			} else if (!strcasecmp(binding->ssl_version, "TLSv1")) {
-				curl_easy_setopt(curl_handle, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1);
-			}
-		}
+	if (binding->ssl_key_password) {
+		curl_easy_setopt(curl_handle, CURLOPT_SSLKEYPASSWD, binding->ssl_key_password);
+	}
 
-		if (binding->ssl_cacert_file) {
-			curl_easy_setopt(curl_handle, CURLOPT_CAINFO, binding->ssl_cacert_file);
+	if (binding->ssl_version) {
+		if (!strcasecmp(binding->ssl_version, "SSLv3")) {
+			curl_easy_setopt(curl_handle, CURLOPT_SSLVERSION, CURL_SSLVERSION_SSLv3);
+		} else if (!strcasecmp(binding->ssl_version, "TLSv1")) {
+			curl_easy_setopt(curl_handle, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1);
 		}
+	}
 
-		if (binding->enable_ssl_verifyhost) {
-			curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 2);
-		}
+	if (binding->ssl_cacert_file) {
+		curl_easy_setopt(curl_handle, CURLOPT_CAINFO, binding->ssl_cacert_file);
+	}
 
-		if (binding->cookie_file) {
-			curl_easy_setopt(curl_handle, CURLOPT_COOKIEJAR, binding->cookie_file);
-			curl_easy_setopt(curl_handle, CURLOPT_COOKIEFILE, binding->cookie_file);
-		}
+	if (binding->enable_ssl_verifyhost) {
+		curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 2);
+	}
 
-		curl_easy_perform(curl_handle);
-		curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &httpRes);
-		curl_easy_cleanup(curl_handle);
-		curl_slist_free_all(headers);
-		curl_slist_free_all(slist);
-		close(config_data.fd);
-	} else {
-		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error Opening temp file!\n");
+	if (binding->cookie_file) {
+		curl_easy_setopt(curl_handle, CURLOPT_COOKIEJAR, binding->cookie_file);
+		curl_easy_setopt(curl_handle, CURLOPT_COOKIEFILE, binding->cookie_file);
 	}
 
+	curl_easy_perform(curl_handle);
+	curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &httpRes);
+	put_handle(binding, curl_handle);
+	curl_slist_free_all(headers);
+	curl_slist_free_all(slist);
+
 	if (config_data.err) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error encountered! [%s]\ndata: [%s]\n", binding->url, data);
 		xml = NULL;
-	} else {
-		if (httpRes == 200) {
-			if (!(xml = switch_xml_parse_file(filename))) {
-				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error Parsing Result! [%s]\ndata: [%s]\n", binding->url, data);
+	} else if (httpRes == 200 && config_data.bytes) {
+		/* Only go through a file when switch_xml_parse_file() has something to preprocess */
+		int preprocess = strstr(config_data.buf, "$${") || switch_stristr("X-pre-process", config_data.buf);
+		int fd = -1;
+
+		if (keep_files_around || preprocess) {
+			switch_uuid_get(&uuid);
+			switch_uuid_format(uuid_str, &uuid);
+			switch_snprintf(filename, sizeof(filename), "%s%s.tmp.xml", SWITCH_GLOBAL_dirs.temp_dir, uuid_str);
+
+			if ((fd = open(filename, O_CREAT | O_RDWR | O_TRUNC, S_IRUSR | S_IWUSR)) > -1) {
+				if (write(fd, config_data.buf, (unsigned) config_data.bytes) != (int) config_data.bytes) {
+					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Short write to %s\n", filename);
+				}
+				close(fd);
+			} else {
+				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error Opening temp file!\n");
+				*filename = '\0';
 			}
-		} else {
-			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Received HTTP error %ld trying to fetch %s\ndata: [%s]\n", httpRes, binding->url,
-							  data);
-			xml = NULL;
 		}
+
+		if (preprocess && *filename) {
+			xml = switch_xml_parse_file(filename);
+		} else if (key) {
+			/* parse a copy and only cache a body that parsed cleanly */
+			if ((xml = switch_xml_parse_str_dynamic(config_data.buf, SWITCH_TRUE)) && zstr(switch_xml_error(xml))) {
+				cache_put(binding, key, config_data.buf);
+			}
+		} else if ((xml = switch_xml_parse_str_dynamic(config_data.buf, SWITCH_FALSE))) {
+			/* the xml owns the buffer from here */
+			config_data.buf = NULL;
+		}
+
+		if (!xml) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error Parsing Result! [%s]\ndata: [%s]\n", binding->url, data);
+		}
+	} else if (httpRes == 200) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Error Parsing Result! [%s]\ndata: [%s]\n", binding->url, data);
+	} else {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Received HTTP error %ld trying to fetch %s\ndata: [%s]\n", httpRes, binding->url,
+						  data);
+		xml = NULL;
+	}
+
+	if (!xml && key) {
+		cache_put(binding, key, NULL);
 	}
 
 	/* Debug by leaving the file behind for review */
-	if (keep_files_around) {
-		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "XML response is in %s\n", filename);
-	} else {
-		if (unlink(filename) != 0) {
+	if (*filename) {
+		if (keep_files_around) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "XML response is in %s\n", filename);
+		} else if (unlink(filename) != 0) {
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "XML response file [%s] delete failed\n", filename);
 		}
 	}
 
+	switch_safe_free(config_data.buf);
+	switch_safe_free(key);
 	switch_safe_free(data);
 	if (binding->use_get_style == 1)
 		switch_safe_free(uri);
@@ -362,6 +600,9 @@ static switch_status_t do_config(void)
 		char *cookie_file = NULL;
 		hash_node_t *hash_node;
 		int auth_scheme = CURLAUTH_BASIC;
+		int cache_ttl = 0, cache_negative_ttl = 0, keep_alive = 0;
+		uint32_t cache_max_entries = 10000;
+		char *cache_key_vars = NULL;
 		need_vars_map = 0;
 		vars_map = NULL;
 
@@ -423,6 +664,19 @@ static switch_status_t do_config(void)
 				cookie_file = val;
 			} else if (!strcasecmp(var, "use-dynamic-url") && switch_true(val)) {
 				use_dynamic_url = 1;
+			} else if (!strcasecmp(var, "cache-ttl")) {
+				cache_ttl = atoi(val);
+			} else if (!strcasecmp(var, "cache-negative-ttl")) {
+				cache_negative_ttl = atoi(val);
+			} else if (!strcasecmp(var, "cache-max-entries")) {
+				int tmp = atoi(val);
+				if (tmp > 0) {
+					cache_max_entries = tmp;
+				}
+			} else if (!strcasecmp(var, "cache-key-vars")) {
+				cache_key_vars = val;
+			} else if (!strcasecmp(var, "keep-alive")) {
+				keep_alive = switch_true(val);
 			} else if (!strcasecmp(var, "enable-post-var")) {
 				if (!vars_map && need_vars_map == 0) {
 					if (switch_core_hash_init(&vars_map, globals.pool) != SWITCH_STATUS_SUCCESS) {
@@ -505,6 +759,27 @@ static switch_status_t do_config(void)
 
 		binding->vars_map = vars_map;
 
+		binding->cache_ttl = cache_ttl;
+		binding->cache_negative_ttl = cache_negative_ttl;
+		binding->cache_max_entries = cache_max_entries;
+		if (!zstr(cache_key_vars)) {
+			binding->cache_key_vars_str = strdup(cache_key_vars);
+			binding->cache_key_var_count = switch_separate_string(binding->cache_key_vars_str, ',', binding->cache_key_vars,
+																  (sizeof(binding->cache_key_vars) / sizeof(binding->cache_key_vars[0])));
+		}
+
+		/* the full param string carries per-request headers, so without a list of vars there is no usable key */
+		if ((cache_ttl > 0 || cache_negative_ttl > 0) && !binding->cache_key_var_count && !vars_map) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
+							  "Binding [%s] sets cache-ttl without cache-key-vars or enable-post-var, caching disabled!\n", switch_str_nil(bname));
+			binding->cache_ttl = binding->cache_negative_ttl = 0;
+		}
+		binding->keep_alive = keep_alive;
+		switch_mutex_init(&binding->mutex, SWITCH_MUTEX_NESTED, globals.pool);
+		switch_core_hash_init(&binding->cache, globals.pool);
+		binding->next = globals.bindings;
+		globals.bindings = binding;
+
 		if (vars_map) {
 			switch_zmalloc(hash_node, sizeof(hash_node_t));
 			hash_node->hash = vars_map;
@@ -556,6 +831,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_xml_curl_load)
 	SWITCH_ADD_API(xml_curl_api_interface, "xml_curl", "XML Curl", xml_curl_function, XML_CURL_SYNTAX);
 	switch_console_set_complete("add xml_curl debug_on");
 	switch_console_set_complete("add xml_curl debug_off");
+	switch_console_set_complete("add xml_curl flush");
 
 	/* indicate that the module should continue to be loaded */
 	return SWITCH_STATUS_SUCCESS;
@@ -564,6 +840,7 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_xml_curl_load)
 SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_xml_curl_shutdown)
 {
 	hash_node_t *ptr = NULL;
+	xml_binding_t *binding;
 
 	while (globals.hash_root) {
 		ptr = globals.hash_root;
@@ -573,6 +850,18 @@ SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_xml_curl_shutdown)
 	}
 
 	switch_xml_unbind_search_function_ptr(xml_url_fetch);
+
+	for (binding = globals.bindings; binding; binding = binding->next) {
+		switch_mutex_lock(binding->mutex);
+		cache_clear(binding);
+		switch_core_hash_destroy(&binding->cache);
+		while (binding->handle_count) {
+			curl_easy_cleanup(binding->handles[--binding->handle_count]);
+		}
+		switch_mutex_unlock(binding->mutex);
+	}
+	globals.bindings = NULL;
+
 	curl_global_cleanup();
 	return SWITCH_STATUS_SUCCESS;
 }
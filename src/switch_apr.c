@@ -818,6 +818,46 @@ SWITCH_DECLARE(int32_t) switch_sockaddr_get_family(switch_sockaddr_t *sa)
 	return sa->family;
 }
 
+SWITCH_DECLARE(const void *) switch_sockaddr_get_raw(switch_sockaddr_t *sa, uint32_t *len)
+{
+	*len = (uint32_t) sa->salen;
+	return &sa->sa;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_sockaddr_set_raw(switch_sockaddr_t *sa, const void *raw, uint32_t len)
+{
+	const struct sockaddr *in = (const struct sockaddr *) raw;
+
+	if (!raw || len > sizeof(sa->sa)) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	memcpy(&sa->sa, raw, len);
+	sa->salen = len;
+	sa->family = in->sa_family;
+	sa->port = ntohs(sa->sa.sin.sin_port);
+
+	if (in->sa_family == AF_INET) {
+		sa->addr_str_len = 16;
+		sa->ipaddr_ptr = &(sa->sa.sin.sin_addr);
+		sa->ipaddr_len = sizeof(struct in_addr);
+	}
+#if APR_HAVE_IPV6
+	else if (in->sa_family == AF_INET6) {
+		sa->addr_str_len = 46;
+		sa->ipaddr_ptr = &(sa->sa.sin6.sin6_addr);
+		sa->ipaddr_len = sizeof(struct in6_addr);
+	}
+#endif
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_os_sock_get(switch_os_socket_t *thesock, switch_socket_t *sock)
+{
+	return apr_os_sock_get(thesock, sock);
+}
+
 SWITCH_DECLARE(switch_status_t) switch_socket_atmark(switch_socket_t *sock, int *atmark)
 {
 	return apr_socket_atmark(sock, atmark);
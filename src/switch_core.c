@@ -1361,6 +1361,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_init(switch_core_flag_t flags, switc
 	switch_mutex_init(&runtime.global_var_mutex, SWITCH_MUTEX_NESTED, runtime.memory_pool);
 	switch_core_set_globals();
 	switch_core_session_init(runtime.memory_pool);
+	switch_regex_cache_init(runtime.memory_pool);
 	switch_event_create_plain(&runtime.global_vars, SWITCH_EVENT_CHANNEL_DATA);
 	switch_core_hash_init(&runtime.mime_types, runtime.memory_pool);
 	switch_core_hash_init_case(&runtime.ptimes, runtime.memory_pool, SWITCH_FALSE);
@@ -1409,6 +1410,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_init(switch_core_flag_t flags, switc
 	runtime.timer_affinity = -1;
 	
 	switch_load_core_config("switch.conf");
+	switch_core_session_thread_pool_start();
 
 	switch_core_state_machine_init(runtime.memory_pool);
 
@@ -1676,10 +1678,54 @@ static void switch_load_core_config(const char *file)
 					} else {
 						switch_clear_flag((&runtime), SCF_VERBOSE_EVENTS);
 					}
+				} else if (!strcasecmp(var, "event-subscriber-queue-len") && !zstr(val)) {
+					int tmp = atoi(val);
+
+					if (tmp >= 0 && tmp <= 1000000) {
+						runtime.event_queue_len = (uint32_t) tmp;
+					} else {
+						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "event-subscriber-queue-len must be between 0 and 1000000\n");
+					}
+				} else if (!strcasecmp(var, "event-subscriber-queue-policy") && !zstr(val)) {
+					if (!strcasecmp(val, "block")) {
+						runtime.event_queue_policy = SWITCH_EVENT_QUEUE_POLICY_BLOCK;
+					} else {
+						runtime.event_queue_policy = SWITCH_EVENT_QUEUE_POLICY_DROP;
+					}
+				} else if (!strcasecmp(var, "indexed-channel-variables")) {
+					if (switch_true(val)) {
+						switch_set_flag((&runtime), SCF_INDEXED_VARIABLES);
+					} else {
+						switch_clear_flag((&runtime), SCF_INDEXED_VARIABLES);
+					}
+				} else if (!strcasecmp(var, "xml-user-cache-ttl") && !zstr(val)) {
+					int tmp = atoi(val);
+
+					if (tmp >= 0) {
+						switch_xml_set_user_cache_ttl((uint32_t) tmp);
+					} else {
+						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "xml-user-cache-ttl must be 0 or greater\n");
+					}
+				} else if (!strcasecmp(var, "xml-user-cache-max-entries") && !zstr(val)) {
+					int tmp = atoi(val);
+
+					if (tmp >= 0) {
+						switch_xml_set_user_cache_max_entries((uint32_t) tmp);
+					} else {
+						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "xml-user-cache-max-entries must be 0 or greater\n");
+					}
 				} else if (!strcasecmp(var, "min-idle-cpu") && !zstr(val)) {
 					switch_core_min_idle_cpu(atof(val));
 				} else if (!strcasecmp(var, "tipping-point") && !zstr(val)) {
 					runtime.tipping_point = atoi(val);
+				} else if (!strcasecmp(var, "timer-shards") && !zstr(val)) {
+					int tmp = atoi(val);
+
+					if (tmp >= 0 && tmp <= 64) {
+						runtime.timer_shards = (uint32_t) tmp;
+					} else {
+						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "timer-shards must be between 0 and 64\n");
+					}
 				} else if (!strcasecmp(var, "timer-affinity") && !zstr(val)) {
 					if (!strcasecmp(val, "disabled")) {
 						runtime.timer_affinity = -1;
@@ -1690,6 +1736,38 @@ static void switch_load_core_config(const char *file)
 					switch_rtp_set_start_port((switch_port_t) atoi(val));
 				} else if (!strcasecmp(var, "rtp-end-port") && !zstr(val)) {
 					switch_rtp_set_end_port((switch_port_t) atoi(val));
+				} else if (!strcasecmp(var, "session-threads-min") && !zstr(val)) {
+					int tmp = atoi(val);
+
+					if (tmp >= 0 && tmp <= 10000) {
+						session_manager.thread_pool_min = (uint32_t) tmp;
+					} else {
+						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "session-threads-min must be between 0 and 10000\n");
+					}
+				} else if (!strcasecmp(var, "session-threads-max") && !zstr(val)) {
+					int tmp = atoi(val);
+
+					if (tmp >= 0 && tmp <= 10000) {
+						session_manager.thread_pool_max = (uint32_t) tmp;
+					} else {
+						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "session-threads-max must be between 0 and 10000\n");
+					}
+				} else if (!strcasecmp(var, "session-threads-idle-timeout") && !zstr(val)) {
+					int tmp = atoi(val);
+
+					if (tmp > 0) {
+						session_manager.thread_pool_idle_timeout = (uint32_t) tmp;
+					} else {
+						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "session-threads-idle-timeout must be at least 1 second\n");
+					}
+				} else if (!strcasecmp(var, "rtp-io-threads") && !zstr(val)) {
+					int tmp = atoi(val);
+
+					if (tmp >= 0 && tmp <= 64) {
+						switch_rtp_set_io_threads((uint32_t) tmp);
+					} else {
+						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "rtp-io-threads must be between 0 and 64\n");
+					}
 				} else if (!strcasecmp(var, "core-db-name") && !zstr(val)) {
 					runtime.dbname = switch_core_strdup(runtime.memory_pool, val);
 				} else if (!strcasecmp(var, "core-db-dsn") && !zstr(val)) {
@@ -1801,6 +1879,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_init_and_modload(switch_core_flag_t
 	switch_load_network_lists(SWITCH_FALSE);
 
 	switch_load_core_config("post_load_switch.conf");
+	switch_core_session_thread_pool_start();
 
 	if (switch_event_create(&event, SWITCH_EVENT_STARTUP) == SWITCH_STATUS_SUCCESS) {
 		switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Event-Info", "System Ready");
@@ -2090,6 +2169,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_destroy(void)
 
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "End existing sessions\n");
 	switch_core_session_hupall(SWITCH_CAUSE_SYSTEM_SHUTDOWN);
+	switch_core_session_thread_pool_stop();
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Clean up modules.\n");
 
 	switch_loadable_module_shutdown();
@@ -2100,6 +2180,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_destroy(void)
 	switch_scheduler_task_thread_stop();
 
 	switch_rtp_shutdown();
+	switch_regex_cache_shutdown();
 
 	if (switch_test_flag((&runtime), SCF_USE_AUTO_NAT)) {
 		switch_nat_shutdown();
@@ -46,6 +46,62 @@
 #define PER_POOL_LOCK 1
 #endif
 
+#if defined(PER_POOL_LOCK) && !defined(INSTANTLY_DESTROY_POOLS)
+/* destroyed pools are parked per thread and reused by the same thread once they have rested */
+#define POOL_CACHE 1
+#define POOL_CACHE_SIZE 64
+/* how long a destroyed pool is left alone before it is cleared, the same rest pool_thread gives pool_queue */
+#define POOL_CACHE_GRACE 1000000
+/* freed blocks a recycled pool's allocator may hold on to */
+#define POOL_CACHE_MAX_FREE (64 * 1024)
+/* cleared pools kept for threads with nothing due in their cache, fed by the pool thread */
+#define POOL_RECYCLE_MAX 1024
+#define POOL_SITE_MEMO_SIZE 32
+
+#endif
+
+/* pools created from one file:line */
+typedef struct {
+	const char *tag;
+	volatile switch_atomic_t live;
+	volatile switch_atomic_t peak;
+	volatile switch_atomic_t bytes;
+	volatile switch_atomic_t created;
+} pool_site_t;
+
+/* hung off the pool header (apr_pool_owner_data_set) so allocations and destroy find their site without a lookup */
+typedef struct {
+	pool_site_t *site;
+	/* bytes not yet added to the site, moved over in POOL_BYTES_FLUSH steps to keep threads off the shared counter */
+	volatile switch_atomic_t pending;
+	/* bytes already added to the site */
+	volatile switch_atomic_t flushed;
+} pool_rec_t;
+
+#define POOL_BYTES_FLUSH 4096
+
+#ifdef POOL_CACHE
+typedef struct {
+	const char *file;
+	int line;
+	pool_site_t *site;
+} pool_site_memo_t;
+
+typedef struct {
+	switch_memory_pool_t *pool;
+	switch_time_t parked;
+} pool_cache_slot_t;
+
+typedef struct {
+	/* oldest first, slots[head] is the next one due */
+	pool_cache_slot_t slots[POOL_CACHE_SIZE];
+	int head;
+	int len;
+	/* recently used sites so most creates skip the shared site table */
+	pool_site_memo_t memo[POOL_SITE_MEMO_SIZE];
+} pool_cache_t;
+#endif
+
 static struct {
 #ifdef USE_MEM_LOCK
 	switch_mutex_t *mem_lock;
@@ -54,8 +110,229 @@ static struct {
 	switch_queue_t *pool_recycle_queue;
 	switch_memory_pool_t *memory_pool;
 	int pool_thread_running;
+	switch_hash_t *sites;
+	switch_thread_rwlock_t *sites_rwlock;
+#ifdef POOL_CACHE
+	apr_threadkey_t *cache_key;
+	volatile switch_atomic_t cache_hits;
+	volatile switch_atomic_t recycle_hits;
+	volatile switch_atomic_t misses;
+#endif
 } memory_manager;
 
+static void pool_account(switch_memory_pool_t *pool, switch_size_t bytes)
+{
+	pool_rec_t *rec = (pool_rec_t *) apr_pool_owner_data_get(pool);
+	int32_t pending;
+
+	if (!rec) {
+		return;
+	}
+
+	switch_atomic_add(&rec->pending, (uint32_t) bytes);
+
+	/* racing threads may both move the same bytes, pending then goes negative and the sum stays right */
+	if ((pending = (int32_t) switch_atomic_read(&rec->pending)) >= POOL_BYTES_FLUSH) {
+		switch_atomic_add(&rec->pending, (uint32_t) 0 - (uint32_t) pending);
+		switch_atomic_add(&rec->flushed, (uint32_t) pending);
+		switch_atomic_add(&rec->site->bytes, (uint32_t) pending);
+	}
+}
+
+#ifdef POOL_CACHE
+static pool_cache_t *pool_cache_get(switch_bool_t create)
+{
+	pool_cache_t *cache = NULL;
+
+	if (!memory_manager.cache_key) {
+		return NULL;
+	}
+
+	apr_threadkey_private_get((void **) &cache, memory_manager.cache_key);
+
+	if (!cache && create) {
+		switch_zmalloc(cache, sizeof(*cache));
+		apr_threadkey_private_set(cache, memory_manager.cache_key);
+	}
+
+	return cache;
+}
+#endif
+
+static pool_site_t *pool_site_get(const char *file, int line)
+{
+	char key[256];
+	pool_site_t *site;
+#ifdef POOL_CACHE
+	pool_cache_t *cache = pool_cache_get(SWITCH_TRUE);
+	pool_site_memo_t *memo = NULL;
+
+	if (cache) {
+		memo = &cache->memo[((uintptr_t) file + line) % POOL_SITE_MEMO_SIZE];
+		if (memo->file == file && memo->line == line) {
+			return memo->site;
+		}
+	}
+#endif
+
+	switch_snprintf(key, sizeof(key), "%s:%d", file, line);
+
+	switch_thread_rwlock_rdlock(memory_manager.sites_rwlock);
+	site = switch_core_hash_find(memory_manager.sites, key);
+	switch_thread_rwlock_unlock(memory_manager.sites_rwlock);
+
+	if (!site) {
+		switch_thread_rwlock_wrlock(memory_manager.sites_rwlock);
+		if (!(site = switch_core_hash_find(memory_manager.sites, key))) {
+			site = apr_pcalloc(memory_manager.memory_pool, sizeof(*site));
+			site->tag = apr_pstrdup(memory_manager.memory_pool, key);
+			switch_core_hash_insert(memory_manager.sites, site->tag, site);
+		}
+		switch_thread_rwlock_unlock(memory_manager.sites_rwlock);
+	}
+
+#ifdef POOL_CACHE
+	if (memo) {
+		memo->file = file;
+		memo->line = line;
+		memo->site = site;
+	}
+#endif
+
+	return site;
+}
+
+static void pool_site_attach(switch_memory_pool_t *pool, pool_site_t *site)
+{
+	pool_rec_t *rec = apr_pcalloc(pool, sizeof(*rec));
+	uint32_t live;
+
+	rec->site = site;
+	apr_pool_owner_data_set(pool, rec);
+	apr_pool_tag(pool, site->tag);
+
+	switch_atomic_inc(&site->created);
+	switch_atomic_inc(&site->live);
+	if ((live = switch_atomic_read(&site->live)) > switch_atomic_read(&site->peak)) {
+		switch_atomic_set(&site->peak, live);
+	}
+}
+
+static pool_site_t *pool_site_detach(switch_memory_pool_t *pool, switch_bool_t release)
+{
+	pool_rec_t *rec = (pool_rec_t *) apr_pool_owner_data_get(pool);
+
+	if (!rec) {
+		return NULL;
+	}
+
+	switch_atomic_add(&rec->site->bytes, (uint32_t) 0 - switch_atomic_read(&rec->flushed));
+	switch_atomic_set(&rec->pending, 0);
+	switch_atomic_set(&rec->flushed, 0);
+
+	if (release) {
+		switch_atomic_dec(&rec->site->live);
+		apr_pool_owner_data_set(pool, NULL);
+	}
+
+	return rec->site;
+}
+
+#ifdef PER_POOL_LOCK
+/* clear a pool and give it and its allocator a fresh mutex, the old one lived in the pool */
+static void pool_reset(switch_memory_pool_t *pool)
+{
+	apr_allocator_t *allocator = apr_pool_allocator_get(pool);
+	apr_thread_mutex_t *my_mutex;
+
+	apr_pool_mutex_set(pool, NULL);
+	apr_allocator_mutex_set(allocator, NULL);
+
+	apr_pool_clear(pool);
+
+	if ((apr_thread_mutex_create(&my_mutex, APR_THREAD_MUTEX_NESTED, pool)) != APR_SUCCESS) {
+		abort();
+	}
+
+	apr_allocator_mutex_set(allocator, my_mutex);
+	apr_pool_mutex_set(pool, my_mutex);
+}
+#endif
+
+#ifdef POOL_CACHE
+static void pool_recycle(switch_memory_pool_t *pool)
+{
+	apr_allocator_max_free_set(apr_pool_allocator_get(pool), POOL_CACHE_MAX_FREE);
+	pool_reset(pool);
+}
+
+/* hand a cleared pool to any thread, FALSE when the shared queue is full or going away */
+static switch_bool_t pool_recycle_share(switch_memory_pool_t *pool)
+{
+	return memory_manager.pool_thread_running == 1 && switch_queue_size(memory_manager.pool_recycle_queue) < POOL_RECYCLE_MAX &&
+		switch_queue_trypush(memory_manager.pool_recycle_queue, pool) == SWITCH_STATUS_SUCCESS;
+}
+
+/* the thread is going away, let pool_thread finish the rest of its parked pools */
+static void pool_cache_destroy(void *data)
+{
+	pool_cache_t *cache = (pool_cache_t *) data;
+
+	while (cache->len) {
+		switch_memory_pool_t *pool = cache->slots[cache->head].pool;
+
+		cache->head = (cache->head + 1) % POOL_CACHE_SIZE;
+		cache->len--;
+
+		if (memory_manager.pool_thread_running != 1 || switch_queue_trypush(memory_manager.pool_queue, pool) != SWITCH_STATUS_SUCCESS) {
+			apr_pool_destroy(pool);
+		}
+	}
+
+	free(cache);
+}
+
+static switch_memory_pool_t *pool_cache_pop(void)
+{
+	pool_cache_t *cache = pool_cache_get(SWITCH_FALSE);
+	switch_memory_pool_t *pool = NULL;
+	void *pop = NULL;
+
+	if (cache && cache->len && switch_micro_time_now() - cache->slots[cache->head].parked >= POOL_CACHE_GRACE) {
+		pool = cache->slots[cache->head].pool;
+		cache->head = (cache->head + 1) % POOL_CACHE_SIZE;
+		cache->len--;
+		pool_recycle(pool);
+		switch_atomic_inc(&memory_manager.cache_hits);
+	} else if (switch_queue_trypop(memory_manager.pool_recycle_queue, &pop) == SWITCH_STATUS_SUCCESS && pop) {
+		pool = (switch_memory_pool_t *) pop;
+		switch_atomic_inc(&memory_manager.recycle_hits);
+	} else {
+		switch_atomic_inc(&memory_manager.misses);
+	}
+
+	return pool;
+}
+
+/* park the pool as it is, it is only cleared once it has rested POOL_CACHE_GRACE and this thread wants it back.
+   FALSE when the cache is full, the caller then queues it for pool_thread as before */
+static switch_bool_t pool_cache_push(switch_memory_pool_t *pool)
+{
+	pool_cache_t *cache = pool_cache_get(SWITCH_TRUE);
+	pool_cache_slot_t *slot;
+
+	if (!cache || cache->len >= POOL_CACHE_SIZE) {
+		return SWITCH_FALSE;
+	}
+
+	slot = &cache->slots[(cache->head + cache->len++) % POOL_CACHE_SIZE];
+	slot->pool = pool;
+	slot->parked = switch_micro_time_now();
+
+	return SWITCH_TRUE;
+}
+#endif
+
 SWITCH_DECLARE(switch_memory_pool_t *) switch_core_session_get_pool(switch_core_session_t *session)
 {
 	switch_assert(session != NULL);
@@ -86,6 +363,7 @@ SWITCH_DECLARE(void *) switch_core_perform_session_alloc(switch_core_session_t *
 
 	ptr = apr_palloc(session->pool, memory);
 	switch_assert(ptr != NULL);
+	pool_account(session->pool, memory);
 
 	memset(ptr, 0, memory);
 
@@ -197,6 +475,7 @@ SWITCH_DECLARE(char *) switch_core_vsprintf(switch_memory_pool_t *pool, const ch
 
 	result = apr_pvsprintf(pool, fmt, ap);
 	switch_assert(result != NULL);
+	pool_account(pool, strlen(result) + 1);
 
 #ifdef LOCK_MORE
 #ifdef USE_MEM_LOCK
@@ -251,6 +530,7 @@ SWITCH_DECLARE(char *) switch_core_perform_session_strdup(switch_core_session_t
 
 	duped = apr_pstrdup(session->pool, todup);
 	switch_assert(duped != NULL);
+	pool_account(session->pool, strlen(duped) + 1);
 
 #ifdef LOCK_MORE
 #ifdef USE_MEM_LOCK
@@ -289,6 +569,7 @@ SWITCH_DECLARE(char *) switch_core_perform_strdup(switch_memory_pool_t *pool, co
 
 	duped = apr_pstrmemdup(pool, todup, len);
 	switch_assert(duped != NULL);
+	pool_account(pool, len);
 
 #ifdef LOCK_MORE
 #ifdef USE_MEM_LOCK
@@ -320,30 +601,27 @@ SWITCH_DECLARE(void) switch_core_memory_pool_tag(switch_memory_pool_t *pool, con
 
 SWITCH_DECLARE(void) switch_pool_clear(switch_memory_pool_t *p)
 {
-#ifdef PER_POOL_LOCK
-	apr_thread_mutex_t *my_mutex;
-	apr_pool_mutex_set(p, NULL);
-#endif
-
-	apr_pool_clear(p);
+	pool_site_t *site = pool_site_detach(p, SWITCH_FALSE);
 
 #ifdef PER_POOL_LOCK
-
-	if ((apr_thread_mutex_create(&my_mutex, APR_THREAD_MUTEX_NESTED, p)) != APR_SUCCESS) {
-		abort();
-	}
-
-	apr_pool_mutex_set(p, my_mutex);
-
+	pool_reset(p);
+#else
+	apr_pool_clear(p);
 #endif
 
+	if (site) {
+		/* the clear dropped our record, put it back without counting the pool twice */
+		pool_rec_t *rec = apr_pcalloc(p, sizeof(*rec));
+		rec->site = site;
+		apr_pool_owner_data_set(p, rec);
+		apr_pool_tag(p, site->tag);
+	}
 }
 
 
 
 SWITCH_DECLARE(switch_status_t) switch_core_perform_new_memory_pool(switch_memory_pool_t **pool, const char *file, const char *func, int line)
 {
-	char *tmp;
 #ifdef INSTANTLY_DESTROY_POOLS
 	apr_pool_create(pool, NULL);
 	switch_assert(*pool != NULL);
@@ -368,6 +646,9 @@ SWITCH_DECLARE(switch_status_t) switch_core_perform_new_memory_pool(switch_memor
 #endif
 
 #ifdef PER_POOL_LOCK
+#ifdef POOL_CACHE
+	if (!(*pool = pool_cache_pop())) {
+#endif
 		if ((apr_allocator_create(&my_allocator)) != APR_SUCCESS) {
 			abort();
 		}
@@ -384,6 +665,9 @@ SWITCH_DECLARE(switch_status_t) switch_core_perform_new_memory_pool(switch_memor
 		apr_allocator_owner_set(my_allocator, *pool);
 
 		apr_pool_mutex_set(*pool, my_mutex);
+#ifdef POOL_CACHE
+	}
+#endif
 
 #else
 		apr_pool_create(pool, NULL);
@@ -395,8 +679,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_perform_new_memory_pool(switch_memor
 #ifdef DEBUG_ALLOC2
 	switch_log_printf(SWITCH_CHANNEL_ID_LOG, file, func, line, NULL, SWITCH_LOG_CONSOLE, "New Pool\n");
 #endif
-	tmp = switch_core_sprintf(*pool, "%s:%d", file, line);
-	apr_pool_tag(*pool, tmp);
+	pool_site_attach(*pool, pool_site_get(file, line));
 
 
 #ifdef USE_MEM_LOCK
@@ -414,6 +697,8 @@ SWITCH_DECLARE(switch_status_t) switch_core_perform_destroy_memory_pool(switch_m
 	switch_log_printf(SWITCH_CHANNEL_ID_LOG, file, func, line, NULL, SWITCH_LOG_CONSOLE, "Free Pool\n");
 #endif
 
+	pool_site_detach(*pool, SWITCH_TRUE);
+
 #ifdef INSTANTLY_DESTROY_POOLS
 #ifdef USE_MEM_LOCK
 	switch_mutex_lock(memory_manager.mem_lock);
@@ -423,6 +708,12 @@ SWITCH_DECLARE(switch_status_t) switch_core_perform_destroy_memory_pool(switch_m
 	switch_mutex_unlock(memory_manager.mem_lock);
 #endif
 #else
+#ifdef POOL_CACHE
+	if (pool_cache_push(*pool)) {
+		*pool = NULL;
+		return SWITCH_STATUS_SUCCESS;
+	}
+#endif
 	if ((memory_manager.pool_thread_running != 1) || (switch_queue_push(memory_manager.pool_queue, *pool) != SWITCH_STATUS_SUCCESS)) {
 #ifdef USE_MEM_LOCK
 		switch_mutex_lock(memory_manager.mem_lock);
@@ -459,6 +750,7 @@ SWITCH_DECLARE(void *) switch_core_perform_alloc(switch_memory_pool_t *pool, swi
 
 	ptr = apr_palloc(pool, memory);
 	switch_assert(ptr != NULL);
+	pool_account(pool, memory);
 	memset(ptr, 0, memory);
 
 #ifdef LOCK_MORE
@@ -470,9 +762,41 @@ SWITCH_DECLARE(void *) switch_core_perform_alloc(switch_memory_pool_t *pool, swi
 	return ptr;
 }
 
+SWITCH_DECLARE(void) switch_core_memory_pool_stats(switch_stream_handle_t *stream)
+{
+	switch_hash_index_t *hi;
+	const void *var;
+	void *val;
+	uint32_t sites = 0, live = 0, bytes = 0;
+
+	stream->write_function(stream, "%8s %8s %12s %10s  %s\n", "live", "peak", "bytes", "created", "site");
+
+	switch_thread_rwlock_rdlock(memory_manager.sites_rwlock);
+	for (hi = switch_hash_first(NULL, memory_manager.sites); hi; hi = switch_hash_next(hi)) {
+		pool_site_t *site;
+
+		switch_hash_this(hi, &var, NULL, &val);
+		site = (pool_site_t *) val;
+
+		stream->write_function(stream, "%8u %8u %12u %10u  %s\n", switch_atomic_read(&site->live), switch_atomic_read(&site->peak),
+							   switch_atomic_read(&site->bytes), switch_atomic_read(&site->created), site->tag);
+		sites++;
+		live += switch_atomic_read(&site->live);
+		bytes += switch_atomic_read(&site->bytes);
+	}
+	switch_thread_rwlock_unlock(memory_manager.sites_rwlock);
+
+	stream->write_function(stream, "\n%u sites, %u live pools, %u bytes\n", sites, live, bytes);
+#ifdef POOL_CACHE
+	stream->write_function(stream, "reused from thread cache %u, from recycle queue %u, newly created %u, recycle queue %u\n",
+						   switch_atomic_read(&memory_manager.cache_hits), switch_atomic_read(&memory_manager.recycle_hits),
+						   switch_atomic_read(&memory_manager.misses), switch_queue_size(memory_manager.pool_recycle_queue));
+#endif
+}
+
 SWITCH_DECLARE(void) switch_core_memory_reclaim(void)
 {
-#if !defined(PER_POOL_LOCK) && !defined(INSTANTLY_DESTROY_POOLS)
+#if !defined(INSTANTLY_DESTROY_POOLS)
 	switch_memory_pool_t *pool;
 	void *pop = NULL;
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Returning %d recycled memory pool(s)\n",
@@ -515,7 +839,13 @@ static void *SWITCH_THREAD_FUNC pool_thread(switch_thread_t *thread, void *obj)
 					done = 1;
 					break;
 				}
-#if defined(PER_POOL_LOCK) || defined(DESTROY_POOLS)
+#if defined(POOL_CACHE) && !defined(DESTROY_POOLS)
+				/* pools the thread caches could not take, keep a bounded number cleared and ready for any thread */
+				pool_recycle(pop);
+				if (!pool_recycle_share(pop)) {
+					apr_pool_destroy(pop);
+				}
+#elif defined(PER_POOL_LOCK) || defined(DESTROY_POOLS)
 #ifdef USE_MEM_LOCK
 				switch_mutex_lock(memory_manager.mem_lock);
 #endif
@@ -584,8 +914,13 @@ void switch_core_memory_stop(void)
 
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Stopping memory pool queue.\n");
 
-	memory_manager.pool_thread_running = 0;
+	/* the pool thread is detached so the join returns at once, it drops the flag to 0 once pool_queue is drained */
+	memory_manager.pool_thread_running = -1;
 	switch_thread_join(&st, pool_thread_p);
+
+	while (memory_manager.pool_thread_running) {
+		switch_yield(100000);
+	}
 #endif
 }
 
@@ -629,6 +964,9 @@ switch_memory_pool_t *switch_core_memory_init(void)
 	switch_mutex_init(&memory_manager.mem_lock, SWITCH_MUTEX_NESTED, memory_manager.memory_pool);
 #endif
 
+	switch_core_hash_init(&memory_manager.sites, memory_manager.memory_pool);
+	switch_thread_rwlock_create(&memory_manager.sites_rwlock, memory_manager.memory_pool);
+
 #ifdef INSTANTLY_DESTROY_POOLS
 	{
 		void *foo;
@@ -638,6 +976,9 @@ switch_memory_pool_t *switch_core_memory_init(void)
 
 	switch_queue_create(&memory_manager.pool_queue, 50000, memory_manager.memory_pool);
 	switch_queue_create(&memory_manager.pool_recycle_queue, 50000, memory_manager.memory_pool);
+#ifdef POOL_CACHE
+	apr_threadkey_private_create(&memory_manager.cache_key, pool_cache_destroy, memory_manager.memory_pool);
+#endif
 
 	switch_threadattr_create(&thd_attr, memory_manager.memory_pool);
 	switch_threadattr_detach_set(thd_attr, 1);
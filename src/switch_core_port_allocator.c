@@ -35,18 +35,123 @@
 #include <switch.h>
 #include "private/switch_core_pvt.h"
 
+/* a freed port is held back this long so late packets from the last call don't land on the next one */
+#define PORT_QUARANTINE_MS 5000
+
+typedef enum {
+	PORT_FREE = 0,
+	PORT_USED,
+	PORT_QUARANTINE
+} port_state_t;
+
 struct switch_core_port_allocator {
 	switch_port_t start;
 	switch_port_t end;
-	switch_port_t next;
-	int8_t *track;
+	uint32_t stride;
+	uint8_t *track;
 	uint32_t track_len;
 	uint32_t track_used;
+	uint32_t high_water;
+	uint64_t failed;
+	/* one bit per slot that is free to hand out, plus one bit per map word that has any bit set */
+	uint32_t *map;
+	uint32_t map_len;
+	uint32_t *summary;
+	uint32_t summary_len;
+	uint32_t cursor;
+	/* ring of freed slots in the order they were released */
+	uint32_t *q_slot;
+	int64_t *q_time;
+	uint32_t q_head;
+	uint32_t q_count;
 	switch_port_flag_t flags;
 	switch_mutex_t *mutex;
 	switch_memory_pool_t *pool;
 };
 
+static inline uint32_t lowest_bit(uint32_t word)
+{
+#if defined(__GNUC__)
+	return (uint32_t) __builtin_ctz(word);
+#else
+	uint32_t bit = 0;
+
+	while (!(word & 1)) {
+		word >>= 1;
+		bit++;
+	}
+
+	return bit;
+#endif
+}
+
+static void slot_set_free(switch_core_port_allocator_t *alloc, uint32_t index)
+{
+	uint32_t w = index >> 5;
+
+	alloc->track[index] = PORT_FREE;
+	alloc->map[w] |= (1u << (index & 31));
+	alloc->summary[w >> 5] |= (1u << (w & 31));
+}
+
+static void slot_take(switch_core_port_allocator_t *alloc, uint32_t index)
+{
+	uint32_t w = index >> 5;
+
+	alloc->map[w] &= ~(1u << (index & 31));
+	if (!alloc->map[w]) {
+		alloc->summary[w >> 5] &= ~(1u << (w & 31));
+	}
+}
+
+/* returns the first map word at or after the cursor word (wrapping) with a free slot, or -1 */
+static int find_free_word(switch_core_port_allocator_t *alloc)
+{
+	uint32_t first = alloc->cursor % alloc->map_len;
+	uint32_t s = first >> 5;
+	uint32_t word;
+	uint32_t x;
+
+	/* the part of the cursor's summary word at or above the cursor */
+	if ((word = alloc->summary[s] & (~0u << (first & 31)))) {
+		return (int) ((s << 5) + lowest_bit(word));
+	}
+
+	for (x = 1; x <= alloc->summary_len; x++) {
+		uint32_t i = (s + x) % alloc->summary_len;
+
+		if ((word = alloc->summary[i])) {
+			return (int) ((i << 5) + lowest_bit(word));
+		}
+	}
+
+	return -1;
+}
+
+/* move quarantined slots back to the free map, all of them if force is set and nothing else is left */
+static void release_quarantine(switch_core_port_allocator_t *alloc, int64_t now, switch_bool_t force)
+{
+	while (alloc->q_count) {
+		uint32_t index = alloc->q_slot[alloc->q_head];
+
+		if (!force && now - alloc->q_time[alloc->q_head] < PORT_QUARANTINE_MS) {
+			break;
+		}
+
+		if (++alloc->q_head == alloc->track_len) {
+			alloc->q_head = 0;
+		}
+		alloc->q_count--;
+
+		if (alloc->track[index] == PORT_QUARANTINE) {
+			slot_set_free(alloc, index);
+			if (force) {
+				break;
+			}
+		}
+	}
+}
+
 SWITCH_DECLARE(switch_status_t) switch_core_port_allocator_new(switch_port_t start,
 															   switch_port_t end, switch_port_flag_t flags, switch_core_port_allocator_t **new_allocator)
 {
@@ -54,6 +159,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_port_allocator_new(switch_port_t sta
 	switch_memory_pool_t *pool;
 	switch_core_port_allocator_t *alloc;
 	int even, odd;
+	uint32_t x;
 
 	if ((status = switch_core_new_memory_pool(&pool)) != SWITCH_STATUS_SUCCESS) {
 		return status;
@@ -90,18 +196,31 @@ SWITCH_DECLARE(switch_status_t) switch_core_port_allocator_new(switch_port_t sta
 		}
 	}
 
-	alloc->track_len = (end - start) + 2;
-
-	if (!(even && odd)) {
-		alloc->track_len /= 2;
+	if (end < start) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "Invalid port range %d-%d\n", start, end);
+		switch_core_destroy_memory_pool(&pool);
+		return SWITCH_STATUS_FALSE;
 	}
 
-	alloc->track = switch_core_alloc(pool, (alloc->track_len + 2) * sizeof(switch_byte_t));
+	/* unless both are allowed, every other port is skipped so the one above stays free for RTCP */
+	alloc->stride = (even && odd) ? 1 : 2;
+	alloc->track_len = ((end - start) / alloc->stride) + 1;
+	alloc->map_len = (alloc->track_len + 31) / 32;
+	alloc->summary_len = (alloc->map_len + 31) / 32;
+
+	alloc->track = switch_core_alloc(pool, alloc->track_len * sizeof(*alloc->track));
+	alloc->map = switch_core_alloc(pool, alloc->map_len * sizeof(*alloc->map));
+	alloc->summary = switch_core_alloc(pool, alloc->summary_len * sizeof(*alloc->summary));
+	alloc->q_slot = switch_core_alloc(pool, alloc->track_len * sizeof(*alloc->q_slot));
+	alloc->q_time = switch_core_alloc(pool, alloc->track_len * sizeof(*alloc->q_time));
+
+	for (x = 0; x < alloc->track_len; x++) {
+		slot_set_free(alloc, x);
+	}
 
 	alloc->start = start;
-	alloc->next = start;
 	alloc->end = end;
-
+	alloc->cursor = (uint32_t) (switch_micro_time_now() % alloc->map_len);
 
 	switch_mutex_init(&alloc->mutex, SWITCH_MUTEX_NESTED, pool);
 	alloc->pool = pool;
@@ -114,75 +233,63 @@ SWITCH_DECLARE(switch_status_t) switch_core_port_allocator_request_port(switch_c
 {
 	switch_port_t port = 0;
 	switch_status_t status = SWITCH_STATUS_FALSE;
-	int even = switch_test_flag(alloc, SPF_EVEN);
-	int odd = switch_test_flag(alloc, SPF_ODD);
+	int w;
 
 	switch_mutex_lock(alloc->mutex);
-	srand((unsigned) ((unsigned) (intptr_t) port_ptr + (unsigned) (intptr_t) switch_thread_self() + switch_micro_time_now()));
 
-	while (alloc->track_used < alloc->track_len) {
-		uint32_t index;
-		uint32_t tries = 0;
-
-		/* randomly pick a port */
-		index = rand() % alloc->track_len;
-
-		/* if it is used walk up the list to find a free one */
-		while (alloc->track[index] && tries < alloc->track_len) {
-			tries++;
-			if (alloc->track[index] < 0) {
-				alloc->track[index]++;
-			}
-			if (++index >= alloc->track_len) {
-				index = 0;
-			}
-		}
-
-		if (tries < alloc->track_len) {
-			alloc->track[index] = 1;
-			alloc->track_used++;
-			status = SWITCH_STATUS_SUCCESS;
-
-			if ((even && odd)) {
-				port = (switch_port_t) (index + alloc->start);
-			} else {
-				port = (switch_port_t) (index + (alloc->start / 2));
-				port *= 2;
-			}
-			goto end;
-		}
+	if (alloc->q_count) {
+		release_quarantine(alloc, switch_micro_time_now() / 1000, SWITCH_FALSE);
 	}
 
+	/* running dry is better than failing the call, so take back the port that has rested longest */
+	if ((w = find_free_word(alloc)) < 0 && alloc->q_count) {
+		release_quarantine(alloc, 0, SWITCH_TRUE);
+		w = find_free_word(alloc);
+	}
 
-  end:
+	if (w >= 0) {
+		uint32_t index = ((uint32_t) w << 5) + lowest_bit(alloc->map[w]);
 
-	switch_mutex_unlock(alloc->mutex);
+		slot_take(alloc, index);
+		alloc->track[index] = PORT_USED;
+		if (++alloc->track_used > alloc->high_water) {
+			alloc->high_water = alloc->track_used;
+		}
+		/* rotate through the range rather than handing the same low ports out again */
+		alloc->cursor = (uint32_t) w + 1;
 
-	if (status == SWITCH_STATUS_SUCCESS) {
-		*port_ptr = port;
+		port = (switch_port_t) (alloc->start + index * alloc->stride);
+		status = SWITCH_STATUS_SUCCESS;
 	} else {
-		*port_ptr = 0;
+		alloc->failed++;
 	}
 
+	switch_mutex_unlock(alloc->mutex);
 
-	return status;
+	*port_ptr = port;
 
+	return status;
 }
 
 SWITCH_DECLARE(switch_status_t) switch_core_port_allocator_free_port(switch_core_port_allocator_t *alloc, switch_port_t port)
 {
 	switch_status_t status = SWITCH_STATUS_FALSE;
-	int even = switch_test_flag(alloc, SPF_EVEN);
-	int odd = switch_test_flag(alloc, SPF_ODD);
-	int index = port - alloc->start;
+	uint32_t index;
 
-	if (!(even && odd)) {
-		index /= 2;
+	if (port < alloc->start || port > alloc->end || (port - alloc->start) % alloc->stride) {
+		return status;
 	}
 
+	index = (port - alloc->start) / alloc->stride;
+
 	switch_mutex_lock(alloc->mutex);
-	if (alloc->track[index] > 0) {
-		alloc->track[index] = -4;
+	if (alloc->track[index] == PORT_USED) {
+		uint32_t tail = (alloc->q_head + alloc->q_count) % alloc->track_len;
+
+		alloc->track[index] = PORT_QUARANTINE;
+		alloc->q_slot[tail] = index;
+		alloc->q_time[tail] = switch_micro_time_now() / 1000;
+		alloc->q_count++;
 		alloc->track_used--;
 		status = SWITCH_STATUS_SUCCESS;
 	}
@@ -191,6 +298,19 @@ SWITCH_DECLARE(switch_status_t) switch_core_port_allocator_free_port(switch_core
 	return status;
 }
 
+SWITCH_DECLARE(void) switch_core_port_allocator_stats(switch_core_port_allocator_t *alloc, switch_core_port_allocator_stats_t *stats)
+{
+	switch_mutex_lock(alloc->mutex);
+	stats->start = alloc->start;
+	stats->end = alloc->end;
+	stats->total = alloc->track_len;
+	stats->used = alloc->track_used;
+	stats->high_water = alloc->high_water;
+	stats->quarantined = alloc->q_count;
+	stats->failed = alloc->failed;
+	switch_mutex_unlock(alloc->mutex);
+}
+
 SWITCH_DECLARE(void) switch_core_port_allocator_destroy(switch_core_port_allocator_t **alloc)
 {
 	switch_memory_pool_t *pool = (*alloc)->pool;
@@ -1309,14 +1309,224 @@ static void *SWITCH_THREAD_FUNC switch_core_session_thread(switch_thread_t *thre
 	return NULL;
 }
 
-SWITCH_DECLARE(switch_status_t) switch_core_session_thread_launch(switch_core_session_t *session)
+#define SESSION_THREAD_POOL_QUEUE_LEN 10000
+
+typedef struct {
+	switch_thread_start_t func;
+	void *obj;
+} session_thread_job_t;
+
+typedef struct {
+	switch_memory_pool_t *pool;
+	session_thread_job_t *job;
+} session_thread_worker_t;
+
+/* Pooled threads run one job after another.  A launcher only queues a job after reserving an idle thread
+   (thread_pool_idle--) under the pool mutex so every queued job already has a thread waiting for it.
+   Whenever the queue is empty under the mutex thread_pool_idle is exactly the number of waiting threads. */
+static void *SWITCH_THREAD_FUNC session_thread_pool_worker(switch_thread_t *thread, void *obj)
 {
-	switch_status_t status = SWITCH_STATUS_FALSE;
+	session_thread_worker_t *worker = obj;
+	session_thread_job_t *job = worker->job;
+	switch_memory_pool_t *pool = worker->pool;
+	void *pop;
+
+	for (;;) {
+		if (job) {
+			job->func(thread, job->obj);
+			free(job);
+			job = NULL;
+		}
+
+		switch_mutex_lock(session_manager.thread_pool_mutex);
+		if (!session_manager.thread_pool_running) {
+			session_manager.thread_pool_threads--;
+			switch_mutex_unlock(session_manager.thread_pool_mutex);
+			break;
+		}
+		session_manager.thread_pool_idle++;
+		switch_mutex_unlock(session_manager.thread_pool_mutex);
+
+		for (;;) {
+			pop = NULL;
+
+			if (switch_queue_pop_timeout(session_manager.thread_pool_queue, &pop,
+										 (switch_interval_time_t) session_manager.thread_pool_idle_timeout * 1000000) == SWITCH_STATUS_SUCCESS) {
+				break;
+			}
+
+			switch_mutex_lock(session_manager.thread_pool_mutex);
+			if (switch_queue_trypop(session_manager.thread_pool_queue, &pop) == SWITCH_STATUS_SUCCESS) {
+				switch_mutex_unlock(session_manager.thread_pool_mutex);
+				break;
+			}
+
+			if (session_manager.thread_pool_threads > session_manager.thread_pool_min) {
+				session_manager.thread_pool_idle--;
+				session_manager.thread_pool_threads--;
+				switch_mutex_unlock(session_manager.thread_pool_mutex);
+				goto done;
+			}
+			switch_mutex_unlock(session_manager.thread_pool_mutex);
+		}
+
+		if (!(job = (session_thread_job_t *) pop)) {
+			/* woken up by switch_core_session_thread_pool_stop */
+			switch_mutex_lock(session_manager.thread_pool_mutex);
+			session_manager.thread_pool_threads--;
+			switch_mutex_unlock(session_manager.thread_pool_mutex);
+			break;
+		}
+	}
+
+ done:
+
+	switch_core_destroy_memory_pool(&pool);
+	return NULL;
+}
+
+static switch_status_t session_thread_pool_spawn(session_thread_job_t *job)
+{
+	switch_memory_pool_t *pool = NULL;
+	session_thread_worker_t *worker;
 	switch_thread_t *thread;
-	switch_threadattr_t *thd_attr;;
+	switch_threadattr_t *thd_attr = NULL;
+
+	if (switch_core_new_memory_pool(&pool) != SWITCH_STATUS_SUCCESS) {
+		return SWITCH_STATUS_MEMERR;
+	}
 
-	switch_threadattr_create(&thd_attr, session->pool);
+	worker = switch_core_alloc(pool, sizeof(*worker));
+	worker->pool = pool;
+	worker->job = job;
+
+	switch_threadattr_create(&thd_attr, pool);
 	switch_threadattr_detach_set(thd_attr, 1);
+	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+
+	if (switch_thread_create(&thread, thd_attr, session_thread_pool_worker, worker, pool) != SWITCH_STATUS_SUCCESS) {
+		switch_core_destroy_memory_pool(&pool);
+		return SWITCH_STATUS_FALSE;
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_core_session_thread_pool_launch(switch_thread_start_t func, void *obj, switch_memory_pool_t *pool)
+{
+	session_thread_job_t *job;
+	switch_thread_t *thread;
+	switch_threadattr_t *thd_attr = NULL;
+	uint32_t busy;
+	int spawn = 0;
+
+	switch_zmalloc(job, sizeof(*job));
+	job->func = func;
+	job->obj = obj;
+
+	switch_mutex_lock(session_manager.thread_pool_mutex);
+	if (session_manager.thread_pool_running) {
+		if (session_manager.thread_pool_idle && switch_queue_trypush(session_manager.thread_pool_queue, job) == SWITCH_STATUS_SUCCESS) {
+			session_manager.thread_pool_idle--;
+			session_manager.thread_pool_jobs++;
+			job = NULL;
+		} else if (session_manager.thread_pool_threads < session_manager.thread_pool_max) {
+			session_manager.thread_pool_threads++;
+			session_manager.thread_pool_created++;
+			session_manager.thread_pool_jobs++;
+			spawn = 1;
+		} else {
+			session_manager.thread_pool_overflow++;
+		}
+
+		busy = session_manager.thread_pool_threads - session_manager.thread_pool_idle;
+		if (busy > session_manager.thread_pool_peak) {
+			session_manager.thread_pool_peak = busy;
+		}
+	}
+	switch_mutex_unlock(session_manager.thread_pool_mutex);
+
+	if (!job) {
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	if (spawn) {
+		if (session_thread_pool_spawn(job) == SWITCH_STATUS_SUCCESS) {
+			return SWITCH_STATUS_SUCCESS;
+		}
+
+		switch_mutex_lock(session_manager.thread_pool_mutex);
+		session_manager.thread_pool_threads--;
+		session_manager.thread_pool_jobs--;
+		switch_mutex_unlock(session_manager.thread_pool_mutex);
+	}
+
+	free(job);
+
+	/* the pool is saturated or stopped, fall back to a thread of our own */
+	switch_threadattr_create(&thd_attr, pool);
+	switch_threadattr_detach_set(thd_attr, 1);
+	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+
+	return switch_thread_create(&thread, thd_attr, func, obj, pool);
+}
+
+SWITCH_DECLARE(void) switch_core_session_thread_pool_stats(switch_core_session_thread_pool_stats_t *stats)
+{
+	switch_mutex_lock(session_manager.thread_pool_mutex);
+	stats->min = session_manager.thread_pool_min;
+	stats->max = session_manager.thread_pool_max;
+	stats->idle_timeout = session_manager.thread_pool_idle_timeout;
+	stats->threads = session_manager.thread_pool_threads;
+	stats->idle = session_manager.thread_pool_idle;
+	stats->peak = session_manager.thread_pool_peak;
+	stats->jobs = session_manager.thread_pool_jobs;
+	stats->created = session_manager.thread_pool_created;
+	stats->overflow = session_manager.thread_pool_overflow;
+	switch_mutex_unlock(session_manager.thread_pool_mutex);
+}
+
+void switch_core_session_thread_pool_start(void)
+{
+	uint32_t need = 0;
+
+	switch_mutex_lock(session_manager.thread_pool_mutex);
+	session_manager.thread_pool_running = 1;
+	if (session_manager.thread_pool_min > session_manager.thread_pool_threads) {
+		need = session_manager.thread_pool_min - session_manager.thread_pool_threads;
+		session_manager.thread_pool_threads += need;
+		session_manager.thread_pool_created += need;
+	}
+	switch_mutex_unlock(session_manager.thread_pool_mutex);
+
+	while (need) {
+		if (session_thread_pool_spawn(NULL) != SWITCH_STATUS_SUCCESS) {
+			switch_mutex_lock(session_manager.thread_pool_mutex);
+			session_manager.thread_pool_threads -= need;
+			switch_mutex_unlock(session_manager.thread_pool_mutex);
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "Cannot create session pool thread!\n");
+			break;
+		}
+		need--;
+	}
+}
+
+void switch_core_session_thread_pool_stop(void)
+{
+	switch_mutex_lock(session_manager.thread_pool_mutex);
+	session_manager.thread_pool_running = 0;
+	while (session_manager.thread_pool_idle) {
+		if (switch_queue_trypush(session_manager.thread_pool_queue, NULL) != SWITCH_STATUS_SUCCESS) {
+			break;
+		}
+		session_manager.thread_pool_idle--;
+	}
+	switch_mutex_unlock(session_manager.thread_pool_mutex);
+}
+
+SWITCH_DECLARE(switch_status_t) switch_core_session_thread_launch(switch_core_session_t *session)
+{
+	switch_status_t status = SWITCH_STATUS_FALSE;
 
 	if (switch_test_flag(session, SSF_THREAD_RUNNING) || switch_test_flag(session, SSF_THREAD_STARTED)) {
 		goto end;
@@ -1331,8 +1541,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_thread_launch(switch_core_se
 	} else {
 		switch_set_flag(session, SSF_THREAD_RUNNING);
 		switch_set_flag(session, SSF_THREAD_STARTED);
-		switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
-		if (switch_thread_create(&thread, thd_attr, switch_core_session_thread, session, session->pool) == SWITCH_STATUS_SUCCESS) {
+		if (switch_core_session_thread_pool_launch(switch_core_session_thread, session, session->pool) == SWITCH_STATUS_SUCCESS) {
 			switch_set_flag(session, SSF_THREAD_STARTED);
 			status = SWITCH_STATUS_SUCCESS;
 		} else {
@@ -1351,14 +1560,7 @@ SWITCH_DECLARE(switch_status_t) switch_core_session_thread_launch(switch_core_se
 
 SWITCH_DECLARE(void) switch_core_session_launch_thread(switch_core_session_t *session, switch_thread_start_t func, void *obj)
 {
-	switch_thread_t *thread;
-	switch_threadattr_t *thd_attr = NULL;
-	switch_threadattr_create(&thd_attr, session->pool);
-	switch_threadattr_detach_set(thd_attr, 1);
-
-	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
-	switch_thread_create(&thread, thd_attr, func, obj, session->pool);
-
+	switch_core_session_thread_pool_launch(func, obj, session->pool);
 }
 
 SWITCH_DECLARE(switch_status_t) switch_core_session_set_uuid(switch_core_session_t *session, const char *use_uuid)
@@ -1825,6 +2027,11 @@ void switch_core_session_init(switch_memory_pool_t *pool)
 	session_manager.session_id = 1;
 	session_manager.memory_pool = pool;
 	switch_core_hash_init(&session_manager.session_table, session_manager.memory_pool);
+	session_manager.thread_pool_min = 16;
+	session_manager.thread_pool_max = 4096;
+	session_manager.thread_pool_idle_timeout = 60;
+	switch_mutex_init(&session_manager.thread_pool_mutex, SWITCH_MUTEX_NESTED, session_manager.memory_pool);
+	switch_queue_create(&session_manager.thread_pool_queue, SESSION_THREAD_POOL_QUEUE_LEN, session_manager.memory_pool);
 }
 
 void switch_core_session_uninit(void)
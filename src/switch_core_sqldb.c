@@ -53,6 +53,78 @@ struct switch_cache_db_handle {
 	struct switch_cache_db_handle *next;
 };
 
+/* Statements the core event handler issues often enough to be worth preparing once.
+   Jobs carrying one of these ids hold bound args instead of a rendered string. */
+typedef enum {
+	SQL_STMT_RAW = 0,
+	SQL_STMT_CHANNEL_INSERT,
+	SQL_STMT_CHANNEL_DELETE,
+	SQL_STMT_CHANNEL_STATE,
+	SQL_STMT_CHANNEL_CALLSTATE,
+	SQL_STMT_CHANNEL_ROUTING,
+	SQL_STMT_CHANNEL_CODEC,
+	SQL_STMT_CHANNEL_APP,
+	SQL_STMT_CHANNEL_ORIGINATE,
+	SQL_STMT_CHANNEL_CALLEE,
+	SQL_STMT_CHANNEL_CALL_UUID,
+	SQL_STMT_CALLS_INSERT,
+	SQL_STMT_CALLS_DELETE,
+	SQL_STMT_MAX
+} sql_stmt_id_t;
+
+#define SQL_STMT_MAX_ARGS 16
+
+static const struct {
+	const char *sql;
+	const char *alt_sql;		/* used instead of sql when the odbc dbtype is not the default */
+	int argc;
+	int queue;
+} sql_stmts[SQL_STMT_MAX] = {
+	/* SQL_STMT_RAW */
+	{ NULL, NULL, 0, 0 },
+	/* SQL_STMT_CHANNEL_INSERT */
+	{ "insert into channels (uuid,direction,created,created_epoch,name,state,callstate,dialplan,context,hostname) "
+	  "values(?,?,?,?,?,?,?,?,?,?)", NULL, 10, 0 },
+	/* SQL_STMT_CHANNEL_DELETE */
+	{ "delete from channels where uuid=? and hostname=?", NULL, 2, 1 },
+	/* SQL_STMT_CHANNEL_STATE */
+	{ "update channels set state=? where uuid=? and hostname=?", NULL, 3, 1 },
+	/* SQL_STMT_CHANNEL_CALLSTATE */
+	{ "update channels set callstate=? where uuid=? and hostname=?", NULL, 3, 1 },
+	/* SQL_STMT_CHANNEL_ROUTING */
+	{ "update channels set state=?,cid_name=?,cid_num=?,ip_addr=?,dest=?,dialplan=?,context=?,presence_id=?,presence_data=? "
+	  "where uuid=? and hostname=?", NULL, 11, 1 },
+	/* SQL_STMT_CHANNEL_CODEC */
+	{ "update channels set read_codec=?,read_rate=?,read_bit_rate=?,write_codec=?,write_rate=?,write_bit_rate=? "
+	  "where uuid=? and hostname=?", NULL, 8, 1 },
+	/* SQL_STMT_CHANNEL_APP */
+	{ "update channels set application=?,application_data=?,presence_id=?,presence_data=? where uuid=? and hostname=?", NULL, 6, 1 },
+	/* SQL_STMT_CHANNEL_ORIGINATE */
+	{ "update channels set presence_id=?,presence_data=?,call_uuid=? where uuid=? and hostname=?", NULL, 5, 1 },
+	/* SQL_STMT_CHANNEL_CALLEE */
+	{ "update channels set state=?,callstate=?,callee_name=?,callee_num=?,callee_direction=? where uuid=? and hostname=?", NULL, 7, 1 },
+	/* SQL_STMT_CHANNEL_CALL_UUID */
+	{ "update channels set call_uuid=? where uuid=? and hostname=?", NULL, 3, 1 },
+	/* SQL_STMT_CALLS_INSERT */
+	{ "insert into calls (call_uuid,call_created,call_created_epoch,function,caller_cid_name,"
+	  "caller_cid_num,caller_dest_num,caller_chan_name,caller_uuid,callee_cid_name,"
+	  "callee_cid_num,callee_dest_num,callee_chan_name,callee_uuid,hostname) "
+	  "values (?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)",
+	  "insert into calls (call_uuid,call_created,call_created_epoch,call_function,caller_cid_name,"
+	  "caller_cid_num,caller_dest_num,caller_chan_name,caller_uuid,callee_cid_name,"
+	  "callee_cid_num,callee_dest_num,callee_chan_name,callee_uuid,hostname) "
+	  "values (?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)", 15, 0 },
+	/* SQL_STMT_CALLS_DELETE */
+	{ "delete from calls where (caller_uuid=? or callee_uuid=?) and hostname=?", NULL, 3, 0 }
+};
+
+typedef struct {
+	sql_stmt_id_t id;
+	switch_size_t len;
+	char *sql;
+	const char *args[SQL_STMT_MAX_ARGS];
+} sql_job_t;
+
 static struct {
 	switch_cache_db_handle_t *event_db;
 	switch_queue_t *sql_queue[2];
@@ -70,6 +142,13 @@ static struct {
 	switch_mutex_t *cond_mutex;
 	uint32_t total_handles;
 	uint32_t total_used_handles;
+	switch_core_db_stmt_t *stmts[SQL_STMT_MAX];
+	uint64_t rows;
+	uint32_t rows_per_sec;
+	uint32_t rate_rows;
+	switch_time_t rate_start;
+	uint32_t queue_peak;
+	uint32_t prepared;
 } sql_manager;
 
 
@@ -699,21 +778,11 @@ SWITCH_DECLARE(switch_status_t) switch_cache_db_persistant_execute(switch_cache_
 }
 
 
-SWITCH_DECLARE(switch_status_t) switch_cache_db_persistant_execute_trans(switch_cache_db_handle_t *dbh, char *sql, uint32_t retries)
+static switch_status_t cache_db_begin_trans(switch_cache_db_handle_t *dbh)
 {
 	char *errmsg = NULL;
-	switch_status_t status = SWITCH_STATUS_FALSE;
-	uint8_t forever = 0;
 	unsigned begin_retries = 100;
 	uint8_t again = 0;
-	switch_mutex_t *io_mutex = dbh->io_mutex;
-
-	if (!retries) {
-		forever = 1;
-		retries = 1000;
-	}
-
-	if (io_mutex) switch_mutex_lock(io_mutex);
 
  again:
 
@@ -756,7 +825,7 @@ SWITCH_DECLARE(switch_status_t) switch_cache_db_persistant_execute_trans(switch_
 			switch_yield(100000);
 
 			if (begin_retries == 0) {
-				goto done;
+				return SWITCH_STATUS_FALSE;
 			}
 
 			continue;
@@ -765,6 +834,37 @@ SWITCH_DECLARE(switch_status_t) switch_cache_db_persistant_execute_trans(switch_
 		break;
 	}
 
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static void cache_db_end_trans(switch_cache_db_handle_t *dbh)
+{
+	if (runtime.odbc_dbtype == DBTYPE_DEFAULT) {
+		switch_cache_db_execute_sql_real(dbh, "COMMIT", NULL);
+	} else {
+		switch_odbc_SQLEndTran(dbh->native_handle.odbc_dbh, 1);
+		switch_odbc_SQLSetAutoCommitAttr(dbh->native_handle.odbc_dbh, 1);
+	}
+}
+
+SWITCH_DECLARE(switch_status_t) switch_cache_db_persistant_execute_trans(switch_cache_db_handle_t *dbh, char *sql, uint32_t retries)
+{
+	char *errmsg = NULL;
+	switch_status_t status = SWITCH_STATUS_FALSE;
+	uint8_t forever = 0;
+	switch_mutex_t *io_mutex = dbh->io_mutex;
+
+	if (!retries) {
+		forever = 1;
+		retries = 1000;
+	}
+
+	if (io_mutex) switch_mutex_lock(io_mutex);
+
+	if (cache_db_begin_trans(dbh) != SWITCH_STATUS_SUCCESS) {
+		goto done;
+	}
+
 	while (retries > 0) {
 
 		switch_cache_db_execute_sql(dbh, sql, &errmsg);
@@ -787,12 +887,7 @@ SWITCH_DECLARE(switch_status_t) switch_cache_db_persistant_execute_trans(switch_
 
  done:
 
-	if (runtime.odbc_dbtype == DBTYPE_DEFAULT) {
-		switch_cache_db_execute_sql_real(dbh, "COMMIT", NULL);
-	} else {
-		switch_odbc_SQLEndTran(dbh->native_handle.odbc_dbh, 1);
-		switch_odbc_SQLSetAutoCommitAttr(dbh->native_handle.odbc_dbh, 1);
-	}
+	cache_db_end_trans(dbh);
 
 	if (io_mutex) switch_mutex_unlock(io_mutex);
 
@@ -926,20 +1021,245 @@ static void *SWITCH_THREAD_FUNC switch_core_sql_db_thread(switch_thread_t *threa
 	return NULL;
 }
 
+static sql_job_t *sql_job_new(sql_stmt_id_t id, ...)
+{
+	const char *args[SQL_STMT_MAX_ARGS];
+	switch_size_t lens[SQL_STMT_MAX_ARGS];
+	switch_size_t total = 0;
+	sql_job_t *job;
+	char *p;
+	va_list ap;
+	int i, argc = sql_stmts[id].argc;
+
+	switch_assert(id > SQL_STMT_RAW && id < SQL_STMT_MAX && argc <= SQL_STMT_MAX_ARGS);
+
+	va_start(ap, id);
+	for (i = 0; i < argc; i++) {
+		args[i] = va_arg(ap, const char *);
+		if (!args[i]) {
+			args[i] = "";
+		}
+		lens[i] = strlen(args[i]) + 1;
+		total += lens[i];
+	}
+	va_end(ap);
+
+	switch_zmalloc(job, sizeof(*job) + total);
+	p = (char *) (job + 1);
+
+	for (i = 0; i < argc; i++) {
+		memcpy(p, args[i], lens[i]);
+		job->args[i] = p;
+		p += lens[i];
+	}
+
+	job->id = id;
+	job->len = strlen(sql_stmts[id].sql) + total * 2;
+
+	return job;
+}
+
+static sql_job_t *sql_job_raw(char *sql)
+{
+	sql_job_t *job;
+
+	switch_zmalloc(job, sizeof(*job));
+	job->id = SQL_STMT_RAW;
+	job->sql = sql;
+	job->len = strlen(sql) + 2;
+
+	return job;
+}
+
+static void sql_job_free(sql_job_t *job)
+{
+	if (job) {
+		switch_safe_free(job->sql);
+		free(job);
+	}
+}
+
+/* Expand a typed job into literal SQL for handles that cannot use the prepared statement cache. */
+static char *sql_job_render(sql_job_t *job)
+{
+	const char *tpl = sql_stmts[job->id].sql, *a;
+	char *buf, *p;
+	int i = 0;
+
+	if (runtime.odbc_dbtype != DBTYPE_DEFAULT && sql_stmts[job->id].alt_sql) {
+		tpl = sql_stmts[job->id].alt_sql;
+	}
+
+	switch_zmalloc(buf, strlen(tpl) + job->len + 1);
+	p = buf;
+
+	for (; *tpl; tpl++) {
+		if (*tpl != '?') {
+			*p++ = *tpl;
+			continue;
+		}
+
+		*p++ = '\'';
+		for (a = job->args[i++]; *a; a++) {
+			if (*a == '\'') {
+				*p++ = '\'';
+			}
+			*p++ = *a;
+		}
+		*p++ = '\'';
+	}
+
+	return buf;
+}
+
+static switch_status_t sql_exec_job(switch_cache_db_handle_t *dbh, sql_job_t *job)
+{
+	switch_core_db_stmt_t *stmt;
+	char *errmsg = NULL, *sql;
+	int i, r;
+
+	if (dbh->type != SCDB_TYPE_CORE_DB) {
+		sql = sql_job_render(job);
+		switch_cache_db_execute_sql_real(dbh, sql, &errmsg);
+		free(sql);
+
+		if (errmsg) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "SQL ERR [%s]\n", errmsg);
+			free(errmsg);
+			return SWITCH_STATUS_FALSE;
+		}
+
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	if (!(stmt = sql_manager.stmts[job->id])) {
+		if (switch_core_db_prepare(dbh->native_handle.core_db_dbh, sql_stmts[job->id].sql, -1, &stmt, NULL) != SWITCH_CORE_DB_OK) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "SQL ERR [%s] preparing [%s]\n",
+							  switch_core_db_errmsg(dbh->native_handle.core_db_dbh), sql_stmts[job->id].sql);
+			return SWITCH_STATUS_FALSE;
+		}
+		sql_manager.stmts[job->id] = stmt;
+		sql_manager.prepared++;
+	}
+
+	for (i = 0; i < sql_stmts[job->id].argc; i++) {
+		switch_core_db_bind_text(stmt, i + 1, job->args[i], -1, SWITCH_CORE_DB_STATIC);
+	}
+
+	r = switch_core_db_step(stmt);
+	switch_core_db_reset(stmt);
+
+	if (r != SWITCH_CORE_DB_DONE) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "SQL ERR [%s]\n", switch_core_db_errmsg(dbh->native_handle.core_db_dbh));
+		/* drop it so a schema change gets a fresh prepare next time around */
+		switch_core_db_finalize(stmt);
+		sql_manager.stmts[job->id] = NULL;
+		sql_manager.prepared--;
+		return SWITCH_STATUS_FALSE;
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static void sql_flush_text(switch_cache_db_handle_t *dbh, char *sqlbuf, switch_size_t *len)
+{
+	char *errmsg = NULL;
+
+	if (!*len) {
+		return;
+	}
+
+	switch_cache_db_execute_sql_real(dbh, sqlbuf, &errmsg);
+
+	if (errmsg) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "SQL ERR [%s]\n", errmsg);
+		free(errmsg);
+	}
+
+	*len = 0;
+	*sqlbuf = '\0';
+}
+
+/* Run one batch of queued jobs inside a single transaction.  Consecutive raw
+   statements are still glued into one blob, typed ones go through the statement cache. */
+static switch_status_t sql_run_batch(switch_cache_db_handle_t *dbh, sql_job_t **batch, uint32_t count, char **sqlbuf, switch_size_t *sql_len)
+{
+	switch_mutex_t *io_mutex = dbh->io_mutex;
+	switch_status_t status = SWITCH_STATUS_SUCCESS;
+	switch_size_t len = 0;
+	switch_time_t now;
+	char *tmp;
+	uint32_t i;
+
+	if (io_mutex) switch_mutex_lock(io_mutex);
+
+	if (cache_db_begin_trans(dbh) != SWITCH_STATUS_SUCCESS) {
+		status = SWITCH_STATUS_FALSE;
+		goto done;
+	}
+
+	for (i = 0; i < count; i++) {
+		sql_job_t *job = batch[i];
+
+		if (job->id != SQL_STMT_RAW) {
+			sql_flush_text(dbh, *sqlbuf, &len);
+			sql_exec_job(dbh, job);
+			continue;
+		}
+
+		if (len + job->len + 1 > *sql_len) {
+			*sql_len = len + job->len + 10240;
+			if (!(tmp = realloc(*sqlbuf, *sql_len))) {
+				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "SQL thread ending on mem err\n");
+				abort();
+			}
+			*sqlbuf = tmp;
+		}
+
+		sprintf(*sqlbuf + len, "%s;\n", job->sql);
+		len += job->len;
+	}
+
+	sql_flush_text(dbh, *sqlbuf, &len);
+
+ done:
+
+	cache_db_end_trans(dbh);
+
+	if (io_mutex) switch_mutex_unlock(io_mutex);
+
+	if (status == SWITCH_STATUS_SUCCESS) {
+		now = switch_micro_time_now();
+		sql_manager.rows += count;
+		sql_manager.rate_rows += count;
+
+		if (!sql_manager.rate_start) {
+			sql_manager.rate_start = now;
+		} else if (now - sql_manager.rate_start >= 1000000) {
+			sql_manager.rows_per_sec = (uint32_t) (((uint64_t) sql_manager.rate_rows * 1000000) / (now - sql_manager.rate_start));
+			sql_manager.rate_rows = 0;
+			sql_manager.rate_start = now;
+		}
+	}
+
+	return status;
+}
+
 static void *SWITCH_THREAD_FUNC switch_core_sql_thread(switch_thread_t *thread, void *obj)
 {
 	void *pop = NULL;
 	uint32_t iterations = 0;
-	uint8_t trans = 0;
 	uint32_t target = 20000;
 	switch_size_t len = 0, sql_len = runtime.sql_buffer_len;
-	char *tmp, *sqlbuf = (char *) malloc(sql_len);
-	char *sql = NULL, *save_sql = NULL;
-	switch_size_t newlen;
+	char *sqlbuf = (char *) malloc(sql_len);
+	sql_job_t **batch = (sql_job_t **) malloc(sizeof(*batch) * target);
+	sql_job_t *job = NULL, *save_job = NULL;
 	int lc = 0, wrote = 0, do_sleep = 1;
 	uint32_t sanity = 120;
+	int i;
 	
 	switch_assert(sqlbuf);
+	switch_assert(batch);
 
 	while (!sql_manager.event_db) {
 		if (switch_core_db_handle(&sql_manager.event_db) == SWITCH_STATUS_SUCCESS && sql_manager.event_db)
@@ -951,6 +1271,8 @@ static void *SWITCH_THREAD_FUNC switch_core_sql_thread(switch_thread_t *thread,
 
 	if (!sql_manager.event_db) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "Error getting core db Disabling core sql functionality\n");
+		free(sqlbuf);
+		free(batch);
 		return NULL;
 	}
 
@@ -959,56 +1281,31 @@ static void *SWITCH_THREAD_FUNC switch_core_sql_thread(switch_thread_t *thread,
 	switch_mutex_lock(sql_manager.cond_mutex);
 
 	while (sql_manager.thread_running == 1) {
-		if (save_sql || switch_queue_trypop(sql_manager.sql_queue[0], &pop) == SWITCH_STATUS_SUCCESS ||
+		if (save_job || switch_queue_trypop(sql_manager.sql_queue[0], &pop) == SWITCH_STATUS_SUCCESS ||
 			switch_queue_trypop(sql_manager.sql_queue[1], &pop) == SWITCH_STATUS_SUCCESS) {
 
-			if (save_sql) {
-				sql = save_sql;
-				save_sql = NULL;
-			} else if ((sql = (char *) pop)) {
+			if (save_job) {
+				job = save_job;
+				save_job = NULL;
+			} else if ((job = (sql_job_t *) pop)) {
 				pop = NULL;
 			}
 			
-			if (sql) {
-				newlen = strlen(sql) + 2;
-
-				if (iterations == 0) {
-					trans = 1;
-				}
-
-				if (len + newlen > sql_len) {
-					int new_mlen = len + newlen + 10240;
-					
-					if (new_mlen < runtime.max_sql_buffer_len) {
-						sql_len = new_mlen;
+			if (job) {
+				if (iterations && len + job->len > (switch_size_t) runtime.max_sql_buffer_len) {
 #ifdef DEBUG_SQL
-						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, 
-										  "REALLOC %ld %d %d\n", (long int)sql_len, switch_queue_size(sql_manager.sql_queue[0]), 
-										  switch_queue_size(sql_manager.sql_queue[1]));
+					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, 
+									  "SAVE %d %d\n", switch_queue_size(sql_manager.sql_queue[0]), switch_queue_size(sql_manager.sql_queue[1]));
 #endif
-						if (!(tmp = realloc(sqlbuf, sql_len))) {
-							switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "SQL thread ending on mem err\n");
-							abort();
-							break;
-						}
-						sqlbuf = tmp;
-					} else {
-#ifdef DEBUG_SQL
-						switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, 
-										  "SAVE %d %d\n", switch_queue_size(sql_manager.sql_queue[0]), switch_queue_size(sql_manager.sql_queue[1]));
-#endif
-						save_sql = sql;
-						sql = NULL;
-						lc = 0;
-						goto skip;
-					}
+					save_job = job;
+					job = NULL;
+					lc = 0;
+					goto skip;
 				}
 
-				iterations++;				
-				sprintf(sqlbuf + len, "%s;\n", sql);
-				len += newlen;
-				free(sql);
-				sql = NULL;
+				batch[iterations++] = job;
+				len += job->len;
+				job = NULL;
 			} else {
 				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "SQL thread ending\n");
 				break;
@@ -1017,25 +1314,30 @@ static void *SWITCH_THREAD_FUNC switch_core_sql_thread(switch_thread_t *thread,
 
 		lc = switch_queue_size(sql_manager.sql_queue[0]) + switch_queue_size(sql_manager.sql_queue[1]);
 
+		if ((uint32_t) lc > sql_manager.queue_peak) {
+			sql_manager.queue_peak = lc;
+		}
+
 	skip:
 		
 		wrote = 0;
 
-		if (trans && iterations && (iterations > target || !lc)) {
+		if (iterations && (iterations >= target || !lc)) {
 #ifdef DEBUG_SQL
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, 
 							  "RUN %d %d %d\n", switch_queue_size(sql_manager.sql_queue[0]), switch_queue_size(sql_manager.sql_queue[1]), iterations);
 #endif
-			if (switch_cache_db_persistant_execute_trans(sql_manager.event_db, sqlbuf, 1) != SWITCH_STATUS_SUCCESS) {
+			if (sql_run_batch(sql_manager.event_db, batch, iterations, &sqlbuf, &sql_len) != SWITCH_STATUS_SUCCESS) {
 				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "SQL thread unable to commit transaction, records lost!\n");
 			}
 #ifdef DEBUG_SQL
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CRIT, "DONE\n");
 #endif
+			for (i = 0; i < (int) iterations; i++) {
+				sql_job_free(batch[i]);
+			}
 			iterations = 0;
-			trans = 0;
 			len = 0;
-			*sqlbuf = '\0';
 			lc = 0;
 			if (do_sleep) {
 				switch_yield(200000);
@@ -1060,15 +1362,34 @@ static void *SWITCH_THREAD_FUNC switch_core_sql_thread(switch_thread_t *thread,
 
 	switch_mutex_unlock(sql_manager.cond_mutex);
 
+	if (iterations) {
+		sql_run_batch(sql_manager.event_db, batch, iterations, &sqlbuf, &sql_len);
+	}
+
+	for (i = 0; i < (int) iterations; i++) {
+		sql_job_free(batch[i]);
+	}
+
+	sql_job_free(save_job);
+
 	while (switch_queue_trypop(sql_manager.sql_queue[0], &pop) == SWITCH_STATUS_SUCCESS) {
-		free(pop);
+		sql_job_free((sql_job_t *) pop);
 	}
 
 	while (switch_queue_trypop(sql_manager.sql_queue[1], &pop) == SWITCH_STATUS_SUCCESS) {
-		free(pop);
+		sql_job_free((sql_job_t *) pop);
 	}
 
+	for (i = 0; i < SQL_STMT_MAX; i++) {
+		if (sql_manager.stmts[i]) {
+			switch_core_db_finalize(sql_manager.stmts[i]);
+			sql_manager.stmts[i] = NULL;
+		}
+	}
+	sql_manager.prepared = 0;
+
 	free(sqlbuf);
+	free(batch);
 
 	sql_manager.thread_running = 0;
 
@@ -1118,12 +1439,15 @@ static char *parse_presence_data_cols(switch_event_t *event)
 
 #define MAX_SQL 5
 #define new_sql() switch_assert(sql_idx+1 < MAX_SQL); sql[sql_idx++]
+#define new_job() switch_assert(sql_idx+1 < MAX_SQL); job[sql_idx++]
 
 static void core_event_handler(switch_event_t *event)
 {
 	char *sql[MAX_SQL] = { 0 };
+	sql_job_t *job[MAX_SQL] = { 0 };
 	int sql_idx = 0;
 	char *extra_cols;
+	char epoch[32];
 
 	switch_assert(event);
 
@@ -1165,11 +1489,8 @@ static void core_event_handler(switch_event_t *event)
 			const char *uuid = switch_event_get_header(event, "unique-id");
 			
 			if (uuid) {
-				new_sql() = switch_mprintf("delete from channels where uuid='%q' and hostname='%q'",
-										   uuid, switch_core_get_hostname());
-
-				new_sql() = switch_mprintf("delete from calls where (caller_uuid='%q' or callee_uuid='%q') and hostname='%q'",
-										   uuid, uuid, switch_core_get_hostname());
+				new_job() = sql_job_new(SQL_STMT_CHANNEL_DELETE, uuid, switch_core_get_hostname());
+				new_job() = sql_job_new(SQL_STMT_CALLS_DELETE, uuid, uuid, switch_core_get_hostname());
 
 			}
 		}
@@ -1191,12 +1512,12 @@ static void core_event_handler(switch_event_t *event)
 			break;
 		}
 	case SWITCH_EVENT_CHANNEL_CREATE:
-		new_sql() = switch_mprintf("insert into channels (uuid,direction,created,created_epoch, name,state,callstate,dialplan,context,hostname) "
-								   "values('%q','%q','%q','%ld','%q','%q','%q','%q','%q','%q')",
+		switch_snprintf(epoch, sizeof(epoch), "%ld", (long) switch_epoch_time_now(NULL));
+		new_job() = sql_job_new(SQL_STMT_CHANNEL_INSERT,
 								   switch_event_get_header_nil(event, "unique-id"),
 								   switch_event_get_header_nil(event, "call-direction"),
 								   switch_event_get_header_nil(event, "event-date-local"),
-								   (long) switch_epoch_time_now(NULL),
+								   epoch,
 								   switch_event_get_header_nil(event, "channel-name"),
 								   switch_event_get_header_nil(event, "channel-state"),
 								   switch_event_get_header_nil(event, "channel-call-state"),
@@ -1205,9 +1526,9 @@ static void core_event_handler(switch_event_t *event)
 								   );
 		break;
 	case SWITCH_EVENT_CODEC:
-		new_sql() =
-			switch_mprintf
-			("update channels set read_codec='%q',read_rate='%q',read_bit_rate='%q',write_codec='%q',write_rate='%q',write_bit_rate='%q' where uuid='%q' and hostname='%q'",
+		new_job() =
+			sql_job_new
+			(SQL_STMT_CHANNEL_CODEC,
 			 switch_event_get_header_nil(event, "channel-read-codec-name"),
 			 switch_event_get_header_nil(event, "channel-read-codec-rate"),
 			 switch_event_get_header_nil(event, "channel-read-codec-bit-rate"),
@@ -1220,8 +1541,7 @@ static void core_event_handler(switch_event_t *event)
 	case SWITCH_EVENT_CHANNEL_UNHOLD:
 	case SWITCH_EVENT_CHANNEL_EXECUTE: {
 		
-		new_sql() = switch_mprintf("update channels set application='%q',application_data='%q',"
-								   "presence_id='%q',presence_data='%q' where uuid='%q' and hostname='%q'",
+		new_job() = sql_job_new(SQL_STMT_CHANNEL_APP,
 								   switch_event_get_header_nil(event, "application"),
 								   switch_event_get_header_nil(event, "application-data"),
 								   switch_event_get_header_nil(event, "channel-presence-id"),
@@ -1244,8 +1564,7 @@ static void core_event_handler(switch_event_t *event)
 										   switch_event_get_header_nil(event, "unique-id"), switch_core_get_hostname());
 				free(extra_cols);
 			} else {
-				new_sql() = switch_mprintf("update channels set "
-										   "presence_id='%q',presence_data='%q', call_uuid='%q' where uuid='%q' and hostname='%q'",
+				new_job() = sql_job_new(SQL_STMT_CHANNEL_ORIGINATE,
 										   switch_event_get_header_nil(event, "channel-presence-id"),
 										   switch_event_get_header_nil(event, "channel-presence-data"),
 										   switch_event_get_header_nil(event, "channel-call-uuid"),
@@ -1277,8 +1596,7 @@ static void core_event_handler(switch_event_t *event)
 			}
 
 			if (!zstr(name) && !zstr(number)) {
-				new_sql() = switch_mprintf("update channels set state='%s',callstate='%s',callee_name='%q',"
-										   "callee_num='%q',callee_direction='%q' where uuid='%s' and hostname='%q'",
+				new_job() = sql_job_new(SQL_STMT_CHANNEL_CALLEE,
 										   switch_event_get_header_nil(event, "channel-state"),
 										   switch_event_get_header_nil(event, "channel-call-state"),
 										   switch_str_nil(name),
@@ -1299,7 +1617,7 @@ static void core_event_handler(switch_event_t *event)
 		break;
 	case SWITCH_EVENT_CHANNEL_CALLSTATE:
 		{
-			new_sql() = switch_mprintf("update channels set callstate='%q' where uuid='%q' and hostname='%q'",
+			new_job() = sql_job_new(SQL_STMT_CHANNEL_CALLSTATE,
 									   switch_event_get_header_nil(event, "channel-call-state"),
 									   switch_event_get_header_nil(event, "unique-id"), switch_core_get_hostname());
 
@@ -1336,9 +1654,7 @@ static void core_event_handler(switch_event_t *event)
 											   switch_event_get_header_nil(event, "unique-id"), switch_core_get_hostname());
 					free(extra_cols);
 				} else {
-					new_sql() = switch_mprintf("update channels set state='%s',cid_name='%q',cid_num='%q',"
-											   "ip_addr='%s',dest='%q',dialplan='%q',context='%q',presence_id='%q',presence_data='%q' "
-											   "where uuid='%s' and hostname='%q'",
+					new_job() = sql_job_new(SQL_STMT_CHANNEL_ROUTING,
 											   switch_event_get_header_nil(event, "channel-state"),
 											   switch_event_get_header_nil(event, "caller-caller-id-name"),
 											   switch_event_get_header_nil(event, "caller-caller-id-number"),
@@ -1352,7 +1668,7 @@ static void core_event_handler(switch_event_t *event)
 				}
 				break;
 			default:
-				new_sql() = switch_mprintf("update channels set state='%s' where uuid='%s' and hostname='%q'",
+				new_job() = sql_job_new(SQL_STMT_CHANNEL_STATE,
 										   switch_event_get_header_nil(event, "channel-state"),
 										   switch_event_get_header_nil(event, "unique-id"), switch_core_get_hostname());
 				break;
@@ -1365,7 +1681,6 @@ static void core_event_handler(switch_event_t *event)
 	case SWITCH_EVENT_CHANNEL_BRIDGE:
 		{
 			const char *callee_cid_name, *callee_cid_num, *direction;
-			char *func_name;
 
 			direction = switch_event_get_header(event, "other-leg-direction");
 
@@ -1378,25 +1693,15 @@ static void core_event_handler(switch_event_t *event)
 			}
 
 
-			new_sql() = switch_mprintf("update channels set call_uuid='%q' where uuid='%s' and hostname='%q'",
+			new_job() = sql_job_new(SQL_STMT_CHANNEL_CALL_UUID,
 									   switch_event_get_header_nil(event, "channel-call-uuid"),
 									   switch_event_get_header_nil(event, "unique-id"), switch_core_get_hostname());
 
-			if (runtime.odbc_dbtype == DBTYPE_DEFAULT) {
-				func_name = "function";
-			}
-			else {
-				func_name = "call_function";
-			}
-
-			new_sql() = switch_mprintf("insert into calls (call_uuid,call_created,call_created_epoch,%s,caller_cid_name,"
-									   "caller_cid_num,caller_dest_num,caller_chan_name,caller_uuid,callee_cid_name,"
-									   "callee_cid_num,callee_dest_num,callee_chan_name,callee_uuid,hostname) "
-									   "values ('%s', '%s', '%ld', '%s','%q','%q','%q','%q','%s','%q','%q','%q','%q','%s','%q')",
-									   func_name,
+			switch_snprintf(epoch, sizeof(epoch), "%ld", (long) switch_epoch_time_now(NULL));
+			new_job() = sql_job_new(SQL_STMT_CALLS_INSERT,
 									   switch_event_get_header_nil(event, "channel-call-uuid"),
 									   switch_event_get_header_nil(event, "event-date-local"),
-									   (long) switch_epoch_time_now(NULL),
+									   epoch,
 									   switch_event_get_header_nil(event, "event-calling-function"),
 									   switch_event_get_header_nil(event, "caller-caller-id-name"),
 									   switch_event_get_header_nil(event, "caller-caller-id-number"),
@@ -1415,8 +1720,7 @@ static void core_event_handler(switch_event_t *event)
 		{
 			char *uuid = switch_event_get_header_nil(event, "caller-unique-id");
 
-			new_sql() = switch_mprintf("delete from calls where (caller_uuid='%q' or callee_uuid='%q') and hostname='%q'",
-									   uuid, uuid, switch_core_get_hostname());
+			new_job() = sql_job_new(SQL_STMT_CALLS_DELETE, uuid, uuid, switch_core_get_hostname());
 			break;
 		}
 	case SWITCH_EVENT_SHUTDOWN:
@@ -1498,11 +1802,14 @@ static void core_event_handler(switch_event_t *event)
 		int i = 0;
 
 		for (i = 0; i < sql_idx; i++) {
-			if (switch_stristr("update channels", sql[i]) || switch_stristr("delete from channels", sql[i])) {
-				switch_queue_push(sql_manager.sql_queue[1], sql[i]);
+			if (job[i]) {
+				switch_queue_push(sql_manager.sql_queue[sql_stmts[job[i]->id].queue], job[i]);
+			} else if (switch_stristr("update channels", sql[i]) || switch_stristr("delete from channels", sql[i])) {
+				switch_queue_push(sql_manager.sql_queue[1], sql_job_raw(sql[i]));
 			} else {
-				switch_queue_push(sql_manager.sql_queue[0], sql[i]);
+				switch_queue_push(sql_manager.sql_queue[0], sql_job_raw(sql[i]));
 			}
+			job[i] = NULL;
 			sql[i] = NULL;
 			wake_thread(0);
 		}
@@ -1993,6 +2300,18 @@ SWITCH_DECLARE(void) switch_cache_db_status(switch_stream_handle_t *stream)
 	stream->write_function(stream, "%d total. %d in use.\n", count, used);
 
 	switch_mutex_unlock(sql_manager.dbh_mutex);
+
+	if (sql_manager.manage && sql_manager.sql_queue[0]) {
+		uint32_t rate = sql_manager.rows_per_sec;
+
+		if (switch_micro_time_now() - sql_manager.rate_start > 2000000) {
+			rate = 0;
+		}
+
+		stream->write_function(stream, "\nCore SQL queue\n\tDepth: %u (peak %u)\n\tRows: %" SWITCH_UINT64_T_FMT " (%u/sec)\n\tPrepared statements: %u\n",
+							   switch_queue_size(sql_manager.sql_queue[0]) + switch_queue_size(sql_manager.sql_queue[1]),
+							   sql_manager.queue_peak, sql_manager.rows, rate, sql_manager.prepared);
+	}
 }
 
 /* For Emacs:
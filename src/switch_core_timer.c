@@ -130,6 +130,24 @@ SWITCH_DECLARE(switch_status_t) switch_core_timer_destroy(switch_timer_t *timer)
 	return SWITCH_STATUS_SUCCESS;
 }
 
+SWITCH_DECLARE(switch_status_t) switch_core_timer_stats(const char *timer_name, switch_stream_handle_t *stream)
+{
+	switch_timer_interface_t *timer_interface;
+	switch_status_t status = SWITCH_STATUS_NOTIMPL;
+
+	if ((timer_interface = switch_loadable_module_get_timer_interface(timer_name)) == 0) {
+		return SWITCH_STATUS_GENERR;
+	}
+
+	if (timer_interface->timer_stats) {
+		status = timer_interface->timer_stats(stream);
+	}
+
+	UNPROTECT_INTERFACE(timer_interface);
+
+	return status;
+}
+
 /* For Emacs:
  * Local Variables:
  * mode:c
@@ -34,6 +34,7 @@
 
 #include <switch.h>
 #include <switch_event.h>
+#include "private/switch_core_pvt.h"
 
 #define DISPATCH_QUEUE_LEN 5000
 //#define DEBUG_DISPATCH_QUEUES
@@ -50,9 +51,31 @@ struct switch_event_node {
 	switch_event_callback_t callback;
 	/*! private data */
 	void *user_data;
+	/*! private queue and thread when the subscriber is not called from the dispatch threads */
+	switch_queue_t *queue;
+	switch_thread_t *thread;
+	switch_memory_pool_t *pool;
+	switch_mutex_t *mutex;
+	switch_event_queue_policy_t policy;
+	uint32_t queue_len;
+	uint32_t high_water;
+	uint64_t queued;
+	uint64_t delivered;
+	uint64_t dropped;
+	uint64_t blocked;
+	/* deliveries waiting on a full queue outside RWLOCK */
+	uint32_t refs;
+	int running;
 	struct switch_event_node *next;
 };
 
+/*! \brief A copy held back for a full blocking subscriber until RWLOCK is released */
+typedef struct event_node_pending {
+	switch_event_node_t *node;
+	switch_event_t *event;
+	struct event_node_pending *next;
+} event_node_pending_t;
+
 /*! \brief A registered custom event subclass  */
 struct switch_event_subclass {
 	/*! the owner of the subclass */
@@ -358,18 +381,220 @@ static void *SWITCH_THREAD_FUNC switch_event_thread(switch_thread_t *thread, voi
 }
 
 
+static void *SWITCH_THREAD_FUNC switch_event_node_thread(switch_thread_t *thread, void *obj)
+{
+	switch_event_node_t *node = (switch_event_node_t *) obj;
+
+	while (node->running) {
+		void *pop = NULL;
+		switch_event_t *event = NULL;
+
+		if (switch_queue_pop(node->queue, &pop) != SWITCH_STATUS_SUCCESS) {
+			if (node->running) {
+				continue;
+			}
+			break;
+		}
+
+		if (!pop) {
+			break;
+		}
+
+		event = (switch_event_t *) pop;
+		node->callback(event);
+		switch_event_destroy(&event);
+
+		switch_mutex_lock(node->mutex);
+		node->delivered++;
+		switch_mutex_unlock(node->mutex);
+	}
+
+	return NULL;
+}
+
+static void event_node_launch(switch_event_node_t *node)
+{
+	switch_threadattr_t *thd_attr;
+
+	switch_core_new_memory_pool(&node->pool);
+	switch_mutex_init(&node->mutex, SWITCH_MUTEX_NESTED, node->pool);
+	switch_queue_create(&node->queue, node->queue_len, node->pool);
+	node->running = 1;
+
+	switch_threadattr_create(&thd_attr, node->pool);
+	switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+	switch_thread_create(&node->thread, thd_attr, switch_event_node_thread, node, node->pool);
+}
+
+/* must be called after the node has been unlinked from EVENT_NODES so nothing else can queue to it */
+static void event_node_stop(switch_event_node_t *node)
+{
+	void *pop = NULL;
+	switch_status_t st;
+
+	if (!node->queue) {
+		return;
+	}
+
+	node->running = 0;
+	switch_queue_trypush(node->queue, NULL);
+	switch_queue_interrupt_all(node->queue);
+	switch_thread_join(&st, node->thread);
+
+	/* blocked deliveries notice running is clear and give up their copy */
+	for (;;) {
+		uint32_t refs;
+
+		switch_mutex_lock(node->mutex);
+		refs = node->refs;
+		switch_mutex_unlock(node->mutex);
+
+		if (!refs) {
+			break;
+		}
+		switch_yield(1000);
+	}
+
+	while (switch_queue_trypop(node->queue, &pop) == SWITCH_STATUS_SUCCESS) {
+		switch_event_t *event = (switch_event_t *) pop;
+		switch_event_destroy(&event);
+	}
+
+	node->queue = NULL;
+	switch_core_destroy_memory_pool(&node->pool);
+}
+
+static void event_node_queued(switch_event_node_t *node)
+{
+	uint32_t depth = switch_queue_size(node->queue);
+
+	switch_mutex_lock(node->mutex);
+	node->queued++;
+	if (depth > node->high_water) {
+		node->high_water = depth;
+	}
+	switch_mutex_unlock(node->mutex);
+}
+
+/* called with RWLOCK read locked.  A blocking subscriber whose queue is full is never waited on
+   here, it would stall every dispatch thread and any bind or unbind behind the read lock; the copy
+   is handed back in pending for event_node_push_pending() to wait on once the lock is dropped. */
+static void event_node_enqueue(switch_event_node_t *node, switch_event_t *event, event_node_pending_t **pending)
+{
+	switch_event_t *clone = NULL;
+	event_node_pending_t *pe;
+
+	if (switch_event_dup(&clone, event) != SWITCH_STATUS_SUCCESS) {
+		return;
+	}
+
+	clone->bind_user_data = node->user_data;
+
+	if (switch_queue_trypush(node->queue, clone) == SWITCH_STATUS_SUCCESS) {
+		event_node_queued(node);
+		return;
+	}
+
+	if (node->policy == SWITCH_EVENT_QUEUE_POLICY_BLOCK && (pe = malloc(sizeof(*pe)))) {
+		switch_mutex_lock(node->mutex);
+		node->blocked++;
+		node->refs++;
+		switch_mutex_unlock(node->mutex);
+
+		pe->node = node;
+		pe->event = clone;
+		pe->next = *pending;
+		*pending = pe;
+		return;
+	}
+
+	switch_event_destroy(&clone);
+	switch_mutex_lock(node->mutex);
+	node->dropped++;
+	switch_mutex_unlock(node->mutex);
+}
+
+/* called without RWLOCK, the reference taken in event_node_enqueue() keeps the node alive */
+static void event_node_push_pending(event_node_pending_t *pending)
+{
+	event_node_pending_t *pe;
+
+	while ((pe = pending)) {
+		switch_event_node_t *node = pe->node;
+		switch_event_t *clone = pe->event;
+
+		pending = pe->next;
+		free(pe);
+
+		while (switch_queue_trypush(node->queue, clone) != SWITCH_STATUS_SUCCESS) {
+			if (!SYSTEM_RUNNING || !node->running) {
+				switch_event_destroy(&clone);
+				break;
+			}
+			switch_yield(1000);
+		}
+
+		if (clone) {
+			event_node_queued(node);
+		} else {
+			switch_mutex_lock(node->mutex);
+			node->dropped++;
+			switch_mutex_unlock(node->mutex);
+		}
+
+		switch_mutex_lock(node->mutex);
+		node->refs--;
+		switch_mutex_unlock(node->mutex);
+	}
+}
+
+SWITCH_DECLARE(void) switch_event_queue_stats(switch_stream_handle_t *stream)
+{
+	switch_event_node_t *node;
+	int id, total = 0;
+
+	stream->write_function(stream, "id,event,subclass,policy,size,depth,high_water,queued,delivered,dropped,blocked\n");
+
+	switch_thread_rwlock_rdlock(RWLOCK);
+	for (id = 0; id <= SWITCH_EVENT_ALL; id++) {
+		for (node = EVENT_NODES[id]; node; node = node->next) {
+			if (!node->queue) {
+				continue;
+			}
+
+			switch_mutex_lock(node->mutex);
+			stream->write_function(stream, "%s,%s,%s,%s,%u,%u,%u,%" SWITCH_UINT64_T_FMT ",%" SWITCH_UINT64_T_FMT ",%" SWITCH_UINT64_T_FMT ",%" SWITCH_UINT64_T_FMT "\n",
+								   node->id, switch_event_name(node->event_id), node->subclass ? node->subclass->name : "",
+								   node->policy == SWITCH_EVENT_QUEUE_POLICY_BLOCK ? "block" : "drop",
+								   node->queue_len, switch_queue_size(node->queue), node->high_water,
+								   node->queued, node->delivered, node->dropped, node->blocked);
+			switch_mutex_unlock(node->mutex);
+			total++;
+		}
+	}
+	switch_thread_rwlock_unlock(RWLOCK);
+
+	stream->write_function(stream, "\n%d total.\n", total);
+}
+
+
 SWITCH_DECLARE(void) switch_event_deliver(switch_event_t **event)
 {
 	switch_event_types_t e;
 	switch_event_node_t *node;
+	event_node_pending_t *pending = NULL;
 
 	if (SYSTEM_RUNNING) {
 		switch_thread_rwlock_rdlock(RWLOCK);
 		for (e = (*event)->event_id;; e = SWITCH_EVENT_ALL) {
 			for (node = EVENT_NODES[e]; node; node = node->next) {
 				if (switch_events_match(*event, node)) {
-					(*event)->bind_user_data = node->user_data;
-					node->callback(*event);
+					if (node->queue) {
+						event_node_enqueue(node, *event, &pending);
+					} else {
+						(*event)->bind_user_data = node->user_data;
+						node->callback(*event);
+					}
 				}
 			}
 
@@ -378,6 +603,10 @@ SWITCH_DECLARE(void) switch_event_deliver(switch_event_t **event)
 			}
 		}
 		switch_thread_rwlock_unlock(RWLOCK);
+
+		if (pending) {
+			event_node_push_pending(pending);
+		}
 	}
 
 	switch_event_destroy(event);
@@ -492,6 +721,7 @@ SWITCH_DECLARE(void) switch_core_memory_reclaim_events(void)
 
 SWITCH_DECLARE(switch_status_t) switch_event_shutdown(void)
 {
+	switch_event_node_t *node, *dead = NULL;
 	uint32_t x = 0;
 	int last = 0;
 	switch_hash_index_t *hi;
@@ -502,6 +732,36 @@ SWITCH_DECLARE(switch_status_t) switch_event_shutdown(void)
 	SYSTEM_RUNNING = 0;
 	switch_mutex_unlock(EVENT_QUEUE_MUTEX);
 
+	/* queued subscribers are unlinked under the lock and joined outside it, the same as unbind,
+	   so a callback that binds or unbinds while draining can't wedge shutdown */
+	switch_thread_rwlock_wrlock(RWLOCK);
+	for (x = 0; x <= SWITCH_EVENT_ALL; x++) {
+		switch_event_node_t *np, *next, *prev = NULL;
+
+		for (np = EVENT_NODES[x]; np; np = next) {
+			next = np->next;
+			if (np->queue) {
+				if (prev) {
+					prev->next = next;
+				} else {
+					EVENT_NODES[x] = next;
+				}
+				np->next = dead;
+				dead = np;
+			} else {
+				prev = np;
+			}
+		}
+	}
+	switch_thread_rwlock_unlock(RWLOCK);
+
+	/* the nodes themselves stay allocated, a late switch_event_unbind() on one just won't find it */
+	while ((node = dead)) {
+		dead = node->next;
+		node->next = NULL;
+		event_node_stop(node);
+	}
+
 	for (x = 0; x < 3; x++) {
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Stopping event queue %d\n", x);
 		switch_queue_trypush(EVENT_QUEUE[x], NULL);
@@ -699,6 +959,295 @@ SWITCH_DECLARE(switch_status_t) switch_event_create_subclass_detailed(const char
 	return SWITCH_STATUS_SUCCESS;
 }
 
+/*
+ * Indexed header storage
+ *
+ * An indexed event keeps a small open addressed table (linear probing) mapping each header
+ * name to the first header of that name in list order, so lookups do not have to walk
+ * event->headers.  Header structs, names and short values are carved out of a per-event
+ * arena with per size class free lists so repeatedly replaced headers recycle their memory.
+ * Anything that did not come from the arena (headers added before indexing, long values) is
+ * still released with FREE().
+ */
+
+#define EVENT_INDEX_MIN_SLOTS 32
+#define EVENT_ARENA_ALIGN 16
+#define EVENT_ARENA_MAX_CHUNK 512
+#define EVENT_ARENA_CLASSES (EVENT_ARENA_MAX_CHUNK / EVENT_ARENA_ALIGN)
+#define EVENT_ARENA_BLOCK_LEN 4096
+#define EVENT_ARENA_MAX_BLOCK_LEN 65536
+#define EVENT_ARENA_ROUND(_l) (((_l) + (EVENT_ARENA_ALIGN - 1)) & ~((switch_size_t)EVENT_ARENA_ALIGN - 1))
+
+typedef struct switch_event_arena_block {
+	struct switch_event_arena_block *next;
+	switch_size_t len;
+	switch_size_t used;
+	switch_size_t pad;
+} switch_event_arena_block_t;
+
+struct switch_event_index {
+	switch_event_header_t **slots;
+	uint32_t size;
+	uint32_t count;
+	switch_event_arena_block_t *blocks;
+	void *free_chunks[EVENT_ARENA_CLASSES];
+};
+
+static void *event_arena_alloc(struct switch_event_index *idx, switch_size_t len)
+{
+	switch_event_arena_block_t *block = idx->blocks;
+	uint32_t class;
+	void *p;
+
+	len = EVENT_ARENA_ROUND(len);
+	switch_assert(len && len <= EVENT_ARENA_MAX_CHUNK);
+	class = (uint32_t) (len / EVENT_ARENA_ALIGN) - 1;
+
+	if ((p = idx->free_chunks[class])) {
+		idx->free_chunks[class] = *(void **) p;
+		return p;
+	}
+
+	if (!block || block->used + len > block->len) {
+		switch_size_t blen = block ? block->len * 2 : EVENT_ARENA_BLOCK_LEN;
+
+		if (blen > EVENT_ARENA_MAX_BLOCK_LEN) {
+			blen = EVENT_ARENA_MAX_BLOCK_LEN;
+		}
+
+		block = ALLOC(sizeof(*block) + blen);
+		switch_assert(block);
+		block->len = blen;
+		block->used = 0;
+		block->next = idx->blocks;
+		idx->blocks = block;
+	}
+
+	p = (char *) (block + 1) + block->used;
+	block->used += len;
+
+	return p;
+}
+
+static int event_arena_owns(struct switch_event_index *idx, const void *p)
+{
+	switch_event_arena_block_t *block;
+
+	for (block = idx->blocks; block; block = block->next) {
+		const char *start = (const char *) (block + 1);
+		if ((const char *) p >= start && (const char *) p < start + block->len) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* give back memory that either came from the arena (len is a lower bound of the chunk size) or from ALLOC */
+static void event_arena_release(struct switch_event_index *idx, void *p, switch_size_t len)
+{
+	uint32_t class;
+
+	if (!p) {
+		return;
+	}
+
+	if (!event_arena_owns(idx, p)) {
+		FREE(p);
+		return;
+	}
+
+	len = EVENT_ARENA_ROUND(len);
+	if (len < sizeof(void *)) {
+		len = EVENT_ARENA_ROUND(sizeof(void *));
+	}
+	class = (uint32_t) (len / EVENT_ARENA_ALIGN) - 1;
+
+	*(void **) p = idx->free_chunks[class];
+	idx->free_chunks[class] = p;
+}
+
+static char *event_arena_strdup(struct switch_event_index *idx, const char *s)
+{
+	switch_size_t len = strlen(s) + 1;
+
+	if (len > EVENT_ARENA_MAX_CHUNK) {
+		return DUP(s);
+	}
+
+	return (char *) memcpy(event_arena_alloc(idx, len), s, len);
+}
+
+/* take ownership of an ALLOC'd string, moving it into the arena when it fits */
+static char *event_arena_adopt(struct switch_event_index *idx, char *s)
+{
+	switch_size_t len = strlen(s) + 1;
+	char *r;
+
+	if (len > EVENT_ARENA_MAX_CHUNK) {
+		return s;
+	}
+
+	r = (char *) memcpy(event_arena_alloc(idx, len), s, len);
+	FREE(s);
+
+	return r;
+}
+
+static void event_arena_free_header(struct switch_event_index *idx, switch_event_header_t *hp)
+{
+	if (hp->name) {
+		event_arena_release(idx, hp->name, strlen(hp->name) + 1);
+	}
+	if (hp->value) {
+		event_arena_release(idx, hp->value, strlen(hp->value) + 1);
+	}
+	event_arena_release(idx, hp, sizeof(*hp));
+}
+
+static switch_event_header_t **event_index_slot(struct switch_event_index *idx, const char *name, unsigned long hash)
+{
+	uint32_t mask = idx->size - 1;
+	uint32_t i;
+
+	for (i = (uint32_t) (hash & mask); idx->slots[i]; i = (i + 1) & mask) {
+		if (idx->slots[i]->hash == hash && !strcasecmp(idx->slots[i]->name, name)) {
+			break;
+		}
+	}
+
+	return &idx->slots[i];
+}
+
+static void event_index_resize(struct switch_event_index *idx, uint32_t size)
+{
+	switch_event_header_t **old = idx->slots;
+	uint32_t old_size = idx->size;
+	uint32_t i, j;
+
+	switch_zmalloc(idx->slots, size * sizeof(*idx->slots));
+	idx->size = size;
+
+	for (i = 0; i < old_size; i++) {
+		if (old[i]) {
+			for (j = (uint32_t) (old[i]->hash & (size - 1)); idx->slots[j]; j = (j + 1) & (size - 1));
+			idx->slots[j] = old[i];
+		}
+	}
+
+	FREE(old);
+}
+
+static void event_index_add(struct switch_event_index *idx, switch_event_header_t *header, switch_stack_t stack)
+{
+	switch_event_header_t **slot = event_index_slot(idx, header->name, header->hash);
+
+	if (!*slot) {
+		*slot = header;
+		if (++idx->count * 2 > idx->size) {
+			event_index_resize(idx, idx->size * 2);
+		}
+	} else if ((stack & SWITCH_STACK_TOP)) {
+		/* the index always points at the header switch_event_get_header would have found first */
+		*slot = header;
+	}
+}
+
+/* backward shift deletion so probe sequences stay intact without tombstones */
+static void event_index_remove(struct switch_event_index *idx, switch_event_header_t **slot)
+{
+	uint32_t mask = idx->size - 1;
+	uint32_t i = (uint32_t) (slot - idx->slots), j = i, k;
+
+	idx->count--;
+
+	for (;;) {
+		idx->slots[i] = NULL;
+
+		for (;;) {
+			j = (j + 1) & mask;
+
+			if (!idx->slots[j]) {
+				return;
+			}
+
+			k = (uint32_t) (idx->slots[j]->hash & mask);
+
+			if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j))) {
+				break;
+			}
+		}
+
+		idx->slots[i] = idx->slots[j];
+		i = j;
+	}
+}
+
+static void event_index_create(switch_event_t *event, uint32_t hint)
+{
+	struct switch_event_index *idx;
+	switch_event_header_t *hp;
+	uint32_t size = EVENT_INDEX_MIN_SLOTS;
+
+	while (size < hint * 2) {
+		size <<= 1;
+	}
+
+	switch_zmalloc(idx, sizeof(*idx));
+	switch_zmalloc(idx->slots, size * sizeof(*idx->slots));
+	idx->size = size;
+
+	for (hp = event->headers; hp; hp = hp->next) {
+		event_index_add(idx, hp, SWITCH_STACK_BOTTOM);
+	}
+
+	event->index = idx;
+}
+
+static void event_index_destroy(switch_event_t *event)
+{
+	struct switch_event_index *idx = event->index;
+	switch_event_arena_block_t *block, *next;
+	switch_event_header_t *hp, *this;
+
+	for (hp = event->headers; hp;) {
+		this = hp;
+		hp = hp->next;
+		if (!event_arena_owns(idx, this->name)) {
+			FREE(this->name);
+		}
+		if (!event_arena_owns(idx, this->value)) {
+			FREE(this->value);
+		}
+		if (!event_arena_owns(idx, this)) {
+			FREE(this);
+		}
+	}
+
+	event->headers = event->last_header = NULL;
+
+	for (block = idx->blocks; block; block = next) {
+		next = block->next;
+		FREE(block);
+	}
+
+	FREE(idx->slots);
+	FREE(idx);
+	event->index = NULL;
+}
+
+SWITCH_DECLARE(switch_status_t) switch_event_index_headers(switch_event_t *event)
+{
+	switch_assert(event);
+
+	if (!event->index) {
+		event_index_create(event, 0);
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+
 SWITCH_DECLARE(switch_status_t) switch_event_set_priority(switch_event_t *event, switch_priority_t priority)
 {
 	event->priority = priority;
@@ -719,6 +1268,10 @@ SWITCH_DECLARE(char *) switch_event_get_header(switch_event_t *event, const char
 
 	hash = switch_ci_hashfunc_default(header_name, &hlen);
 
+	if (event->index) {
+		return (hp = *event_index_slot(event->index, header_name, hash)) ? hp->value : NULL;
+	}
+
 	for (hp = event->headers; hp; hp = hp->next) {
 		if ((!hp->hash || hash == hp->hash) && !strcasecmp(hp->name, header_name)) {
 			return hp->value;
@@ -735,11 +1288,49 @@ SWITCH_DECLARE(char *) switch_event_get_body(switch_event_t *event)
 SWITCH_DECLARE(switch_status_t) switch_event_del_header_val(switch_event_t *event, const char *header_name, const char *val)
 {
 	switch_event_header_t *hp, *lp = NULL, *tp;
+	switch_event_header_t **slot = NULL;
 	switch_status_t status = SWITCH_STATUS_FALSE;
 	int x = 0;
 	switch_ssize_t hlen = -1;
 	unsigned long hash = 0;
 
+	if (event->index) {
+		hash = switch_ci_hashfunc_default(header_name, &hlen);
+
+		if (!*(slot = event_index_slot(event->index, header_name, hash))) {
+			return SWITCH_STATUS_FALSE;
+		}
+
+		if (switch_test_flag(event, EF_UNIQ_HEADERS)) {
+			/* there can only be one of them so unlink it without comparing any names */
+			hp = *slot;
+
+			if (!zstr(val) && strcmp(hp->value, val)) {
+				return SWITCH_STATUS_FALSE;
+			}
+
+			for (tp = event->headers; tp && tp != hp; tp = tp->next) {
+				lp = tp;
+			}
+
+			switch_assert(tp);
+
+			if (lp) {
+				lp->next = hp->next;
+			} else {
+				event->headers = hp->next;
+			}
+			if (hp == event->last_header) {
+				event->last_header = lp;
+			}
+
+			event_index_remove(event->index, slot);
+			event_arena_free_header(event->index, hp);
+
+			return SWITCH_STATUS_SUCCESS;
+		}
+	}
+
 	tp = event->headers;
 	while (tp) {
 		hp = tp;
@@ -758,6 +1349,11 @@ SWITCH_DECLARE(switch_status_t) switch_event_del_header_val(switch_event_t *even
 			if (hp == event->last_header || !hp->next) {
 				event->last_header = lp;
 			}
+			if (event->index) {
+				event_arena_free_header(event->index, hp);
+				status = SWITCH_STATUS_SUCCESS;
+				continue;
+			}
 			FREE(hp->name);
 			FREE(hp->value);
 			memset(hp, 0, sizeof(*hp));
@@ -774,33 +1370,53 @@ SWITCH_DECLARE(switch_status_t) switch_event_del_header_val(switch_event_t *even
 		}
 	}
 
+	if (slot && status == SWITCH_STATUS_SUCCESS) {
+		/* the indexed header may be gone, point the slot at whatever is left with that name */
+		event_index_remove(event->index, slot);
+
+		if (!zstr(val)) {
+			for (hp = event->headers; hp; hp = hp->next) {
+				if (hp->hash == hash && !strcasecmp(header_name, hp->name)) {
+					event_index_add(event->index, hp, SWITCH_STACK_BOTTOM);
+					break;
+				}
+			}
+		}
+	}
+
 	return status;
 }
 
-switch_status_t switch_event_base_add_header(switch_event_t *event, switch_stack_t stack, const char *header_name, char *data)
+static switch_status_t event_add_header(switch_event_t *event, switch_stack_t stack, const char *header_name, char *data)
 {
 	switch_event_header_t *header;
 	switch_ssize_t hlen = -1;
 
-#ifdef SWITCH_EVENT_RECYCLE
-	void *pop;
-	if (switch_queue_trypop(EVENT_HEADER_RECYCLE_QUEUE, &pop) == SWITCH_STATUS_SUCCESS) {
-		header = (switch_event_header_t *) pop;
+	if (switch_test_flag(event, EF_UNIQ_HEADERS)) {
+		switch_event_del_header(event, header_name);
+	}
+
+	if (event->index) {
+		header = event_arena_alloc(event->index, sizeof(*header));
+		memset(header, 0, sizeof(*header));
+		header->name = event_arena_strdup(event->index, header_name);
 	} else {
+#ifdef SWITCH_EVENT_RECYCLE
+		void *pop;
+		if (switch_queue_trypop(EVENT_HEADER_RECYCLE_QUEUE, &pop) == SWITCH_STATUS_SUCCESS) {
+			header = (switch_event_header_t *) pop;
+		} else {
 #endif
-		header = ALLOC(sizeof(*header));
-		switch_assert(header);
+			header = ALLOC(sizeof(*header));
+			switch_assert(header);
 #ifdef SWITCH_EVENT_RECYCLE
-	}
+		}
 #endif
 
-	if (switch_test_flag(event, EF_UNIQ_HEADERS)) {
-		switch_event_del_header(event, header_name);
+		memset(header, 0, sizeof(*header));
+		header->name = DUP(header_name);
 	}
 
-	memset(header, 0, sizeof(*header));
-
-	header->name = DUP(header_name);
 	header->value = data;
 	header->hash = switch_ci_hashfunc_default(header->name, &hlen);
 
@@ -820,9 +1436,22 @@ switch_status_t switch_event_base_add_header(switch_event_t *event, switch_stack
 		event->last_header = header;
 	}
 
+	if (event->index) {
+		event_index_add(event->index, header, stack);
+	}
+
 	return SWITCH_STATUS_SUCCESS;
 }
 
+switch_status_t switch_event_base_add_header(switch_event_t *event, switch_stack_t stack, const char *header_name, char *data)
+{
+	if (event->index) {
+		data = event_arena_adopt(event->index, data);
+	}
+
+	return event_add_header(event, stack, header_name, data);
+}
+
 SWITCH_DECLARE(switch_status_t) switch_event_add_header(switch_event_t *event, switch_stack_t stack, const char *header_name, const char *fmt, ...)
 {
 	int ret = 0;
@@ -855,7 +1484,10 @@ SWITCH_DECLARE(switch_status_t) switch_event_set_subclass_name(switch_event_t *e
 SWITCH_DECLARE(switch_status_t) switch_event_add_header_string(switch_event_t *event, switch_stack_t stack, const char *header_name, const char *data)
 {
 	if (data) {
-		return switch_event_base_add_header(event, stack, header_name, (stack & SWITCH_STACK_NODUP) ? (char *)data : DUP(data));
+		if ((stack & SWITCH_STACK_NODUP)) {
+			return switch_event_base_add_header(event, stack, header_name, (char *) data);
+		}
+		return event_add_header(event, stack, header_name, event->index ? event_arena_strdup(event->index, data) : DUP(data));
 	}
 	return SWITCH_STATUS_GENERR;
 }
@@ -889,6 +1521,10 @@ SWITCH_DECLARE(void) switch_event_destroy(switch_event_t **event)
 	switch_event_header_t *hp, *this;
 
 	if (ep) {
+		if (ep->index) {
+			event_index_destroy(ep);
+		}
+
 		for (hp = ep->headers; hp;) {
 			this = hp;
 			hp = hp->next;
@@ -942,6 +1578,11 @@ SWITCH_DECLARE(switch_status_t) switch_event_dup(switch_event_t **event, switch_
 	(*event)->event_user_data = todup->event_user_data;
 	(*event)->bind_user_data = todup->bind_user_data;
 	(*event)->flags = todup->flags;
+
+	if (todup->index) {
+		event_index_create(*event, todup->index->count);
+	}
+
 	for (hp = todup->headers; hp; hp = hp->next) {
 		if (todup->subclass_name && !strcmp(hp->name, "Event-Subclass")) {
 			continue;
@@ -1411,6 +2052,12 @@ SWITCH_DECLARE(switch_status_t) switch_event_bind_removable(const char *id, swit
 		event_node->callback = callback;
 		event_node->user_data = user_data;
 
+		if (runtime.event_queue_len) {
+			event_node->queue_len = runtime.event_queue_len;
+			event_node->policy = runtime.event_queue_policy;
+			event_node_launch(event_node);
+		}
+
 		if (EVENT_NODES[event]) {
 			event_node->next = EVENT_NODES[event];
 		}
@@ -1440,7 +2087,7 @@ SWITCH_DECLARE(switch_status_t) switch_event_bind(const char *id, switch_event_t
 
 SWITCH_DECLARE(switch_status_t) switch_event_unbind_callback(switch_event_callback_t callback)
 {
-	switch_event_node_t *n, *np, *lnp = NULL;
+	switch_event_node_t *n, *np, *lnp = NULL, *dead = NULL;
 	switch_status_t status = SWITCH_STATUS_FALSE;
 	int id;
 
@@ -1461,8 +2108,8 @@ SWITCH_DECLARE(switch_status_t) switch_event_unbind_callback(switch_event_callba
 				}
 
 				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Event Binding deleted for %s:%s\n", n->id, switch_event_name(n->event_id));
-				FREE(n->id);
-				FREE(n);
+				n->next = dead;
+				dead = n;
 				status = SWITCH_STATUS_SUCCESS;
 			} else {
 				lnp = n;
@@ -1473,6 +2120,14 @@ SWITCH_DECLARE(switch_status_t) switch_event_unbind_callback(switch_event_callba
 	switch_thread_rwlock_unlock(RWLOCK);
 	/* </LOCKED> ----------------------------------------------- */
 
+	/* queued subscribers are drained outside the lock, their thread may still be inside the callback */
+	while ((n = dead)) {
+		dead = n->next;
+		event_node_stop(n);
+		FREE(n->id);
+		FREE(n);
+	}
+
 	return status;
 }
 
@@ -1501,8 +2156,6 @@ SWITCH_DECLARE(switch_status_t) switch_event_unbind(switch_event_node_t **node)
 			}
 			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Event Binding deleted for %s:%s\n", n->id, switch_event_name(n->event_id));
 			n->subclass = NULL;
-			FREE(n->id);
-			FREE(n);
 			*node = NULL;
 			status = SWITCH_STATUS_SUCCESS;
 			break;
@@ -1513,6 +2166,12 @@ SWITCH_DECLARE(switch_status_t) switch_event_unbind(switch_event_node_t **node)
 	switch_thread_rwlock_unlock(RWLOCK);
 	/* </LOCKED> ----------------------------------------------- */
 
+	if (status == SWITCH_STATUS_SUCCESS) {
+		event_node_stop(n);
+		FREE(n->id);
+		FREE(n);
+	}
+
 	return status;
 }
 
@@ -32,6 +32,303 @@
 
 #include <switch.h>
 #include <pcre.h>
+#include "private/switch_core_pvt.h"
+
+/* Compiled (and studied) patterns are kept in a bounded LRU keyed on the compile
+   flags and the final expression.  Patterns produced by variable expansion live in
+   their own class so a flood of one-off expansions can't push out the static ones.
+   A handle given to a caller holds a reference on its entry until switch_regex_free(). */
+
+#define REGEX_CACHE_STATIC_SIZE 1024
+#define REGEX_CACHE_DYNAMIC_SIZE 256
+#define REGEX_CACHE_KEY_LEN 1024
+
+typedef struct regex_cache_entry_s {
+	char *key;
+	char re_key[32];
+	pcre *re;
+	pcre_extra *extra;
+	uint32_t refs;
+	uint8_t registered;
+	uint8_t cached;
+	int class_id;
+	struct regex_cache_entry_s *prev;
+	struct regex_cache_entry_s *next;
+} regex_cache_entry_t;
+
+typedef struct {
+	const char *name;
+	switch_hash_t *hash;
+	regex_cache_entry_t *head;
+	regex_cache_entry_t *tail;
+	uint32_t count;
+	uint32_t max;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+} regex_cache_class_t;
+
+static struct {
+	switch_mutex_t *mutex;
+	switch_hash_t *by_re;
+	regex_cache_class_t classes[2];
+	uint32_t registered;
+	int running;
+} REGEX_CACHE;
+
+static void regex_entry_destroy(regex_cache_entry_t *entry)
+{
+	if (entry->registered && REGEX_CACHE.by_re) {
+		switch_core_hash_delete(REGEX_CACHE.by_re, entry->re_key);
+		/* after shutdown the lookup table only lives until the last held handle comes back */
+		if (!--REGEX_CACHE.registered && !REGEX_CACHE.running) {
+			switch_core_hash_destroy(&REGEX_CACHE.by_re);
+		}
+	}
+	if (entry->extra) {
+		pcre_free(entry->extra);
+	}
+	pcre_free(entry->re);
+	switch_safe_free(entry->key);
+	free(entry);
+}
+
+static void regex_entry_unlink(regex_cache_entry_t *entry)
+{
+	regex_cache_class_t *cls = &REGEX_CACHE.classes[entry->class_id];
+
+	if (entry->prev) {
+		entry->prev->next = entry->next;
+	} else {
+		cls->head = entry->next;
+	}
+
+	if (entry->next) {
+		entry->next->prev = entry->prev;
+	} else {
+		cls->tail = entry->prev;
+	}
+
+	entry->prev = entry->next = NULL;
+}
+
+static void regex_entry_link(regex_cache_entry_t *entry)
+{
+	regex_cache_class_t *cls = &REGEX_CACHE.classes[entry->class_id];
+
+	entry->prev = NULL;
+	entry->next = cls->head;
+
+	if (cls->head) {
+		cls->head->prev = entry;
+	} else {
+		cls->tail = entry;
+	}
+
+	cls->head = entry;
+}
+
+/* must be called with the cache mutex held */
+static void regex_entry_evict(regex_cache_entry_t *entry)
+{
+	regex_cache_class_t *cls = &REGEX_CACHE.classes[entry->class_id];
+
+	regex_entry_unlink(entry);
+	switch_core_hash_delete(cls->hash, entry->key);
+	cls->count--;
+	entry->cached = 0;
+
+	if (--entry->refs == 0) {
+		regex_entry_destroy(entry);
+	}
+}
+
+static regex_cache_entry_t *regex_cache_get(const char *expression, int flags, switch_bool_t dynamic, const char **error, int *erroffset)
+{
+	regex_cache_entry_t *entry = NULL, *found;
+	regex_cache_class_t *cls = &REGEX_CACHE.classes[dynamic ? 1 : 0];
+	char key[REGEX_CACHE_KEY_LEN];
+	int use_cache = 0;
+	pcre *re;
+
+	if (REGEX_CACHE.running && switch_snprintf(key, sizeof(key), "%x:%s", flags, expression) < (int) sizeof(key) - 1) {
+		use_cache = 1;
+		switch_mutex_lock(REGEX_CACHE.mutex);
+		if ((entry = switch_core_hash_find(cls->hash, key))) {
+			cls->hits++;
+			entry->refs++;
+			regex_entry_unlink(entry);
+			regex_entry_link(entry);
+			switch_mutex_unlock(REGEX_CACHE.mutex);
+			return entry;
+		}
+		cls->misses++;
+		switch_mutex_unlock(REGEX_CACHE.mutex);
+	}
+
+	if (!(re = pcre_compile(expression, flags, error, erroffset, NULL)) || *error) {
+		if (re) {
+			pcre_free(re);
+		}
+		return NULL;
+	}
+
+	switch_zmalloc(entry, sizeof(*entry));
+	entry->re = re;
+	entry->extra = pcre_study(re, 0, error);
+	*error = NULL;
+	entry->refs = 1;
+	entry->class_id = dynamic ? 1 : 0;
+
+	if (!use_cache) {
+		return entry;
+	}
+
+	switch_mutex_lock(REGEX_CACHE.mutex);
+
+	if (!REGEX_CACHE.running) {
+		switch_mutex_unlock(REGEX_CACHE.mutex);
+		return entry;
+	}
+
+	if ((found = switch_core_hash_find(cls->hash, key))) {
+		/* somebody else compiled it while we weren't holding the lock */
+		found->refs++;
+		switch_mutex_unlock(REGEX_CACHE.mutex);
+		regex_entry_destroy(entry);
+		return found;
+	}
+
+	entry->key = strdup(key);
+	switch_snprintf(entry->re_key, sizeof(entry->re_key), "%" SWITCH_SIZE_T_FMT, (switch_size_t) (intptr_t) re);
+	switch_core_hash_insert(cls->hash, entry->key, entry);
+	switch_core_hash_insert(REGEX_CACHE.by_re, entry->re_key, entry);
+	REGEX_CACHE.registered++;
+	entry->registered = 1;
+	entry->cached = 1;
+	entry->refs++;
+	regex_entry_link(entry);
+	cls->count++;
+
+	while (cls->count > cls->max && cls->tail) {
+		regex_entry_evict(cls->tail);
+		cls->evictions++;
+	}
+
+	switch_mutex_unlock(REGEX_CACHE.mutex);
+
+	return entry;
+}
+
+static void regex_cache_release(regex_cache_entry_t *entry)
+{
+	if (!entry->registered) {
+		regex_entry_destroy(entry);
+		return;
+	}
+
+	switch_mutex_lock(REGEX_CACHE.mutex);
+	if (--entry->refs == 0) {
+		regex_entry_destroy(entry);
+	}
+	switch_mutex_unlock(REGEX_CACHE.mutex);
+}
+
+/* hand the compiled pattern to a caller who will give it back with switch_regex_free() */
+static pcre *regex_cache_detach(regex_cache_entry_t *entry)
+{
+	pcre *re = entry->re;
+
+	if (entry->registered) {
+		return re;
+	}
+
+	if (entry->extra) {
+		pcre_free(entry->extra);
+	}
+	switch_safe_free(entry->key);
+	free(entry);
+
+	return re;
+}
+
+void switch_regex_cache_init(switch_memory_pool_t *pool)
+{
+	memset(&REGEX_CACHE, 0, sizeof(REGEX_CACHE));
+	switch_mutex_init(&REGEX_CACHE.mutex, SWITCH_MUTEX_NESTED, pool);
+	switch_core_hash_init(&REGEX_CACHE.by_re, NULL);
+	switch_core_hash_init_case(&REGEX_CACHE.classes[0].hash, NULL, SWITCH_TRUE);
+	switch_core_hash_init_case(&REGEX_CACHE.classes[1].hash, NULL, SWITCH_TRUE);
+	REGEX_CACHE.classes[0].name = "static";
+	REGEX_CACHE.classes[0].max = REGEX_CACHE_STATIC_SIZE;
+	REGEX_CACHE.classes[1].name = "dynamic";
+	REGEX_CACHE.classes[1].max = REGEX_CACHE_DYNAMIC_SIZE;
+	REGEX_CACHE.running = 1;
+}
+
+void switch_regex_cache_shutdown(void)
+{
+	int i;
+
+	if (!REGEX_CACHE.running) {
+		return;
+	}
+
+	switch_mutex_lock(REGEX_CACHE.mutex);
+	REGEX_CACHE.running = 0;
+
+	for (i = 0; i < 2; i++) {
+		while (REGEX_CACHE.classes[i].tail) {
+			regex_entry_evict(REGEX_CACHE.classes[i].tail);
+		}
+	}
+
+	switch_core_hash_destroy(&REGEX_CACHE.classes[0].hash);
+	switch_core_hash_destroy(&REGEX_CACHE.classes[1].hash);
+
+	/* handles still held are freed by switch_regex_free(), which needs by_re to find them */
+	if (REGEX_CACHE.by_re && !REGEX_CACHE.registered) {
+		switch_core_hash_destroy(&REGEX_CACHE.by_re);
+	}
+	switch_mutex_unlock(REGEX_CACHE.mutex);
+}
+
+SWITCH_DECLARE(void) switch_regex_cache_flush(void)
+{
+	int i;
+
+	if (!REGEX_CACHE.running) {
+		return;
+	}
+
+	switch_mutex_lock(REGEX_CACHE.mutex);
+	for (i = 0; i < 2; i++) {
+		while (REGEX_CACHE.classes[i].tail) {
+			regex_entry_evict(REGEX_CACHE.classes[i].tail);
+		}
+	}
+	switch_mutex_unlock(REGEX_CACHE.mutex);
+}
+
+SWITCH_DECLARE(void) switch_regex_cache_status(switch_stream_handle_t *stream)
+{
+	int i;
+
+	if (!REGEX_CACHE.running) {
+		stream->write_function(stream, "-ERR regex cache not running\n");
+		return;
+	}
+
+	switch_mutex_lock(REGEX_CACHE.mutex);
+	for (i = 0; i < 2; i++) {
+		regex_cache_class_t *cls = &REGEX_CACHE.classes[i];
+
+		stream->write_function(stream, "%s\n\tEntries: %u/%u\n\tHits: %" SWITCH_UINT64_T_FMT "\n\tMisses: %" SWITCH_UINT64_T_FMT
+							   "\n\tEvictions: %" SWITCH_UINT64_T_FMT "\n",
+							   cls->name, cls->count, cls->max, cls->hits, cls->misses, cls->evictions);
+	}
+	switch_mutex_unlock(REGEX_CACHE.mutex);
+}
 
 SWITCH_DECLARE(switch_regex_t *) switch_regex_compile(const char *pattern,
 													  int options, const char **errorptr, int *erroroffset, const unsigned char *tables)
@@ -48,15 +345,37 @@ SWITCH_DECLARE(int) switch_regex_copy_substring(const char *subject, int *ovecto
 
 SWITCH_DECLARE(void) switch_regex_free(void *data)
 {
-	pcre_free(data);
+	regex_cache_entry_t *entry = NULL;
+	char re_key[32];
+
+	if (REGEX_CACHE.mutex) {
+		switch_snprintf(re_key, sizeof(re_key), "%" SWITCH_SIZE_T_FMT, (switch_size_t) (intptr_t) data);
+		switch_mutex_lock(REGEX_CACHE.mutex);
+		if (REGEX_CACHE.by_re && (entry = switch_core_hash_find(REGEX_CACHE.by_re, re_key))) {
+			if (--entry->refs == 0) {
+				regex_entry_destroy(entry);
+			}
+		}
+		switch_mutex_unlock(REGEX_CACHE.mutex);
+	}
+
+	if (!entry) {
+		pcre_free(data);
+	}
 
 }
 
 SWITCH_DECLARE(int) switch_regex_perform(const char *field, const char *expression, switch_regex_t **new_re, int *ovector, uint32_t olen)
+{
+	return switch_regex_perform_ex(field, expression, new_re, ovector, olen, SWITCH_FALSE);
+}
+
+SWITCH_DECLARE(int) switch_regex_perform_ex(const char *field, const char *expression, switch_regex_t **new_re, int *ovector, uint32_t olen,
+											switch_bool_t dynamic)
 {
 	const char *error = NULL;
 	int erroffset = 0;
-	pcre *re = NULL;
+	regex_cache_entry_t *entry = NULL;
 	int match_count = 0;
 	char *tmp = NULL;
 	uint32_t flags = 0;
@@ -92,19 +411,13 @@ SWITCH_DECLARE(int) switch_regex_perform(const char *field, const char *expressi
 		}
 	}
 
-	re = pcre_compile(expression,	/* the pattern */
-					  flags,	/* default options */
-					  &error,	/* for error message */
-					  &erroffset,	/* for error offset */
-					  NULL);	/* use default character tables */
-	if (error) {
-		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "COMPILE ERROR: %d [%s][%s]\n", erroffset, error, expression);
-		switch_regex_safe_free(re);
+	if (!(entry = regex_cache_get(expression, flags, dynamic, &error, &erroffset))) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "COMPILE ERROR: %d [%s][%s]\n", erroffset, switch_str_nil(error), expression);
 		goto end;
 	}
 
-	match_count = pcre_exec(re,	/* result of pcre_compile() */
-							NULL,	/* we didn't study the pattern */
+	match_count = pcre_exec(entry->re,	/* result of pcre_compile() */
+							entry->extra,	/* result of pcre_study() */
 							field,	/* the subject string */
 							(int) strlen(field),	/* the length of the subject string */
 							0,	/* start at offset 0 in the subject */
@@ -114,12 +427,13 @@ SWITCH_DECLARE(int) switch_regex_perform(const char *field, const char *expressi
 
 
 	if (match_count <= 0) {
-		switch_regex_safe_free(re);
+		regex_cache_release(entry);
 		match_count = 0;
+		*new_re = NULL;
+	} else {
+		*new_re = (switch_regex_t *) regex_cache_detach(entry);
 	}
 
-	*new_re = (switch_regex_t *) re;
-
   end:
 	switch_safe_free(tmp);
 	return match_count;
@@ -172,21 +486,16 @@ SWITCH_DECLARE(switch_status_t) switch_regex_match_partial(const char *target, c
 {
 	const char *error = NULL;	/* Used to hold any errors                                           */
 	int error_offset = 0;		/* Holds the offset of an error                                      */
-	pcre *pcre_prepared = NULL;	/* Holds the compiled regex                                          */
+	regex_cache_entry_t *entry = NULL;	/* Holds the compiled regex                                  */
 	int match_count = 0;		/* Number of times the regex was matched                             */
 	int offset_vectors[255];	/* not used, but has to exist or pcre won't even try to find a match */
 	int pcre_flags = 0;
 
 	/* Compile the expression */
-	pcre_prepared = pcre_compile(expression, 0, &error, &error_offset, NULL);
+	entry = regex_cache_get(expression, 0, SWITCH_FALSE, &error, &error_offset);
 
 	/* See if there was an error in the expression */
-	if (error != NULL) {
-		/* Clean up after ourselves */
-		if (pcre_prepared) {
-			pcre_free(pcre_prepared);
-			pcre_prepared = NULL;
-		}
+	if (!entry) {
 		/* Note our error */
 		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
 						  "Regular Expression Error expression[%s] error[%s] location[%d]\n", expression, error, error_offset);
@@ -201,13 +510,10 @@ SWITCH_DECLARE(switch_status_t) switch_regex_match_partial(const char *target, c
 
 	/* So far so good, run the regex */
 	match_count =
-		pcre_exec(pcre_prepared, NULL, target, (int) strlen(target), 0, pcre_flags, offset_vectors, sizeof(offset_vectors) / sizeof(offset_vectors[0]));
+		pcre_exec(entry->re, entry->extra, target, (int) strlen(target), 0, pcre_flags, offset_vectors, sizeof(offset_vectors) / sizeof(offset_vectors[0]));
 
 	/* Clean up */
-	if (pcre_prepared) {
-		pcre_free(pcre_prepared);
-		pcre_prepared = NULL;
-	}
+	regex_cache_release(entry);
 
 	/* switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "number of matches: %d\n", match_count); */
 
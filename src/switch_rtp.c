@@ -35,6 +35,9 @@
 //#define DEBUG_MISSED_SEQ
 #include <switch.h>
 #include <switch_stun.h>
+#ifndef WIN32
+#include <switch_private.h>
+#endif
 #undef PACKAGE_NAME
 #undef PACKAGE_STRING
 #undef PACKAGE_TARNAME
@@ -53,6 +56,11 @@
 
 #include "stfu.h"
 
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_RECVMMSG)
+#define ENABLE_RTP_IO
+#include <sys/epoll.h>
+#endif
+
 #define rtp_header_len 12
 #define RTP_START_PORT 16384
 #define RTP_END_PORT 32768
@@ -95,6 +103,65 @@ typedef struct {
 	char body[SWITCH_RTCP_MAX_BUF_LEN];
 } rtcp_msg_t;
 
+#ifdef ENABLE_RTP_IO
+/* 
+ * The shared RTP I/O engine: a few threads own the input sockets of timed
+ * audio sessions through epoll and drain them with recvmmsg into a per
+ * session ring.  The worker is the only producer and the session's reader
+ * (under read_mutex) the only consumer, so the ring needs no lock.
+ */
+#define RTP_IO_RING_LEN 16
+#define RTP_IO_SLOT_LEN 2048
+#define RTP_IO_EVENTS 256
+
+typedef struct {
+	uint32_t len;
+	socklen_t fromlen;
+	struct sockaddr_storage from;
+	char buf[RTP_IO_SLOT_LEN];
+} rtp_io_slot_t;
+
+struct rtp_io_worker_s;
+
+typedef struct rtp_io_reg_s {
+	int fd;
+	int dead;
+	/* the ring filled with datagrams still on the socket, the reader re-arms it once there is room */
+	volatile int stalled;
+	uint64_t dead_cycle;
+	struct rtp_io_worker_s *worker;
+	volatile uint32_t head;
+	volatile uint32_t tail;
+	struct rtp_io_reg_s *next;
+	rtp_io_slot_t slots[RTP_IO_RING_LEN];
+} rtp_io_reg_t;
+
+typedef struct rtp_io_worker_s {
+	int index;
+	int epfd;
+	int running;
+	switch_thread_t *thread;
+	switch_mutex_t *mutex;
+	uint64_t cycle;
+	uint32_t regs;
+	rtp_io_reg_t *graveyard;
+	uint64_t wakeups;
+	uint64_t calls;
+	uint64_t packets;
+	uint64_t full;
+	uint64_t truncated;
+} rtp_io_worker_t;
+
+static struct {
+	uint32_t threads;
+	uint32_t count;
+	uint32_t next;
+	rtp_io_worker_t *workers;
+} rtp_io;
+
+#define rtp_io_barrier() __sync_synchronize()
+#endif
+
 struct switch_rtp_vad_data {
 	switch_core_session_t *session;
 	switch_codec_t vad_codec;
@@ -249,6 +316,9 @@ struct switch_rtp {
 	uint16_t last_seq;
 	switch_time_t last_read_time;
 	switch_size_t last_flush_packet_count;
+#ifdef ENABLE_RTP_IO
+	rtp_io_reg_t *io_reg;
+#endif
 };
 
 struct switch_rtcp_senderinfo {
@@ -804,6 +874,384 @@ static void zrtp_logger(int level, const char *data, int len, int offset)
 }
 #endif
 
+#ifdef ENABLE_RTP_IO
+static void rtp_io_drain(rtp_io_worker_t *worker, rtp_io_reg_t *reg)
+{
+	struct mmsghdr msgs[RTP_IO_RING_LEN];
+	struct iovec iov[RTP_IO_RING_LEN];
+	uint32_t head = reg->head, space, i;
+	int got;
+
+	for (;;) {
+		space = RTP_IO_RING_LEN - (head - reg->tail);
+		rtp_io_barrier();
+
+		if (!space) {
+			/* the reader is behind, with edge triggering nothing wakes us for what is left on the
+			   socket so the reader re-arms the fd once it has made room */
+			worker->full++;
+			reg->stalled = 1;
+			return;
+		}
+
+		memset(msgs, 0, sizeof(*msgs) * space);
+
+		for (i = 0; i < space; i++) {
+			rtp_io_slot_t *slot = &reg->slots[(head + i) % RTP_IO_RING_LEN];
+
+			iov[i].iov_base = slot->buf;
+			iov[i].iov_len = sizeof(slot->buf);
+			msgs[i].msg_hdr.msg_name = &slot->from;
+			msgs[i].msg_hdr.msg_namelen = sizeof(slot->from);
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		worker->calls++;
+
+		if ((got = recvmmsg(reg->fd, msgs, space, MSG_DONTWAIT, NULL)) <= 0) {
+			if (got < 0 && errno == EINTR) {
+				continue;
+			}
+			return;
+		}
+
+		for (i = 0; i < (uint32_t) got; i++) {
+			rtp_io_slot_t *slot = &reg->slots[(head + i) % RTP_IO_RING_LEN];
+
+			if ((msgs[i].msg_hdr.msg_flags & MSG_TRUNC)) {
+				worker->truncated++;
+				slot->len = 0;
+			} else {
+				slot->len = msgs[i].msg_len;
+			}
+			slot->fromlen = msgs[i].msg_hdr.msg_namelen;
+		}
+
+		head += got;
+		worker->packets += got;
+		rtp_io_barrier();
+		reg->head = head;
+
+		if ((uint32_t) got < space) {
+			return;
+		}
+	}
+}
+
+static void rtp_io_reap(rtp_io_worker_t *worker, switch_bool_t all)
+{
+	rtp_io_reg_t *reg, *next, *keep = NULL;
+
+	switch_mutex_lock(worker->mutex);
+	for (reg = worker->graveyard; reg; reg = next) {
+		next = reg->next;
+		/* an epoll_wait that began before the reg died has finished by now */
+		if (all || reg->dead_cycle < worker->cycle) {
+			free(reg);
+		} else {
+			reg->next = keep;
+			keep = reg;
+		}
+	}
+	worker->graveyard = keep;
+	switch_mutex_unlock(worker->mutex);
+}
+
+static void *SWITCH_THREAD_FUNC rtp_io_thread(switch_thread_t *thread, void *obj)
+{
+	rtp_io_worker_t *worker = (rtp_io_worker_t *) obj;
+	struct epoll_event events[RTP_IO_EVENTS];
+	int i, n;
+
+	while (worker->running) {
+		if (worker->graveyard) {
+			rtp_io_reap(worker, SWITCH_FALSE);
+		}
+
+		n = epoll_wait(worker->epfd, events, RTP_IO_EVENTS, 100);
+
+		switch_mutex_lock(worker->mutex);
+		if (n > 0) {
+			worker->wakeups++;
+		}
+		for (i = 0; i < n; i++) {
+			rtp_io_reg_t *reg = (rtp_io_reg_t *) events[i].data.ptr;
+
+			if (!reg->dead) {
+				rtp_io_drain(worker, reg);
+			}
+		}
+		worker->cycle++;
+		switch_mutex_unlock(worker->mutex);
+	}
+
+	return NULL;
+}
+
+static void rtp_io_start(switch_memory_pool_t *pool)
+{
+	switch_threadattr_t *thd_attr = NULL;
+	uint32_t i;
+
+	if (!rtp_io.threads) {
+		return;
+	}
+
+	rtp_io.workers = switch_core_alloc(pool, sizeof(rtp_io_worker_t) * rtp_io.threads);
+
+	for (i = 0; i < rtp_io.threads; i++) {
+		rtp_io_worker_t *worker = &rtp_io.workers[i];
+
+		worker->index = i;
+
+		if ((worker->epfd = epoll_create(RTP_IO_EVENTS)) < 0) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "RTP I/O thread %u: epoll_create failed: %s\n", i, strerror(errno));
+			break;
+		}
+
+		switch_mutex_init(&worker->mutex, SWITCH_MUTEX_NESTED, pool);
+		worker->running = 1;
+
+		switch_threadattr_create(&thd_attr, pool);
+		switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+		switch_threadattr_priority_increase(thd_attr);
+		switch_thread_create(&worker->thread, thd_attr, rtp_io_thread, worker, pool);
+		rtp_io.count++;
+	}
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Started %u RTP I/O thread%s\n", rtp_io.count, rtp_io.count == 1 ? "" : "s");
+}
+
+static void rtp_io_stop(void)
+{
+	switch_status_t st;
+	uint32_t i;
+
+	for (i = 0; i < rtp_io.count; i++) {
+		rtp_io_worker_t *worker = &rtp_io.workers[i];
+		switch_thread_t *thread = worker->thread;
+
+		worker->running = 0;
+		switch_thread_join(&st, thread);
+
+		switch_mutex_lock(worker->mutex);
+		worker->thread = NULL;
+		close(worker->epfd);
+		worker->epfd = -1;
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG,
+						  "RTP I/O thread %u: %" SWITCH_UINT64_T_FMT " packets in %" SWITCH_UINT64_T_FMT " reads over %" SWITCH_UINT64_T_FMT
+						  " wakeups, %" SWITCH_UINT64_T_FMT " ring full, %" SWITCH_UINT64_T_FMT " truncated\n",
+						  i, worker->packets, worker->calls, worker->wakeups, worker->full, worker->truncated);
+		switch_mutex_unlock(worker->mutex);
+
+		rtp_io_reap(worker, SWITCH_TRUE);
+	}
+
+	rtp_io.count = 0;
+}
+
+static int rtp_io_usable(switch_rtp_t *rtp_session)
+{
+	return switch_test_flag(rtp_session, SWITCH_RTP_FLAG_USE_TIMER) &&
+		!switch_test_flag(rtp_session, SWITCH_RTP_FLAG_PROXY_MEDIA) &&
+		!switch_test_flag(rtp_session, SWITCH_RTP_FLAG_UDPTL) &&
+		!switch_test_flag(rtp_session, SWITCH_RTP_FLAG_VIDEO);
+}
+
+static void rtp_io_attach(switch_rtp_t *rtp_session)
+{
+	rtp_io_worker_t *worker;
+	rtp_io_reg_t *reg;
+	struct epoll_event ev = { 0 };
+	switch_os_socket_t fd;
+
+	/* room for 16 bit stereo plus srtp auth in one slot, anything bigger stays on the direct path */
+	if (!rtp_io.count || rtp_session->io_reg || !rtp_session->sock_input || !rtp_io_usable(rtp_session) ||
+		rtp_session->samples_per_interval * 4 + rtp_header_len + 16 > RTP_IO_SLOT_LEN) {
+		return;
+	}
+
+	if (switch_os_sock_get(&fd, rtp_session->sock_input) != SWITCH_STATUS_SUCCESS) {
+		return;
+	}
+
+	switch_zmalloc(reg, sizeof(*reg));
+	reg->fd = fd;
+	/* an unlocked round robin, a lost increment only skews the balance */
+	worker = reg->worker = &rtp_io.workers[rtp_io.next++ % rtp_io.count];
+
+	ev.events = EPOLLIN | EPOLLET;
+	ev.data.ptr = reg;
+
+	switch_mutex_lock(worker->mutex);
+	if (!worker->running || epoll_ctl(worker->epfd, EPOLL_CTL_ADD, fd, &ev)) {
+		switch_mutex_unlock(worker->mutex);
+		free(reg);
+		return;
+	}
+	worker->regs++;
+	switch_mutex_unlock(worker->mutex);
+
+	rtp_session->io_reg = reg;
+}
+
+/* stop feeding the ring, the reader may still drain what is left in it */
+static void rtp_io_detach(rtp_io_reg_t *reg)
+{
+	rtp_io_worker_t *worker = reg->worker;
+
+	switch_mutex_lock(worker->mutex);
+	if (!reg->dead) {
+		if (worker->epfd > -1) {
+			epoll_ctl(worker->epfd, EPOLL_CTL_DEL, reg->fd, NULL);
+		}
+		reg->dead = 1;
+		reg->dead_cycle = worker->cycle;
+		worker->regs--;
+	}
+	switch_mutex_unlock(worker->mutex);
+}
+
+/* the ring filled up before the socket was empty, have epoll report the fd again now there is room */
+static void rtp_io_rearm(rtp_io_reg_t *reg)
+{
+	rtp_io_worker_t *worker = reg->worker;
+	struct epoll_event ev = { 0 };
+
+	switch_mutex_lock(worker->mutex);
+	if (reg->stalled && !reg->dead && worker->epfd > -1) {
+		reg->stalled = 0;
+		ev.events = EPOLLIN | EPOLLET;
+		ev.data.ptr = reg;
+		epoll_ctl(worker->epfd, EPOLL_CTL_MOD, reg->fd, &ev);
+	}
+	switch_mutex_unlock(worker->mutex);
+}
+
+/* must only be called when nobody can be reading the session */
+static void rtp_io_release(switch_rtp_t *rtp_session)
+{
+	rtp_io_worker_t *worker;
+	rtp_io_reg_t *reg;
+
+	if (!(reg = rtp_session->io_reg)) {
+		return;
+	}
+
+	rtp_session->io_reg = NULL;
+	rtp_io_detach(reg);
+	worker = reg->worker;
+
+	switch_mutex_lock(worker->mutex);
+	if (worker->thread) {
+		reg->next = worker->graveyard;
+		worker->graveyard = reg;
+		reg = NULL;
+	}
+	switch_mutex_unlock(worker->mutex);
+
+	switch_safe_free(reg);
+}
+
+static switch_status_t rtp_io_recvfrom(switch_rtp_t *rtp_session, void *buf, switch_size_t *bytes)
+{
+	rtp_io_reg_t *reg = rtp_session->io_reg;
+	uint32_t tail = reg->tail;
+	switch_size_t len = *bytes;
+
+	*bytes = 0;
+
+	while (tail != reg->head) {
+		rtp_io_slot_t *slot;
+
+		rtp_io_barrier();
+		slot = &reg->slots[tail % RTP_IO_RING_LEN];
+
+		if (slot->len) {
+			if (len > slot->len) {
+				len = slot->len;
+			}
+			memcpy(buf, slot->buf, len);
+			switch_sockaddr_set_raw(rtp_session->from_addr, &slot->from, (uint32_t) slot->fromlen);
+			*bytes = len;
+		}
+
+		tail++;
+		rtp_io_barrier();
+		reg->tail = tail;
+
+		if (reg->stalled) {
+			rtp_io_rearm(reg);
+		}
+
+		if (*bytes) {
+			return SWITCH_STATUS_SUCCESS;
+		}
+	}
+
+	return SWITCH_STATUS_BREAK;
+}
+#endif
+
+static switch_status_t rtp_recvfrom(switch_rtp_t *rtp_session, switch_size_t *bytes)
+{
+#ifdef ENABLE_RTP_IO
+	rtp_io_reg_t *reg;
+
+	if ((reg = rtp_session->io_reg)) {
+		if (!reg->dead) {
+			if (rtp_io_usable(rtp_session)) {
+				return rtp_io_recvfrom(rtp_session, (void *) &rtp_session->recv_msg, bytes);
+			}
+			/* the session left timed audio mode, hand the socket back to the reader */
+			rtp_io_detach(reg);
+		}
+
+		/* what the worker already pulled off the socket is older than anything still on it */
+		if (reg->tail != reg->head) {
+			switch_size_t len = *bytes;
+
+			if (rtp_io_recvfrom(rtp_session, (void *) &rtp_session->recv_msg, bytes) == SWITCH_STATUS_SUCCESS) {
+				return SWITCH_STATUS_SUCCESS;
+			}
+			*bytes = len;
+		}
+	}
+#endif
+	return switch_socket_recvfrom(rtp_session->from_addr, rtp_session->sock_input, 0, (void *) &rtp_session->recv_msg, bytes);
+}
+
+static int rtp_input_pending(switch_rtp_t *rtp_session)
+{
+	int fdr = 0;
+
+#ifdef ENABLE_RTP_IO
+	if (rtp_session->io_reg) {
+		if (rtp_session->io_reg->tail != rtp_session->io_reg->head) {
+			return 1;
+		}
+		if (!rtp_session->io_reg->dead) {
+			return 0;
+		}
+	}
+#endif
+	return switch_poll(rtp_session->read_pollfd, 1, &fdr, 0) == SWITCH_STATUS_SUCCESS;
+}
+
+SWITCH_DECLARE(void) switch_rtp_set_io_threads(uint32_t threads)
+{
+#ifdef ENABLE_RTP_IO
+	if (!global_init) {
+		rtp_io.threads = threads;
+	}
+#else
+	if (threads) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "rtp-io-threads is not supported on this platform\n");
+	}
+#endif
+}
+
 SWITCH_DECLARE(void) switch_rtp_init(switch_memory_pool_t *pool)
 {
 #ifdef ENABLE_ZRTP
@@ -846,6 +1294,9 @@ SWITCH_DECLARE(void) switch_rtp_init(switch_memory_pool_t *pool)
 #endif
 	srtp_init();
 	switch_mutex_init(&port_lock, SWITCH_MUTEX_NESTED, pool);
+#ifdef ENABLE_RTP_IO
+	rtp_io_start(pool);
+#endif
 	global_init = 1;
 }
 
@@ -866,6 +1317,10 @@ SWITCH_DECLARE(void) switch_rtp_shutdown(void)
 		return;
 	}
 
+#ifdef ENABLE_RTP_IO
+	rtp_io_stop();
+#endif
+
 	switch_mutex_lock(port_lock);
 
 	for (hi = switch_hash_first(NULL, alloc_hash); hi; hi = switch_hash_next(hi)) {
@@ -929,6 +1384,8 @@ SWITCH_DECLARE(switch_port_t) switch_rtp_set_end_port(switch_port_t port)
 	return END_PORT;
 }
 
+/* port_lock only guards the ip to allocator map, each allocator has its own lock so
+   calls on different ips don't wait on each other */
 SWITCH_DECLARE(void) switch_rtp_release_port(const char *ip, switch_port_t port)
 {
 	switch_core_port_allocator_t *alloc = NULL;
@@ -938,11 +1395,12 @@ SWITCH_DECLARE(void) switch_rtp_release_port(const char *ip, switch_port_t port)
 	}
 
 	switch_mutex_lock(port_lock);
-	if ((alloc = switch_core_hash_find(alloc_hash, ip))) {
-		switch_core_port_allocator_free_port(alloc, port);
-	}
+	alloc = switch_core_hash_find(alloc_hash, ip);
 	switch_mutex_unlock(port_lock);
 
+	if (alloc) {
+		switch_core_port_allocator_free_port(alloc, port);
+	}
 }
 
 SWITCH_DECLARE(switch_port_t) switch_rtp_request_port(const char *ip)
@@ -959,15 +1417,33 @@ SWITCH_DECLARE(switch_port_t) switch_rtp_request_port(const char *ip)
 
 		switch_core_hash_insert(alloc_hash, ip, alloc);
 	}
+	switch_mutex_unlock(port_lock);
 
 	if (switch_core_port_allocator_request_port(alloc, &port) != SWITCH_STATUS_SUCCESS) {
+		switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR, "No free RTP ports left on %s\n", ip);
 		port = 0;
 	}
 
-	switch_mutex_unlock(port_lock);
 	return port;
 }
 
+SWITCH_DECLARE(void) switch_rtp_port_usage(switch_stream_handle_t *stream)
+{
+	switch_hash_index_t *hi;
+	const void *var;
+	void *val;
+	switch_core_port_allocator_stats_t stats;
+
+	switch_mutex_lock(port_lock);
+	for (hi = switch_hash_first(NULL, alloc_hash); hi; hi = switch_hash_next(hi)) {
+		switch_hash_this(hi, &var, NULL, &val);
+		switch_core_port_allocator_stats((switch_core_port_allocator_t *) val, &stats);
+		stream->write_function(stream, "rtp ports %s %u-%u %u/%u used, %u peak, %u resting, %" SWITCH_UINT64_T_FMT " failed\n",
+							   (char *) var, stats.start, stats.end, stats.used, stats.total, stats.high_water, stats.quarantined, stats.failed);
+	}
+	switch_mutex_unlock(port_lock);
+}
+
 SWITCH_DECLARE(void) switch_rtp_intentional_bugs(switch_rtp_t *rtp_session, switch_rtp_bug_flag_t bugs)
 {
 	rtp_session->rtp_bugs = bugs;
@@ -1179,6 +1655,11 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_set_local_address(switch_rtp_t *rtp_s
 
 	switch_socket_create_pollset(&rtp_session->read_pollfd, rtp_session->sock_input, SWITCH_POLLIN | SWITCH_POLLERR, rtp_session->pool);
 
+#ifdef ENABLE_RTP_IO
+	rtp_io_release(rtp_session);
+	rtp_io_attach(rtp_session);
+#endif
+
 	if (switch_test_flag(rtp_session, SWITCH_RTP_FLAG_ENABLE_RTCP)) {
 		if ((status = enable_local_rtcp_socket(rtp_session, err)) == SWITCH_STATUS_SUCCESS) {
 			*err = "Success";
@@ -1260,6 +1741,12 @@ SWITCH_DECLARE(switch_status_t) switch_rtp_udptl_mode(switch_rtp_t *rtp_session)
 
 	switch_clear_flag(rtp_session, SWITCH_RTP_FLAG_ENABLE_RTCP);
 
+#ifdef ENABLE_RTP_IO
+	if (rtp_session->io_reg) {
+		rtp_io_detach(rtp_session->io_reg);
+	}
+#endif
+
 	if (rtp_session->rtcp_sock_input) {
 		ping_socket(rtp_session);
 		switch_socket_shutdown(rtp_session->rtcp_sock_input, SWITCH_SHUTDOWN_READWRITE);
@@ -2019,6 +2506,11 @@ SWITCH_DECLARE(void) switch_rtp_kill_socket(switch_rtp_t *rtp_session)
 	switch_mutex_lock(rtp_session->flag_mutex);
 	if (switch_test_flag(rtp_session, SWITCH_RTP_FLAG_IO)) {
 		switch_clear_flag(rtp_session, SWITCH_RTP_FLAG_IO);
+#ifdef ENABLE_RTP_IO
+		if (rtp_session->io_reg) {
+			rtp_io_detach(rtp_session->io_reg);
+		}
+#endif
 		if (rtp_session->sock_input) {
 			ping_socket(rtp_session);
 			switch_socket_shutdown(rtp_session->sock_input, SWITCH_SHUTDOWN_READWRITE);
@@ -2091,6 +2583,10 @@ SWITCH_DECLARE(void) switch_rtp_destroy(switch_rtp_t **rtp_session)
 		stfu_n_destroy(&(*rtp_session)->jb);
 	}
 
+#ifdef ENABLE_RTP_IO
+	rtp_io_release(*rtp_session);
+#endif
+
 	sock = (*rtp_session)->sock_input;
 	(*rtp_session)->sock_input = NULL;
 	switch_socket_close(sock);
@@ -2196,6 +2692,12 @@ SWITCH_DECLARE(void) switch_rtp_set_flag(switch_rtp_t *rtp_session, switch_rtp_f
 		switch_socket_opt_set(rtp_session->sock_input, SWITCH_SO_NONBLOCK, TRUE);
 	}
 
+#ifdef ENABLE_RTP_IO
+	/* once out of timed audio mode a session stays on the direct read path */
+	if (rtp_session->io_reg && (flags & (SWITCH_RTP_FLAG_PROXY_MEDIA | SWITCH_RTP_FLAG_UDPTL | SWITCH_RTP_FLAG_VIDEO))) {
+		rtp_io_detach(rtp_session->io_reg);
+	}
+#endif
 }
 
 SWITCH_DECLARE(uint32_t) switch_rtp_test_flag(switch_rtp_t *rtp_session, switch_rtp_flag_t flags)
@@ -2210,6 +2712,12 @@ SWITCH_DECLARE(void) switch_rtp_clear_flag(switch_rtp_t *rtp_session, switch_rtp
 	if (flags & SWITCH_RTP_FLAG_NOBLOCK) {
 		switch_socket_opt_set(rtp_session->sock_input, SWITCH_SO_NONBLOCK, FALSE);
 	}
+
+#ifdef ENABLE_RTP_IO
+	if (rtp_session->io_reg && (flags & SWITCH_RTP_FLAG_USE_TIMER)) {
+		rtp_io_detach(rtp_session->io_reg);
+	}
+#endif
 }
 
 static void do_2833(switch_rtp_t *rtp_session, switch_core_session_t *session)
@@ -2377,7 +2885,7 @@ static void do_flush(switch_rtp_t *rtp_session)
 		do {
 			if (switch_rtp_ready(rtp_session)) {
 				bytes = sizeof(rtp_msg_t);
-				status = switch_socket_recvfrom(rtp_session->from_addr, rtp_session->sock_input, 0, (void *) &rtp_session->recv_msg, &bytes);
+				status = rtp_recvfrom(rtp_session, &bytes);
 				if (bytes) {
 					int do_cng = 0;
 
@@ -2424,7 +2932,7 @@ static switch_status_t read_rtp_packet(switch_rtp_t *rtp_session, switch_size_t
 	switch_assert(bytes);
  more:
 	*bytes = sizeof(rtp_msg_t);
-	status = switch_socket_recvfrom(rtp_session->from_addr, rtp_session->sock_input, 0, (void *) &rtp_session->recv_msg, bytes);
+	status = rtp_recvfrom(rtp_session, bytes);
 	ts = ntohl(rtp_session->recv_msg.header.ts);
 
 	if (*bytes) {
@@ -2762,7 +3270,7 @@ static int rtp_common_read(switch_rtp_t *rtp_session, switch_payload_t *payload_
 		if (switch_test_flag(rtp_session, SWITCH_RTP_FLAG_USE_TIMER)) {
 			if ((switch_test_flag(rtp_session, SWITCH_RTP_FLAG_AUTOFLUSH) || switch_test_flag(rtp_session, SWITCH_RTP_FLAG_STICKY_FLUSH)) &&
 				rtp_session->read_pollfd) {
-				if (switch_poll(rtp_session->read_pollfd, 1, &fdr, 0) == SWITCH_STATUS_SUCCESS) {
+				if (rtp_input_pending(rtp_session)) {
 					status = read_rtp_packet(rtp_session, &bytes, flags, SWITCH_FALSE);
 					/* switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Initial (%i) %d\n", status, bytes); */
 					if (status != SWITCH_STATUS_FALSE) {
@@ -2770,7 +3278,7 @@ static int rtp_common_read(switch_rtp_t *rtp_session, switch_payload_t *payload_
 					}
 
 					if (bytes) {
-						if (switch_poll(rtp_session->read_pollfd, 1, &fdr, 0) == SWITCH_STATUS_SUCCESS) {
+						if (rtp_input_pending(rtp_session)) {
 							/* switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Trigger %d\n", rtp_session->hot_hits); */
 							rtp_session->hot_hits += rtp_session->samples_per_interval;
 						} else {
@@ -32,146 +32,327 @@
 
 #include <switch.h>
 
+/* own-thread tasks share a pool of workers that grows on demand up to this many */
+#define SCHEDULER_MAX_WORKERS 32
+/* never sleep longer than this so a stop request is noticed */
+#define SCHEDULER_MAX_WAIT_MS 1000
+/* how long an own-thread task waits before retrying when the worker queue is full */
+#define SCHEDULER_RETRY_MS 10
+
 struct switch_scheduler_task_container {
 	switch_scheduler_task_t task;
 	int64_t executed;
+	int64_t due;
 	int in_thread;
 	int destroyed;
 	switch_scheduler_func_t func;
-	switch_memory_pool_t *pool;
 	uint32_t flags;
 	char *desc;
-	struct switch_scheduler_task_container *next;
+	int heap_index;
+	struct switch_scheduler_task_container *group_next;
+	struct switch_scheduler_task_container *group_prev;
 };
 typedef struct switch_scheduler_task_container switch_scheduler_task_container_t;
 
 static struct {
-	switch_scheduler_task_container_t *task_list;
+	switch_scheduler_task_container_t **heap;
+	uint32_t heap_size;
+	uint32_t heap_alloc;
+	switch_hash_t *task_hash;
+	switch_hash_t *group_hash;
 	switch_mutex_t *task_mutex;
+	switch_thread_cond_t *task_cond;
 	uint32_t task_id;
 	int task_thread_running;
 	switch_memory_pool_t *memory_pool;
+	switch_queue_t *worker_queue;
+	uint32_t workers;
+	uint32_t workers_busy;
+	int workers_running;
 } globals;
 
-static void switch_scheduler_execute(switch_scheduler_task_container_t *tp)
+static int64_t switch_scheduler_now(void)
+{
+	return switch_micro_time_now() / 1000;
+}
+
+static void switch_scheduler_fire_event(switch_scheduler_task_container_t *tp, switch_event_types_t event_id)
 {
 	switch_event_t *event;
-	//switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Executing task %u %s (%s)\n", tp->task.task_id, tp->desc, switch_str_nil(tp->task.group));
 
-	tp->func(&tp->task);
+	if (switch_event_create(&event, event_id) == SWITCH_STATUS_SUCCESS) {
+		switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Task-ID", "%u", tp->task.task_id);
+		switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Task-Desc", tp->desc);
+		switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Task-Group", switch_str_nil(tp->task.group));
+		switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Task-Runtime", "%" SWITCH_INT64_T_FMT, tp->task.runtime);
+		switch_event_fire(&event);
+	}
+}
 
-	if (tp->task.runtime > tp->executed) {
-		tp->executed = 0;
-		if (switch_event_create(&event, SWITCH_EVENT_RE_SCHEDULE) == SWITCH_STATUS_SUCCESS) {
-			switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Task-ID", "%u", tp->task.task_id);
-			switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Task-Desc", tp->desc);
-			switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Task-Group", switch_str_nil(tp->task.group));
-			switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Task-Runtime", "%" SWITCH_INT64_T_FMT, tp->task.runtime);
-			switch_event_fire(&event);
-		}
-	} else {
-		if (switch_event_create(&event, SWITCH_EVENT_DEL_SCHEDULE) == SWITCH_STATUS_SUCCESS) {
-			switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Task-ID", "%u", tp->task.task_id);
-			switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Task-Desc", tp->desc);
-			switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Task-Group", switch_str_nil(tp->task.group));
-			switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Task-Runtime", "%" SWITCH_INT64_T_FMT, tp->task.runtime);
-			switch_event_fire(&event);
+/* The pending tasks are a binary min-heap on due time (epoch ms).  Each container remembers its slot so a
+   delete by id or group is O(log n) instead of a walk over every task. */
+
+static void heap_set(uint32_t i, switch_scheduler_task_container_t *tp)
+{
+	globals.heap[i] = tp;
+	tp->heap_index = (int) i;
+}
+
+static void heap_sift_up(uint32_t i)
+{
+	switch_scheduler_task_container_t *tp = globals.heap[i];
+
+	while (i > 0) {
+		uint32_t parent = (i - 1) / 2;
+
+		if (globals.heap[parent]->due <= tp->due) {
+			break;
 		}
-		tp->destroyed = 1;
+		heap_set(i, globals.heap[parent]);
+		i = parent;
 	}
+
+	heap_set(i, tp);
 }
 
-static void *SWITCH_THREAD_FUNC task_own_thread(switch_thread_t *thread, void *obj)
+static void heap_sift_down(uint32_t i)
 {
-	switch_scheduler_task_container_t *tp = (switch_scheduler_task_container_t *) obj;
-	switch_memory_pool_t *pool;
+	switch_scheduler_task_container_t *tp = globals.heap[i];
 
-	pool = tp->pool;
-	tp->pool = NULL;
+	for (;;) {
+		uint32_t child = i * 2 + 1;
 
-	switch_scheduler_execute(tp);
-	switch_core_destroy_memory_pool(&pool);
-	tp->in_thread = 0;
+		if (child >= globals.heap_size) {
+			break;
+		}
+		if (child + 1 < globals.heap_size && globals.heap[child + 1]->due < globals.heap[child]->due) {
+			child++;
+		}
+		if (tp->due <= globals.heap[child]->due) {
+			break;
+		}
+		heap_set(i, globals.heap[child]);
+		i = child;
+	}
 
-	return NULL;
+	heap_set(i, tp);
 }
 
-static int task_thread_loop(int done)
+static void heap_insert(switch_scheduler_task_container_t *tp)
 {
-	switch_scheduler_task_container_t *tofree, *tp, *last = NULL;
+	if (globals.heap_size == globals.heap_alloc) {
+		globals.heap_alloc = globals.heap_alloc ? globals.heap_alloc * 2 : 1024;
+		globals.heap = realloc(globals.heap, sizeof(*globals.heap) * globals.heap_alloc);
+		switch_assert(globals.heap);
+	}
 
+	heap_set(globals.heap_size++, tp);
+	heap_sift_up(tp->heap_index);
+}
 
-	switch_mutex_lock(globals.task_mutex);
+static void heap_remove(switch_scheduler_task_container_t *tp)
+{
+	uint32_t i = (uint32_t) tp->heap_index;
+	switch_scheduler_task_container_t *last;
 
-	for (tp = globals.task_list; tp; tp = tp->next) {
-		if (done) {
-			tp->destroyed = 1;
+	if (tp->heap_index < 0) {
+		return;
+	}
+
+	tp->heap_index = -1;
+	last = globals.heap[--globals.heap_size];
+
+	if (last != tp) {
+		heap_set(i, last);
+		if (i > 0 && globals.heap[(i - 1) / 2]->due > last->due) {
+			heap_sift_up(i);
 		} else {
-			int64_t now = switch_epoch_time_now(NULL);
-			if (now >= tp->task.runtime && !tp->in_thread) {
-				int32_t diff = (int32_t) (now - tp->task.runtime);
-				if (diff > 1) {
-					switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Task was executed late by %d seconds %u %s (%s)\n",
-									  diff, tp->task.task_id, tp->desc, switch_str_nil(tp->task.group));
-				}
-				tp->executed = now;
-				if (switch_test_flag(tp, SSHF_OWN_THREAD)) {
-					switch_thread_t *thread;
-					switch_threadattr_t *thd_attr;
-					switch_core_new_memory_pool(&tp->pool);
-					switch_threadattr_create(&thd_attr, tp->pool);
-					switch_threadattr_detach_set(thd_attr, 1);
-					tp->in_thread = 1;
-					switch_thread_create(&thread, thd_attr, task_own_thread, tp, tp->pool);
-				} else {
-					switch_scheduler_execute(tp);
-				}
-			}
+			heap_sift_down(i);
 		}
 	}
-	switch_mutex_unlock(globals.task_mutex);
+}
+
+static void task_index_add(switch_scheduler_task_container_t *tp)
+{
+	char id[32];
+	switch_scheduler_task_container_t *head;
+
+	switch_snprintf(id, sizeof(id), "%u", tp->task.task_id);
+	switch_core_hash_insert(globals.task_hash, id, tp);
+
+	if ((head = switch_core_hash_find(globals.group_hash, tp->task.group))) {
+		tp->group_next = head;
+		head->group_prev = tp;
+	}
+	switch_core_hash_insert(globals.group_hash, tp->task.group, tp);
+}
+
+static void task_index_del(switch_scheduler_task_container_t *tp)
+{
+	char id[32];
+
+	switch_snprintf(id, sizeof(id), "%u", tp->task.task_id);
+	switch_core_hash_delete(globals.task_hash, id);
+
+	if (tp->group_prev) {
+		tp->group_prev->group_next = tp->group_next;
+	} else if (tp->group_next) {
+		switch_core_hash_insert(globals.group_hash, tp->task.group, tp->group_next);
+	} else {
+		switch_core_hash_delete(globals.group_hash, tp->task.group);
+	}
+
+	if (tp->group_next) {
+		tp->group_next->group_prev = tp->group_prev;
+	}
+
+	tp->group_next = tp->group_prev = NULL;
+}
+
+static void task_free(switch_scheduler_task_container_t *tp)
+{
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Deleting task %u %s (%s)\n",
+					  tp->task.task_id, tp->desc, switch_str_nil(tp->task.group));
+
+	task_index_del(tp);
+	switch_safe_free(tp->task.group);
+	if (tp->task.cmd_arg && switch_test_flag(tp, SSHF_FREE_ARG)) {
+		free(tp->task.cmd_arg);
+	}
+	switch_safe_free(tp->desc);
+	free(tp);
+}
+
+/* runs the task without task_mutex held, returns SWITCH_TRUE when the callback moved runtime forward */
+static switch_bool_t switch_scheduler_execute(switch_scheduler_task_container_t *tp)
+{
+	//switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Executing task %u %s (%s)\n", tp->task.task_id, tp->desc, switch_str_nil(tp->task.group));
+
+	tp->func(&tp->task);
+
+	if (tp->task.runtime > tp->executed) {
+		tp->executed = 0;
+		switch_scheduler_fire_event(tp, SWITCH_EVENT_RE_SCHEDULE);
+		return SWITCH_TRUE;
+	}
+
+	switch_scheduler_fire_event(tp, SWITCH_EVENT_DEL_SCHEDULE);
+	return SWITCH_FALSE;
+}
+
+/* called with task_mutex held once a task has run */
+static void task_done(switch_scheduler_task_container_t *tp, switch_bool_t reschedule)
+{
+	tp->in_thread = 0;
+
+	if (!reschedule || tp->destroyed || globals.task_thread_running != 1) {
+		task_free(tp);
+		return;
+	}
+
+	tp->due = tp->task.runtime * 1000;
+	heap_insert(tp);
+}
+
+static void *SWITCH_THREAD_FUNC task_worker_thread(switch_thread_t *thread, void *obj)
+{
+	void *pop;
+
+	while (switch_queue_pop(globals.worker_queue, &pop) == SWITCH_STATUS_SUCCESS && pop) {
+		switch_scheduler_task_container_t *tp = (switch_scheduler_task_container_t *) pop;
+		switch_bool_t reschedule = switch_scheduler_execute(tp);
+
+		switch_mutex_lock(globals.task_mutex);
+		task_done(tp, reschedule);
+		globals.workers_busy--;
+		switch_thread_cond_signal(globals.task_cond);
+		switch_mutex_unlock(globals.task_mutex);
+	}
+
 	switch_mutex_lock(globals.task_mutex);
-	for (tp = globals.task_list; tp;) {
-		if (tp->destroyed && !tp->in_thread) {
-			tofree = tp;
-			tp = tp->next;
-			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Deleting task %u %s (%s)\n",
-							  tofree->task.task_id, tofree->desc, switch_str_nil(tofree->task.group));
-			if (last) {
-				last->next = tofree->next;
-			} else {
-				globals.task_list = tofree->next;
-			}
-			switch_safe_free(tofree->task.group);
-			if (tofree->task.cmd_arg && switch_test_flag(tofree, SSHF_FREE_ARG)) {
-				free(tofree->task.cmd_arg);
-			}
-			switch_safe_free(tofree->desc);
-			free(tofree);
-		} else {
-			last = tp;
-			tp = tp->next;
+	globals.workers--;
+	switch_mutex_unlock(globals.task_mutex);
+
+	return NULL;
+}
+
+/* called with task_mutex held */
+static void task_dispatch_own_thread(switch_scheduler_task_container_t *tp)
+{
+	if (++globals.workers_busy > globals.workers && globals.workers < SCHEDULER_MAX_WORKERS) {
+		switch_thread_t *thread;
+		switch_threadattr_t *thd_attr;
+
+		switch_threadattr_create(&thd_attr, globals.memory_pool);
+		switch_threadattr_detach_set(thd_attr, 1);
+		switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+		if (switch_thread_create(&thread, thd_attr, task_worker_thread, NULL, globals.memory_pool) == SWITCH_STATUS_SUCCESS) {
+			globals.workers++;
 		}
 	}
-	switch_mutex_unlock(globals.task_mutex);
 
-	return done;
+	/* never block on the queue while holding task_mutex, the workers need it to finish */
+	if (switch_queue_trypush(globals.worker_queue, tp) != SWITCH_STATUS_SUCCESS) {
+		globals.workers_busy--;
+		tp->in_thread = 0;
+		tp->due = switch_scheduler_now() + SCHEDULER_RETRY_MS;
+		heap_insert(tp);
+	}
 }
 
 static void *SWITCH_THREAD_FUNC switch_scheduler_task_thread(switch_thread_t *thread, void *obj)
 {
+	switch_scheduler_task_container_t *tp;
 
 	globals.task_thread_running = 1;
 
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Starting task thread\n");
+
+	switch_mutex_lock(globals.task_mutex);
+
 	while (globals.task_thread_running == 1) {
-		if (task_thread_loop(0)) {
-			break;
+		int64_t now = switch_scheduler_now();
+		int64_t diff;
+
+		if (!globals.heap_size || (tp = globals.heap[0])->due > now) {
+			int64_t wait = globals.heap_size ? globals.heap[0]->due - now : SCHEDULER_MAX_WAIT_MS;
+
+			if (wait > SCHEDULER_MAX_WAIT_MS) {
+				wait = SCHEDULER_MAX_WAIT_MS;
+			}
+			switch_thread_cond_timedwait(globals.task_cond, globals.task_mutex, wait * 1000);
+			continue;
+		}
+
+		heap_remove(tp);
+
+		if ((diff = (now - tp->due) / 1000) > 1) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Task was executed late by %d seconds %u %s (%s)\n",
+							  (int) diff, tp->task.task_id, tp->desc, switch_str_nil(tp->task.group));
+		}
+
+		tp->executed = now / 1000;
+		tp->in_thread = 1;
+
+		if (switch_test_flag(tp, SSHF_OWN_THREAD)) {
+			task_dispatch_own_thread(tp);
+		} else {
+			switch_bool_t reschedule;
+
+			switch_mutex_unlock(globals.task_mutex);
+			reschedule = switch_scheduler_execute(tp);
+			switch_mutex_lock(globals.task_mutex);
+			task_done(tp, reschedule);
 		}
-		switch_yield(500000);
 	}
 
-	task_thread_loop(1);
+	while (globals.heap_size) {
+		tp = globals.heap[0];
+		heap_remove(tp);
+		task_free(tp);
+	}
+
+	switch_mutex_unlock(globals.task_mutex);
 
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Task thread ending\n");
 	globals.task_thread_running = 0;
@@ -179,75 +360,90 @@ static void *SWITCH_THREAD_FUNC switch_scheduler_task_thread(switch_thread_t *th
 	return NULL;
 }
 
-SWITCH_DECLARE(uint32_t) switch_scheduler_add_task(time_t task_runtime,
-												   switch_scheduler_func_t func,
-												   const char *desc, const char *group, uint32_t cmd_id, void *cmd_arg, switch_scheduler_flag_t flags)
+static uint32_t switch_scheduler_add(int64_t due, switch_scheduler_func_t func,
+									 const char *desc, const char *group, uint32_t cmd_id, void *cmd_arg, switch_scheduler_flag_t flags)
 {
 	switch_scheduler_task_container_t *container, *tp;
-	switch_event_t *event;
 
-	switch_mutex_lock(globals.task_mutex);
-	switch_zmalloc(container, sizeof(*container));
 	switch_assert(func);
+	switch_zmalloc(container, sizeof(*container));
 	container->func = func;
 	container->task.created = switch_epoch_time_now(NULL);
-	container->task.runtime = task_runtime;
+	container->task.runtime = due / 1000;
 	container->task.group = strdup(group ? group : "none");
 	container->task.cmd_id = cmd_id;
 	container->task.cmd_arg = cmd_arg;
 	container->flags = flags;
 	container->desc = strdup(desc ? desc : "none");
+	container->due = due;
+	container->heap_index = -1;
 
-	for (tp = globals.task_list; tp && tp->next; tp = tp->next);
-
-	if (tp) {
-		tp->next = container;
-	} else {
-		globals.task_list = container;
-	}
+	switch_mutex_lock(globals.task_mutex);
 
 	for (container->task.task_id = 0; !container->task.task_id; container->task.task_id = ++globals.task_id);
 
+	task_index_add(container);
+	heap_insert(container);
+
+	/* only a new earliest task changes how long the task thread should sleep */
+	if (!container->heap_index) {
+		switch_thread_cond_signal(globals.task_cond);
+	}
+
 	switch_mutex_unlock(globals.task_mutex);
 
 	tp = container;
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Added task %u %s (%s) to run at %" SWITCH_INT64_T_FMT "\n",
 					  tp->task.task_id, tp->desc, switch_str_nil(tp->task.group), tp->task.runtime);
 
-	if (switch_event_create(&event, SWITCH_EVENT_ADD_SCHEDULE) == SWITCH_STATUS_SUCCESS) {
-		switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Task-ID", "%u", tp->task.task_id);
-		switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Task-Desc", tp->desc);
-		switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Task-Group", switch_str_nil(tp->task.group));
-		switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Task-Runtime", "%" SWITCH_INT64_T_FMT, tp->task.runtime);
-		switch_event_fire(&event);
+	switch_scheduler_fire_event(tp, SWITCH_EVENT_ADD_SCHEDULE);
+
+	return tp->task.task_id;
+}
+
+SWITCH_DECLARE(uint32_t) switch_scheduler_add_task(time_t task_runtime,
+												   switch_scheduler_func_t func,
+												   const char *desc, const char *group, uint32_t cmd_id, void *cmd_arg, switch_scheduler_flag_t flags)
+{
+	return switch_scheduler_add((int64_t) task_runtime * 1000, func, desc, group, cmd_id, cmd_arg, flags);
+}
+
+SWITCH_DECLARE(uint32_t) switch_scheduler_add_task_ms(int64_t task_runtime_ms,
+													  switch_scheduler_func_t func,
+													  const char *desc, const char *group, uint32_t cmd_id, void *cmd_arg, switch_scheduler_flag_t flags)
+{
+	return switch_scheduler_add(task_runtime_ms, func, desc, group, cmd_id, cmd_arg, flags);
+}
+
+/* called with task_mutex held; a task that is running right now is freed by whoever finishes it */
+static void task_delete(switch_scheduler_task_container_t *tp)
+{
+	switch_scheduler_fire_event(tp, SWITCH_EVENT_DEL_SCHEDULE);
+
+	if (tp->in_thread) {
+		tp->destroyed++;
+	} else {
+		heap_remove(tp);
+		task_free(tp);
 	}
-	return container->task.task_id;
 }
 
 SWITCH_DECLARE(uint32_t) switch_scheduler_del_task_id(uint32_t task_id)
 {
 	switch_scheduler_task_container_t *tp;
-	switch_event_t *event;
 	uint32_t delcnt = 0;
+	char id[32];
+
+	switch_snprintf(id, sizeof(id), "%u", task_id);
 
 	switch_mutex_lock(globals.task_mutex);
-	for (tp = globals.task_list; tp; tp = tp->next) {
-		if (tp->task.task_id == task_id) {
-			if (switch_test_flag(tp, SSHF_NO_DEL)) {
-				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Attempt made to delete undeletable task #%u (group %s)\n",
-								  tp->task.task_id, tp->task.group);
-				break;
-			}
-			tp->destroyed++;
-			if (switch_event_create(&event, SWITCH_EVENT_DEL_SCHEDULE) == SWITCH_STATUS_SUCCESS) {
-				switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Task-ID", "%u", tp->task.task_id);
-				switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Task-Desc", tp->desc);
-				switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Task-Group", switch_str_nil(tp->task.group));
-				switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Task-Runtime", "%" SWITCH_INT64_T_FMT, tp->task.runtime);
-				switch_event_fire(&event);
-			}
+	if ((tp = switch_core_hash_find(globals.task_hash, id)) && !tp->destroyed) {
+		if (switch_test_flag(tp, SSHF_NO_DEL)) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Attempt made to delete undeletable task #%u (group %s)\n",
+							  tp->task.task_id, tp->task.group);
+		} else {
+			task_delete(tp);
 			delcnt++;
-			break;
 		}
 	}
 	switch_mutex_unlock(globals.task_mutex);
@@ -257,28 +453,27 @@ SWITCH_DECLARE(uint32_t) switch_scheduler_del_task_id(uint32_t task_id)
 
 SWITCH_DECLARE(uint32_t) switch_scheduler_del_task_group(const char *group)
 {
-	switch_scheduler_task_container_t *tp;
-	switch_event_t *event;
+	switch_scheduler_task_container_t *tp, *next;
 	uint32_t delcnt = 0;
 
+	if (zstr(group)) {
+		return 0;
+	}
+
 	switch_mutex_lock(globals.task_mutex);
-	for (tp = globals.task_list; tp; tp = tp->next) {
-		if (!zstr(group) && !strcmp(tp->task.group, group)) {
-			if (switch_test_flag(tp, SSHF_NO_DEL)) {
-				switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Attempt made to delete undeletable task #%u (group %s)\n",
-								  tp->task.task_id, group);
-				continue;
-			}
-			if (switch_event_create(&event, SWITCH_EVENT_DEL_SCHEDULE) == SWITCH_STATUS_SUCCESS) {
-				switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Task-ID", "%u", tp->task.task_id);
-				switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Task-Desc", tp->desc);
-				switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, "Task-Group", switch_str_nil(tp->task.group));
-				switch_event_add_header(event, SWITCH_STACK_BOTTOM, "Task-Runtime", "%" SWITCH_INT64_T_FMT, tp->task.runtime);
-				switch_event_fire(&event);
-			}
-			tp->destroyed++;
-			delcnt++;
+	for (tp = switch_core_hash_find(globals.group_hash, group); tp; tp = next) {
+		next = tp->group_next;
+
+		if (tp->destroyed) {
+			continue;
+		}
+		if (switch_test_flag(tp, SSHF_NO_DEL)) {
+			switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "Attempt made to delete undeletable task #%u (group %s)\n",
+							  tp->task.task_id, group);
+			continue;
 		}
+		task_delete(tp);
+		delcnt++;
 	}
 	switch_mutex_unlock(globals.task_mutex);
 
@@ -294,7 +489,11 @@ SWITCH_DECLARE(void) switch_scheduler_task_thread_start(void)
 
 	switch_core_new_memory_pool(&globals.memory_pool);
 	switch_threadattr_create(&thd_attr, globals.memory_pool);
-	switch_mutex_init(&globals.task_mutex, SWITCH_MUTEX_NESTED, globals.memory_pool);
+	switch_mutex_init(&globals.task_mutex, SWITCH_MUTEX_DEFAULT, globals.memory_pool);
+	switch_thread_cond_create(&globals.task_cond, globals.memory_pool);
+	switch_core_hash_init(&globals.task_hash, globals.memory_pool);
+	switch_core_hash_init(&globals.group_hash, globals.memory_pool);
+	switch_queue_create(&globals.worker_queue, SWITCH_CORE_QUEUE_LEN, globals.memory_pool);
 
 	switch_threadattr_detach_set(thd_attr, 1);
 	switch_thread_create(&task_thread_p, thd_attr, switch_scheduler_task_thread, NULL, globals.memory_pool);
@@ -305,13 +504,22 @@ SWITCH_DECLARE(void) switch_scheduler_task_thread_stop(void)
 	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_CONSOLE, "Stopping Task Thread\n");
 	if (globals.task_thread_running == 1) {
 		int sanity = 0;
+		uint32_t x, workers;
 		switch_status_t st;
 
+		switch_mutex_lock(globals.task_mutex);
 		globals.task_thread_running = -1;
+		switch_thread_cond_signal(globals.task_cond);
+		workers = globals.workers;
+		switch_mutex_unlock(globals.task_mutex);
 
 		switch_thread_join(&st, task_thread_p);
 
-		while (globals.task_thread_running) {
+		for (x = 0; x < workers; x++) {
+			switch_queue_push(globals.worker_queue, NULL);
+		}
+
+		while (globals.task_thread_running || globals.workers) {
 			switch_yield(100000);
 			if (++sanity > 10) {
 				break;
@@ -668,6 +668,452 @@ static switch_status_t timer_destroy(switch_timer_t *timer)
 	return SWITCH_STATUS_SUCCESS;
 }
 
+/* The "sharded" timer spreads timers over several tick threads instead of the single soft timer loop.
+   Each shard keeps one slot per interval in use, sleeps until the earliest slot is due and then
+   wakes every timer waiting on that slot with a single broadcast. */
+
+#define TIMER_SHARD_MAX 64
+#define TIMER_SHARD_IDLE 1000000
+#define TIMER_SHARD_BUCKETS 8
+
+static const switch_interval_time_t TIMER_SHARD_LIMITS[TIMER_SHARD_BUCKETS - 1] = { 50, 100, 250, 500, 1000, 2000, 5000 };
+static const char *TIMER_SHARD_LABELS[TIMER_SHARD_BUCKETS] = { "<50us", "<100us", "<250us", "<500us", "<1ms", "<2ms", "<5ms", ">=5ms" };
+
+typedef struct timer_shard_slot {
+	int interval;
+	uint32_t count;
+	switch_size_t tick;
+	switch_time_t due;
+	switch_thread_cond_t *cond;
+	struct timer_shard_slot *next;
+} timer_shard_slot_t;
+
+typedef struct timer_shard {
+	int id;
+	int running;
+	int tfd;
+	uint32_t timers;
+	switch_time_t next_due;
+	switch_thread_t *thread;
+	switch_mutex_t *mutex;
+	switch_thread_cond_t *cond;
+	timer_shard_slot_t *slots;
+	uint64_t wakeups;
+	uint64_t late[TIMER_SHARD_BUCKETS];
+	switch_interval_time_t late_max;
+} timer_shard_t;
+
+struct shard_private {
+	timer_shard_t *shard;
+	timer_shard_slot_t *slot;
+	switch_size_t reference;
+	switch_size_t start;
+	uint32_t ready;
+};
+typedef struct shard_private shard_private_t;
+
+static struct {
+	timer_shard_t *shards;
+	uint32_t count;
+	switch_mutex_t *mutex;
+} SHARDS;
+
+static int shard_cpu_count(void)
+{
+#if defined(WIN32)
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (int) info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (int) n : 1;
+#else
+	return 1;
+#endif
+}
+
+/* point the shard's sleep at a new deadline, must be called with shard->mutex held */
+static void shard_rearm(timer_shard_t *shard, switch_time_t due)
+{
+	shard->next_due = due;
+
+#ifdef HAVE_TIMERFD_CREATE
+	if (shard->tfd > -1) {
+		struct itimerspec spec = { { 0 } };
+
+		spec.it_value.tv_sec = due / APR_USEC_PER_SEC;
+		spec.it_value.tv_nsec = (due % APR_USEC_PER_SEC) * 1000;
+		timerfd_settime(shard->tfd, TFD_TIMER_ABSTIME, &spec, NULL);
+		return;
+	}
+#endif
+
+	switch_thread_cond_signal(shard->cond);
+}
+
+static void *SWITCH_THREAD_FUNC timer_shard_thread(switch_thread_t *thread, void *obj)
+{
+	timer_shard_t *shard = (timer_shard_t *) obj;
+	timer_shard_slot_t *slot;
+	switch_time_t now, due;
+	switch_interval_time_t late;
+	int i;
+
+#ifdef HAVE_CPU_SET_MACROS
+	{
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(shard->id % shard_cpu_count(), &set);
+		sched_setaffinity(0, sizeof(set), &set);
+	}
+#endif
+
+	switch_mutex_lock(shard->mutex);
+
+	while (shard->running) {
+		now = time_now(0);
+		due = now + TIMER_SHARD_IDLE;
+
+		for (slot = shard->slots; slot; slot = slot->next) {
+			if (!slot->count) {
+				continue;
+			}
+
+			if (slot->due <= now) {
+				late = now - slot->due;
+
+				for (i = 0; i < TIMER_SHARD_BUCKETS - 1 && late >= TIMER_SHARD_LIMITS[i]; i++);
+				shard->late[i]++;
+				if (late > shard->late_max) {
+					shard->late_max = late;
+				}
+
+				slot->tick++;
+				slot->due += slot->interval * 1000;
+
+				if (slot->due <= now) {
+					/* we fell a whole interval behind, don't try to catch up with a burst */
+					slot->due = now + slot->interval * 1000;
+				}
+
+				switch_thread_cond_broadcast(slot->cond);
+			}
+
+			if (slot->due < due) {
+				due = slot->due;
+			}
+		}
+
+		shard->wakeups++;
+		shard->next_due = due;
+
+#ifdef HAVE_TIMERFD_CREATE
+		if (shard->tfd > -1) {
+			uint64_t exp;
+
+			shard_rearm(shard, due);
+			switch_mutex_unlock(shard->mutex);
+			if (read(shard->tfd, &exp, sizeof(exp)) != sizeof(exp)) {
+				do_sleep(1000);
+			}
+			switch_mutex_lock(shard->mutex);
+			continue;
+		}
+#endif
+
+		if ((now = time_now(0)) < due) {
+			switch_thread_cond_timedwait(shard->cond, shard->mutex, due - now);
+		}
+	}
+
+	/* let anyone still waiting find out we are going away */
+	for (slot = shard->slots; slot; slot = slot->next) {
+		switch_thread_cond_broadcast(slot->cond);
+	}
+
+	switch_mutex_unlock(shard->mutex);
+
+	return NULL;
+}
+
+/* start the shard threads the first time a sharded timer is asked for */
+static switch_status_t timer_shards_start(void)
+{
+	switch_threadattr_t *thd_attr = NULL;
+	timer_shard_t *shard;
+	uint32_t i, count;
+
+	if (SHARDS.count) {
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	if (!(count = runtime.timer_shards)) {
+		count = (uint32_t) shard_cpu_count();
+	}
+
+	if (count > TIMER_SHARD_MAX) {
+		count = TIMER_SHARD_MAX;
+	}
+
+	SHARDS.shards = switch_core_alloc(module_pool, sizeof(*SHARDS.shards) * count);
+
+	for (i = 0; i < count; i++) {
+		shard = &SHARDS.shards[i];
+		shard->id = i;
+		shard->running = 1;
+		shard->tfd = -1;
+		switch_mutex_init(&shard->mutex, SWITCH_MUTEX_NESTED, module_pool);
+		switch_thread_cond_create(&shard->cond, module_pool);
+
+#ifdef HAVE_TIMERFD_CREATE
+		if (MONO) {
+			shard->tfd = timerfd_create(CLOCK_MONOTONIC, 0);
+		}
+#endif
+
+		switch_threadattr_create(&thd_attr, module_pool);
+		switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+		switch_threadattr_priority_increase(thd_attr);
+		switch_thread_create(&shard->thread, thd_attr, timer_shard_thread, shard, module_pool);
+	}
+
+	SHARDS.count = count;
+
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_NOTICE, "Started %u timer shard%s.\n", count, count == 1 ? "" : "s");
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static void timer_shards_stop(void)
+{
+	timer_shard_t *shard;
+	switch_status_t st;
+	uint32_t i;
+
+	for (i = 0; i < SHARDS.count; i++) {
+		shard = &SHARDS.shards[i];
+		switch_mutex_lock(shard->mutex);
+		shard->running = 0;
+		shard_rearm(shard, 1);
+		switch_mutex_unlock(shard->mutex);
+	}
+
+	for (i = 0; i < SHARDS.count; i++) {
+		shard = &SHARDS.shards[i];
+		switch_thread_join(&st, shard->thread);
+
+		if (shard->tfd > -1) {
+			close(shard->tfd);
+			shard->tfd = -1;
+		}
+	}
+
+	SHARDS.count = 0;
+}
+
+static switch_status_t shard_timer_init(switch_timer_t *timer)
+{
+	shard_private_t *private_info;
+	timer_shard_t *shard;
+	timer_shard_slot_t *slot;
+	uint32_t i;
+
+	if (globals.RUNNING != 1 || timer->interval < 1 || !SHARDS.mutex) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (!(private_info = switch_core_alloc(timer->memory_pool, sizeof(*private_info)))) {
+		return SWITCH_STATUS_MEMERR;
+	}
+
+	switch_mutex_lock(SHARDS.mutex);
+
+	timer_shards_start();
+
+	/* the least loaded shard gets it */
+	shard = &SHARDS.shards[0];
+	for (i = 1; i < SHARDS.count; i++) {
+		if (SHARDS.shards[i].timers < shard->timers) {
+			shard = &SHARDS.shards[i];
+		}
+	}
+
+	switch_mutex_lock(shard->mutex);
+	shard->timers++;
+
+	for (slot = shard->slots; slot; slot = slot->next) {
+		if (slot->interval == timer->interval) {
+			break;
+		}
+	}
+
+	if (!slot) {
+		slot = switch_core_alloc(module_pool, sizeof(*slot));
+		slot->interval = timer->interval;
+		switch_thread_cond_create(&slot->cond, module_pool);
+		slot->next = shard->slots;
+		shard->slots = slot;
+	}
+
+	if (!slot->count++) {
+		slot->due = time_now(0) + slot->interval * 1000;
+		if (slot->due < shard->next_due) {
+			shard_rearm(shard, slot->due);
+		}
+	}
+
+	private_info->shard = shard;
+	private_info->slot = slot;
+	private_info->start = private_info->reference = slot->tick;
+	private_info->start -= 2; /* switch_core_timer_init sets samplecount to samples, this makes first next() step once */
+	private_info->ready = 1;
+
+	switch_mutex_unlock(shard->mutex);
+	switch_mutex_unlock(SHARDS.mutex);
+
+	timer->private_info = private_info;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t shard_timer_step(switch_timer_t *timer)
+{
+	shard_private_t *private_info = timer->private_info;
+	uint64_t samples;
+
+	if (globals.RUNNING != 1 || private_info->ready == 0) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	samples = timer->samples * (private_info->reference - private_info->start);
+
+	if (samples > UINT32_MAX) {
+		private_info->start = private_info->reference;
+		samples = timer->samples;
+	}
+
+	timer->samplecount = (uint32_t) samples;
+	private_info->reference++;
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t shard_timer_sync(switch_timer_t *timer)
+{
+	shard_private_t *private_info = timer->private_info;
+
+	if (globals.RUNNING != 1 || private_info->ready == 0) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	private_info->reference = timer->tick = private_info->slot->tick;
+	shard_timer_step(timer);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t shard_timer_next(switch_timer_t *timer)
+{
+	shard_private_t *private_info = timer->private_info;
+	timer_shard_t *shard = private_info->shard;
+	timer_shard_slot_t *slot = private_info->slot;
+
+	/* sync up timer if it's not been called for a while otherwise it will return instantly several times until it catches up */
+	if ((int) (private_info->reference - slot->tick) < -1) {
+		private_info->reference = timer->tick = slot->tick;
+	}
+	shard_timer_step(timer);
+
+	switch_mutex_lock(shard->mutex);
+	while (globals.RUNNING == 1 && shard->running && private_info->ready && slot->tick < private_info->reference) {
+		switch_thread_cond_wait(slot->cond, shard->mutex);
+	}
+	switch_mutex_unlock(shard->mutex);
+
+	return globals.RUNNING == 1 && shard->running ? SWITCH_STATUS_SUCCESS : SWITCH_STATUS_FALSE;
+}
+
+static switch_status_t shard_timer_check(switch_timer_t *timer, switch_bool_t step)
+{
+	shard_private_t *private_info = timer->private_info;
+
+	if (globals.RUNNING != 1 || !private_info->ready) {
+		return SWITCH_STATUS_SUCCESS;
+	}
+
+	timer->tick = private_info->slot->tick;
+
+	if (timer->tick < private_info->reference) {
+		timer->diff = private_info->reference - timer->tick;
+	} else {
+		timer->diff = 0;
+	}
+
+	if (timer->diff) {
+		return SWITCH_STATUS_FALSE;
+	}
+
+	if (step) {
+		shard_timer_step(timer);
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t shard_timer_destroy(switch_timer_t *timer)
+{
+	shard_private_t *private_info = timer->private_info;
+
+	if (private_info && private_info->ready) {
+		switch_mutex_lock(private_info->shard->mutex);
+		private_info->ready = 0;
+		private_info->slot->count--;
+		private_info->shard->timers--;
+		switch_mutex_unlock(private_info->shard->mutex);
+	}
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t shard_timer_stats(switch_stream_handle_t *stream)
+{
+	timer_shard_t *shard;
+	timer_shard_slot_t *slot;
+	uint32_t i, slots;
+	int b;
+
+	stream->write_function(stream, "shard,timers,intervals,wakeups,late_max_us");
+	for (b = 0; b < TIMER_SHARD_BUCKETS; b++) {
+		stream->write_function(stream, ",%s", TIMER_SHARD_LABELS[b]);
+	}
+	stream->write_function(stream, "\n");
+
+	switch_mutex_lock(SHARDS.mutex);
+	for (i = 0; i < SHARDS.count; i++) {
+		shard = &SHARDS.shards[i];
+		switch_mutex_lock(shard->mutex);
+
+		for (slots = 0, slot = shard->slots; slot; slot = slot->next) {
+			if (slot->count) {
+				slots++;
+			}
+		}
+
+		stream->write_function(stream, "%u,%u,%u,%" SWITCH_UINT64_T_FMT ",%" SWITCH_INT64_T_FMT,
+							   i, shard->timers, slots, shard->wakeups, (int64_t) shard->late_max);
+		for (b = 0; b < TIMER_SHARD_BUCKETS; b++) {
+			stream->write_function(stream, ",%" SWITCH_UINT64_T_FMT, shard->late[b]);
+		}
+		stream->write_function(stream, "\n");
+
+		switch_mutex_unlock(shard->mutex);
+	}
+	stream->write_function(stream, "\n%u total.\n", SHARDS.count);
+	switch_mutex_unlock(SHARDS.mutex);
+
+	return SWITCH_STATUS_SUCCESS;
+}
+
 SWITCH_MODULE_RUNTIME_FUNCTION(softtimer_runtime)
 {
 	switch_time_t too_late = STEP_MIC * 1000;
@@ -1102,6 +1548,19 @@ SWITCH_MODULE_LOAD_FUNCTION(softtimer_load)
 	timer_interface->timer_check = timer_check;
 	timer_interface->timer_destroy = timer_destroy;
 
+	memset(&SHARDS, 0, sizeof(SHARDS));
+	switch_mutex_init(&SHARDS.mutex, SWITCH_MUTEX_NESTED, module_pool);
+
+	timer_interface = switch_loadable_module_create_interface(*module_interface, SWITCH_TIMER_INTERFACE);
+	timer_interface->interface_name = "sharded";
+	timer_interface->timer_init = shard_timer_init;
+	timer_interface->timer_next = shard_timer_next;
+	timer_interface->timer_step = shard_timer_step;
+	timer_interface->timer_sync = shard_timer_sync;
+	timer_interface->timer_check = shard_timer_check;
+	timer_interface->timer_destroy = shard_timer_destroy;
+	timer_interface->timer_stats = shard_timer_stats;
+
 	if (!switch_test_flag((&runtime), SCF_USE_CLOCK_RT)) {
 		switch_time_set_nanosleep(SWITCH_FALSE);
 	}
@@ -1129,6 +1588,8 @@ SWITCH_MODULE_SHUTDOWN_FUNCTION(softtimer_shutdown)
 {
 	globals.use_cond_yield = 0;
 
+	timer_shards_stop();
+
 	if (globals.RUNNING == 1) {
 		switch_mutex_lock(globals.mutex);
 		globals.RUNNING = -1;
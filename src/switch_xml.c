@@ -1920,6 +1920,348 @@ SWITCH_DECLARE(switch_status_t) switch_xml_locate_user(const char *key,
 	return status;
 }
 
+struct user_cache_entry {
+	switch_xml_t xml;
+	char *user_name;
+	char *domain_name;
+	time_t expires;
+	/* the domain has users picked by source address */
+	int ip_users;
+};
+typedef struct user_cache_entry user_cache_entry_t;
+
+static struct {
+	switch_hash_t *hash;
+	switch_mutex_t *mutex;
+	uint32_t ttl;
+	uint32_t max_entries;
+	uint32_t entries;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t expired;
+	uint64_t flushed;
+} USER_CACHE;
+
+/* copy src (attributes, text and all children) into a new tag under dest or into a new root when dest is NULL */
+static switch_xml_t user_cache_copy(switch_xml_t dest, switch_xml_t src, switch_size_t off)
+{
+	switch_xml_t x, child;
+	switch_size_t coff = 0;
+	int i;
+
+	if (dest) {
+		x = switch_xml_add_child_d(dest, src->name, off);
+	} else {
+		x = switch_xml_new_d(src->name);
+	}
+
+	for (i = 0; src->attr && src->attr[i]; i += 2) {
+		switch_xml_set_attr_d(x, src->attr[i], src->attr[i + 1]);
+	}
+
+	if (!zstr(src->txt)) {
+		switch_xml_set_txt_d(x, src->txt);
+	}
+
+	for (child = src->child; child; child = child->ordered) {
+		user_cache_copy(x, child, coff++);
+	}
+
+	return x;
+}
+
+static void user_cache_copy_settings(switch_xml_t dest, switch_xml_t src)
+{
+	switch_xml_t x;
+	switch_size_t off = 0;
+
+	if ((x = switch_xml_child(src, "params"))) {
+		user_cache_copy(dest, x, off++);
+	}
+
+	if ((x = switch_xml_child(src, "variables"))) {
+		user_cache_copy(dest, x, off++);
+	}
+}
+
+/* build a minimal directory fragment holding only the parts of the domain and group the user inherits from */
+static switch_xml_t user_cache_build(switch_xml_t domain, switch_xml_t group, switch_xml_t user)
+{
+	switch_xml_t x_domain, x_group, x_users;
+	int i;
+
+	x_domain = switch_xml_new_d("domain");
+
+	for (i = 0; domain->attr && domain->attr[i]; i += 2) {
+		switch_xml_set_attr_d(x_domain, domain->attr[i], domain->attr[i + 1]);
+	}
+
+	user_cache_copy_settings(x_domain, domain);
+
+	if (group) {
+		x_group = switch_xml_add_child_d(switch_xml_add_child_d(x_domain, "groups", 2), "group", 0);
+		for (i = 0; group->attr && group->attr[i]; i += 2) {
+			switch_xml_set_attr_d(x_group, group->attr[i], group->attr[i + 1]);
+		}
+		user_cache_copy_settings(x_group, group);
+		x_users = switch_xml_add_child_d(x_group, "users", 2);
+		user_cache_copy(x_users, user, 0);
+	} else {
+		user_cache_copy(x_domain, user, 2);
+	}
+
+	return x_domain;
+}
+
+static int user_cache_has_ip_users(switch_xml_t domain)
+{
+	switch_xml_t group, users, x_user;
+
+	for (x_user = switch_xml_child(domain, "user"); x_user; x_user = x_user->next) {
+		if (switch_xml_attr(x_user, "ip")) {
+			return 1;
+		}
+	}
+
+	for (group = switch_xml_child(switch_xml_child(domain, "groups"), "group"); group; group = group->next) {
+		for (users = switch_xml_child(group, "users"), x_user = switch_xml_child(users, "user"); x_user; x_user = x_user->next) {
+			if (switch_xml_attr(x_user, "ip")) {
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static void user_cache_entry_free(user_cache_entry_t *entry)
+{
+	switch_xml_free(entry->xml);
+	switch_safe_free(entry->user_name);
+	switch_safe_free(entry->domain_name);
+	free(entry);
+}
+
+struct user_cache_match {
+	const char *user_name;
+	const char *domain_name;
+	time_t now;
+	uint32_t count;
+};
+
+static switch_bool_t user_cache_match_callback(const void *key, const void *val, void *pData)
+{
+	user_cache_entry_t *entry = (user_cache_entry_t *) val;
+	struct user_cache_match *match = (struct user_cache_match *) pData;
+
+	if (match->now) {
+		if (entry->expires > match->now) {
+			return SWITCH_FALSE;
+		}
+	} else {
+		if (match->user_name && strcasecmp(match->user_name, entry->user_name)) {
+			return SWITCH_FALSE;
+		}
+		if (match->domain_name && strcasecmp(match->domain_name, entry->domain_name)) {
+			return SWITCH_FALSE;
+		}
+	}
+
+	user_cache_entry_free(entry);
+	match->count++;
+
+	return SWITCH_TRUE;
+}
+
+static uint32_t user_cache_delete(struct user_cache_match *match)
+{
+	match->count = 0;
+	switch_core_hash_delete_multi(USER_CACHE.hash, user_cache_match_callback, match);
+	USER_CACHE.entries -= match->count;
+	return match->count;
+}
+
+SWITCH_DECLARE(uint32_t) switch_xml_clear_user_cache(const char *user_name, const char *domain_name)
+{
+	struct user_cache_match match = { 0 };
+	uint32_t count;
+
+	if (!USER_CACHE.mutex) {
+		return 0;
+	}
+
+	match.user_name = zstr(user_name) ? NULL : user_name;
+	match.domain_name = zstr(domain_name) ? NULL : domain_name;
+
+	switch_mutex_lock(USER_CACHE.mutex);
+	count = user_cache_delete(&match);
+	USER_CACHE.flushed += count;
+	switch_mutex_unlock(USER_CACHE.mutex);
+
+	return count;
+}
+
+SWITCH_DECLARE(void) switch_xml_set_user_cache_ttl(uint32_t ttl)
+{
+	USER_CACHE.ttl = ttl;
+
+	if (!ttl) {
+		switch_xml_clear_user_cache(NULL, NULL);
+	}
+}
+
+SWITCH_DECLARE(void) switch_xml_set_user_cache_max_entries(uint32_t max_entries)
+{
+	USER_CACHE.max_entries = max_entries;
+}
+
+SWITCH_DECLARE(void) switch_xml_user_cache_stats(switch_xml_user_cache_stats_t *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+
+	if (!USER_CACHE.mutex) {
+		return;
+	}
+
+	switch_mutex_lock(USER_CACHE.mutex);
+	stats->ttl = USER_CACHE.ttl;
+	stats->max_entries = USER_CACHE.max_entries;
+	stats->entries = USER_CACHE.entries;
+	stats->hits = USER_CACHE.hits;
+	stats->misses = USER_CACHE.misses;
+	stats->expired = USER_CACHE.expired;
+	stats->flushed = USER_CACHE.flushed;
+	switch_mutex_unlock(USER_CACHE.mutex);
+}
+
+static void user_cache_event_handler(switch_event_t *event)
+{
+	const char *user_name = switch_event_get_header(event, "user");
+	const char *domain_name = switch_event_get_header(event, "domain");
+	uint32_t count;
+
+	count = switch_xml_clear_user_cache(user_name, domain_name);
+	switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_DEBUG, "Flushed %u user cache entr%s for [%s@%s]\n",
+					  count, count == 1 ? "y" : "ies", switch_str_nil(user_name), switch_str_nil(domain_name));
+}
+
+SWITCH_DECLARE(switch_status_t) switch_xml_locate_user_cached(const char *key,
+															  const char *user_name,
+															  const char *domain_name,
+															  const char *ip,
+															  switch_xml_t *root,
+															  switch_xml_t *domain, switch_xml_t *user, switch_xml_t *ingroup, switch_event_t *params)
+{
+	switch_status_t status;
+	user_cache_entry_t *entry;
+	const char *user_type = NULL;
+	switch_xml_t group = NULL;
+	char *cache_key;
+	time_t now;
+
+	if (!USER_CACHE.ttl || !USER_CACHE.mutex || zstr(user_name) || zstr(domain_name)) {
+		return switch_xml_locate_user(key, user_name, domain_name, ip, root, domain, user, ingroup, params);
+	}
+
+	if (params) {
+		user_type = switch_event_get_header(params, "user_type");
+	}
+
+	cache_key = switch_mprintf("%s|%s|%s|%s", key, user_name, domain_name, switch_str_nil(user_type));
+	now = switch_epoch_time_now(NULL);
+
+	switch_mutex_lock(USER_CACHE.mutex);
+	if ((entry = switch_core_hash_find(USER_CACHE.hash, cache_key))) {
+		if (entry->expires > now && ip && entry->ip_users) {
+			/* only the full lookup knows whether this address maps to one of the ip= users */
+			USER_CACHE.misses++;
+			switch_mutex_unlock(USER_CACHE.mutex);
+			free(cache_key);
+			return switch_xml_locate_user(key, user_name, domain_name, ip, root, domain, user, ingroup, params);
+		}
+
+		if (entry->expires > now) {
+			*root = *domain = user_cache_copy(NULL, entry->xml, 0);
+			USER_CACHE.hits++;
+			switch_mutex_unlock(USER_CACHE.mutex);
+
+			/* the same request params the uncached lookup leaves behind */
+			if (params) {
+				switch_event_add_header_string(params, SWITCH_STACK_BOTTOM, "key", key);
+				switch_event_add_header_string(params, SWITCH_STACK_BOTTOM, "user", user_name);
+				switch_event_add_header_string(params, SWITCH_STACK_BOTTOM, "domain", domain_name);
+				if (ip) {
+					switch_event_add_header_string(params, SWITCH_STACK_BOTTOM, "ip", ip);
+				}
+			}
+
+			if ((group = switch_xml_child(*domain, "groups")) && (group = switch_xml_child(group, "group"))) {
+				*user = switch_xml_child(switch_xml_child(group, "users"), "user");
+			} else {
+				group = NULL;
+				*user = switch_xml_child(*domain, "user");
+			}
+
+			if (ingroup) {
+				*ingroup = group;
+			}
+
+			free(cache_key);
+			return SWITCH_STATUS_SUCCESS;
+		}
+
+		switch_core_hash_delete(USER_CACHE.hash, cache_key);
+		user_cache_entry_free(entry);
+		USER_CACHE.entries--;
+		USER_CACHE.expired++;
+	}
+	USER_CACHE.misses++;
+	switch_mutex_unlock(USER_CACHE.mutex);
+
+	if ((status = switch_xml_locate_user(key, user_name, domain_name, ip, root, domain, user, &group, params)) != SWITCH_STATUS_SUCCESS) {
+		goto end;
+	}
+
+	if (ingroup) {
+		*ingroup = group;
+	}
+
+	/* a user picked by source address instead of by name is not a property of (user, domain) */
+	if (ip && !strcmp(switch_xml_attr_soft(*user, "ip"), ip)) {
+		goto end;
+	}
+
+	switch_mutex_lock(USER_CACHE.mutex);
+	if (USER_CACHE.max_entries && USER_CACHE.entries >= USER_CACHE.max_entries) {
+		struct user_cache_match match = { 0 };
+
+		match.now = now;
+		USER_CACHE.expired += user_cache_delete(&match);
+	}
+
+	if (!USER_CACHE.max_entries || USER_CACHE.entries < USER_CACHE.max_entries) {
+		if ((entry = switch_core_hash_find(USER_CACHE.hash, cache_key))) {
+			user_cache_entry_free(entry);
+			USER_CACHE.entries--;
+		}
+		switch_zmalloc(entry, sizeof(*entry));
+		entry->xml = user_cache_build(*domain, group, *user);
+		entry->user_name = strdup(user_name);
+		entry->domain_name = strdup(domain_name);
+		entry->expires = now + USER_CACHE.ttl;
+		entry->ip_users = user_cache_has_ip_users(*domain);
+		switch_core_hash_insert(USER_CACHE.hash, cache_key, entry);
+		USER_CACHE.entries++;
+	}
+	switch_mutex_unlock(USER_CACHE.mutex);
+
+  end:
+
+	free(cache_key);
+
+	return status;
+}
+
 SWITCH_DECLARE(switch_xml_t) switch_xml_root(void)
 {
 	switch_xml_root_t root = NULL;
@@ -2025,6 +2367,9 @@ SWITCH_DECLARE(switch_xml_t) switch_xml_open_root(uint8_t reload, const char **e
 
 	if (errcnt == 0) {
 		switch_event_t *event;
+
+		switch_xml_clear_user_cache(NULL, NULL);
+
 		if (switch_event_create(&event, SWITCH_EVENT_RELOADXML) == SWITCH_STATUS_SUCCESS) {
 			if (switch_event_fire(&event) != SWITCH_STATUS_SUCCESS) {
 				switch_event_destroy(&event);
@@ -2061,6 +2406,9 @@ SWITCH_DECLARE(switch_status_t) switch_xml_init(switch_memory_pool_t *pool, cons
 	switch_mutex_init(&XML_RWFILE_LOCK, SWITCH_MUTEX_NESTED, XML_MEMORY_POOL);
 	switch_thread_rwlock_create(&B_RWLOCK, XML_MEMORY_POOL);
 	switch_thread_rwlock_create(&XML_RWLOCK, XML_MEMORY_POOL);
+	switch_mutex_init(&USER_CACHE.mutex, SWITCH_MUTEX_NESTED, XML_MEMORY_POOL);
+	switch_core_hash_init_case(&USER_CACHE.hash, XML_MEMORY_POOL, SWITCH_FALSE);
+	switch_event_bind("core_xml", SWITCH_EVENT_CUSTOM, SWITCH_XML_USER_CACHE_FLUSH_EVENT, user_cache_event_handler, NULL);
 
 	assert(pool != NULL);
 
@@ -2075,6 +2423,10 @@ SWITCH_DECLARE(switch_status_t) switch_xml_init(switch_memory_pool_t *pool, cons
 SWITCH_DECLARE(switch_status_t) switch_xml_destroy(void)
 {
 	switch_status_t status = SWITCH_STATUS_FALSE;
+
+	switch_event_unbind_callback(user_cache_event_handler);
+	switch_xml_clear_user_cache(NULL, NULL);
+
 	switch_thread_rwlock_wrlock(XML_RWLOCK);
 
 	if (MAIN_XML_ROOT) {
@@ -0,0 +1,206 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2011, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Anthony Minessale II <anthm@freeswitch.org>
+ *
+ *
+ * conference_mix_bench.c -- mod_conference mixing kernel cost per frame
+ *
+ * Replays -m synthetic members through the mux loop's per-tick work: every
+ * member's frame is added into the 32 bit mix, the conference energy is
+ * taken from it, and every member gets the mix minus its own audio
+ * saturated to 16 bit, plus its input energy.  Each kernel table the CPU
+ * can run (scalar, sse2, avx2) is timed in ns per frame and checked
+ * against the scalar output.  The member frames include full scale
+ * samples so the saturation paths are covered.
+ *
+ * usage: conference_mix_bench [-m members] [-s samples per frame] [-n frames]
+ */
+
+#ifndef _XOPEN_SOURCE
+#define _XOPEN_SOURCE 600
+#endif
+
+#include <switch.h>
+#include "../src/mod/applications/mod_conference/conference_mix.h"
+
+#define MIX_BENCH_MEMBERS 16
+/* 20ms at 48kHz */
+#define MIX_BENCH_SAMPLES 960
+#define MIX_BENCH_FRAMES 20000
+
+typedef struct {
+	int members;
+	uint32_t samples;
+	int16_t **in;
+	int32_t *mix;
+	/* members * samples written frames */
+	int16_t *out;
+	uint32_t conf_energy;
+	uint32_t *energy;
+} mix_bench_t;
+
+static void mix_bench_tick(const conference_mix_kernels_t *k, mix_bench_t *b)
+{
+	int i;
+
+	memset(b->mix, 0, b->samples * sizeof(*b->mix));
+
+	for (i = 0; i < b->members; i++) {
+		b->energy[i] = k->energy16(b->in[i], b->samples);
+		k->accumulate(b->mix, b->in[i], b->samples);
+	}
+
+	b->conf_energy = k->energy32(b->mix, b->samples);
+
+	for (i = 0; i < b->members; i++) {
+		/* the mux loop passes read / 2 + 1 for a member with audio */
+		k->subtract(b->out + i * b->samples, b->mix, b->in[i], b->samples, b->samples);
+	}
+}
+
+static int mix_bench_same(const mix_bench_t *a, const mix_bench_t *b)
+{
+	return a->conf_energy == b->conf_energy &&
+		!memcmp(a->energy, b->energy, a->members * sizeof(*a->energy)) &&
+		!memcmp(a->out, b->out, a->members * a->samples * sizeof(*a->out));
+}
+
+static void mix_bench_init(mix_bench_t *b, int members, uint32_t samples, int16_t **in)
+{
+	b->members = members;
+	b->samples = samples;
+	b->in = in;
+	b->mix = calloc(samples, sizeof(*b->mix));
+	b->out = calloc(members * samples, sizeof(*b->out));
+	b->energy = calloc(members, sizeof(*b->energy));
+	switch_assert(b->mix && b->out && b->energy);
+}
+
+static void mix_bench_destroy(mix_bench_t *b)
+{
+	free(b->mix);
+	free(b->out);
+	free(b->energy);
+}
+
+int main(int argc, char *argv[])
+{
+	int members = MIX_BENCH_MEMBERS, frames = MIX_BENCH_FRAMES, failures = 0, i, n, opt;
+	uint32_t samples = MIX_BENCH_SAMPLES, x;
+	const conference_mix_kernels_t *kernels[3];
+	int nkernels = 0;
+	mix_bench_t ref, run;
+	int16_t **in;
+
+	while ((opt = getopt(argc, argv, "m:s:n:")) != -1) {
+		switch (opt) {
+		case 'm':
+			members = atoi(optarg);
+			break;
+		case 's':
+			samples = atoi(optarg);
+			break;
+		case 'n':
+			frames = atoi(optarg);
+			break;
+		default:
+			members = 0;
+			break;
+		}
+	}
+
+	if (members < 1 || samples < 1 || samples > SWITCH_RECOMMENDED_BUFFER_SIZE / 2 || frames < 1) {
+		fprintf(stderr, "usage: %s [-m members] [-s samples per frame, at most %d] [-n frames]\n", argv[0], SWITCH_RECOMMENDED_BUFFER_SIZE / 2);
+		return 255;
+	}
+
+	kernels[nkernels++] = &conference_mix_scalar;
+#ifdef CONF_MIX_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("sse2")) {
+		kernels[nkernels++] = &conference_mix_sse2;
+	}
+
+	if (__builtin_cpu_supports("avx2")) {
+		kernels[nkernels++] = &conference_mix_avx2;
+	}
+#endif
+
+	srand(1);
+	in = malloc(members * sizeof(*in));
+	switch_assert(in);
+
+	for (i = 0; i < members; i++) {
+		in[i] = malloc(samples * sizeof(**in));
+		switch_assert(in[i]);
+
+		for (x = 0; x < samples; x++) {
+			/* mostly speech level audio with the odd full scale sample so the mix saturates */
+			in[i][x] = (rand() % 16) ? (int16_t) (rand() % 16384 - 8192) : ((rand() & 1) ? SWITCH_SMAX : SWITCH_SMIN);
+		}
+	}
+
+	mix_bench_init(&ref, members, samples, in);
+	mix_bench_init(&run, members, samples, in);
+	mix_bench_tick(&conference_mix_scalar, &ref);
+
+	printf("%d members, %u samples per frame, %d frames\n", members, samples, frames);
+
+	for (n = 0; n < nkernels; n++) {
+		switch_time_t start, elapsed;
+
+		mix_bench_tick(kernels[n], &run);
+
+		if (!mix_bench_same(&ref, &run)) {
+			fprintf(stderr, "%s kernels do not match the scalar output\n", kernels[n]->name);
+			failures++;
+		}
+
+		start = switch_micro_time_now();
+		for (i = 0; i < frames; i++) {
+			mix_bench_tick(kernels[n], &run);
+		}
+		elapsed = switch_micro_time_now() - start;
+
+		printf("%-8s %10.1f ns/frame\n", kernels[n]->name, (double) elapsed * 1000 / frames);
+	}
+
+	mix_bench_destroy(&ref);
+	mix_bench_destroy(&run);
+
+	for (i = 0; i < members; i++) {
+		free(in[i]);
+	}
+	free(in);
+
+	if (failures) {
+		printf("%d failures\n", failures);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,315 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2011, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Anthony Minessale II <anthm@freeswitch.org>
+ *
+ *
+ * conference_relationship_bench.c -- conference relationships, per sample vs per tick
+ *
+ * Mixes -m synthetic members, all with audio, and builds every listener's
+ * frame two ways for a growing number of random nohear/nospeak
+ * relationships: with the per-sample loop the mux thread used to run,
+ * which walks every member and both relationship lists for every sample,
+ * and the way it does now, resolving each listener's relationships once
+ * per tick into a list of excluded frames for conference_mix_exclude().
+ * The relationship rules are the ones conference_relationship_exclusions()
+ * applies.  It reports ns per tick for both and fails if any listener's
+ * frame differs.
+ *
+ * usage: conference_relationship_bench [-m members] [-s samples per frame] [-n frames] [-r max relationships]
+ */
+
+#ifndef _XOPEN_SOURCE
+#define _XOPEN_SOURCE 600
+#endif
+
+#include <switch.h>
+#include "../src/mod/applications/mod_conference/conference_mix.h"
+
+#define REL_BENCH_MEMBERS 32
+/* 20ms at 16kHz */
+#define REL_BENCH_SAMPLES 320
+#define REL_BENCH_FRAMES 200
+#define REL_BENCH_MAX_RELATIONSHIPS 256
+
+#define REL_BENCH_CAN_HEAR (1 << 0)
+#define REL_BENCH_CAN_SPEAK (1 << 1)
+
+typedef struct rel_bench_relationship {
+	/* 0 applies to every member */
+	uint32_t id;
+	uint32_t flags;
+	struct rel_bench_relationship *next;
+} rel_bench_relationship_t;
+
+typedef struct {
+	uint32_t id;
+	int16_t *frame;
+	rel_bench_relationship_t *relationships;
+} rel_bench_member_t;
+
+static int members = REL_BENCH_MEMBERS;
+static uint32_t samples = REL_BENCH_SAMPLES;
+static rel_bench_member_t *member;
+static const conference_mix_kernels_t *kernels = &conference_mix_scalar;
+
+/* the mux loop before relationships were resolved per tick */
+static void rel_bench_per_sample(const int32_t *mix, int16_t *out)
+{
+	int o, i;
+	uint32_t x;
+
+	for (o = 0; o < members; o++) {
+		rel_bench_member_t *omember = &member[o];
+		int16_t *bptr = omember->frame;
+
+		for (x = 0; x < samples; x++) {
+			int32_t z = mix[x] - (int32_t) bptr[x];
+
+			for (i = 0; i < members; i++) {
+				rel_bench_member_t *imember = &member[i];
+				rel_bench_relationship_t *rel;
+				int found = 0;
+
+				if (imember == omember) {
+					continue;
+				}
+
+				for (rel = imember->relationships; rel; rel = rel->next) {
+					if ((rel->id == omember->id || rel->id == 0) && !(rel->flags & REL_BENCH_CAN_SPEAK)) {
+						z -= (int32_t) imember->frame[x];
+						found = 1;
+						break;
+					}
+				}
+
+				if (!found) {
+					for (rel = omember->relationships; rel; rel = rel->next) {
+						if ((rel->id == imember->id || rel->id == 0) && !(rel->flags & REL_BENCH_CAN_HEAR)) {
+							z -= (int32_t) imember->frame[x];
+							break;
+						}
+					}
+				}
+			}
+
+			switch_normalize_to_16bit(z);
+			out[o * samples + x] = (int16_t) z;
+		}
+	}
+}
+
+/* the mux loop now: relationships resolved once per listener, then whole frames taken out of a copy of the mix */
+static void rel_bench_per_tick(const int32_t *mix, int32_t *scratch, int16_t **excluded, int16_t *out)
+{
+	int o, i;
+
+	for (o = 0; o < members; o++) {
+		rel_bench_member_t *omember = &member[o];
+		uint32_t count = 0;
+
+		for (i = 0; i < members; i++) {
+			rel_bench_member_t *imember = &member[i];
+			rel_bench_relationship_t *rel;
+
+			if (imember == omember) {
+				continue;
+			}
+
+			for (rel = imember->relationships; rel; rel = rel->next) {
+				if ((rel->id == omember->id || rel->id == 0) && !(rel->flags & REL_BENCH_CAN_SPEAK)) {
+					break;
+				}
+			}
+
+			if (!rel) {
+				for (rel = omember->relationships; rel; rel = rel->next) {
+					if ((rel->id == imember->id || rel->id == 0) && !(rel->flags & REL_BENCH_CAN_HEAR)) {
+						break;
+					}
+				}
+			}
+
+			if (rel) {
+				excluded[count++] = imember->frame;
+			}
+		}
+
+		/* the mux loop passes read / 2 + 1 for a member with audio */
+		if (count) {
+			conference_mix_exclude(kernels, out + o * samples, mix, scratch, excluded, count, omember->frame, samples + 1, samples);
+		} else {
+			kernels->subtract(out + o * samples, mix, omember->frame, samples + 1, samples);
+		}
+	}
+}
+
+static void rel_bench_add_relationship(void)
+{
+	rel_bench_relationship_t *rel = malloc(sizeof(*rel));
+	rel_bench_member_t *owner = &member[rand() % members];
+
+	switch_assert(rel);
+	rel->id = rand() % (members + 1);
+	/* either the owner may not speak to id or may not hear it */
+	rel->flags = (rand() & 1) ? REL_BENCH_CAN_HEAR : REL_BENCH_CAN_SPEAK;
+	rel->next = owner->relationships;
+	owner->relationships = rel;
+}
+
+int main(int argc, char *argv[])
+{
+	int frames = REL_BENCH_FRAMES, max_relationships = REL_BENCH_MAX_RELATIONSHIPS, relationships = 0, target, failures = 0, i, opt;
+	int32_t *mix, *scratch;
+	int16_t *out_sample, *out_tick, **excluded;
+	uint32_t x;
+
+	while ((opt = getopt(argc, argv, "m:s:n:r:")) != -1) {
+		switch (opt) {
+		case 'm':
+			members = atoi(optarg);
+			break;
+		case 's':
+			samples = atoi(optarg);
+			break;
+		case 'n':
+			frames = atoi(optarg);
+			break;
+		case 'r':
+			max_relationships = atoi(optarg);
+			break;
+		default:
+			members = 0;
+			break;
+		}
+	}
+
+	if (members < 2 || samples < 1 || frames < 1 || max_relationships < 0) {
+		fprintf(stderr, "usage: %s [-m members] [-s samples per frame] [-n frames] [-r max relationships]\n", argv[0]);
+		return 255;
+	}
+
+	/* the same kernels the module would pick */
+#ifdef CONF_MIX_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2")) {
+		kernels = &conference_mix_avx2;
+	} else if (__builtin_cpu_supports("sse2")) {
+		kernels = &conference_mix_sse2;
+	}
+#endif
+
+	srand(1);
+	member = calloc(members, sizeof(*member));
+	mix = calloc(samples, sizeof(*mix));
+	scratch = calloc(samples, sizeof(*scratch));
+	out_sample = calloc(members * samples, sizeof(*out_sample));
+	out_tick = calloc(members * samples, sizeof(*out_tick));
+	excluded = calloc(members, sizeof(*excluded));
+	switch_assert(member && mix && scratch && out_sample && out_tick && excluded);
+
+	for (i = 0; i < members; i++) {
+		member[i].id = i + 1;
+		member[i].frame = malloc(samples * sizeof(*member[i].frame));
+		switch_assert(member[i].frame);
+
+		for (x = 0; x < samples; x++) {
+			/* the odd full scale sample keeps the saturation in play */
+			member[i].frame[x] = (rand() % 16) ? (int16_t) (rand() % 16384 - 8192) : ((rand() & 1) ? SWITCH_SMAX : SWITCH_SMIN);
+		}
+
+		kernels->accumulate(mix, member[i].frame, samples);
+	}
+
+	printf("%d members, %u samples per frame, %d frames, %s kernels\n", members, samples, frames, kernels->name);
+
+	for (;;) {
+		switch_time_t start, per_sample, per_tick;
+
+		rel_bench_per_sample(mix, out_sample);
+		rel_bench_per_tick(mix, scratch, excluded, out_tick);
+
+		if (memcmp(out_sample, out_tick, members * samples * sizeof(*out_tick))) {
+			fprintf(stderr, "%d relationships: per tick frames differ from the per sample loop\n", relationships);
+			failures++;
+		}
+
+		start = switch_micro_time_now();
+		for (i = 0; i < frames; i++) {
+			rel_bench_per_sample(mix, out_sample);
+		}
+		per_sample = switch_micro_time_now() - start;
+
+		start = switch_micro_time_now();
+		for (i = 0; i < frames; i++) {
+			rel_bench_per_tick(mix, scratch, excluded, out_tick);
+		}
+		per_tick = switch_micro_time_now() - start;
+
+		printf("%5d relationships: per sample %12.1f ns/tick, per tick %10.1f ns/tick\n", relationships,
+			   (double) per_sample * 1000 / frames, (double) per_tick * 1000 / frames);
+
+		if (relationships >= max_relationships) {
+			break;
+		}
+
+		/* 0, 1, 2, 4, 8 ... up to -r */
+		target = relationships ? relationships * 2 : 1;
+
+		if (target > max_relationships) {
+			target = max_relationships;
+		}
+
+		while (relationships < target) {
+			rel_bench_add_relationship();
+			relationships++;
+		}
+	}
+
+	for (i = 0; i < members; i++) {
+		rel_bench_relationship_t *rel, *next;
+
+		for (rel = member[i].relationships; rel; rel = next) {
+			next = rel->next;
+			free(rel);
+		}
+		free(member[i].frame);
+	}
+
+	free(member);
+	free(mix);
+	free(scratch);
+	free(out_sample);
+	free(out_tick);
+	free(excluded);
+
+	if (failures) {
+		printf("%d failures\n", failures);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,215 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2011, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Anthony Minessale II <anthm@freeswitch.org>
+ *
+ *
+ * event_header_bench.c -- event header lookup, dup and serialize cost
+ *
+ * Builds a plain event with the given number of headers, the way a channel's
+ * variables end up, and times switch_event_get_header() (hits and misses),
+ * switch_event_dup() and switch_event_serialize() on it, once with plain
+ * list storage and once after switch_event_index_headers().  It fails if
+ * the indexed event returns a different value for any header or
+ * serializes to a different string than the plain one.
+ *
+ * The core is started minimal like tone2wav; -c and -l point it at a conf
+ * tree and a writable log dir when FreeSWITCH is not installed.
+ *
+ * usage: event_header_bench [-c conf_dir] [-l log_dir] [-h headers] [-n iterations]
+ */
+
+#ifndef _XOPEN_SOURCE
+#define _XOPEN_SOURCE 600
+#endif
+
+#include <switch.h>
+
+#define EVENT_BENCH_HEADERS 200
+#define EVENT_BENCH_ITERATIONS 2000
+
+static int failures;
+
+static switch_event_t *event_bench_build(int headers, switch_bool_t indexed)
+{
+	switch_event_t *event = NULL;
+	char name[64], value[128];
+	int i;
+
+	/* no default headers, the two copies have to match exactly */
+	switch_event_create_plain(&event, SWITCH_EVENT_CHANNEL_DATA);
+
+	if (indexed) {
+		switch_event_index_headers(event);
+	}
+
+	for (i = 0; i < headers; i++) {
+		switch_snprintf(name, sizeof(name), "variable_bench_var_%d", i);
+		switch_snprintf(value, sizeof(value), "value of bench variable number %d", i);
+		switch_event_add_header_string(event, SWITCH_STACK_BOTTOM, name, value);
+	}
+
+	return event;
+}
+
+static double event_bench_ns(switch_time_t start, int ops)
+{
+	switch_time_t elapsed = switch_micro_time_now() - start;
+
+	return (double) elapsed * 1000 / (ops ? ops : 1);
+}
+
+static void event_bench_run(const char *label, switch_event_t *event, int headers, int iterations)
+{
+	switch_time_t start;
+	char name[64];
+	int i, k, found = 0;
+
+	start = switch_micro_time_now();
+	for (i = 0; i < iterations; i++) {
+		for (k = 0; k < headers; k++) {
+			/* every other lookup is a miss, the usual case for optional variables */
+			switch_snprintf(name, sizeof(name), (k & 1) ? "variable_bench_var_%d" : "variable_bench_missing_%d", k);
+			found += switch_event_get_header(event, name) != NULL;
+		}
+	}
+	printf("%-8s get_header: %8.1f ns/lookup (%d found)\n", label, event_bench_ns(start, iterations * headers), found);
+
+	start = switch_micro_time_now();
+	for (i = 0; i < iterations; i++) {
+		switch_event_t *clone = NULL;
+
+		switch_event_dup(&clone, event);
+		switch_event_destroy(&clone);
+	}
+	printf("%-8s dup:        %8.1f ns/event\n", label, event_bench_ns(start, iterations));
+
+	start = switch_micro_time_now();
+	for (i = 0; i < iterations; i++) {
+		char *str = NULL;
+
+		switch_event_serialize(event, &str, SWITCH_TRUE);
+		switch_safe_free(str);
+	}
+	printf("%-8s serialize:  %8.1f ns/event\n", label, event_bench_ns(start, iterations));
+}
+
+static void event_bench_compare(switch_event_t *plain, switch_event_t *indexed)
+{
+	switch_event_header_t *hp;
+	switch_event_t *clone = NULL;
+	char *a = NULL, *b = NULL;
+
+	for (hp = plain->headers; hp; hp = hp->next) {
+		const char *v = switch_event_get_header(indexed, hp->name);
+
+		if (!v || strcmp(v, hp->value)) {
+			fprintf(stderr, "header %s: expected [%s] got [%s]\n", hp->name, hp->value, switch_str_nil(v));
+			failures++;
+		}
+	}
+
+	if (switch_event_get_header(indexed, "variable_bench_missing_0")) {
+		fprintf(stderr, "lookup of a missing header succeeded\n");
+		failures++;
+	}
+
+	/* the copy has to stay indexed and hand back the same headers in the same order */
+	switch_event_dup(&clone, indexed);
+
+	if (!clone->index) {
+		fprintf(stderr, "dup of an indexed event is not indexed\n");
+		failures++;
+	}
+
+	switch_event_serialize(plain, &a, SWITCH_TRUE);
+	switch_event_serialize(clone, &b, SWITCH_TRUE);
+
+	if (strcmp(a, b)) {
+		fprintf(stderr, "indexed event serializes differently\n");
+		failures++;
+	}
+
+	switch_safe_free(a);
+	switch_safe_free(b);
+	switch_event_destroy(&clone);
+}
+
+int main(int argc, char *argv[])
+{
+	int headers = EVENT_BENCH_HEADERS, iterations = EVENT_BENCH_ITERATIONS, opt;
+	switch_event_t *plain, *indexed;
+	const char *err = NULL;
+
+	while ((opt = getopt(argc, argv, "c:l:h:n:")) != -1) {
+		switch (opt) {
+		case 'c':
+			SWITCH_GLOBAL_dirs.conf_dir = strdup(optarg);
+			break;
+		case 'l':
+			SWITCH_GLOBAL_dirs.log_dir = strdup(optarg);
+			break;
+		case 'h':
+			headers = atoi(optarg);
+			break;
+		case 'n':
+			iterations = atoi(optarg);
+			break;
+		default:
+			headers = 0;
+			break;
+		}
+	}
+
+	if (headers < 1 || iterations < 1) {
+		fprintf(stderr, "usage: %s [-c conf_dir] [-l log_dir] [-h headers] [-n iterations]\n", argv[0]);
+		return 255;
+	}
+
+	if (switch_core_init(SCF_MINIMAL, SWITCH_FALSE, &err) != SWITCH_STATUS_SUCCESS) {
+		fprintf(stderr, "Cannot init core [%s]\n", err);
+		return 255;
+	}
+
+	plain = event_bench_build(headers, SWITCH_FALSE);
+	indexed = event_bench_build(headers, SWITCH_TRUE);
+
+	event_bench_compare(plain, indexed);
+
+	printf("%d headers, %d iterations\n", headers, iterations);
+	event_bench_run("list", plain, headers, iterations);
+	event_bench_run("indexed", indexed, headers, iterations);
+
+	switch_event_destroy(&plain);
+	switch_event_destroy(&indexed);
+	switch_core_destroy();
+
+	if (failures) {
+		printf("%d failures\n", failures);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,160 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2011, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Anthony Minessale II <anthm@freeswitch.org>
+ *
+ *
+ * pool_reuse.c -- memory pool create/destroy throughput under contention
+ *
+ * Every thread creates a pool, allocates from it the way a short lived
+ * session or event would, and destroys it again.  Each round starts a new
+ * set of threads so the hand-off of cached pools between threads is part
+ * of the run.  It fails if a reused pool hands out memory that is not
+ * zeroed.  A destroyed pool is only reused after a one second rest, so in
+ * a loop this tight most pools overflow to the pool thread and the rate
+ * is bounded by how fast it drains pool_queue.
+ *
+ * The core is started minimal like tone2wav; -c and -l point it at a conf
+ * tree and a writable log dir when FreeSWITCH is not installed.
+ *
+ * usage: pool_reuse [-c conf_dir] [-l log_dir] [-t threads] [-n iterations per thread] [-r rounds]
+ */
+
+#ifndef _XOPEN_SOURCE
+#define _XOPEN_SOURCE 600
+#endif
+
+#include <switch.h>
+
+#define POOL_REUSE_THREADS 32
+#define POOL_REUSE_ITERATIONS 20000
+#define POOL_REUSE_ROUNDS 3
+#define POOL_REUSE_ALLOCS 8
+#define POOL_REUSE_ALLOC_SIZE 512
+
+static int iterations = POOL_REUSE_ITERATIONS;
+static switch_atomic_t failures;
+
+static void *SWITCH_THREAD_FUNC pool_reuse_thread(switch_thread_t *thread, void *obj)
+{
+	int i, k;
+
+	for (i = 0; i < iterations; i++) {
+		switch_memory_pool_t *pool = NULL;
+
+		if (switch_core_new_memory_pool(&pool) != SWITCH_STATUS_SUCCESS) {
+			switch_atomic_inc(&failures);
+			continue;
+		}
+
+		for (k = 0; k < POOL_REUSE_ALLOCS; k++) {
+			char *p = switch_core_alloc(pool, POOL_REUSE_ALLOC_SIZE);
+
+			/* a recycled pool must come back zeroed like a new one */
+			if (!p || p[0] || p[POOL_REUSE_ALLOC_SIZE - 1]) {
+				switch_atomic_inc(&failures);
+			} else {
+				p[0] = p[POOL_REUSE_ALLOC_SIZE - 1] = 1;
+			}
+		}
+
+		switch_core_destroy_memory_pool(&pool);
+	}
+
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	int threads = POOL_REUSE_THREADS, rounds = POOL_REUSE_ROUNDS, r, i, opt;
+	switch_memory_pool_t *pool = NULL;
+	switch_threadattr_t *thd_attr = NULL;
+	switch_thread_t **thread;
+	const char *err = NULL;
+
+	while ((opt = getopt(argc, argv, "c:l:t:n:r:")) != -1) {
+		switch (opt) {
+		case 'c':
+			SWITCH_GLOBAL_dirs.conf_dir = strdup(optarg);
+			break;
+		case 'l':
+			SWITCH_GLOBAL_dirs.log_dir = strdup(optarg);
+			break;
+		case 't':
+			threads = atoi(optarg);
+			break;
+		case 'n':
+			iterations = atoi(optarg);
+			break;
+		case 'r':
+			rounds = atoi(optarg);
+			break;
+		default:
+			threads = 0;
+			break;
+		}
+	}
+
+	if (threads < 1 || iterations < 1 || rounds < 1) {
+		fprintf(stderr, "usage: %s [-c conf_dir] [-l log_dir] [-t threads] [-n iterations per thread] [-r rounds]\n", argv[0]);
+		return 255;
+	}
+
+	if (switch_core_init(SCF_MINIMAL, SWITCH_FALSE, &err) != SWITCH_STATUS_SUCCESS) {
+		fprintf(stderr, "Cannot init core [%s]\n", err);
+		return 255;
+	}
+
+	switch_core_new_memory_pool(&pool);
+	switch_threadattr_create(&thd_attr, pool);
+	thread = switch_core_alloc(pool, sizeof(*thread) * threads);
+
+	for (r = 0; r < rounds; r++) {
+		switch_time_t start = switch_micro_time_now(), elapsed;
+		switch_status_t st;
+
+		for (i = 0; i < threads; i++) {
+			switch_thread_create(&thread[i], thd_attr, pool_reuse_thread, NULL, pool);
+		}
+
+		for (i = 0; i < threads; i++) {
+			switch_thread_join(&st, thread[i]);
+		}
+
+		elapsed = switch_micro_time_now() - start;
+		printf("round %d: %d threads, %.0f create/destroy per sec\n", r, threads,
+			   (double) threads * iterations * 1000000 / (elapsed ? elapsed : 1));
+	}
+
+	switch_core_destroy_memory_pool(&pool);
+	switch_core_destroy();
+
+	if (switch_atomic_read(&failures)) {
+		printf("%u failures\n", switch_atomic_read(&failures));
+		return 1;
+	}
+
+	return 0;
+}
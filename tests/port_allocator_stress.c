@@ -0,0 +1,239 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2011, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Anthony Minessale II <anthm@freeswitch.org>
+ *
+ *
+ *
+ * port_allocator_stress.c -- RTP port allocator request/free under contention
+ *
+ * The range is first drained once from a single thread to check that every
+ * port comes out once, even and in range, then freed.  It is then filled to
+ * the given percentage and left that way while the threads take and give
+ * back ports at random, so most requests have to search a nearly full
+ * range the way a loaded box does.  Every port carries an owner count that
+ * is raised when it is handed out and dropped before it is freed; a port
+ * owned twice is a failure.  Ops per second and the allocator counters are
+ * printed at the end.
+ *
+ * The core is started minimal like tone2wav; -c and -l point it at a conf
+ * tree and a writable log dir when FreeSWITCH is not installed.
+ *
+ * usage: port_allocator_stress [-c conf_dir] [-l log_dir] [-t threads] [-n ops per thread]
+ *                              [-s start_port] [-e end_port] [-f fill percent]
+ */
+
+#ifndef _XOPEN_SOURCE
+#define _XOPEN_SOURCE 600
+#endif
+
+#include <switch.h>
+
+#define PA_STRESS_THREADS 16
+#define PA_STRESS_OPS 200000
+#define PA_STRESS_START 16384
+#define PA_STRESS_END 32768
+#define PA_STRESS_FILL 90
+#define PA_STRESS_HELD 32
+
+static switch_core_port_allocator_t *alloc;
+static switch_port_t start_port = PA_STRESS_START, end_port = PA_STRESS_END;
+static int ops = PA_STRESS_OPS;
+static switch_atomic_t owners[65536];
+static switch_atomic_t failures;
+
+static void take_port(switch_port_t port)
+{
+	if (port < start_port || port > end_port || (port % 2)) {
+		switch_atomic_inc(&failures);
+	}
+	switch_atomic_inc(&owners[port]);
+}
+
+static void give_port(switch_port_t port)
+{
+	/* the count only drops to zero if nobody else was handed this port */
+	if (switch_atomic_dec(&owners[port])) {
+		switch_atomic_inc(&failures);
+	}
+
+	if (switch_core_port_allocator_free_port(alloc, port) != SWITCH_STATUS_SUCCESS) {
+		switch_atomic_inc(&failures);
+	}
+}
+
+static void *SWITCH_THREAD_FUNC port_stress_thread(switch_thread_t *thread, void *obj)
+{
+	switch_port_t held[PA_STRESS_HELD];
+	uint32_t seed = (uint32_t) (intptr_t) obj;
+	int i, nheld = 0;
+
+	for (i = 0; i < ops; i++) {
+		seed = seed * 1103515245 + 12345;
+
+		if (nheld < PA_STRESS_HELD && (!nheld || (seed >> 16) % 2)) {
+			switch_port_t port;
+
+			if (switch_core_port_allocator_request_port(alloc, &port) == SWITCH_STATUS_SUCCESS) {
+				take_port(port);
+				held[nheld++] = port;
+			}
+		} else {
+			give_port(held[--nheld]);
+		}
+	}
+
+	while (nheld) {
+		give_port(held[--nheld]);
+	}
+
+	return NULL;
+}
+
+static void print_stats(const char *what)
+{
+	switch_core_port_allocator_stats_t stats;
+
+	switch_core_port_allocator_stats(alloc, &stats);
+	printf("%s: %u-%u total %u used %u high water %u quarantined %u failed %" SWITCH_UINT64_T_FMT "\n",
+		   what, stats.start, stats.end, stats.total, stats.used, stats.high_water, stats.quarantined, stats.failed);
+}
+
+int main(int argc, char *argv[])
+{
+	int threads = PA_STRESS_THREADS, fill = PA_STRESS_FILL, i, n, opt;
+	switch_memory_pool_t *pool = NULL;
+	switch_threadattr_t *thd_attr = NULL;
+	switch_thread_t **thread;
+	switch_core_port_allocator_stats_t stats;
+	switch_time_t start, elapsed;
+	switch_status_t st;
+	switch_port_t port;
+	const char *err = NULL;
+
+	while ((opt = getopt(argc, argv, "c:l:t:n:s:e:f:")) != -1) {
+		switch (opt) {
+		case 'c':
+			SWITCH_GLOBAL_dirs.conf_dir = strdup(optarg);
+			break;
+		case 'l':
+			SWITCH_GLOBAL_dirs.log_dir = strdup(optarg);
+			break;
+		case 't':
+			threads = atoi(optarg);
+			break;
+		case 'n':
+			ops = atoi(optarg);
+			break;
+		case 's':
+			start_port = (switch_port_t) atoi(optarg);
+			break;
+		case 'e':
+			end_port = (switch_port_t) atoi(optarg);
+			break;
+		case 'f':
+			fill = atoi(optarg);
+			break;
+		default:
+			threads = 0;
+			break;
+		}
+	}
+
+	if (threads < 1 || ops < 1 || fill < 0 || fill > 100 || start_port < 2 || end_port <= start_port) {
+		fprintf(stderr, "usage: %s [-c conf_dir] [-l log_dir] [-t threads] [-n ops per thread] "
+				"[-s start_port] [-e end_port] [-f fill percent]\n", argv[0]);
+		return 255;
+	}
+
+	/* the allocator only hands out even ports, keep the checks in step */
+	start_port += start_port % 2;
+	end_port -= end_port % 2;
+
+	if (switch_core_init(SCF_MINIMAL, SWITCH_FALSE, &err) != SWITCH_STATUS_SUCCESS) {
+		fprintf(stderr, "Cannot init core [%s]\n", err);
+		return 255;
+	}
+
+	if (switch_core_port_allocator_new(start_port, end_port, SPF_EVEN, &alloc) != SWITCH_STATUS_SUCCESS) {
+		fprintf(stderr, "Cannot create port allocator\n");
+		switch_core_destroy();
+		return 255;
+	}
+
+	for (n = 0; switch_core_port_allocator_request_port(alloc, &port) == SWITCH_STATUS_SUCCESS; n++) {
+		take_port(port);
+	}
+
+	switch_core_port_allocator_stats(alloc, &stats);
+	print_stats("drained");
+
+	if ((uint32_t) n != stats.total || stats.used != stats.total) {
+		printf("drained %d ports of %u\n", n, stats.total);
+		switch_atomic_inc(&failures);
+	}
+
+	for (port = start_port; port <= end_port; port += 2) {
+		give_port(port);
+	}
+
+	for (i = 0; i < (int) (stats.total * fill / 100); i++) {
+		if (switch_core_port_allocator_request_port(alloc, &port) == SWITCH_STATUS_SUCCESS) {
+			take_port(port);
+		}
+	}
+
+	print_stats("filled");
+
+	switch_core_new_memory_pool(&pool);
+	switch_threadattr_create(&thd_attr, pool);
+	thread = switch_core_alloc(pool, sizeof(*thread) * threads);
+
+	start = switch_micro_time_now();
+
+	for (i = 0; i < threads; i++) {
+		switch_thread_create(&thread[i], thd_attr, port_stress_thread, (void *) (intptr_t) (i + 1), pool);
+	}
+
+	for (i = 0; i < threads; i++) {
+		switch_thread_join(&st, thread[i]);
+	}
+
+	elapsed = switch_micro_time_now() - start;
+
+	print_stats("contended");
+	printf("%d threads at %d%% full, %.0f ops per sec\n", threads, fill, (double) threads * ops * 1000000 / (elapsed ? elapsed : 1));
+
+	switch_core_port_allocator_destroy(&alloc);
+	switch_core_destroy_memory_pool(&pool);
+	switch_core_destroy();
+
+	if (switch_atomic_read(&failures)) {
+		printf("%u failures\n", switch_atomic_read(&failures));
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,340 @@
+/*
+ * FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ * Copyright (C) 2005-2011, Anthony Minessale II <anthm@freeswitch.org>
+ *
+ * Version: MPL 1.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is FreeSWITCH Modular Media Switching Software Library / Soft-Switch Application
+ *
+ * The Initial Developer of the Original Code is
+ * Anthony Minessale II <anthm@freeswitch.org>
+ * Portions created by the Initial Developer are Copyright (C)
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Anthony Minessale II <anthm@freeswitch.org>
+ *
+ *
+ * sip_register_bench.c -- drive authenticated REGISTERs at a sofia profile
+ *
+ * A pool of UDP clients register against a running profile.  Each client
+ * is challenged once and then keeps reusing its nonce with qop=auth and an
+ * increasing nc, so after warm up every request is a nonce lookup plus an
+ * nc update and nothing else: that is the path nonce-store=memory takes out
+ * of the database.  A stale or unknown nonce is answered with a fresh
+ * challenge and the client simply picks it up.
+ *
+ * Requests are paced to the target rate (default 20000/s); every second the
+ * 200 OK rate, challenges, other replies, timeouts and mean latency are
+ * printed.  The users must exist in the directory with the same password,
+ * e.g. the default 1000-1019/1234.
+ *
+ * usage: sip_register_bench [-h host] [-p port] [-d domain] [-u first_user] [-U users]
+ *                           [-w password] [-c clients] [-r rate] [-t seconds] [-e expires] [-l local_ip]
+ */
+
+#ifndef _XOPEN_SOURCE
+#define _XOPEN_SOURCE 600
+#endif
+
+#include <switch.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/time.h>
+
+#define REG_BENCH_TIMEOUT_US 2000000
+
+typedef struct {
+	char call_id[64];
+	char tag[16];
+	char user[32];
+	char realm[128];
+	char nonce[128];
+	uint32_t cseq;
+	uint32_t nc;
+	int64_t sent;
+} reg_client_t;
+
+typedef struct {
+	uint64_t sent;
+	uint64_t ok;
+	uint64_t challenged;
+	uint64_t other;
+	uint64_t timeouts;
+	uint64_t latency_us;
+} reg_stats_t;
+
+static int64_t now_us(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (int64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static void md5_hex(char out[SWITCH_MD5_DIGEST_STRING_SIZE], const char *in)
+{
+	switch_md5_string(out, in, strlen(in));
+}
+
+/* copy the quoted value of name="..." out of a header */
+static int get_param(const char *hdr, const char *name, char *out, size_t outlen)
+{
+	char key[64];
+	const char *p, *e;
+
+	switch_snprintf(key, sizeof(key), "%s=\"", name);
+
+	if (!(p = strstr(hdr, key))) {
+		return 0;
+	}
+	p += strlen(key);
+	if (!(e = strchr(p, '"')) || (size_t) (e - p) >= outlen) {
+		return 0;
+	}
+	memcpy(out, p, e - p);
+	out[e - p] = '\0';
+
+	return 1;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *host = "127.0.0.1", *domain = NULL, *password = "1234", *local_ip = "127.0.0.1";
+	int port = 5060, first_user = 1000, users = 20, nclients = 2000, rate = 20000, seconds = 10, expires = 3600;
+	reg_client_t *clients;
+	reg_stats_t total = { 0 }, sec = { 0 };
+	struct sockaddr_in dst, src;
+	socklen_t slen = sizeof(src);
+	int sock, opt, bufsize = 4 * 1024 * 1024, next = 0, i;
+	int64_t start, last_report, last_sweep;
+	char buf[4096], msg[2048], auth[768];
+
+	while ((opt = getopt(argc, argv, "h:p:d:u:U:w:c:r:t:e:l:")) != -1) {
+		switch (opt) {
+		case 'h': host = optarg; break;
+		case 'p': port = atoi(optarg); break;
+		case 'd': domain = optarg; break;
+		case 'u': first_user = atoi(optarg); break;
+		case 'U': users = atoi(optarg); break;
+		case 'w': password = optarg; break;
+		case 'c': nclients = atoi(optarg); break;
+		case 'r': rate = atoi(optarg); break;
+		case 't': seconds = atoi(optarg); break;
+		case 'e': expires = atoi(optarg); break;
+		case 'l': local_ip = optarg; break;
+		default:
+			fprintf(stderr, "usage: %s [-h host] [-p port] [-d domain] [-u first_user] [-U users] [-w password]\n"
+					"          [-c clients] [-r rate] [-t seconds] [-e expires] [-l local_ip]\n", argv[0]);
+			return 255;
+		}
+	}
+
+	if (!domain) {
+		domain = host;
+	}
+
+	if (nclients < 1 || users < 1 || rate < 1 || seconds < 1) {
+		fprintf(stderr, "clients, users, rate and seconds must be positive\n");
+		return 255;
+	}
+
+	memset(&dst, 0, sizeof(dst));
+	dst.sin_family = AF_INET;
+	dst.sin_port = htons((uint16_t) port);
+	if (inet_pton(AF_INET, host, &dst.sin_addr) != 1) {
+		fprintf(stderr, "bad host %s\n", host);
+		return 255;
+	}
+
+	memset(&src, 0, sizeof(src));
+	src.sin_family = AF_INET;
+	inet_pton(AF_INET, local_ip, &src.sin_addr);
+
+	if ((sock = socket(AF_INET, SOCK_DGRAM, 0)) < 0 || bind(sock, (struct sockaddr *) &src, sizeof(src)) < 0 ||
+		getsockname(sock, (struct sockaddr *) &src, &slen) < 0) {
+		perror("socket");
+		return 255;
+	}
+	setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize));
+	setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof(bufsize));
+
+	clients = calloc(nclients, sizeof(*clients));
+	switch_assert(clients);
+	srand((unsigned) now_us());
+
+	for (i = 0; i < nclients; i++) {
+		switch_snprintf(clients[i].call_id, sizeof(clients[i].call_id), "regbench-%d-%x", i, rand());
+		switch_snprintf(clients[i].tag, sizeof(clients[i].tag), "%x", rand());
+		switch_snprintf(clients[i].user, sizeof(clients[i].user), "%d", first_user + i % users);
+	}
+
+	printf("%d clients, %d users, target %d REGISTER/s for %ds at %s:%d\n", nclients, users, rate, seconds, host, port);
+
+	start = last_report = last_sweep = now_us();
+
+	for (;;) {
+		int64_t now = now_us();
+		uint64_t due = (uint64_t) ((now - start) * (double) rate / 1000000);
+		struct pollfd pfd = { sock, POLLIN, 0 };
+		ssize_t len;
+
+		if (now - start >= (int64_t) seconds * 1000000) {
+			break;
+		}
+
+		/* pace sends, but only from clients with nothing in flight */
+		while (total.sent < due) {
+			reg_client_t *c = NULL;
+			int tries;
+
+			for (tries = 0; tries < nclients; tries++) {
+				reg_client_t *x = &clients[next];
+
+				next = (next + 1) % nclients;
+				if (!x->sent) {
+					c = x;
+					break;
+				}
+			}
+
+			if (!c) {
+				break;
+			}
+
+			*auth = '\0';
+			if (*c->nonce) {
+				char a1_src[256], a2_src[256], r_src[512], cnonce[16];
+				char ha1[SWITCH_MD5_DIGEST_STRING_SIZE], ha2[SWITCH_MD5_DIGEST_STRING_SIZE], resp[SWITCH_MD5_DIGEST_STRING_SIZE];
+
+				c->nc++;
+				switch_snprintf(cnonce, sizeof(cnonce), "%x", rand());
+				switch_snprintf(a1_src, sizeof(a1_src), "%s:%s:%s", c->user, c->realm, password);
+				switch_snprintf(a2_src, sizeof(a2_src), "REGISTER:sip:%s", domain);
+				md5_hex(ha1, a1_src);
+				md5_hex(ha2, a2_src);
+				switch_snprintf(r_src, sizeof(r_src), "%s:%s:%08x:%s:auth:%s", ha1, c->nonce, c->nc, cnonce, ha2);
+				md5_hex(resp, r_src);
+				switch_snprintf(auth, sizeof(auth),
+								"Authorization: Digest username=\"%s\", realm=\"%s\", nonce=\"%s\", uri=\"sip:%s\", "
+								"response=\"%s\", algorithm=MD5, qop=auth, nc=%08x, cnonce=\"%s\"\r\n",
+								c->user, c->realm, c->nonce, domain, resp, c->nc, cnonce);
+			}
+
+			switch_snprintf(msg, sizeof(msg),
+							"REGISTER sip:%s SIP/2.0\r\n"
+							"Via: SIP/2.0/UDP %s:%d;rport;branch=z9hG4bK%x%x\r\n"
+							"Max-Forwards: 70\r\n"
+							"From: <sip:%s@%s>;tag=%s\r\n"
+							"To: <sip:%s@%s>\r\n"
+							"Call-ID: %s\r\n"
+							"CSeq: %u REGISTER\r\n"
+							"Contact: <sip:%s@%s:%d>\r\n"
+							"Expires: %d\r\n"
+							"%s"
+							"Content-Length: 0\r\n\r\n",
+							domain, local_ip, ntohs(src.sin_port), rand(), rand(),
+							c->user, domain, c->tag, c->user, domain, c->call_id, ++c->cseq,
+							c->user, local_ip, ntohs(src.sin_port), expires, auth);
+
+			if (sendto(sock, msg, strlen(msg), 0, (struct sockaddr *) &dst, sizeof(dst)) < 0) {
+				break;
+			}
+
+			c->sent = now;
+			total.sent++;
+			sec.sent++;
+		}
+
+		if (poll(&pfd, 1, 1) <= 0) {
+			goto housekeeping;
+		}
+
+		while ((len = recv(sock, buf, sizeof(buf) - 1, MSG_DONTWAIT)) > 0) {
+			reg_client_t *c;
+			const char *p;
+			int code, idx;
+
+			buf[len] = '\0';
+
+			if (strncmp(buf, "SIP/2.0 ", 8) || !(p = strstr(buf, "\r\nCall-ID: regbench-")) || sscanf(p + 20, "%d", &idx) != 1 ||
+				idx < 0 || idx >= nclients) {
+				continue;
+			}
+
+			code = atoi(buf + 8);
+			c = &clients[idx];
+
+			if (code < 200 || !c->sent) {
+				continue;
+			}
+
+			if (code == 200) {
+				total.ok++;
+				sec.ok++;
+				total.latency_us += now_us() - c->sent;
+				sec.latency_us += now_us() - c->sent;
+			} else if (code == 401 && (p = strstr(buf, "WWW-Authenticate:")) &&
+					   get_param(p, "nonce", c->nonce, sizeof(c->nonce)) && get_param(p, "realm", c->realm, sizeof(c->realm))) {
+				c->nc = 0;
+				total.challenged++;
+				sec.challenged++;
+			} else {
+				*c->nonce = '\0';
+				total.other++;
+				sec.other++;
+			}
+
+			c->sent = 0;
+		}
+
+	  housekeeping:
+
+		now = now_us();
+
+		if (now - last_sweep >= 100000) {
+			for (i = 0; i < nclients; i++) {
+				if (clients[i].sent && now - clients[i].sent > REG_BENCH_TIMEOUT_US) {
+					clients[i].sent = 0;
+					*clients[i].nonce = '\0';
+					total.timeouts++;
+					sec.timeouts++;
+				}
+			}
+			last_sweep = now;
+		}
+
+		if (now - last_report >= 1000000) {
+			printf("sent %" SWITCH_UINT64_T_FMT " ok %" SWITCH_UINT64_T_FMT " challenged %" SWITCH_UINT64_T_FMT
+				   " other %" SWITCH_UINT64_T_FMT " timeout %" SWITCH_UINT64_T_FMT " latency %.2fms\n",
+				   sec.sent, sec.ok, sec.challenged, sec.other, sec.timeouts, sec.ok ? sec.latency_us / 1000.0 / sec.ok : 0);
+			fflush(stdout);
+			memset(&sec, 0, sizeof(sec));
+			last_report = now;
+		}
+	}
+
+	printf("total: sent %" SWITCH_UINT64_T_FMT " ok %" SWITCH_UINT64_T_FMT " challenged %" SWITCH_UINT64_T_FMT
+		   " other %" SWITCH_UINT64_T_FMT " timeout %" SWITCH_UINT64_T_FMT "\n",
+		   total.sent, total.ok, total.challenged, total.other, total.timeouts);
+	printf("%.0f authenticated REGISTER/s (target %d), mean latency %.2fms\n",
+		   total.ok / ((now_us() - start) / 1000000.0), rate, total.ok ? total.latency_us / 1000.0 / total.ok : 0);
+
+	close(sock);
+	free(clients);
+
+	return total.ok ? 0 : 1;
+}